@@ -29,8 +29,17 @@ typedef enum {
   CBOR_SIZE_INDEFINITE = 31,
 } cbor_size_type_t;
 
+// hands a full encoder buffer to the sink, the encoder then continues from the start of the buffer
+typedef void (*cbor_flush_fn_t)(const uint8_t *data, uint32_t len, void *priv);
+
 typedef struct {
   uint8_t *start, *curr, *end;
+
+  cbor_flush_fn_t flush;
+  void *priv;
+
+  // not used by the codec itself, lets callers pass encoding options down to nested encoders
+  uint32_t flags;
 } cbor_value_t;
 
 typedef struct {
@@ -72,6 +81,8 @@ cbor_result_t cbor_decode_bool(cbor_value_t *dec, bool *val);
 
 void cbor_encoder_init(cbor_value_t *enc, uint8_t *data, uint32_t len);
 uint32_t cbor_encoder_len(cbor_value_t *enc);
+void cbor_encoder_set_flush(cbor_value_t *enc, cbor_flush_fn_t flush, void *priv);
+cbor_result_t cbor_encoder_flush(cbor_value_t *enc);
 
 cbor_result_t cbor_encode_array(cbor_value_t *enc, uint32_t len);
 cbor_result_t cbor_encode_map(cbor_value_t *enc, uint32_t len);
@@ -12,11 +12,22 @@
 void cbor_decoder_init(cbor_value_t *dec, uint8_t *data, uint32_t len) {
   dec->start = dec->curr = data;
   dec->end = dec->start + len;
+  dec->flush = NULL;
+  dec->priv = NULL;
+  dec->flags = 0;
 }
 
 void cbor_encoder_init(cbor_value_t *enc, uint8_t *data, uint32_t len) {
   enc->start = enc->curr = data;
   enc->end = enc->start + len;
+  enc->flush = NULL;
+  enc->priv = NULL;
+  enc->flags = 0;
+}
+
+void cbor_encoder_set_flush(cbor_value_t *enc, cbor_flush_fn_t flush, void *priv) {
+  enc->flush = flush;
+  enc->priv = priv;
 }
 
 static int32_t _cbor_remaining(cbor_value_t *dec) {
@@ -27,6 +38,50 @@ uint32_t cbor_encoder_len(cbor_value_t *enc) {
   return (uint32_t)(enc->curr - enc->start);
 }
 
+cbor_result_t cbor_encoder_flush(cbor_value_t *enc) {
+  if (enc->flush == NULL) {
+    return CBOR_ERR_EOF;
+  }
+  if (enc->curr != enc->start) {
+    enc->flush(enc->start, cbor_encoder_len(enc), enc->priv);
+    enc->curr = enc->start;
+  }
+  return CBOR_OK;
+}
+
+// makes sure the next size bytes fit, flushing the buffer if the encoder has a sink
+static cbor_result_t _cbor_encode_ensure(cbor_value_t *enc, uint32_t size) {
+  if ((enc->curr + size) < enc->end) {
+    return CBOR_OK;
+  }
+  if (enc->flush == NULL || enc->curr == enc->start) {
+    return CBOR_ERR_EOF;
+  }
+  cbor_encoder_flush(enc);
+  if ((enc->curr + size) < enc->end) {
+    return CBOR_OK;
+  }
+  return CBOR_ERR_EOF;
+}
+
+// payloads may be larger than the whole buffer, with a sink they are split across flushes
+static cbor_result_t _cbor_encode_bytes(cbor_value_t *enc, const uint8_t *buf, uint32_t len) {
+  while (enc->flush != NULL && enc->end > enc->start && (uint32_t)_cbor_remaining(enc) < len) {
+    const uint32_t size = (uint32_t)_cbor_remaining(enc);
+    memcpy(enc->curr, buf, size);
+    enc->curr += size;
+    buf += size;
+    len -= size;
+    cbor_encoder_flush(enc);
+  }
+  if ((uint32_t)_cbor_remaining(enc) < len) {
+    return CBOR_ERR_EOF;
+  }
+  memcpy(enc->curr, buf, len);
+  enc->curr += len;
+  return CBOR_OK;
+}
+
 static cbor_result_t _cbor_decode_type(uint8_t v) {
   return (v & CBOR_TYPE_MASK) >> CBOR_TYPE_OFFSET;
 }
@@ -108,20 +163,20 @@ static cbor_result_t _cbor_decode_raw(cbor_value_t *dec, uint8_t *val, uint8_t m
 
 static cbor_result_t _cbor_encode_raw(cbor_value_t *enc, cbor_major_type_t type, const uint8_t *val, cbor_size_type_t max) {
   uint8_t byte_len = max;
-  if ((enc->curr + 1) >= enc->end) {
-    return CBOR_ERR_EOF;
-  }
   if (max == CBOR_SIZE_BYTE && *val < CBOR_SIZE_BYTE) {
+    if (_cbor_encode_ensure(enc, 1) < CBOR_OK) {
+      return CBOR_ERR_EOF;
+    }
     *enc->curr++ = (uint8_t)((type << CBOR_TYPE_OFFSET) | (*val & CBOR_VALUE_MASK));
     return 1;
   }
 
-  *enc->curr++ = (uint8_t)((type << CBOR_TYPE_OFFSET) | (byte_len & CBOR_VALUE_MASK));
-
   uint8_t size = (uint8_t)(1 << (max - CBOR_SIZE_BYTE));
-  if ((enc->curr + size) >= enc->end) {
+  if (_cbor_encode_ensure(enc, 1 + size) < CBOR_OK) {
     return CBOR_ERR_EOF;
   }
+
+  *enc->curr++ = (uint8_t)((type << CBOR_TYPE_OFFSET) | (byte_len & CBOR_VALUE_MASK));
   for (uint32_t i = 0; i < size; i++) {
     enc->curr[size - i - 1] = val[i];
   }
@@ -496,21 +551,21 @@ cbor_result_t cbor_encode_map(cbor_value_t *enc, uint32_t len) {
   return res;
 }
 cbor_result_t cbor_encode_array_indefinite(cbor_value_t *enc) {
-  if ((enc->curr + 1) >= enc->end) {
+  if (_cbor_encode_ensure(enc, 1) < CBOR_OK) {
     return CBOR_ERR_EOF;
   }
   *enc->curr++ = (uint8_t)((CBOR_TYPE_ARRAY << CBOR_TYPE_OFFSET) | (CBOR_SIZE_INDEFINITE & CBOR_VALUE_MASK));
   return CBOR_OK;
 }
 cbor_result_t cbor_encode_map_indefinite(cbor_value_t *enc) {
-  if ((enc->curr + 1) >= enc->end) {
+  if (_cbor_encode_ensure(enc, 1) < CBOR_OK) {
     return CBOR_ERR_EOF;
   }
   *enc->curr++ = (uint8_t)((CBOR_TYPE_MAP << CBOR_TYPE_OFFSET) | (CBOR_SIZE_INDEFINITE & CBOR_VALUE_MASK));
   return CBOR_OK;
 }
 cbor_result_t cbor_encode_end_indefinite(cbor_value_t *enc) {
-  if ((enc->curr + 1) >= enc->end) {
+  if (_cbor_encode_ensure(enc, 1) < CBOR_OK) {
     return CBOR_ERR_EOF;
   }
   *enc->curr++ = (uint8_t)((CBOR_TYPE_FLOAT << CBOR_TYPE_OFFSET) | (CBOR_SIZE_INDEFINITE & CBOR_VALUE_MASK));
@@ -558,12 +613,11 @@ cbor_result_t cbor_encode_bstr(cbor_value_t *enc, const uint8_t *buf, uint32_t l
   if (res < CBOR_OK) {
     return res;
   }
-  if ((uint32_t)_cbor_remaining(enc) < len) {
-    return CBOR_ERR_EOF;
-  }
   if (res > 0) {
-    memcpy(enc->curr, buf, len);
-    enc->curr += len;
+    const cbor_result_t bytes = _cbor_encode_bytes(enc, buf, len);
+    if (bytes < CBOR_OK) {
+      return bytes;
+    }
   }
   return res;
 }
@@ -579,12 +633,11 @@ cbor_result_t cbor_encode_tstr(cbor_value_t *enc, const uint8_t *buf, uint32_t l
   if (res < CBOR_OK) {
     return res;
   }
-  if ((uint32_t)_cbor_remaining(enc) < len) {
-    return CBOR_ERR_EOF;
-  }
   if (res > 0) {
-    memcpy(enc->curr, buf, len);
-    enc->curr += len;
+    const cbor_result_t bytes = _cbor_encode_bytes(enc, buf, len);
+    if (bytes < CBOR_OK) {
+      return bytes;
+    }
   }
   return res;
 }
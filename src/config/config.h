@@ -199,6 +199,10 @@
 // #define THROTTLE_BOOST 7.0  // can cause thrust imbalances if too high
 // #define TORQUE_BOOST 1.0    // EXPERIMENTAL - can damage motors!
 
+// ---- MOTOR OUTPUT LINEARISATION ----
+// #define THRUST_LINEAR 30.0           // percent of quadratic thrust to flatten out
+// #define VBAT_SAG_COMPENSATION 100.0  // percent of battery sag to scale out of the outputs
+
 // ---- BRUSHED MOTOR MIXER ----
 // #define MIX_THROTTLE_REDUCTION_PERCENT 10
 // #define MIX_THROTTLE_INCREASE_MAX 0.2f
@@ -255,6 +259,7 @@
 // #define DEBUG_LOGGING
 // #define RESET_ON_FAULT
 // #define BLACKBOX_DEBUG_FLAGS BBOX_DEBUG_DYN_NOTCH
+// #define BLACKBOX_DEBUG_FLAGS BBOX_DEBUG_GYRO_BIAS
 
 // ---- DEBUG PINS ----
 // Define pins for debugging with logic analyzer or oscilloscope
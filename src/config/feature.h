@@ -6,15 +6,17 @@
 #define USE_BLACKBOX
 #define USE_ADC
 
+// spi devices, the simulator backs them with emulated chips
+#define USE_SDCARD
+#define USE_DATA_FLASH
+#define USE_MAX7456
+
 #ifndef SIMULATOR
 #define USE_GYRO
 #define USE_SOFT_SERIAL
-#define USE_SDCARD
-#define USE_DATA_FLASH
 
 #define USE_VTX
 #define USE_DIGITAL_VTX
-#define USE_MAX7456
 #define USE_RGB_LED
 
 #define USE_MOTOR_DSHOT
@@ -25,4 +27,9 @@
 #define USE_RX_SPI_FLYSKY
 #define USE_RX_SPI_EXPRESS_LRS
 #endif
+#endif
+
+// the simulator talks to an emulated esc bootloader
+#if defined(USE_MOTOR_DSHOT) || defined(SIMULATOR)
+#define USE_SERIAL_4WAY
 #endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "core/boot_profile.h"
+
+#include <string.h>
+
+#include "util/cbor_helper.h"
+
+boot_profile_t boot_profile;
+
+void boot_profile_start() {
+  memset(&boot_profile, 0, sizeof(boot_profile_t));
+  boot_profile.active = true;
+  boot_profile.start_us = time_micros();
+}
+
+// stages are only recorded while booting, later calls of the same inits are ignored
+void boot_profile_record(const char *name, uint32_t start_us) {
+  if (!boot_profile.active || boot_profile.stage_count >= BOOT_PROFILE_STAGES_MAX) {
+    return;
+  }
+
+  boot_stage_t *stage = &boot_profile.stages[boot_profile.stage_count++];
+  stage->name = name;
+  stage->time_us = time_micros() - start_us;
+}
+
+void boot_profile_finish() {
+  if (!boot_profile.active) {
+    return;
+  }
+  boot_profile.active = false;
+  boot_profile.total_us = time_micros() - boot_profile.start_us;
+}
+
+cbor_result_t cbor_encode_boot_profile(cbor_value_t *enc) {
+  CBOR_CHECK_ERROR(cbor_result_t res = cbor_encode_map_indefinite(enc));
+
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "total"));
+  CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &boot_profile.total_us));
+
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "stages"));
+  CBOR_CHECK_ERROR(res = cbor_encode_array(enc, boot_profile.stage_count));
+  for (uint32_t i = 0; i < boot_profile.stage_count; i++) {
+    CBOR_CHECK_ERROR(res = cbor_encode_map_indefinite(enc));
+
+    CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "name"));
+    CBOR_CHECK_ERROR(res = cbor_encode_str(enc, boot_profile.stages[i].name));
+
+    CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "time"));
+    CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &boot_profile.stages[i].time_us));
+
+    CBOR_CHECK_ERROR(res = cbor_encode_end_indefinite(enc));
+  }
+
+  CBOR_CHECK_ERROR(res = cbor_encode_end_indefinite(enc));
+  return res;
+}
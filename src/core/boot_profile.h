@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cbor.h>
+
+#include "driver/time.h"
+
+#define BOOT_PROFILE_STAGES_MAX 24
+
+typedef struct {
+  const char *name;
+  uint32_t time_us;
+} boot_stage_t;
+
+typedef struct {
+  bool active;
+  uint32_t start_us;
+  uint32_t total_us;
+
+  uint32_t stage_count;
+  boot_stage_t stages[BOOT_PROFILE_STAGES_MAX];
+} boot_profile_t;
+
+extern boot_profile_t boot_profile;
+
+void boot_profile_start();
+void boot_profile_record(const char *name, uint32_t start_us);
+void boot_profile_finish();
+
+cbor_result_t cbor_encode_boot_profile(cbor_value_t *enc);
+
+// runs an init call and records how long it took
+#define boot_stage(name, call)                   \
+  {                                              \
+    const uint32_t _stage_start = time_micros(); \
+    call;                                        \
+    boot_profile_record(name, _stage_start);     \
+  }
@@ -1,8 +1,10 @@
 #include "core/flash.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "core/boot_profile.h"
 #include "core/failloop.h"
 #include "core/profile.h"
 #include "core/project.h"
@@ -11,6 +13,78 @@
 #include "io/vtx.h"
 #include "rx/rx.h"
 #include "util/cbor_helper.h"
+#include "util/crc.h"
+
+// config is stored as an append only journal of records, the last valid record of a blob wins.
+// once the active bank is full a snapshot of every blob is written to the next bank.
+
+#define FLASH_RECORD_MAGIC 0xC0F1
+
+#define FLASH_BANK_HEADER_SIZE FLASH_ALIGN(sizeof(flash_bank_header_t))
+#define FLASH_RECORD_HEADER_SIZE FLASH_ALIGN(sizeof(flash_record_t))
+#define FLASH_RECORD_SIZE(size) FLASH_ALIGN(FLASH_RECORD_HEADER_SIZE + (size))
+// the profile is the largest record
+#define FLASH_RECORD_MAX FLASH_RECORD_SIZE(PROFILE_STORAGE_SIZE)
+
+// blobs added with the journal have no fixed layout location to migrate from
+#define FLASH_OFFSET_NONE 0xFFFFFFFF
+
+typedef enum {
+  FLASH_BLOB_TARGET,
+  FLASH_BLOB_STORAGE,
+  FLASH_BLOB_BIND,
+  FLASH_BLOB_PROFILE,
+#ifdef USE_VTX
+  FLASH_BLOB_VTX,
+#endif
+  FLASH_BLOB_PROFILE_IMAGE,
+  FLASH_BLOB_MAX,
+} flash_blob_id_t;
+
+// magic comes last, a half programmed header never looks valid
+typedef struct {
+  uint32_t seq;
+  uint32_t magic;
+} flash_bank_header_t;
+
+typedef struct {
+  uint16_t magic;
+  uint16_t id;
+  uint16_t size;
+  uint16_t _padding;
+  uint32_t crc;
+} flash_record_t;
+
+// native copy of the decoded profile, only valid for the build and the target and profile records it was taken from
+typedef struct {
+  uint32_t version;
+  uint32_t build_crc;
+  uint32_t size;
+  uint32_t target_crc;
+  uint32_t profile_crc;
+} flash_profile_image_t;
+
+// encoders return the payload size, 0 on failure. decoders get NULL if the blob was never saved.
+typedef uint32_t (*flash_encode_fn_t)(uint8_t *data, uint32_t size);
+typedef void (*flash_decode_fn_t)(uint8_t *data, uint32_t size);
+
+typedef struct {
+  uint32_t offset;
+  uint32_t size;
+  flash_encode_fn_t encode;
+  flash_decode_fn_t decode;
+} flash_blob_t;
+
+typedef struct {
+  bool valid;
+  uint32_t bank;
+  uint32_t seq;
+  uint32_t head;
+  bool dirty;
+
+  uint32_t offset[FLASH_BLOB_MAX];
+  flash_record_t records[FLASH_BLOB_MAX];
+} flash_journal_t;
 
 extern const profile_t default_profile;
 extern profile_t profile;
@@ -18,6 +92,8 @@ extern profile_t profile;
 flash_storage_t flash_storage;
 rx_bind_storage_t bind_storage;
 
+static flash_journal_t journal;
+
 CBOR_START_STRUCT_ENCODER(rx_bind_storage_t)
 CBOR_ENCODE_MEMBER(bind_saved, uint8_t)
 CBOR_ENCODE_BSTR_MEMBER(raw, BIND_RAW_STORAGE_SIZE)
@@ -28,169 +104,426 @@ CBOR_DECODE_MEMBER(bind_saved, uint8_t)
 CBOR_DECODE_BSTR_MEMBER(raw, BIND_RAW_STORAGE_SIZE)
 CBOR_END_STRUCT_DECODER()
 
-static void flash_write_magic(uint8_t *data, uint32_t magic) {
-  *((uint32_t *)data) = magic;
+static uint32_t flash_encode_target(uint8_t *data, uint32_t size) {
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, data, size);
+
+  cbor_result_t res = cbor_encode_target_t(&enc, &target);
+  if (res < CBOR_OK) {
+    return 0;
+  }
+  return cbor_encoder_len(&enc);
 }
 
-static bool flash_compare_magic(uint32_t addr, uint32_t magic) {
-  return ((uint32_t)fmc_read(addr)) == magic;
+static void flash_decode_target(uint8_t *data, uint32_t size) {
+  if (data == NULL) {
+    return;
+  }
+
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, data, size);
+
+  cbor_result_t res = cbor_decode_target_t(&dec, &target);
+  if (res < CBOR_OK) {
+    failloop(FAILLOOP_FAULT);
+  }
 }
 
-void flash_save() {
-  rx_stop();
+static uint32_t flash_encode_storage(uint8_t *data, uint32_t size) {
+  memcpy(data, (uint8_t *)&flash_storage, sizeof(flash_storage_t));
+  return sizeof(flash_storage_t);
+}
 
-  __disable_irq();
+static void flash_decode_storage(uint8_t *data, uint32_t size) {
+  if (data == NULL) {
+    return;
+  }
+  memcpy((uint8_t *)&flash_storage, data, min(size, sizeof(flash_storage_t)));
+  if (size < sizeof(flash_storage_t) || flash_storage.gyro_cal.magic != GYRO_CAL_MAGIC) {
+    // older storage had no model, whatever followed the accel calibration is not one
+    gyro_cal_reset(&flash_storage.gyro_cal);
+  }
+}
 
-  uint8_t *buffer = (uint8_t *)malloc(PROFILE_STORAGE_SIZE);
-  if (buffer == NULL) {
+static uint32_t flash_encode_bind(uint8_t *data, uint32_t size) {
+  if (bind_storage.bind_saved == 0) {
+    // reset all bind data
+    memset(bind_storage.raw, 0, BIND_RAW_STORAGE_SIZE);
+  }
+
+  memcpy(data, (uint8_t *)&bind_storage, sizeof(rx_bind_storage_t));
+  return sizeof(rx_bind_storage_t);
+}
+
+static void flash_decode_bind(uint8_t *data, uint32_t size) {
+  if (data != NULL) {
+    memcpy((uint8_t *)&bind_storage, data, min(size, sizeof(rx_bind_storage_t)));
+    return;
+  }
+
+#ifdef EXPRESS_LRS_UID
+  const uint8_t uid[6] = {EXPRESS_LRS_UID};
+  bind_storage.bind_saved = 1;
+
+  bind_storage.elrs.is_set = 0x1;
+  bind_storage.elrs.magic = 0x37;
+  memcpy(bind_storage.elrs.uid, uid, 6);
+#endif
+}
+
+static uint32_t flash_encode_profile(uint8_t *data, uint32_t size) {
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, data, size);
+
+  cbor_result_t res = cbor_encode_profile_t(&enc, &profile);
+  if (res < CBOR_OK) {
+    return 0;
+  }
+  return cbor_encoder_len(&enc);
+}
+
+static void flash_decode_profile(uint8_t *data, uint32_t size) {
+  profile_set_defaults();
+
+  if (data == NULL) {
+    return;
+  }
+
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, data, size);
+
+  cbor_result_t res = cbor_decode_profile_t(&dec, &profile);
+  if (res < CBOR_OK) {
     failloop(FAILLOOP_FAULT);
   }
+}
 
-  fmc_unlock();
-  fmc_erase();
+#ifdef USE_VTX
+static uint32_t flash_encode_vtx(uint8_t *data, uint32_t size) {
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, data, size);
+
+  cbor_result_t res = cbor_encode_vtx_settings_t(&enc, &vtx_settings);
+  if (res < CBOR_OK) {
+    return 0;
+  }
+  return cbor_encoder_len(&enc);
+}
+
+static void flash_decode_vtx(uint8_t *data, uint32_t size) {
+  if (data == NULL) {
+    return;
+  }
+
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, data, size);
+
+  cbor_result_t res = cbor_decode_vtx_settings_t(&dec, &vtx_settings);
+  if (res < CBOR_OK) {
+    failloop(FAILLOOP_FAULT);
+  }
+}
+#endif
+
+static uint32_t flash_profile_image_build_crc() {
+  return crc32_data(0, (const uint8_t *)target_info.git_version, strlen(target_info.git_version));
+}
+
+// written after the profile record, so the image can refer to the record crcs
+static uint32_t flash_encode_profile_image(uint8_t *data, uint32_t size) {
+  flash_profile_image_t *image = (flash_profile_image_t *)data;
+  image->version = PROFILE_VERSION;
+  image->build_crc = flash_profile_image_build_crc();
+  image->size = sizeof(profile_t);
+  image->target_crc = journal.records[FLASH_BLOB_TARGET].crc;
+  image->profile_crc = journal.records[FLASH_BLOB_PROFILE].crc;
+
+  memcpy(data + sizeof(flash_profile_image_t), (uint8_t *)&profile, sizeof(profile_t));
+  return sizeof(flash_profile_image_t) + sizeof(profile_t);
+}
+
+// loaded by flash_load_profile_image in place of the profile record instead
+static void flash_decode_profile_image(uint8_t *data, uint32_t size) {}
+
+// decoded in this order, the profile defaults depend on the target
+static const flash_blob_t flash_blobs[FLASH_BLOB_MAX] = {
+    [FLASH_BLOB_TARGET] = {TARGET_STORAGE_OFFSET, TARGET_STORAGE_SIZE, flash_encode_target, flash_decode_target},
+    [FLASH_BLOB_STORAGE] = {FLASH_STORAGE_OFFSET, FLASH_STORAGE_SIZE, flash_encode_storage, flash_decode_storage},
+    [FLASH_BLOB_BIND] = {BIND_STORAGE_OFFSET, BIND_STORAGE_SIZE, flash_encode_bind, flash_decode_bind},
+    [FLASH_BLOB_PROFILE] = {PROFILE_STORAGE_OFFSET, PROFILE_STORAGE_SIZE, flash_encode_profile, flash_decode_profile},
+#ifdef USE_VTX
+    [FLASH_BLOB_VTX] = {VTX_STORAGE_OFFSET, VTX_STORAGE_SIZE, flash_encode_vtx, flash_decode_vtx},
+#endif
+    [FLASH_BLOB_PROFILE_IMAGE] = {FLASH_OFFSET_NONE, PROFILE_IMAGE_STORAGE_SIZE, flash_encode_profile_image, flash_decode_profile_image},
+};
+
+_Static_assert(FLASH_BANK_HEADER_SIZE + FLASH_RECORD_SIZE(TARGET_STORAGE_SIZE) + FLASH_RECORD_SIZE(FLASH_STORAGE_SIZE) + FLASH_RECORD_SIZE(BIND_STORAGE_SIZE) + FLASH_RECORD_SIZE(PROFILE_STORAGE_SIZE) + FLASH_RECORD_SIZE(VTX_STORAGE_SIZE) <= FMC_BANK_SIZE, "config snapshot does not fit a flash bank");
+_Static_assert(TARGET_STORAGE_SIZE <= PROFILE_STORAGE_SIZE && PROFILE_IMAGE_STORAGE_SIZE <= PROFILE_STORAGE_SIZE, "flash record buffer is too small");
+_Static_assert(sizeof(flash_profile_image_t) + sizeof(profile_t) <= PROFILE_IMAGE_STORAGE_SIZE - FMC_MAGIC_SIZE, "profile image does not fit its record");
+
+static uint32_t flash_record_crc(const flash_record_t *rec, const uint8_t *data) {
+  const uint32_t crc = crc32_data(0, (const uint8_t *)rec, offsetof(flash_record_t, crc));
+  return crc32_data(crc, data, rec->size);
+}
 
-  {
-    memset(buffer, 0, TARGET_STORAGE_SIZE);
-    flash_write_magic(buffer, FMC_MAGIC | TARGET_STORAGE_OFFSET);
+static bool flash_is_erased(const uint8_t *data, uint32_t size) {
+  for (uint32_t i = 0; i < size; i++) {
+    if (data[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
 
-    cbor_value_t enc;
-    cbor_encoder_init(&enc, buffer + FMC_MAGIC_SIZE, TARGET_STORAGE_SIZE - FMC_MAGIC_SIZE);
+// finds the newest bank and indexes the last valid record of every blob.
+// records are only ever appended, so a broken one can only be the tail of an interrupted save.
+static void flash_journal_scan(uint8_t *buffer) {
+  memset(&journal, 0, sizeof(flash_journal_t));
 
-    cbor_result_t res = cbor_encode_target_t(&enc, &target);
-    if (res < CBOR_OK) {
-      fmc_lock();
-      __enable_irq();
-      failloop(FAILLOOP_FAULT);
+  for (uint32_t bank = 0; bank < FMC_BANK_COUNT; bank++) {
+    fmc_read_buf(bank * FMC_BANK_SIZE, buffer, FLASH_BANK_HEADER_SIZE);
+
+    const flash_bank_header_t *header = (const flash_bank_header_t *)buffer;
+    if (header->magic != FLASH_JOURNAL_MAGIC) {
+      continue;
+    }
+    if (journal.valid && header->seq <= journal.seq) {
+      continue;
     }
 
-    fmc_write_buf(TARGET_STORAGE_OFFSET, buffer, TARGET_STORAGE_SIZE);
+    journal.valid = true;
+    journal.bank = bank;
+    journal.seq = header->seq;
   }
 
-  {
-    memset(buffer, 0, FLASH_STORAGE_SIZE);
-    flash_write_magic(buffer, FMC_MAGIC | FLASH_STORAGE_OFFSET);
-    memcpy(buffer + FMC_MAGIC_SIZE, (uint8_t *)&flash_storage, sizeof(flash_storage_t));
-    fmc_write_buf(FLASH_STORAGE_OFFSET, buffer, FLASH_STORAGE_SIZE);
+  journal.head = FLASH_BANK_HEADER_SIZE;
+  if (!journal.valid) {
+    return;
   }
 
-  {
-    memset(buffer, 0, BIND_STORAGE_SIZE);
-    flash_write_magic(buffer, FMC_MAGIC | BIND_STORAGE_OFFSET);
+  const uint32_t base = journal.bank * FMC_BANK_SIZE;
+  while (journal.head + FLASH_RECORD_HEADER_SIZE <= FMC_BANK_SIZE) {
+    fmc_read_buf(base + journal.head, buffer, FLASH_RECORD_HEADER_SIZE);
+    if (flash_is_erased(buffer, FLASH_RECORD_HEADER_SIZE)) {
+      return;
+    }
+
+    const flash_record_t rec = *(const flash_record_t *)buffer;
+    if (rec.magic != FLASH_RECORD_MAGIC ||
+        rec.id >= FLASH_BLOB_MAX ||
+        rec.size > flash_blobs[rec.id].size ||
+        journal.head + FLASH_RECORD_SIZE(rec.size) > FMC_BANK_SIZE) {
+      journal.dirty = true;
+      return;
+    }
 
-    if (bind_storage.bind_saved == 0) {
-      // reset all bind data
-      memset(bind_storage.raw, 0, BIND_RAW_STORAGE_SIZE);
+    fmc_read_buf(base + journal.head, buffer, FLASH_RECORD_SIZE(rec.size));
+    if (flash_record_crc(&rec, buffer + FLASH_RECORD_HEADER_SIZE) != rec.crc) {
+      journal.dirty = true;
+      return;
     }
 
-    memcpy(buffer + FMC_MAGIC_SIZE, (uint8_t *)&bind_storage, sizeof(rx_bind_storage_t));
-    fmc_write_buf(BIND_STORAGE_OFFSET, buffer, BIND_STORAGE_SIZE);
+    journal.offset[rec.id] = journal.head;
+    journal.records[rec.id] = rec;
+    journal.head += FLASH_RECORD_SIZE(rec.size);
+  }
+}
+
+// encodes the blob into a full record, returns the record size
+static uint32_t flash_record_encode(flash_blob_id_t id, uint8_t *buffer) {
+  const flash_blob_t *blob = &flash_blobs[id];
+
+  uint8_t *data = buffer + FLASH_RECORD_HEADER_SIZE;
+  memset(buffer, 0xFF, FLASH_RECORD_SIZE(blob->size));
+
+  const uint32_t size = blob->encode(data, blob->size - FMC_MAGIC_SIZE);
+  if (size == 0) {
+    fmc_lock();
+    __enable_irq();
+    failloop(FAILLOOP_FAULT);
+  }
+
+  flash_record_t *rec = (flash_record_t *)buffer;
+  memset(rec, 0, FLASH_RECORD_HEADER_SIZE);
+  rec->magic = FLASH_RECORD_MAGIC;
+  rec->id = id;
+  rec->size = size;
+  rec->crc = flash_record_crc(rec, data);
+
+  return FLASH_RECORD_SIZE(size);
+}
+
+static bool flash_journal_append(flash_blob_id_t id, uint8_t *buffer, uint32_t size) {
+  if (journal.dirty || journal.head + size > FMC_BANK_SIZE) {
+    return false;
   }
 
-  {
-    memset(buffer, 0, PROFILE_STORAGE_SIZE);
-    flash_write_magic(buffer, FMC_MAGIC | PROFILE_STORAGE_OFFSET);
+  fmc_write_buf(journal.bank * FMC_BANK_SIZE + journal.head, buffer, size);
+
+  journal.offset[id] = journal.head;
+  journal.records[id] = *(flash_record_t *)buffer;
+  journal.head += size;
+  return true;
+}
+
+// writes every blob to the next bank, the bank header goes last so an interrupted snapshot is ignored
+static void flash_journal_snapshot(uint8_t *buffer) {
+  const uint32_t bank = journal.valid ? (journal.bank + 1) % FMC_BANK_COUNT : FMC_BANK_COUNT - 1;
+  fmc_erase(bank);
 
-    cbor_value_t enc;
-    cbor_encoder_init(&enc, buffer + FMC_MAGIC_SIZE, PROFILE_STORAGE_SIZE - FMC_MAGIC_SIZE);
+  journal.bank = bank;
+  journal.head = FLASH_BANK_HEADER_SIZE;
+  journal.dirty = false;
+  memset(journal.offset, 0, sizeof(journal.offset));
 
-    cbor_result_t res = cbor_encode_profile_t(&enc, &profile);
-    if (res < CBOR_OK) {
-      fmc_lock();
-      __enable_irq();
-      failloop(FAILLOOP_FAULT);
+  for (uint32_t id = 0; id < FLASH_BLOB_MAX; id++) {
+    if (id == FLASH_BLOB_PROFILE_IMAGE) {
+      continue;
     }
 
-    fmc_write_buf(PROFILE_STORAGE_OFFSET, buffer, PROFILE_STORAGE_SIZE);
+    const uint32_t size = flash_record_encode(id, buffer);
+    flash_journal_append(id, buffer, size);
   }
 
-#ifdef USE_VTX
-  {
-    flash_write_magic(buffer, FMC_MAGIC | VTX_STORAGE_OFFSET);
+  memset(buffer, 0xFF, FLASH_BANK_HEADER_SIZE);
+
+  flash_bank_header_t *header = (flash_bank_header_t *)buffer;
+  header->magic = FLASH_JOURNAL_MAGIC;
+  header->seq = journal.seq + 1;
+  fmc_write_buf(bank * FMC_BANK_SIZE, buffer, FLASH_BANK_HEADER_SIZE);
 
-    cbor_value_t enc;
-    cbor_encoder_init(&enc, buffer + FMC_MAGIC_SIZE, VTX_STORAGE_SIZE - FMC_MAGIC_SIZE);
+  journal.valid = true;
+  journal.seq = header->seq;
+}
 
-    cbor_result_t res = cbor_encode_vtx_settings_t(&enc, &vtx_settings);
-    if (res < CBOR_OK) {
-      fmc_lock();
-      __enable_irq();
-      failloop(FAILLOOP_FAULT);
+// the image only takes the tail that can no longer hold another profile record, so it never causes an erase.
+// a stale image is rejected on load and the profile record is decoded instead
+static void flash_journal_append_image(uint8_t *buffer) {
+  if (journal.head + FLASH_RECORD_SIZE(journal.records[FLASH_BLOB_PROFILE].size) <= FMC_BANK_SIZE) {
+    return;
+  }
+
+  const uint32_t size = flash_record_encode(FLASH_BLOB_PROFILE_IMAGE, buffer);
+
+  const flash_record_t *rec = (const flash_record_t *)buffer;
+  if (journal.offset[FLASH_BLOB_PROFILE_IMAGE] != 0 && journal.records[FLASH_BLOB_PROFILE_IMAGE].crc == rec->crc) {
+    return;
+  }
+
+  flash_journal_append(FLASH_BLOB_PROFILE_IMAGE, buffer, size);
+}
+
+// returns the payload of the blob, either from the journal or the legacy fixed layout
+static uint8_t *flash_journal_read(flash_blob_id_t id, uint8_t *buffer, uint32_t *size) {
+  const flash_blob_t *blob = &flash_blobs[id];
+
+  if (journal.valid) {
+    if (journal.offset[id] == 0) {
+      return NULL;
     }
 
-    fmc_write_buf(VTX_STORAGE_OFFSET, buffer, VTX_STORAGE_SIZE);
+    const flash_record_t *rec = &journal.records[id];
+    fmc_read_buf(journal.bank * FMC_BANK_SIZE + journal.offset[id], buffer, FLASH_RECORD_SIZE(rec->size));
+    *size = rec->size;
+    return buffer + FLASH_RECORD_HEADER_SIZE;
   }
-#endif
 
-  fmc_lock();
-  free(buffer);
-  __enable_irq();
+  if (blob->offset == FLASH_OFFSET_NONE || ((uint32_t)fmc_read(blob->offset)) != (FMC_MAGIC | blob->offset)) {
+    return NULL;
+  }
+
+  fmc_read_buf(blob->offset, buffer, blob->size);
+  *size = blob->size - FMC_MAGIC_SIZE;
+  return buffer + FMC_MAGIC_SIZE;
 }
 
-void flash_load() {
-  uint8_t *buffer = (uint8_t *)malloc(PROFILE_STORAGE_SIZE);
+void flash_save() {
+  rx_stop();
+
+  __disable_irq();
+
+  uint8_t *buffer = (uint8_t *)malloc(FLASH_RECORD_MAX);
   if (buffer == NULL) {
     failloop(FAILLOOP_FAULT);
   }
 
-  if (flash_compare_magic(TARGET_STORAGE_OFFSET, (FMC_MAGIC | TARGET_STORAGE_OFFSET))) {
-    fmc_read_buf(TARGET_STORAGE_OFFSET, buffer, TARGET_STORAGE_SIZE);
+  fmc_unlock();
+  flash_journal_scan(buffer);
+
+  for (uint32_t id = 0; id < FLASH_BLOB_MAX; id++) {
+    if (id == FLASH_BLOB_PROFILE_IMAGE) {
+      continue;
+    }
 
-    cbor_value_t dec;
-    cbor_decoder_init(&dec, buffer + FMC_MAGIC_SIZE, TARGET_STORAGE_SIZE - FMC_MAGIC_SIZE);
+    const uint32_t size = flash_record_encode(id, buffer);
 
-    cbor_result_t res = cbor_decode_target_t(&dec, &target);
-    if (res < CBOR_OK) {
-      failloop(FAILLOOP_FAULT);
+    // unchanged blobs are not written again
+    const flash_record_t *rec = (const flash_record_t *)buffer;
+    if (journal.valid && journal.offset[id] != 0 && journal.records[id].size == rec->size && journal.records[id].crc == rec->crc) {
+      continue;
     }
-  }
 
-  if (flash_compare_magic(FLASH_STORAGE_OFFSET, (FMC_MAGIC | FLASH_STORAGE_OFFSET))) {
-    fmc_read_buf(FLASH_STORAGE_OFFSET, buffer, FLASH_STORAGE_SIZE);
-    memcpy((uint8_t *)&flash_storage, buffer + FMC_MAGIC_SIZE, sizeof(flash_storage_t));
+    if (!journal.valid || !flash_journal_append(id, buffer, size)) {
+      flash_journal_snapshot(buffer);
+      break;
+    }
   }
 
-  if (flash_compare_magic(BIND_STORAGE_OFFSET, (FMC_MAGIC | BIND_STORAGE_OFFSET))) {
-    fmc_read_buf(BIND_STORAGE_OFFSET, buffer, BIND_STORAGE_SIZE);
-    memcpy((uint8_t *)&bind_storage, buffer + FMC_MAGIC_SIZE, sizeof(rx_bind_storage_t));
+  flash_journal_append_image(buffer);
 
-  } else {
-#ifdef EXPRESS_LRS_UID
-    const uint8_t uid[6] = {EXPRESS_LRS_UID};
-    bind_storage.bind_saved = 1;
+  fmc_lock();
+  free(buffer);
+  __enable_irq();
+}
 
-    bind_storage.elrs.is_set = 0x1;
-    bind_storage.elrs.magic = 0x37;
-    memcpy(bind_storage.elrs.uid, uid, 6);
-#endif
+// skips the cbor decode of the profile if the image matches this build and the stored records
+static bool flash_load_profile_image(uint8_t *buffer) {
+  if (!journal.valid || journal.offset[FLASH_BLOB_PROFILE] == 0) {
+    return false;
   }
 
-  profile_set_defaults();
+  uint32_t size = 0;
+  const uint8_t *data = flash_journal_read(FLASH_BLOB_PROFILE_IMAGE, buffer, &size);
+  if (data == NULL || size != sizeof(flash_profile_image_t) + sizeof(profile_t)) {
+    return false;
+  }
 
-  if (flash_compare_magic(PROFILE_STORAGE_OFFSET, (FMC_MAGIC | PROFILE_STORAGE_OFFSET))) {
-    fmc_read_buf(PROFILE_STORAGE_OFFSET, buffer, PROFILE_STORAGE_SIZE);
+  const flash_profile_image_t *image = (const flash_profile_image_t *)data;
+  if (image->version != PROFILE_VERSION ||
+      image->build_crc != flash_profile_image_build_crc() ||
+      image->size != sizeof(profile_t) ||
+      image->target_crc != journal.records[FLASH_BLOB_TARGET].crc ||
+      image->profile_crc != journal.records[FLASH_BLOB_PROFILE].crc) {
+    return false;
+  }
 
-    cbor_value_t dec;
-    cbor_decoder_init(&dec, buffer + FMC_MAGIC_SIZE, PROFILE_STORAGE_SIZE - FMC_MAGIC_SIZE);
+  memcpy((uint8_t *)&profile, data + sizeof(flash_profile_image_t), sizeof(profile_t));
+  return true;
+}
 
-    cbor_result_t res = cbor_decode_profile_t(&dec, &profile);
-    if (res < CBOR_OK) {
-      failloop(FAILLOOP_FAULT);
-    }
+void flash_load() {
+  uint8_t *buffer = (uint8_t *)malloc(FLASH_RECORD_MAX);
+  if (buffer == NULL) {
+    failloop(FAILLOOP_FAULT);
   }
 
-#ifdef USE_VTX
-  if (flash_compare_magic(VTX_STORAGE_OFFSET, (FMC_MAGIC | VTX_STORAGE_OFFSET))) {
-    fmc_read_buf(VTX_STORAGE_OFFSET, buffer, VTX_STORAGE_SIZE);
+  flash_journal_scan(buffer);
+
+  for (uint32_t id = 0; id < FLASH_BLOB_MAX; id++) {
+    const uint32_t start = time_micros();
+    if (id == FLASH_BLOB_PROFILE && flash_load_profile_image(buffer)) {
+      boot_profile_record("profile image", start);
+      continue;
+    }
 
-    cbor_value_t dec;
-    cbor_decoder_init(&dec, buffer + FMC_MAGIC_SIZE, VTX_STORAGE_SIZE - FMC_MAGIC_SIZE);
+    uint32_t size = 0;
+    uint8_t *data = flash_journal_read(id, buffer, &size);
+    flash_blobs[id].decode(data, size);
 
-    cbor_result_t res = cbor_decode_vtx_settings_t(&dec, &vtx_settings);
-    if (res < CBOR_OK) {
-      failloop(FAILLOOP_FAULT);
+    if (id == FLASH_BLOB_PROFILE) {
+      boot_profile_record("profile cbor", start);
     }
   }
-#endif
 
   free(buffer);
 }
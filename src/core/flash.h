@@ -1,5 +1,6 @@
 #pragma once
 
+#include "flight/gyro_cal.h"
 #include "rx/express_lrs.h"
 #include "rx/flysky.h"
 #include "rx/frsky.h"
@@ -9,19 +10,27 @@
 #define FMC_MAGIC 0x12AA0001
 #define FMC_MAGIC_SIZE 4
 
+// the *_STORAGE_OFFSET layout is only read to migrate configs saved before the journal,
+// the *_STORAGE_SIZE values still cap each record payload
+#define FLASH_JOURNAL_MAGIC 0x12AA0002
+
 #define TARGET_STORAGE_OFFSET 0
 #define TARGET_STORAGE_SIZE FLASH_ALIGN(2048)
 
 #define FLASH_STORAGE_OFFSET (TARGET_STORAGE_OFFSET + TARGET_STORAGE_SIZE)
-#define FLASH_STORAGE_SIZE FLASH_ALIGN(32)
+#define FLASH_STORAGE_SIZE FLASH_ALIGN(128)
+// size of the slot in the fixed layout, the storage grew after the journal replaced it
+#define FLASH_STORAGE_LEGACY_SIZE FLASH_ALIGN(32)
 
 typedef struct {
   float accelcal[3];
+  // appended after the legacy slot, only trusted when its magic matches
+  gyro_cal_model_t gyro_cal;
 } flash_storage_t;
 
 extern flash_storage_t flash_storage;
 
-#define BIND_STORAGE_OFFSET (FLASH_STORAGE_OFFSET + FLASH_STORAGE_SIZE)
+#define BIND_STORAGE_OFFSET (FLASH_STORAGE_OFFSET + FLASH_STORAGE_LEGACY_SIZE)
 #define BIND_STORAGE_SIZE FLASH_ALIGN(128)
 #define BIND_RAW_STORAGE_SIZE 60
 
@@ -43,10 +52,15 @@ cbor_result_t cbor_encode_rx_bind_storage_t(cbor_value_t *enc, const rx_bind_sto
 cbor_result_t cbor_decode_rx_bind_storage_t(cbor_value_t *enc, rx_bind_storage_t *s);
 
 #define PROFILE_STORAGE_OFFSET (BIND_STORAGE_OFFSET + BIND_STORAGE_SIZE)
-#define PROFILE_STORAGE_SIZE FLASH_ALIGN(2048)
+#define PROFILE_STORAGE_SIZE FLASH_ALIGN(3072)
+// size of the slot in the fixed layout, the profile outgrew it with the mixer and output curves
+#define PROFILE_STORAGE_LEGACY_SIZE FLASH_ALIGN(2048)
 
-#define VTX_STORAGE_OFFSET (PROFILE_STORAGE_OFFSET + PROFILE_STORAGE_SIZE)
+#define VTX_STORAGE_OFFSET (PROFILE_STORAGE_OFFSET + PROFILE_STORAGE_LEGACY_SIZE)
 #define VTX_STORAGE_SIZE FLASH_ALIGN(512)
 
+// journal only, holds the native profile_t so boot can skip the cbor decode
+#define PROFILE_IMAGE_STORAGE_SIZE FLASH_ALIGN(1536)
+
 void flash_save();
 void flash_load();
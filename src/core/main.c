@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "core/boot_profile.h"
 #include "core/debug.h"
 #include "core/failloop.h"
 #include "core/flash.h"
@@ -26,8 +27,6 @@
 #include "io/led.h"
 #include "io/simulator.h"
 #include "io/vbat.h"
-#include "io/vtx.h"
-#include "osd/render.h"
 
 __attribute__((__used__)) void
 memory_section_init() {
@@ -72,9 +71,10 @@ __attribute__((__used__)) int main() {
 
   // init timer so we can use delays etc
   time_init();
+  boot_profile_start();
 
   // load settings from flash
-  flash_load();
+  boot_stage("flash", flash_load());
 
   // wait for flash to stabilze
   time_delay_us(100);
@@ -94,34 +94,33 @@ __attribute__((__used__)) int main() {
 
   debug_pin_init();
   buzzer_init();
-  usb_init();
+  boot_stage("usb", usb_init());
   simulator_init();
 
   rgb_led_init();
-  motor_init();
+  boot_stage("motor", motor_init());
   motor_set_all(MOTOR_OFF);
 
   // wait for devices to wake up
   time_delay_ms(100);
   rx_spektrum_bind();
 
-  osd_init();
-  sixaxis_init();
+  boot_stage("sixaxis", sixaxis_init());
   // needs to happen after gyro is detected so we know its update period
   scheduler_init();
 
   time_delay_ms(50);
-  sixaxis_gyro_cal();
+  boot_stage("gyro cal", sixaxis_gyro_cal_boot());
 
   adc_init();
   vbat_init();
 
-  rx_init();
-  vtx_init();
+  boot_stage("rx", rx_init());
 
-  blackbox_init();
-  imu_init();
+  boot_stage("blackbox", blackbox_init());
+  boot_stage("imu", imu_init());
 
+  // osd and vtx are initialized by their tasks once the flight loop runs
   scheduler_run();
 }
 #endif
\ No newline at end of file
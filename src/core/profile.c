@@ -1,12 +1,17 @@
 #include "core/profile.h"
 
+#include <stddef.h>
 #include <string.h>
 
+#include "driver/motor.h"
+#include "driver/time.h"
 #include "driver/usb.h"
+#include "flight/control.h"
 #include "io/quic.h"
 #include "osd/render.h"
 #include "rx/rx.h"
 #include "util/cbor_helper.h"
+#include "util/crc.h"
 #include "util/util.h"
 
 // Default values for our profile
@@ -158,8 +163,31 @@ const profile_t default_profile = {
             MOTOR_PIN1,
             MOTOR_PIN2,
             MOTOR_PIN3,
+            MOTOR_PIN4,
+            MOTOR_PIN5,
+            MOTOR_PIN6,
+            MOTOR_PIN7,
         },
         .turtle_throttle_percent = 10.0f,
+        .motor_count = 4,
+#ifdef THRUST_LINEAR
+        .thrust_linear = THRUST_LINEAR,
+#else
+        .thrust_linear = 0.0f,
+#endif
+    },
+
+    .mixer = {
+#ifndef MOTOR_PLUS_CONFIGURATION
+        .roll = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = 1.0f, [MOTOR_BR] = -1.0f, [MOTOR_FR] = -1.0f},
+        .pitch = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = -1.0f, [MOTOR_BR] = 1.0f, [MOTOR_FR] = -1.0f},
+#else
+        // back, left, right and front
+        .roll = {[MOTOR_BL] = 0.0f, [MOTOR_FL] = 1.0f, [MOTOR_BR] = -1.0f, [MOTOR_FR] = 0.0f},
+        .pitch = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = 0.0f, [MOTOR_BR] = 0.0f, [MOTOR_FR] = -1.0f},
+#endif
+        .yaw = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = -1.0f, [MOTOR_BR] = -1.0f, [MOTOR_FR] = 1.0f},
+        .throttle = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = 1.0f, [MOTOR_BR] = 1.0f, [MOTOR_FR] = 1.0f},
     },
 
     .serial = {
@@ -387,6 +415,11 @@ const profile_t default_profile = {
         .ibat_scale = IBAT_SCALE,
 #else
         .ibat_scale = 0,
+#endif
+#ifdef VBAT_SAG_COMPENSATION
+        .vbat_sag_compensation = VBAT_SAG_COMPENSATION,
+#else
+        .vbat_sag_compensation = 0.0f,
 #endif
     },
     .receiver = {
@@ -523,13 +556,13 @@ cbor_result_t cbor_encode_profile_metadata_t(cbor_value_t *enc, const profile_me
   CBOR_CHECK_ERROR(res = cbor_encode_map_indefinite(enc));
 
   const uint32_t version = PROFILE_VERSION;
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "version"));
+  CBOR_CHECK_ERROR(res = cbor_encode_key(enc, "version", 0));
   CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &version));
 
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "name"));
+  CBOR_CHECK_ERROR(res = cbor_encode_key(enc, "name", 1));
   CBOR_CHECK_ERROR(res = cbor_encode_tstr(enc, meta->name, 36));
 
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "datetime"));
+  CBOR_CHECK_ERROR(res = cbor_encode_key(enc, "datetime", 2));
   CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &meta->datetime));
 
   CBOR_CHECK_ERROR(res = cbor_encode_end_indefinite(enc));
@@ -546,6 +579,7 @@ cbor_result_t cbor_encode_profile_metadata_t(cbor_value_t *enc, const profile_me
 
 RATE_MEMBERS
 PROFILE_RATE_MEMBERS
+MIXER_MEMBERS
 MOTOR_MEMBERS
 SERIAL_MEMBERS
 FILTER_PARAMETER_MEMBERS
@@ -581,14 +615,15 @@ cbor_result_t cbor_decode_profile_metadata_t(cbor_value_t *dec, profile_metadata
   if (res < CBOR_OK)
     return res;
 
-  const uint8_t *name;
-  uint32_t name_len;
   for (uint32_t i = 0; i < cbor_decode_map_size(dec, &map); i++) {
-    res = cbor_decode_tstr(dec, &name, &name_len);
+    const uint8_t *name;
+    uint32_t name_len;
+    uint32_t key;
+    res = cbor_decode_key(dec, &key, &name, &name_len);
     if (res < CBOR_OK)
       return res;
 
-    if (buf_equal_string(name, name_len, "name")) {
+    if (name == NULL ? key == 1 : buf_equal_string(name, name_len, "name")) {
       CBOR_CHECK_ERROR(res = cbor_decode_tstr(dec, &name, &name_len));
 
       if (name_len > 36) {
@@ -599,7 +634,7 @@ cbor_result_t cbor_decode_profile_metadata_t(cbor_value_t *dec, profile_metadata
       continue;
     }
 
-    if (buf_equal_string(name, name_len, "datetime")) {
+    if (name == NULL ? key == 2 : buf_equal_string(name, name_len, "datetime")) {
       CBOR_CHECK_ERROR(res = cbor_decode_uint32_t(dec, &meta->datetime));
       continue;
     }
@@ -621,6 +656,95 @@ cbor_result_t cbor_decode_profile_metadata_t(cbor_value_t *dec, profile_metadata
 
 RATE_MEMBERS
 PROFILE_RATE_MEMBERS
+MIXER_MEMBERS
+MOTOR_MEMBERS
+SERIAL_MEMBERS
+FILTER_PARAMETER_MEMBERS
+FILTER_MEMBERS
+OSD_PROFILE_MEMBERS
+OSD_MEMBERS
+VOLTAGE_MEMBERS
+PID_RATE_MEMBERS
+ANGLE_PID_RATE_MEMBERS
+STICK_RATE_MEMBERS
+DTERM_ATTENUATION_MEMBERS
+PID_MEMBERS
+CALIBRATION_LIMIT_MEMBERS
+RECEIVER_MEMBERS
+BLACKBOX_MEMBERS
+PROFILE_MEMBERS
+
+#undef START_STRUCT
+#undef END_STRUCT
+#undef MEMBER
+#undef STR_MEMBER
+#undef TSTR_MEMBER
+#undef ARRAY_MEMBER
+#undef STR_ARRAY_MEMBER
+
+static cbor_result_t cbor_encode_key_table_profile_metadata_t(cbor_value_t *enc) {
+  cbor_result_t res = CBOR_OK;
+
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "profile_metadata_t"));
+  CBOR_CHECK_ERROR(res = cbor_encode_array_indefinite(enc));
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "version"));
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "name"));
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "datetime"));
+  return cbor_encode_end_indefinite(enc);
+}
+
+#define START_STRUCT CBOR_START_STRUCT_KEY_TABLE
+#define END_STRUCT CBOR_END_STRUCT_KEY_TABLE
+#define MEMBER CBOR_KEY_TABLE_MEMBER
+#define STR_MEMBER CBOR_KEY_TABLE_MEMBER
+#define TSTR_MEMBER CBOR_KEY_TABLE_MEMBER
+#define ARRAY_MEMBER CBOR_KEY_TABLE_MEMBER
+#define STR_ARRAY_MEMBER CBOR_KEY_TABLE_MEMBER
+
+RATE_MEMBERS
+PROFILE_RATE_MEMBERS
+MIXER_MEMBERS
+MOTOR_MEMBERS
+SERIAL_MEMBERS
+FILTER_PARAMETER_MEMBERS
+FILTER_MEMBERS
+OSD_PROFILE_MEMBERS
+OSD_MEMBERS
+VOLTAGE_MEMBERS
+PID_RATE_MEMBERS
+ANGLE_PID_RATE_MEMBERS
+STICK_RATE_MEMBERS
+DTERM_ATTENUATION_MEMBERS
+PID_MEMBERS
+CALIBRATION_LIMIT_MEMBERS
+RECEIVER_MEMBERS
+BLACKBOX_MEMBERS
+PROFILE_MEMBERS
+
+#undef START_STRUCT
+#undef END_STRUCT
+#undef MEMBER
+#undef STR_MEMBER
+#undef TSTR_MEMBER
+#undef ARRAY_MEMBER
+#undef STR_ARRAY_MEMBER
+
+#define START_STRUCT(type) CBOR_CHECK_ERROR(res = cbor_encode_key_table_##type(enc));
+#define END_STRUCT()
+#define MEMBER(...)
+#define STR_MEMBER(...)
+#define TSTR_MEMBER(...)
+#define ARRAY_MEMBER(...)
+#define STR_ARRAY_MEMBER(...)
+
+// encodes a "type: [member names]" map entry for every struct, integer keys index into these
+cbor_result_t cbor_encode_profile_key_tables(cbor_value_t *enc) {
+  cbor_result_t res = CBOR_OK;
+  CBOR_CHECK_ERROR(res = cbor_encode_key_table_profile_metadata_t(enc));
+
+RATE_MEMBERS
+PROFILE_RATE_MEMBERS
+MIXER_MEMBERS
 MOTOR_MEMBERS
 SERIAL_MEMBERS
 FILTER_PARAMETER_MEMBERS
@@ -638,6 +762,9 @@ RECEIVER_MEMBERS
 BLACKBOX_MEMBERS
 PROFILE_MEMBERS
 
+  return res;
+}
+
 #undef START_STRUCT
 #undef END_STRUCT
 #undef MEMBER
@@ -645,3 +772,176 @@ PROFILE_MEMBERS
 #undef TSTR_MEMBER
 #undef ARRAY_MEMBER
 #undef STR_ARRAY_MEMBER
+
+static cbor_result_t cbor_patch_profile_metadata_t(cbor_value_t *dec, profile_metadata_t *meta, const uint8_t *path, uint32_t path_len) {
+  if (path_len != 0) {
+    return cbor_handle_error(CBOR_ERR_INVALID_TYPE);
+  }
+  return cbor_decode_profile_metadata_t(dec, meta);
+}
+
+#define START_STRUCT CBOR_START_STRUCT_PATCHER
+#define END_STRUCT CBOR_END_STRUCT_PATCHER
+#define MEMBER CBOR_PATCH_MEMBER
+#define TSTR_MEMBER CBOR_PATCH_TSTR_MEMBER
+#define ARRAY_MEMBER CBOR_PATCH_ARRAY_MEMBER
+
+RATE_MEMBERS
+PROFILE_RATE_MEMBERS
+MIXER_MEMBERS
+MOTOR_MEMBERS
+SERIAL_MEMBERS
+FILTER_PARAMETER_MEMBERS
+FILTER_MEMBERS
+OSD_PROFILE_MEMBERS
+OSD_MEMBERS
+VOLTAGE_MEMBERS
+PID_RATE_MEMBERS
+ANGLE_PID_RATE_MEMBERS
+STICK_RATE_MEMBERS
+DTERM_ATTENUATION_MEMBERS
+PID_MEMBERS
+CALIBRATION_LIMIT_MEMBERS
+RECEIVER_MEMBERS
+BLACKBOX_MEMBERS
+PROFILE_MEMBERS
+
+#undef START_STRUCT
+#undef END_STRUCT
+#undef MEMBER
+#undef TSTR_MEMBER
+#undef ARRAY_MEMBER
+
+// the top level members of the profile are tracked as sections for change queries
+typedef struct {
+  const char *name;
+  uint32_t offset;
+  uint32_t size;
+} profile_section_t;
+
+#define START_STRUCT(type) static const profile_section_t profile_sections[] = {
+#define END_STRUCT() };
+#define MEMBER(member, type) {#member, offsetof(profile_t, member), sizeof(((profile_t *)0)->member)},
+
+PROFILE_MEMBERS
+
+#undef START_STRUCT
+#undef END_STRUCT
+#undef MEMBER
+
+#define PROFILE_SECTION_MAX (sizeof(profile_sections) / sizeof(profile_section_t))
+
+#define START_STRUCT(type)                                                                             \
+  static cbor_result_t cbor_encode_profile_section(cbor_value_t *enc, const type *o, uint32_t section) { \
+    uint32_t index = 0;
+#define END_STRUCT()                               \
+  return cbor_handle_error(CBOR_ERR_INVALID_TYPE); \
+  }
+#define MEMBER(member, type)                    \
+  if (section == index++) {                     \
+    return cbor_encode_##type(enc, &o->member); \
+  }
+
+PROFILE_MEMBERS
+
+#undef START_STRUCT
+#undef END_STRUCT
+#undef MEMBER
+
+static uint32_t profile_generation = 0;
+static uint32_t profile_session = 0;
+static uint32_t profile_section_crc[PROFILE_SECTION_MAX];
+static uint32_t profile_section_generation[PROFILE_SECTION_MAX];
+
+// generations restart on every boot, the session tells a host its generation is from an earlier one
+static void profile_session_init() {
+  // seeded by when the first host asked and the gyro noise at that moment
+  const uint32_t now = time_micros();
+  uint32_t session = crc32_data(0, (const uint8_t *)&now, sizeof(now));
+  session = crc32_data(session, (const uint8_t *)&state.gyro_raw, sizeof(state.gyro_raw));
+  // zero is reserved for hosts that do not send a session
+  profile_session = session ? session : 1;
+}
+
+// picks up changes from any source (quic, msp, osd menu) by comparing section checksums
+uint32_t profile_update_generation() {
+  if (profile_session == 0) {
+    profile_session_init();
+  }
+
+  bool changed = false;
+
+  for (uint32_t i = 0; i < PROFILE_SECTION_MAX; i++) {
+    const profile_section_t *section = &profile_sections[i];
+    const uint32_t crc = crc32_data(0, (const uint8_t *)&profile + section->offset, section->size);
+    if (profile_generation > 0 && crc == profile_section_crc[i]) {
+      continue;
+    }
+
+    if (!changed) {
+      profile_generation++;
+      changed = true;
+    }
+    profile_section_crc[i] = crc;
+    profile_section_generation[i] = profile_generation;
+  }
+
+  return profile_generation;
+}
+
+// applies a map of dotted paths to values, eg {"motor.digital_idle": 4.5, "pid.pid_rates.0.kp.1": 50}
+cbor_result_t profile_patch(cbor_value_t *dec) {
+  cbor_result_t res = CBOR_OK;
+
+  cbor_container_t map;
+  CBOR_CHECK_ERROR(res = cbor_decode_map(dec, &map));
+
+  // every path goes into a copy first, a bad one leaves the live profile untouched
+  static profile_t patched;
+  memcpy(&patched, &profile, sizeof(profile_t));
+
+  for (uint32_t i = 0; i < cbor_decode_map_size(dec, &map); i++) {
+    const uint8_t *path;
+    uint32_t path_len;
+    CBOR_CHECK_ERROR(res = cbor_decode_tstr(dec, &path, &path_len));
+    if (path_len == 0) {
+      return cbor_handle_error(CBOR_ERR_INVALID_TYPE);
+    }
+    CBOR_CHECK_ERROR(res = cbor_patch_profile_t(dec, &patched, path, path_len));
+  }
+
+  memcpy(&profile, &patched, sizeof(profile_t));
+  return res;
+}
+
+// encodes the session, the current generation and every section that changed after the given one.
+// a generation from another session or from the future is stale and gets every section
+cbor_result_t cbor_encode_profile_changes(cbor_value_t *enc, uint32_t session, uint32_t since) {
+  cbor_result_t res = CBOR_OK;
+
+  const uint32_t generation = profile_update_generation();
+  if ((session != 0 && session != profile_session) || since > generation) {
+    since = 0;
+  }
+
+  CBOR_CHECK_ERROR(res = cbor_encode_map_indefinite(enc));
+
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "session"));
+  CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &profile_session));
+
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "generation"));
+  CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &generation));
+
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "profile"));
+  CBOR_CHECK_ERROR(res = cbor_encode_map_indefinite(enc));
+  for (uint32_t i = 0; i < PROFILE_SECTION_MAX; i++) {
+    if (profile_section_generation[i] <= since) {
+      continue;
+    }
+    CBOR_CHECK_ERROR(res = cbor_encode_str(enc, profile_sections[i].name));
+    CBOR_CHECK_ERROR(res = cbor_encode_profile_section(enc, &profile, i));
+  }
+  CBOR_CHECK_ERROR(res = cbor_encode_end_indefinite(enc));
+
+  return cbor_encode_end_indefinite(enc);
+}
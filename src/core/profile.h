@@ -189,6 +189,22 @@ typedef enum {
   DSHOT_TIME_MAX = 600,
 } __attribute__((__packed__)) dshot_time_t;
 
+// mixer matrix stored by column, every axis is one contiguous run over the motors
+typedef struct {
+  float roll[MOTOR_PIN_MAX];
+  float pitch[MOTOR_PIN_MAX];
+  float yaw[MOTOR_PIN_MAX];
+  float throttle[MOTOR_PIN_MAX];
+} profile_mixer_t;
+
+#define MIXER_MEMBERS                          \
+  START_STRUCT(profile_mixer_t)                \
+  ARRAY_MEMBER(roll, MOTOR_PIN_MAX, float)     \
+  ARRAY_MEMBER(pitch, MOTOR_PIN_MAX, float)    \
+  ARRAY_MEMBER(yaw, MOTOR_PIN_MAX, float)      \
+  ARRAY_MEMBER(throttle, MOTOR_PIN_MAX, float) \
+  END_STRUCT()
+
 typedef struct {
   float digital_idle;
   float motor_limit;
@@ -200,6 +216,8 @@ typedef struct {
   float throttle_boost;
   motor_pin_t motor_pins[MOTOR_PIN_MAX];
   float turtle_throttle_percent;
+  uint8_t motor_count;
+  float thrust_linear;
 } profile_motor_t;
 
 #define MOTOR_MEMBERS                              \
@@ -214,6 +232,8 @@ typedef struct {
   MEMBER(throttle_boost, float)                    \
   ARRAY_MEMBER(motor_pins, MOTOR_PIN_MAX, uint8_t) \
   MEMBER(turtle_throttle_percent, float)           \
+  MEMBER(motor_count, uint8_t)                     \
+  MEMBER(thrust_linear, float)                     \
   END_STRUCT()
 
 typedef enum {
@@ -230,6 +250,7 @@ typedef struct {
   uint8_t use_filtered_voltage_for_warnings;
   float vbat_scale;
   float ibat_scale;
+  float vbat_sag_compensation;
 } profile_voltage_t;
 
 #define VOLTAGE_MEMBERS                              \
@@ -242,6 +263,7 @@ typedef struct {
   MEMBER(use_filtered_voltage_for_warnings, uint8_t) \
   MEMBER(vbat_scale, float)                          \
   MEMBER(ibat_scale, float)                          \
+  MEMBER(vbat_sag_compensation, float)               \
   END_STRUCT()
 
 typedef struct {
@@ -380,6 +402,7 @@ typedef struct {
 typedef struct {
   profile_metadata_t meta;
   profile_motor_t motor;
+  profile_mixer_t mixer;
   profile_serial_t serial;
   profile_filter_t filter;
   profile_osd_t osd;
@@ -394,6 +417,7 @@ typedef struct {
   START_STRUCT(profile_t)              \
   MEMBER(meta, profile_metadata_t)     \
   MEMBER(motor, profile_motor_t)       \
+  MEMBER(mixer, profile_mixer_t)       \
   MEMBER(serial, profile_serial_t)     \
   MEMBER(filter, profile_filter_t)     \
   MEMBER(osd, profile_osd_t)           \
@@ -422,6 +446,12 @@ rate_t *profile_current_rates();
 
 cbor_result_t cbor_encode_profile_t(cbor_value_t *enc, const profile_t *p);
 cbor_result_t cbor_decode_profile_t(cbor_value_t *dec, profile_t *p);
+cbor_result_t cbor_patch_profile_t(cbor_value_t *dec, profile_t *p, const uint8_t *path, uint32_t path_len);
+cbor_result_t cbor_encode_profile_key_tables(cbor_value_t *enc);
+
+uint32_t profile_update_generation();
+cbor_result_t profile_patch(cbor_value_t *dec);
+cbor_result_t cbor_encode_profile_changes(cbor_value_t *enc, uint32_t session, uint32_t since);
 
 cbor_result_t cbor_encode_blackbox_preset_t(cbor_value_t *enc, const blackbox_preset_t *p);
 cbor_result_t cbor_decode_blackbox_preset_t(cbor_value_t *dec, blackbox_preset_t *p);
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "core/boot_profile.h"
 #include "core/debug.h"
 #include "core/looptime.h"
 #include "driver/time.h"
@@ -21,6 +22,8 @@ static FAST_RAM uint32_t task_queue_size = 0;
 static FAST_RAM task_t *task_queue[TASK_MAX];
 static FAST_RAM task_t *active_task = NULL;
 
+static uint32_t deferred_init_count = 0;
+
 static bool task_queue_contains(task_t *task) {
   for (uint32_t i = 0; i < task_queue_size; i++) {
     if (task_queue[i] == task) {
@@ -174,6 +177,25 @@ static FORCE_INLINE void task_run(task_t *task, uint32_t task_id) {
   }
 }
 
+// inits that are not needed to fly are held back until the flight loop is running
+static void task_run_init(task_t *task) {
+  if (state.loop_counter == 0) {
+    return;
+  }
+
+  const uint32_t start = time_micros();
+  task->init();
+  task->init = NULL;
+  boot_profile_record(task->name, start);
+
+  task->last_time = time_cycles();
+  looptime_reset();
+
+  if (--deferred_init_count == 0) {
+    boot_profile_finish();
+  }
+}
+
 static FORCE_INLINE uint8_t scheduler_task_mask() {
   uint8_t task_mask = TASK_MASK_DEFAULT;
   if (flags.in_air || flags.arm_state) {
@@ -196,12 +218,20 @@ void scheduler_init() {
 
   for (uint32_t i = 0; i < TASK_MAX; i++) {
     task_queue_push(&tasks[i]);
+
+    if (tasks[i].init != NULL) {
+      deferred_init_count++;
+    }
   }
 }
 
 void scheduler_run() {
   looptime_reset();
 
+  if (deferred_init_count == 0) {
+    boot_profile_finish();
+  }
+
   while (1) {
     simulator_update();
 
@@ -211,9 +241,14 @@ void scheduler_run() {
       task_t *task = task_queue[i];
       // Pass task index to avoid lookup later
       uint32_t task_id = task - tasks; // Pointer arithmetic to get index
-      if (task_should_run(cycles, task_mask, task, task_id)) {
-        task_run(task, task_id);
+      if (!task_should_run(cycles, task_mask, task, task_id)) {
+        continue;
+      }
+      if (task->init != NULL) {
+        task_run_init(task);
+        continue;
       }
+      task_run(task, task_id);
     }
 
     looptime_update();
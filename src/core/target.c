@@ -89,6 +89,69 @@ TARGET_MEMBERS
 #undef INDEX_ARRAY_MEMBER
 #undef STR_ARRAY_MEMBER
 
+#define START_STRUCT CBOR_START_STRUCT_KEY_TABLE
+#define END_STRUCT CBOR_END_STRUCT_KEY_TABLE
+#define MEMBER CBOR_KEY_TABLE_MEMBER
+#define STR_MEMBER CBOR_KEY_TABLE_MEMBER
+#define TSTR_MEMBER CBOR_KEY_TABLE_MEMBER
+#define ARRAY_MEMBER CBOR_KEY_TABLE_MEMBER
+#define INDEX_ARRAY_MEMBER CBOR_KEY_TABLE_MEMBER
+#define STR_ARRAY_MEMBER CBOR_KEY_TABLE_MEMBER
+
+TARGET_DMA_MEMBERS
+TARGET_LED_MEMBERS
+TARGET_BUZZER_MEMBERS
+TARGET_SERIAL_MEMBERS
+TARGET_SPI_MEMBERS
+TARGET_GYRO_SPI_DEVICE_MEMBERS
+TARGET_SPI_DEVICE_MEMBERS
+TARGET_RX_SPI_DEVICE_MEMBERS
+TARGET_MEMBERS
+
+#undef START_STRUCT
+#undef END_STRUCT
+#undef MEMBER
+#undef STR_MEMBER
+#undef TSTR_MEMBER
+#undef ARRAY_MEMBER
+#undef INDEX_ARRAY_MEMBER
+#undef STR_ARRAY_MEMBER
+
+#define START_STRUCT(type) CBOR_CHECK_ERROR(res = cbor_encode_key_table_##type(enc));
+#define END_STRUCT()
+#define MEMBER(...)
+#define STR_MEMBER(...)
+#define TSTR_MEMBER(...)
+#define ARRAY_MEMBER(...)
+#define INDEX_ARRAY_MEMBER(...)
+#define STR_ARRAY_MEMBER(...)
+
+// same as the profile key tables, for every struct reachable from target_t
+cbor_result_t cbor_encode_target_key_tables(cbor_value_t *enc) {
+  cbor_result_t res = CBOR_OK;
+
+TARGET_DMA_MEMBERS
+TARGET_LED_MEMBERS
+TARGET_BUZZER_MEMBERS
+TARGET_SERIAL_MEMBERS
+TARGET_SPI_MEMBERS
+TARGET_GYRO_SPI_DEVICE_MEMBERS
+TARGET_SPI_DEVICE_MEMBERS
+TARGET_RX_SPI_DEVICE_MEMBERS
+TARGET_MEMBERS
+
+  return res;
+}
+
+#undef START_STRUCT
+#undef END_STRUCT
+#undef MEMBER
+#undef STR_MEMBER
+#undef TSTR_MEMBER
+#undef ARRAY_MEMBER
+#undef INDEX_ARRAY_MEMBER
+#undef STR_ARRAY_MEMBER
+
 static const uint8_t pin_none_str[] = "NONE";
 
 typedef enum {
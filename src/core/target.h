@@ -23,6 +23,10 @@ typedef enum {
   MOTOR_PIN1,
   MOTOR_PIN2,
   MOTOR_PIN3,
+  MOTOR_PIN4,
+  MOTOR_PIN5,
+  MOTOR_PIN6,
+  MOTOR_PIN7,
   MOTOR_PIN_MAX
 } __attribute__((__packed__)) motor_pin_t;
 
@@ -299,6 +303,7 @@ cbor_result_t cbor_decode_gpio_pins_t(cbor_value_t *dec, gpio_pins_t *t);
 
 cbor_result_t cbor_encode_target_t(cbor_value_t *enc, const target_t *t);
 cbor_result_t cbor_decode_target_t(cbor_value_t *dec, target_t *t);
+cbor_result_t cbor_encode_target_key_tables(cbor_value_t *enc);
 
 cbor_result_t cbor_encode_target_dma_t(cbor_value_t *enc, const target_dma_t *dma);
 cbor_result_t cbor_decode_target_dma_t(cbor_value_t *dec, target_dma_t *dma);
@@ -56,6 +56,9 @@ typedef struct {
   task_function_t func;
   uint32_t period_cycles;
 
+  // run once in place of the first call, after the first loop
+  task_function_t init;
+
   uint32_t last_time;
   uint32_t runtime_current;
   uint32_t runtime_avg;
@@ -99,6 +102,24 @@ typedef struct {
       .runtime_peak_ema = 0,                                         \
   }
 
+#define CREATE_DEFERRED_TASK(p_name, p_mask, p_priority, p_init, p_func, p_period_us) \
+  {                                                                                   \
+      .name = p_name,                                                                 \
+      .mask = p_mask,                                                                 \
+      .flags = 0,                                                                     \
+      .priority = p_priority,                                                         \
+      .func = p_func,                                                                 \
+      .period_cycles = US_TO_CYCLES(p_period_us),                                     \
+      .init = p_init,                                                                 \
+      .last_time = 0,                                                                 \
+      .runtime_current = 0,                                                           \
+      .runtime_avg = 0,                                                               \
+      .runtime_worst = 0,                                                             \
+      .runtime_max = 0,                                                               \
+      .runtime_avg_sum = 0,                                                           \
+      .runtime_peak_ema = 0,                                                          \
+  }
+
 extern task_t tasks[TASK_MAX];
 
 static inline float task_get_period_us(task_id_t id) {
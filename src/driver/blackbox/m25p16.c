@@ -36,6 +36,7 @@ void m25p16_init() {
 
   bus.port = target.flash.port;
   bus.nss = target.flash.nss;
+  bus.lane = SPI_LANE_BULK;
   spi_bus_device_init(&bus);
   spi_bus_device_reconfigure(&bus, SPI_MODE_LEADING_EDGE, M25P16_BAUD_RATE);
 }
@@ -30,9 +30,7 @@ typedef enum {
 
   SDCARD_WRITE_MULTIPLE_START,
   SDCARD_WRITE_MULTIPLE_READY,
-  SDCARD_WRITE_MULTIPLE_CONTINUE,
   SDCARD_WRITE_MULTIPLE_VERIFY,
-  SDCARD_WRITE_MULTIPLE_SECTOR_SUCCESS,
   SDCARD_WRITE_MULTIPLE_FINISH,
   SDCARD_WRITE_MULTIPLE_FINISH_WAIT,
   SDCARD_WRITE_MULTIPLE_DONE
@@ -61,6 +59,10 @@ static sdcard_operation_t operation;
 
 static spi_bus_device_t bus = {};
 
+// filled by the transaction following a data block or stop token
+static uint8_t busy_buffer[IDLE_BYTES];
+static bool busy_pending = false;
+
 void sdcard_init() {
   if (target.sdcard_detect.pin != PIN_NONE) {
     gpio_config_t gpio_init;
@@ -77,6 +79,7 @@ void sdcard_init() {
 
   bus.port = target.sdcard.port;
   bus.nss = target.sdcard.nss;
+  bus.lane = SPI_LANE_BULK;
   spi_bus_device_init(&bus);
   spi_bus_device_reconfigure(&bus, SPI_MODE_LEADING_EDGE, SPI_SPEED_SLOW);
 }
@@ -133,6 +136,24 @@ static bool sdcard_wait_for_idle() {
   return false;
 }
 
+// non-blocking busy check, the card holds MISO low while it is programming.
+// a new poll is queued on every call until the card releases the bus.
+static bool sdcard_poll_busy() {
+  if (busy_pending) {
+    busy_pending = false;
+    if (busy_buffer[IDLE_BYTES - 1] == 0xFF) {
+      return false;
+    }
+  }
+
+  const spi_txn_segment_t segs[] = {
+      spi_make_seg_buffer(busy_buffer, NULL, IDLE_BYTES),
+  };
+  spi_seg_submit_continue(&bus, segs);
+  busy_pending = true;
+  return true;
+}
+
 static uint8_t sdcard_command(const uint8_t cmd, const uint32_t args) {
   if (cmd != SDCARD_GO_IDLE && cmd != SDCARD_STOP_TRANSMISSION && !sdcard_wait_for_idle()) {
     return 0xFF;
@@ -465,64 +486,40 @@ sdcard_status_t sdcard_update() {
     break;
   }
 
-  case SDCARD_WRITE_MULTIPLE_CONTINUE: {
-    if (!spi_txn_ready(&bus)) {
-      break;
-    }
-    if (operation.count == operation.count_done) {
-      break;
-    }
-
-    const spi_txn_segment_t segs[] = {
-        // token
-        spi_make_seg_const(0xFC),
-
-        spi_make_seg_buffer(NULL, operation.buf, SDCARD_PAGE_SIZE),
-
-        // two bytes CRC
-        spi_make_seg_const(0xFF, 0xFF),
-
-        // write response
-        spi_make_seg_const(0xFF),
-    };
-    spi_seg_submit_continue(&bus, segs);
-
-    state = SDCARD_WRITE_MULTIPLE_VERIFY;
-    break;
-  }
-
   case SDCARD_WRITE_MULTIPLE_VERIFY: {
-    if (!sdcard_wait_for_idle()) {
+    if (sdcard_poll_busy()) {
       break;
     }
 
     operation.count_done++;
-    state = SDCARD_WRITE_MULTIPLE_SECTOR_SUCCESS;
-    break;
+    state = SDCARD_WRITE_MULTIPLE_READY;
+    return SDCARD_IDLE;
   }
 
   case SDCARD_WRITE_MULTIPLE_FINISH: {
     const spi_txn_segment_t segs[] = {
-        spi_make_seg_const(0xFD),
+        // stop token, followed by one byte before busy
+        spi_make_seg_const(0xFD, 0xFF),
+        spi_make_seg_buffer(busy_buffer, NULL, IDLE_BYTES),
     };
     spi_seg_submit_continue(&bus, segs);
+    busy_pending = true;
 
     state = SDCARD_WRITE_MULTIPLE_FINISH_WAIT;
     break;
   }
 
   case SDCARD_WRITE_MULTIPLE_FINISH_WAIT: {
-    if (!sdcard_wait_for_idle()) {
+    if (sdcard_poll_busy()) {
       break;
     }
 
     state = SDCARD_WRITE_MULTIPLE_DONE;
-    break;
+    return SDCARD_IDLE;
   }
 
   case SDCARD_READY:
   case SDCARD_WRITE_MULTIPLE_READY:
-  case SDCARD_WRITE_MULTIPLE_SECTOR_SUCCESS:
   case SDCARD_WRITE_MULTIPLE_DONE:
   case SDCARD_READ_MULTIPLE_DONE:
     return SDCARD_IDLE;
@@ -593,7 +590,8 @@ uint8_t sdcard_write_pages_start(uint32_t sector, uint32_t count) {
     return 0;
   }
 
-  if (sdcard_app_command(SDCARD_ACMD_SET_WR_BLK_ERASE_COUNT, count * 2) != 0x0) {
+  // pre-erase hint, the write itself stays open-ended until finish
+  if (sdcard_app_command(SDCARD_ACMD_SET_WR_BLK_ERASE_COUNT, count) != 0x0) {
     return 0;
   }
 
@@ -607,28 +605,38 @@ uint8_t sdcard_write_pages_start(uint32_t sector, uint32_t count) {
   return 0;
 }
 
+// queues a single page, the page is sent by dma straight from buf so it
+// has to stay untouched until sdcard_write_buffer_free.
 uint8_t sdcard_write_pages_continue(uint8_t *buf) {
-  if (state == SDCARD_WRITE_MULTIPLE_READY) {
-    operation.buf = buf;
-    operation.count++;
-
-    state = SDCARD_WRITE_MULTIPLE_CONTINUE;
+  if (state != SDCARD_WRITE_MULTIPLE_READY || !spi_txn_ready(&bus)) {
     return 0;
   }
 
-  if (state == SDCARD_WRITE_MULTIPLE_SECTOR_SUCCESS) {
-    state = SDCARD_WRITE_MULTIPLE_READY;
-    return 1;
-  }
+  const spi_txn_segment_t segs[] = {
+      // token
+      spi_make_seg_const(0xFC),
 
-  return 0;
+      spi_make_seg_dma(NULL, buf, SDCARD_PAGE_SIZE),
+
+      // two bytes CRC
+      spi_make_seg_const(0xFF, 0xFF),
+
+      // write response, followed by the first busy poll
+      spi_make_seg_buffer(busy_buffer, NULL, IDLE_BYTES),
+  };
+  spi_seg_submit_continue(&bus, segs);
+  busy_pending = true;
+
+  operation.count++;
+  state = SDCARD_WRITE_MULTIPLE_VERIFY;
+  return 1;
+}
+
+bool sdcard_write_buffer_free() {
+  return spi_txn_ready(&bus);
 }
 
 uint8_t sdcard_write_pages_finish() {
-  if (state == SDCARD_WRITE_MULTIPLE_SECTOR_SUCCESS) {
-    state = SDCARD_WRITE_MULTIPLE_READY;
-    return 0;
-  }
   if (state == SDCARD_WRITE_MULTIPLE_READY) {
     state = SDCARD_WRITE_MULTIPLE_FINISH;
     return 0;
@@ -644,23 +652,17 @@ uint8_t sdcard_write_pages_finish() {
 uint8_t sdcard_write_page(uint8_t *buf, uint32_t sector) {
   if (state == SDCARD_READY) {
     sdcard_write_pages_start(sector, 1);
-  }
-  if (state == SDCARD_WRITE_MULTIPLE_SECTOR_SUCCESS) {
-    sdcard_write_pages_continue(buf);
-  }
-  if (state == SDCARD_WRITE_MULTIPLE_DONE) {
-    if (sdcard_write_pages_finish()) {
-      return 1;
-    }
+    return 0;
   }
   if (state == SDCARD_WRITE_MULTIPLE_READY) {
-    if (operation.count_done == 0) {
+    if (operation.count == 0) {
       sdcard_write_pages_continue(buf);
     } else {
       sdcard_write_pages_finish();
     }
+    return 0;
   }
-  return 0;
+  return sdcard_write_pages_finish();
 }
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "io/blackbox_device.h"
@@ -140,4 +141,5 @@ uint8_t sdcard_write_page(uint8_t *buf, uint32_t page);
 
 uint8_t sdcard_write_pages_start(uint32_t page, uint32_t count);
 uint8_t sdcard_write_pages_continue(uint8_t *buf);
+bool sdcard_write_buffer_free();
 uint8_t sdcard_write_pages_finish();
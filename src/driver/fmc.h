@@ -17,11 +17,30 @@ typedef uint32_t flash_word_t;
 
 #define FLASH_ALIGN(offset) MEMORY_ALIGN(offset, FLASH_WORD_SIZE)
 
+// the config area is split into banks that can be erased on their own.
+// f4, f7 and h7 only have a single sector reserved for config.
+#if defined(STM32G4) || defined(AT32F4) || defined(SIMULATOR)
+#define FMC_BANK_SIZE 8192
+#define FMC_BANK_COUNT 2
+#else
+#define FMC_BANK_SIZE 16384
+#define FMC_BANK_COUNT 1
+#endif
+
 void fmc_lock();
 void fmc_unlock();
 
-void fmc_erase();
+void fmc_erase(uint32_t bank);
 
 flash_word_t fmc_read(uint32_t addr);
 void fmc_read_buf(uint32_t offset, uint8_t *data, uint32_t size);
 void fmc_write_buf(uint32_t addr, uint8_t *data, uint32_t size);
+
+#ifdef SIMULATOR
+// nor flash emulator controls for tests, power is cut after the given amount of program or erase operations
+void fmc_emulator_reset();
+void fmc_emulator_cut_power(uint32_t ops);
+void fmc_emulator_restore_power();
+uint32_t fmc_emulator_ops();
+uint32_t fmc_emulator_erases();
+#endif
@@ -78,6 +78,7 @@ gyro_types_t gyro_init() {
 
   gyro_bus.port = target.gyro.port;
   gyro_bus.nss = target.gyro.nss;
+  gyro_bus.lane = SPI_LANE_REALTIME;
   spi_bus_device_init(&gyro_bus);
 
   gyro_type = gyro_spi_detect();
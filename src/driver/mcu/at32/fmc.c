@@ -5,7 +5,7 @@
 
 #define FLASH_PTR(offset) (_config_flash + FLASH_ALIGN(offset))
 
-uint8_t __attribute__((section(".config_flash"))) _config_flash[16384];
+uint8_t __attribute__((section(".config_flash"))) _config_flash[FMC_BANK_SIZE * FMC_BANK_COUNT];
 
 void fmc_lock() {
   flash_lock();
@@ -15,8 +15,17 @@ void fmc_unlock() {
   flash_unlock();
 }
 
-void fmc_erase() {
-  flash_block_erase((uint32_t)_config_flash);
+// erases every sector of the bank, works for both 2k and 4k sector parts
+void fmc_erase(uint32_t bank) {
+  if (bank >= FMC_BANK_COUNT) {
+    fmc_lock();
+    failloop(FAILLOOP_FAULT);
+  }
+
+  const uint32_t start = (uint32_t)_config_flash + bank * FMC_BANK_SIZE;
+  for (uint32_t offset = 0; offset < FMC_BANK_SIZE; offset += 2048) {
+    flash_sector_erase(start + offset);
+  }
 }
 
 flash_word_t fmc_read(uint32_t addr) {
@@ -167,20 +167,26 @@ void spi_reconfigure(spi_bus_device_t *bus) {
   }
 }
 
-void spi_dma_transfer_begin(spi_ports_t port, uint8_t *buffer, uint32_t length, bool has_rx) {
+// completion is signalled by the rx channel, without rx data it drains into a single byte
+static uint8_t rx_discard;
+
+void spi_dma_transfer_begin(spi_ports_t port, const uint8_t *tx_data, uint8_t *rx_data, uint32_t length) {
   const dma_stream_def_t *dma_tx = &dma_stream_defs[target.dma[spi_port_defs[port].dma_tx].dma];
   const dma_stream_def_t *dma_rx = &dma_stream_defs[target.dma[spi_port_defs[port].dma_rx].dma];
 
   dma_clear_flag_tc(dma_rx);
   dma_clear_flag_tc(dma_tx);
 
-  dma_prepare_rx_memory(buffer, length);
-  dma_prepare_tx_memory(buffer, length);
+  if (rx_data) {
+    dma_prepare_rx_memory(rx_data, length);
+  }
+  dma_prepare_tx_memory((void *)tx_data, length);
 
-  dma_rx->stream->maddr = (uint32_t)buffer;
+  dma_rx->stream->ctrl_bit.mincm = rx_data != NULL;
+  dma_rx->stream->maddr = rx_data ? (uint32_t)rx_data : (uint32_t)&rx_discard;
   dma_data_number_set(dma_rx->stream, length);
 
-  dma_tx->stream->maddr = (uint32_t)buffer;
+  dma_tx->stream->maddr = (uint32_t)tx_data;
   dma_data_number_set(dma_tx->stream, length);
 
   dma_interrupt_enable(dma_rx->stream, DMA_FDT_INT, TRUE);
@@ -229,7 +235,7 @@ void spi_device_init(spi_ports_t port) {
 }
 
 void spi_seg_submit_wait_ex(spi_bus_device_t *bus, const spi_txn_segment_t *segs, const uint32_t count) {
-  spi_txn_wait(bus);
+  spi_txn_wait_port(bus->port);
 
   while (!spi_txn_can_send(bus, false))
     ;
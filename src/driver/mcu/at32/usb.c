@@ -9,6 +9,7 @@
 #include "driver/gpio.h"
 #include "driver/interrupt.h"
 #include "driver/time.h"
+#include "util/util.h"
 
 extern volatile bool usb_device_configured;
 
@@ -107,11 +108,20 @@ void usb_cdc_tx_handler() {
 
   static volatile bool did_zlp = false;
 
-  static uint8_t buf[USBD_CDC_OUT_MAXPACKET_SIZE];
-  const uint32_t len = ring_buffer_read_multi(&usb_tx_buffer, buf, USBD_CDC_OUT_MAXPACKET_SIZE);
+  // the fifo is filled from the ring while the transfer runs, release the packet once it completed
+  static uint32_t in_flight = 0;
+  if (in_flight) {
+    ring_buffer_read_commit(&usb_tx_buffer, in_flight);
+    in_flight = 0;
+  }
+
+  uint8_t *buf = NULL;
+  const uint32_t len = min(ring_buffer_read_reserve(&usb_tx_buffer, &buf), USBD_CDC_OUT_MAXPACKET_SIZE);
 
   if (len) {
-    usb_vcp_send_data(&otg_core_struct.dev, buf, len);
+    if (usb_vcp_send_data(&otg_core_struct.dev, buf, len) == SUCCESS) {
+      in_flight = len;
+    }
     tx_stalled = false;
 
     // transfers smaller than max size count as zlp
@@ -162,6 +172,18 @@ void usb_serial_write(uint8_t *data, uint32_t len) {
   }
 }
 
+uint32_t usb_serial_write_reserve(uint8_t **data) {
+  return ring_buffer_write_reserve(&usb_tx_buffer, data);
+}
+
+void usb_serial_write_commit(uint32_t len) {
+  if (len == 0) {
+    return;
+  }
+  ring_buffer_write_commit(&usb_tx_buffer, len);
+  usb_cdc_kickoff_tx();
+}
+
 void usb_delay_ms(uint32_t ms) {
   time_delay_ms(ms);
 }
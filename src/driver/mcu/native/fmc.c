@@ -1,49 +1,131 @@
 #include "driver/fmc.h"
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "core/project.h"
 
 #define FILENAME "flash.bin"
+#define FLASH_SIZE (FMC_BANK_SIZE * FMC_BANK_COUNT)
 
-void fmc_lock() {
+// emulates nor flash: erase sets bytes to 0xff, programming can only clear bits
+static uint8_t flash[FLASH_SIZE];
+static bool flash_loaded = false;
+
+static uint32_t flash_ops = 0;
+static uint32_t flash_erases = 0;
+static uint32_t flash_cut_at = 0;
+static bool flash_cut = false;
+
+static void flash_load_file() {
+  if (flash_loaded) {
+    return;
+  }
+  flash_loaded = true;
+
+  memset(flash, 0xFF, FLASH_SIZE);
+
+  FILE *file = fopen(FILENAME, "rb");
+  if (file == NULL) {
+    return;
+  }
+  fread(flash, FLASH_SIZE, 1, file);
+  fclose(file);
 }
 
-void fmc_unlock() {
+static void flash_store_file() {
+  FILE *file = fopen(FILENAME, "wb");
+  if (file == NULL) {
+    return;
+  }
+  fwrite(flash, FLASH_SIZE, 1, file);
+  fclose(file);
 }
 
-void fmc_erase() {
-  remove(FILENAME);
+// returns how many bytes of the operation make it before the power is cut
+static uint32_t flash_op(uint32_t size) {
+  flash_ops++;
+  if (!flash_cut || flash_ops <= flash_cut_at) {
+    return size;
+  }
+  if (flash_ops == flash_cut_at + 1) {
+    // the operation in flight when the power goes only half completes
+    return size / 2;
+  }
+  return 0;
 }
 
-static FILE *open_file() {
-  FILE *file = fopen(FILENAME, "rb+");
-  if (file == NULL) {
-    file = fopen(FILENAME, "wb+");
+void fmc_emulator_reset() {
+  memset(flash, 0xFF, FLASH_SIZE);
+  flash_loaded = true;
+  flash_ops = 0;
+  flash_erases = 0;
+  flash_cut = false;
+}
+
+void fmc_emulator_cut_power(uint32_t ops) {
+  flash_ops = 0;
+  flash_cut_at = ops;
+  flash_cut = true;
+}
+
+void fmc_emulator_restore_power() {
+  flash_cut = false;
+}
+
+uint32_t fmc_emulator_ops() {
+  return flash_ops;
+}
+
+uint32_t fmc_emulator_erases() {
+  return flash_erases;
+}
+
+void fmc_lock() {
+  flash_store_file();
+}
+
+void fmc_unlock() {
+  flash_load_file();
+}
+
+void fmc_erase(uint32_t bank) {
+  flash_load_file();
+  if (bank >= FMC_BANK_COUNT) {
+    return;
   }
-  return file;
+
+  flash_erases++;
+  memset(flash + bank * FMC_BANK_SIZE, 0xFF, flash_op(FMC_BANK_SIZE));
 }
 
 flash_word_t fmc_read(uint32_t addr) {
-  FILE *file = open_file();
-  fseek(file, addr, SEEK_SET);
+  flash_load_file();
+
   flash_word_t value;
-  fread(&value, sizeof(flash_word_t), 1, file);
-  fclose(file);
+  memcpy(&value, flash + addr, sizeof(flash_word_t));
   return value;
 }
 
 void fmc_read_buf(uint32_t addr, uint8_t *data, uint32_t size) {
-  FILE *file = open_file();
-  fseek(file, addr, SEEK_SET);
-  fread(data, size, 1, file);
-  fclose(file);
+  flash_load_file();
+  if (addr + size > FLASH_SIZE) {
+    return;
+  }
+  memcpy(data, flash + addr, size);
 }
 
 void fmc_write_buf(uint32_t addr, uint8_t *data, uint32_t size) {
-  FILE *file = open_file();
-  fseek(file, addr, SEEK_SET);
-  fwrite(data, size, 1, file);
-  fclose(file);
-}
\ No newline at end of file
+  flash_load_file();
+  if (addr + size > FLASH_SIZE) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < size; i += FLASH_WORD_SIZE) {
+    const uint32_t len = flash_op(FLASH_WORD_SIZE);
+    for (uint32_t j = 0; j < len; j++) {
+      flash[addr + i + j] &= data[i + j];
+    }
+  }
+}
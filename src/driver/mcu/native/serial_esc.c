@@ -0,0 +1,300 @@
+#include "driver/serial_esc.h"
+
+#include <string.h>
+
+#include "core/target.h"
+#include "util/crc.h"
+
+// emulates a blheli_s bootloader on a silabs efm8 behind each pin
+#define ESC_SIGNATURE 0xE8B2
+#define ESC_FLASH_SIZE (16 * 1024)
+#define ESC_PAGE_SIZE 512
+
+// flash timings of the mcu, the rest is the time spent on the wire
+#define ESC_PROG_NS_PER_BYTE 20000
+#define ESC_ERASE_NS 20000000
+#define ESC_TURNAROUND_NS 50000
+
+#define BOOT_INIT_SIZE 17
+
+#define brSUCCESS 0x30
+#define brERRORCOMMAND 0xC1
+#define brERRORCRC 0xC2
+
+typedef struct {
+  gpio_pins_t pin;
+  bool absent; // nothing on the wire, frames are lost
+  bool connected;
+  uint16_t signature;
+
+  uint16_t addr;
+  uint32_t buffer_pending; // bytes expected after a set buffer command
+  uint32_t buffer_size;
+  uint8_t buffer[256];
+
+  uint8_t rx[256 + 2];
+  uint32_t rx_len;
+
+  uint8_t tx[256 + 3];
+  uint32_t tx_len;
+  uint32_t tx_pos;
+  uint64_t ready_ns; // time the response starts
+
+  uint8_t flash[ESC_FLASH_SIZE];
+} esc_emulator_t;
+
+static esc_emulator_t escs[MOTOR_PIN_MAX];
+static uint32_t esc_count = 0;
+static uint64_t time_ns = 0;
+
+static uint64_t byte_time_ns(uint32_t baud) {
+  return 10ULL * 1000000000ULL / baud;
+}
+
+static esc_emulator_t *esc_emulator_find(gpio_pins_t pin) {
+  for (uint32_t i = 0; i < esc_count; i++) {
+    if (escs[i].pin == pin) {
+      return &escs[i];
+    }
+  }
+  if (esc_count == MOTOR_PIN_MAX) {
+    return NULL;
+  }
+
+  esc_emulator_t *esc = &escs[esc_count++];
+  memset(esc, 0, sizeof(esc_emulator_t));
+  memset(esc->flash, 0xFF, ESC_FLASH_SIZE);
+  esc->pin = pin;
+  esc->signature = ESC_SIGNATURE;
+  return esc;
+}
+
+void esc_emulator_reset() {
+  esc_count = 0;
+  time_ns = 0;
+}
+
+uint32_t esc_emulator_time_us() {
+  return time_ns / 1000;
+}
+
+uint8_t *esc_emulator_flash(gpio_pins_t pin) {
+  esc_emulator_t *esc = esc_emulator_find(pin);
+  return esc ? esc->flash : NULL;
+}
+
+void esc_emulator_set_absent(gpio_pins_t pin, bool absent) {
+  esc_emulator_t *esc = esc_emulator_find(pin);
+  if (esc != NULL) {
+    esc->absent = absent;
+  }
+}
+
+void esc_emulator_set_signature(gpio_pins_t pin, uint16_t signature) {
+  esc_emulator_t *esc = esc_emulator_find(pin);
+  if (esc != NULL) {
+    esc->signature = signature;
+  }
+}
+
+bool esc_emulator_connected(gpio_pins_t pin) {
+  esc_emulator_t *esc = esc_emulator_find(pin);
+  return esc != NULL && esc->connected;
+}
+
+static void esc_emulator_respond(esc_emulator_t *esc, const uint8_t *data, uint32_t len, bool crc, uint8_t ack, uint64_t busy_ns) {
+  memcpy(esc->tx, data, len);
+  esc->tx_len = len;
+  if (crc) {
+    const uint16_t c = crc16_arc_data(0, data, len);
+    esc->tx[esc->tx_len++] = c & 0xFF;
+    esc->tx[esc->tx_len++] = c >> 8;
+  }
+  esc->tx[esc->tx_len++] = ack;
+  esc->tx_pos = 0;
+  esc->ready_ns = time_ns + ESC_TURNAROUND_NS + busy_ns;
+}
+
+static void esc_emulator_ack(esc_emulator_t *esc, uint8_t ack, uint64_t busy_ns) {
+  esc_emulator_respond(esc, NULL, 0, false, ack, busy_ns);
+}
+
+static uint32_t esc_emulator_frame_size(esc_emulator_t *esc) {
+  if (!esc->connected) {
+    return BOOT_INIT_SIZE;
+  }
+  if (esc->buffer_pending) {
+    return esc->buffer_pending + 2;
+  }
+  switch (esc->rx[0]) {
+  case 0xFF: // set address
+  case 0xFE: // set buffer
+    return 4 + 2;
+  default:
+    return 2 + 2;
+  }
+}
+
+static void esc_emulator_boot_init(esc_emulator_t *esc) {
+  if (memcmp(esc->rx + 9, "BLHeli", 6) != 0) {
+    return;
+  }
+
+  const uint8_t info[8] = {'4', '7', '1', 'c', esc->signature >> 8, esc->signature & 0xFF, 6, 1};
+  esc_emulator_respond(esc, info, 8, false, brSUCCESS, 0);
+  esc->connected = true;
+}
+
+static void esc_emulator_command(esc_emulator_t *esc) {
+  const uint32_t len = esc->rx_len - 2;
+  const uint16_t crc = esc->rx[len] | (esc->rx[len + 1] << 8);
+  if (crc != crc16_arc_data(0, esc->rx, len)) {
+    esc->buffer_pending = 0;
+    esc_emulator_ack(esc, brERRORCRC, 0);
+    return;
+  }
+
+  if (esc->buffer_pending) {
+    esc->buffer_size = esc->buffer_pending;
+    esc->buffer_pending = 0;
+    memcpy(esc->buffer, esc->rx, esc->buffer_size);
+    esc_emulator_ack(esc, brSUCCESS, 0);
+    return;
+  }
+
+  const uint8_t *rx = esc->rx;
+  switch (rx[0]) {
+  case 0x00: // run
+    esc->connected = false;
+    break;
+
+  case 0xFF: // set address
+    esc->addr = (rx[2] << 8) | rx[3];
+    esc_emulator_ack(esc, brSUCCESS, 0);
+    break;
+
+  case 0xFE: // set buffer, acked only after the data
+    esc->buffer_pending = (rx[2] << 8) | rx[3];
+    if (esc->buffer_pending == 0 || esc->buffer_pending > 256) {
+      esc->buffer_pending = 0;
+      esc_emulator_ack(esc, brERRORCOMMAND, 0);
+    }
+    break;
+
+  case 0x01: { // program flash, bits can only be cleared
+    const uint32_t size = esc->buffer_size ? esc->buffer_size : 256;
+    for (uint32_t i = 0; i < size && esc->addr + i < ESC_FLASH_SIZE; i++) {
+      esc->flash[esc->addr + i] &= esc->buffer[i];
+    }
+    esc_emulator_ack(esc, brSUCCESS, size * ESC_PROG_NS_PER_BYTE);
+    break;
+  }
+
+  case 0x02: // erase page
+    if (esc->addr < ESC_FLASH_SIZE) {
+      memset(esc->flash + (esc->addr / ESC_PAGE_SIZE) * ESC_PAGE_SIZE, 0xFF, ESC_PAGE_SIZE);
+    }
+    esc_emulator_ack(esc, brSUCCESS, ESC_ERASE_NS);
+    break;
+
+  case 0x03: { // read flash
+    const uint32_t size = rx[1] ? rx[1] : 256;
+    if (esc->addr + size > ESC_FLASH_SIZE) {
+      esc_emulator_ack(esc, brERRORCOMMAND, 0);
+      break;
+    }
+    esc_emulator_respond(esc, esc->flash + esc->addr, size, true, brSUCCESS, 0);
+    break;
+  }
+
+  default:
+    // includes keep alive
+    esc_emulator_ack(esc, brERRORCOMMAND, 0);
+    break;
+  }
+}
+
+static void esc_emulator_receive(esc_emulator_t *esc, uint8_t data) {
+  if (esc->absent) {
+    return;
+  }
+
+  // a new frame drops whatever response was not read
+  esc->tx_len = 0;
+
+  esc->rx[esc->rx_len++] = data;
+  if (esc->rx_len < esc_emulator_frame_size(esc)) {
+    return;
+  }
+
+  if (!esc->connected) {
+    esc_emulator_boot_init(esc);
+  } else {
+    esc_emulator_command(esc);
+  }
+  esc->rx_len = 0;
+}
+
+static bool esc_emulator_transmit(esc_emulator_t *esc, uint8_t *data) {
+  if (esc->tx_pos >= esc->tx_len) {
+    return false;
+  }
+  if (esc->tx_pos == 0 && esc->ready_ns > time_ns) {
+    time_ns = esc->ready_ns;
+  }
+  *data = esc->tx[esc->tx_pos++];
+  return true;
+}
+
+bool serial_esc_read_timeout(gpio_pins_t pin, uint32_t baud, uint8_t *bt, uint32_t timeout_us) {
+  esc_emulator_t *esc = esc_emulator_find(pin);
+  if (esc == NULL || !esc_emulator_transmit(esc, bt)) {
+    time_ns += timeout_us * 1000ULL;
+    return false;
+  }
+  time_ns += byte_time_ns(baud);
+  return true;
+}
+
+uint32_t serial_esc_read_multi(const gpio_pins_t *pins, uint32_t count, uint32_t baud, uint8_t *bytes, uint32_t timeout_us) {
+  const uint64_t start_ns = time_ns;
+  uint64_t end_ns = start_ns;
+
+  // every esc answers on its own wire at the same time
+  uint32_t received = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    time_ns = start_ns;
+
+    esc_emulator_t *esc = esc_emulator_find(pins[i]);
+    if (esc != NULL && esc_emulator_transmit(esc, &bytes[i])) {
+      received |= 1 << i;
+      time_ns += byte_time_ns(baud);
+    } else {
+      time_ns += timeout_us * 1000ULL;
+    }
+
+    if (time_ns > end_ns) {
+      end_ns = time_ns;
+    }
+  }
+
+  time_ns = end_ns;
+  return received;
+}
+
+void serial_esc_write(gpio_pins_t pin, uint32_t baud, uint8_t data) {
+  serial_esc_write_buf(&pin, 1, baud, &data, 1);
+}
+
+void serial_esc_write_buf(const gpio_pins_t *pins, uint32_t count, uint32_t baud, const uint8_t *buf, uint32_t size) {
+  for (uint32_t i = 0; i < size; i++) {
+    time_ns += byte_time_ns(baud);
+
+    for (uint32_t j = 0; j < count; j++) {
+      esc_emulator_t *esc = esc_emulator_find(pins[j]);
+      if (esc != NULL) {
+        esc_emulator_receive(esc, buf[i]);
+      }
+    }
+  }
+}
@@ -40,6 +40,149 @@ const spi_port_def_t spi_port_defs[SPI_PORT_MAX] = {
 
 extern FAST_RAM spi_txn_t txn_pool[SPI_TXN_MAX];
 
+// Called by interrupt handler to finish SPI transaction
+extern void spi_txn_finish(spi_ports_t port);
+
+#define SPI_EMULATOR_DEVICE_MAX 8
+
+typedef struct {
+  spi_ports_t port;
+  gpio_pins_t nss;
+  spi_emulator_device_t *dev;
+} spi_emulator_slot_t;
+
+typedef struct {
+  bool has_device;
+  spi_emulator_device_t *selected;
+
+  // the dma transfer in flight and when its isr fires
+  bool busy;
+  uint64_t isr_ns;
+} spi_emulator_port_t;
+
+static spi_emulator_slot_t slots[SPI_EMULATOR_DEVICE_MAX];
+static uint32_t slot_count = 0;
+static spi_emulator_port_t ports[SPI_PORT_MAX];
+
+static uint64_t time_ns = 0;
+static uint64_t byte_offset_ns = 0; // of the byte being clocked, models see the time it ends
+static uint32_t isr_latency_ns = 0;
+
+void spi_emulator_reset() {
+  slot_count = 0;
+  memset(ports, 0, sizeof(ports));
+  time_ns = 0;
+  isr_latency_ns = 0;
+}
+
+void spi_emulator_attach(spi_ports_t port, gpio_pins_t nss, spi_emulator_device_t *dev) {
+  if (slot_count == SPI_EMULATOR_DEVICE_MAX) {
+    failloop(FAILLOOP_SPI);
+  }
+
+  dev->bytes = 0;
+  dev->selects = 0;
+  slots[slot_count++] = (spi_emulator_slot_t){
+      .port = port,
+      .nss = nss,
+      .dev = dev,
+  };
+  ports[port].has_device = true;
+}
+
+void spi_emulator_set_isr_latency(uint32_t ns) {
+  isr_latency_ns = ns;
+}
+
+uint64_t spi_emulator_time_ns() {
+  return time_ns + byte_offset_ns;
+}
+
+static spi_emulator_device_t *spi_emulator_find(spi_ports_t port, gpio_pins_t nss) {
+  for (uint32_t i = 0; i < slot_count; i++) {
+    if (slots[i].port == port && slots[i].nss == nss) {
+      return slots[i].dev;
+    }
+  }
+  return NULL;
+}
+
+static void spi_emulator_select(spi_ports_t port, gpio_pins_t nss) {
+  spi_emulator_port_t *p = &ports[port];
+  p->selected = spi_emulator_find(port, nss);
+  if (p->selected) {
+    p->selected->selects++;
+    if (p->selected->select) {
+      p->selected->select(p->selected);
+    }
+  }
+}
+
+static void spi_emulator_deselect(spi_ports_t port) {
+  spi_emulator_port_t *p = &ports[port];
+  if (p->selected && p->selected->deselect) {
+    p->selected->deselect(p->selected);
+  }
+  p->selected = NULL;
+}
+
+// clocks the bytes through the selected model and returns the time they take on the wire
+static uint64_t spi_emulator_clock(spi_ports_t port, const uint8_t *tx_data, uint8_t *rx_data, uint32_t length) {
+  spi_emulator_device_t *dev = ports[port].selected;
+  const uint32_t hz = spi_dev[port].hz;
+  const uint64_t byte_ns = hz ? 8ULL * 1000000000ULL / hz : 0;
+
+  for (uint32_t i = 0; i < length; i++) {
+    const uint8_t tx = tx_data ? tx_data[i] : 0xFF;
+
+    uint8_t rx = 0;
+    if (dev) {
+      byte_offset_ns = (i + 1) * byte_ns;
+      rx = dev->transfer(dev, tx);
+      dev->bytes++;
+    } else {
+      // Echo back inverted data for simulation
+      rx = tx != 0 ? ~tx : 0;
+    }
+
+    if (rx_data) {
+      rx_data[i] = rx;
+    }
+  }
+  byte_offset_ns = 0;
+
+  return length * byte_ns;
+}
+
+void spi_emulator_poll(spi_ports_t port) {
+  // ports without a model are completed by hand
+  if (ports[port].has_device && ports[port].busy) {
+    spi_dma_complete_port(port);
+  }
+}
+
+void spi_emulator_advance(uint32_t us) {
+  const uint64_t end_ns = time_ns + us * 1000ULL;
+
+  while (true) {
+    spi_ports_t next = SPI_PORT_INVALID;
+    for (uint32_t i = 1; i < SPI_PORT_MAX; i++) {
+      if (!ports[i].busy || ports[i].isr_ns > end_ns) {
+        continue;
+      }
+      if (next == SPI_PORT_INVALID || ports[i].isr_ns < ports[next].isr_ns) {
+        next = i;
+      }
+    }
+    if (next == SPI_PORT_INVALID) {
+      break;
+    }
+    spi_dma_complete_port(next);
+  }
+
+  time_ns = end_ns;
+}
+
 void spi_device_init(spi_ports_t port) {
   if (port >= SPI_PORT_MAX || port == 0) {
     return;
@@ -49,12 +192,14 @@ void spi_device_init(spi_ports_t port) {
   
   dev->is_init = true;
   dev->dma_done = true;
-  dev->txn_head = 0;
-  dev->txn_tail = 0;
+  memset(dev->lanes, 0, sizeof(dev->lanes));
   dev->mode = SPI_MODE_LEADING_EDGE;
   dev->hz = 1000000;  // Default 1MHz
+
+  ports[port].busy = false;
 }
 
+// called once at the start of every transaction, which also ends the previous one
 void spi_reconfigure(spi_bus_device_t *bus) {
   if (bus->port >= SPI_PORT_MAX || bus->port == 0) {
     return;
@@ -67,36 +212,45 @@ void spi_reconfigure(spi_bus_device_t *bus) {
   
   dev->mode = bus->mode;
   dev->hz = bus->hz;
+
+  spi_emulator_deselect(bus->port);
+  spi_emulator_select(bus->port, bus->nss);
 }
 
-void spi_dma_transfer_begin(spi_ports_t port, uint8_t *buffer, uint32_t length, bool has_rx) {
+void spi_dma_transfer_begin(spi_ports_t port, const uint8_t *tx_data, uint8_t *rx_data, uint32_t length) {
   if (port >= SPI_PORT_MAX || port == 0) {
     return;
   }
-  
-  // Simulate SPI transfer - in a real simulator this could interface with
-  // external hardware simulation or just echo data back
-  
-  // For now, we'll just copy TX data to RX data if applicable
-  if (has_rx) {
-    // Simulate some response data
-    for (uint32_t i = 0; i < length; i++) {
-      if (buffer[i] != 0) {
-        // Echo back inverted data for simulation
-        buffer[i] = ~buffer[i];
-      }
-    }
-  }
-  
-  // Mark DMA as complete immediately (no actual DMA in simulator)
-  spi_dev[port].dma_done = true;
+
+  // the data is exchanged right away, the isr only fires once the wire time has passed
+  spi_emulator_port_t *p = &ports[port];
+  p->isr_ns = time_ns + spi_emulator_clock(port, tx_data, rx_data, length) + isr_latency_ns;
+  p->busy = true;
 }
 
 void spi_seg_submit_wait_ex(spi_bus_device_t *bus, const spi_txn_segment_t *segs, const uint32_t count) {
-}
+  const spi_ports_t port = bus->port;
+  if (port >= SPI_PORT_MAX || port == 0) {
+    return;
+  }
 
-// Called by interrupt handler to finish SPI transaction
-extern void spi_txn_finish(spi_ports_t port);
+  spi_txn_wait_port(port);
+
+  spi_dev[port].dma_done = false;
+  spi_reconfigure(bus);
+
+  for (uint32_t i = 0; i < count; i++) {
+    const spi_txn_segment_t *seg = &segs[i];
+    if (seg->type == TXN_CONST) {
+      time_ns += spi_emulator_clock(port, seg->bytes, NULL, seg->size);
+    } else {
+      time_ns += spi_emulator_clock(port, seg->tx_data, seg->rx_data, seg->size);
+    }
+  }
+
+  spi_emulator_deselect(port);
+  spi_dev[port].dma_done = true;
+}
 
 // Since we don't have actual hardware interrupts in the simulator,
 // we need to poll for completion
@@ -104,8 +258,21 @@ void spi_dma_complete_port(spi_ports_t port) {
   if (port >= SPI_PORT_MAX || port == 0) {
     return;
   }
-  
-  if (spi_dev[port].dma_done) {
+
+  spi_emulator_port_t *p = &ports[port];
+  if (p->busy) {
+    p->busy = false;
+    if (p->isr_ns > time_ns) {
+      time_ns = p->isr_ns;
+    }
+  }
+
+  if (!spi_dev[port].dma_done) {
     spi_txn_finish(port);
   }
-}
\ No newline at end of file
+
+  // nothing followed on the port, the chip select goes high
+  if (spi_dev[port].dma_done) {
+    spi_emulator_deselect(port);
+  }
+}
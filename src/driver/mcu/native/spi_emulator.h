@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/spi.h"
+
+// chip models for spi_emulator_attach, each one is reset by its init
+
+#define SPI_EMULATOR_ICM42688_FIFO_SIZE 2048
+
+typedef struct {
+  spi_emulator_device_t dev;
+
+  uint8_t bank;
+  uint8_t regs[4][128];
+
+  bool has_addr;
+  bool read;
+  uint8_t addr;
+
+  uint8_t fifo[SPI_EMULATOR_ICM42688_FIFO_SIZE];
+  uint32_t fifo_tail;
+  uint32_t fifo_count;
+} spi_emulator_icm42688_t;
+
+void spi_emulator_icm42688_init(spi_emulator_icm42688_t *imu);
+// latches a sample into the data registers and the fifo, if it is enabled
+void spi_emulator_icm42688_push(spi_emulator_icm42688_t *imu, const int16_t accel[3], const int16_t gyro[3], int16_t temp);
+
+#define SPI_EMULATOR_M25P16_SIZE (2 * 1024 * 1024)
+#define SPI_EMULATOR_M25P16_PAGE_SIZE 256
+
+typedef struct {
+  spi_emulator_device_t dev;
+
+  uint32_t jedec_id;
+  bool write_enable;
+  uint64_t busy_until_ns;
+
+  uint8_t cmd;
+  uint32_t pos;
+  uint32_t addr;
+
+  // page program latch, written on deselect
+  uint8_t page[SPI_EMULATOR_M25P16_PAGE_SIZE];
+  uint32_t page_bytes;
+
+  uint32_t programs;
+  uint32_t erases;
+
+  uint8_t memory[SPI_EMULATOR_M25P16_SIZE];
+} spi_emulator_m25p16_t;
+
+void spi_emulator_m25p16_init(spi_emulator_m25p16_t *flash);
+
+#define SPI_EMULATOR_SDCARD_SIZE (4 * 1024 * 1024)
+#define SPI_EMULATOR_SDCARD_BLOCK_SIZE 512
+
+typedef enum {
+  SPI_EMULATOR_SDCARD_COMMAND,
+  SPI_EMULATOR_SDCARD_READ_MULTIPLE,
+  SPI_EMULATOR_SDCARD_WRITE_TOKEN,
+  SPI_EMULATOR_SDCARD_WRITE_DATA,
+} spi_emulator_sdcard_state_t;
+
+typedef struct {
+  spi_emulator_device_t dev;
+
+  spi_emulator_sdcard_state_t state;
+  bool idle;
+  bool app_cmd;
+  bool write_multiple;
+  uint64_t busy_until_ns;
+
+  uint8_t cmd[6];
+  uint32_t cmd_len;
+
+  // bytes the card shifts out next, 0xFF or busy once empty
+  uint8_t out[SPI_EMULATOR_SDCARD_BLOCK_SIZE + 8];
+  uint32_t out_pos;
+  uint32_t out_len;
+
+  uint32_t block;
+  uint8_t data[SPI_EMULATOR_SDCARD_BLOCK_SIZE + 2];
+  uint32_t data_len;
+
+  uint32_t blocks_read;
+  uint32_t blocks_written;
+
+  uint8_t memory[SPI_EMULATOR_SDCARD_SIZE];
+} spi_emulator_sdcard_t;
+
+void spi_emulator_sdcard_init(spi_emulator_sdcard_t *card);
+
+#define SPI_EMULATOR_MAX7456_CHARS (16 * 30)
+
+typedef struct {
+  spi_emulator_device_t dev;
+
+  uint8_t regs[16];
+  uint8_t black_level;
+  uint8_t stat;
+
+  bool has_addr;
+  uint8_t addr;
+
+  uint16_t display_addr;
+  uint8_t display[SPI_EMULATOR_MAX7456_CHARS];
+  uint8_t attrs[SPI_EMULATOR_MAX7456_CHARS];
+  uint32_t clears;
+
+  uint8_t char_ram[64];
+  uint8_t nvm[256][64];
+} spi_emulator_max7456_t;
+
+// stat is what the chip reports about the video input, 0x01 for pal
+void spi_emulator_max7456_init(spi_emulator_max7456_t *osd, uint8_t stat);
+
+typedef struct {
+  spi_emulator_device_t dev;
+
+  uint8_t mode;
+  uint8_t cmd;
+  uint32_t pos;
+  uint8_t params[8];
+  uint16_t addr;
+
+  uint16_t irq;
+  uint16_t irq_mask;
+  uint16_t dio1_mask;
+
+  uint8_t tx_base;
+  uint8_t rx_base;
+  uint8_t rx_len;
+  int8_t rssi;
+
+  uint8_t buffer[256];
+  uint8_t regs[0x1000];
+} spi_emulator_sx1280_t;
+
+void spi_emulator_sx1280_init(spi_emulator_sx1280_t *radio);
+// a packet arriving over the air, dropped unless the radio listens
+bool spi_emulator_sx1280_receive(spi_emulator_sx1280_t *radio, const uint8_t *data, uint8_t len, int8_t rssi);
+bool spi_emulator_sx1280_dio1(const spi_emulator_sx1280_t *radio);
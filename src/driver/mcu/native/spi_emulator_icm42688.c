@@ -0,0 +1,161 @@
+#include "driver/mcu/native/spi_emulator.h"
+
+#include <string.h>
+
+#include "driver/gyro/icm42605.h"
+
+#define ICM42688P_ID 0x47
+
+#define FIFO_HEADER_ACCEL_GYRO 0x68
+#define FIFO_PACKET_SIZE 16
+
+static uint8_t icm42688_read_reg(spi_emulator_icm42688_t *imu, uint8_t reg) {
+  if (reg == ICM42605_REG_BANK_SEL) {
+    return imu->bank;
+  }
+  if (imu->bank != 0) {
+    return imu->regs[imu->bank][reg];
+  }
+
+  switch (reg) {
+  case ICM42605_FIFO_COUNTH:
+    return imu->fifo_count >> 8;
+
+  case ICM42605_FIFO_COUNTL:
+    return imu->fifo_count & 0xFF;
+
+  case ICM42605_FIFO_DATA: {
+    if (imu->fifo_count == 0) {
+      return 0xFF;
+    }
+    const uint8_t data = imu->fifo[imu->fifo_tail];
+    imu->fifo_tail = (imu->fifo_tail + 1) % SPI_EMULATOR_ICM42688_FIFO_SIZE;
+    imu->fifo_count--;
+    return data;
+  }
+
+  case ICM42605_INT_STATUS: {
+    // cleared on read
+    const uint8_t status = imu->regs[0][reg];
+    imu->regs[0][reg] = 0;
+    return status;
+  }
+
+  default:
+    return imu->regs[0][reg];
+  }
+}
+
+static void icm42688_reset(spi_emulator_icm42688_t *imu) {
+  memset(imu->regs, 0, sizeof(imu->regs));
+  imu->regs[0][ICM42605_WHO_AM_I] = ICM42688P_ID;
+  imu->bank = 0;
+  imu->fifo_tail = 0;
+  imu->fifo_count = 0;
+}
+
+static void icm42688_write_reg(spi_emulator_icm42688_t *imu, uint8_t reg, uint8_t data) {
+  if (reg == ICM42605_REG_BANK_SEL) {
+    imu->bank = data & 0x03;
+    return;
+  }
+  if (imu->bank != 0) {
+    imu->regs[imu->bank][reg] = data;
+    return;
+  }
+
+  switch (reg) {
+  case ICM42605_DEVICE_CONFIG:
+    if (data & 0x01) {
+      icm42688_reset(imu);
+    }
+    break;
+
+  case ICM42605_SIGNAL_PATH_RESET:
+    if (data & 0x02) {
+      imu->fifo_count = 0;
+    }
+    break;
+
+  case ICM42605_WHO_AM_I:
+  case ICM42605_FIFO_COUNTH:
+  case ICM42605_FIFO_COUNTL:
+  case ICM42605_FIFO_DATA:
+    break;
+
+  default:
+    imu->regs[0][reg] = data;
+    break;
+  }
+}
+
+static void icm42688_select(spi_emulator_device_t *dev) {
+  spi_emulator_icm42688_t *imu = (spi_emulator_icm42688_t *)dev;
+  imu->has_addr = false;
+}
+
+static uint8_t icm42688_transfer(spi_emulator_device_t *dev, uint8_t data) {
+  spi_emulator_icm42688_t *imu = (spi_emulator_icm42688_t *)dev;
+
+  if (!imu->has_addr) {
+    imu->has_addr = true;
+    imu->read = data & 0x80;
+    imu->addr = data & 0x7F;
+    return 0x00;
+  }
+
+  // bursts increment the address, except when streaming the fifo
+  const uint8_t reg = imu->addr;
+  if (reg != ICM42605_FIFO_DATA) {
+    imu->addr = (imu->addr + 1) & 0x7F;
+  }
+
+  if (imu->read) {
+    return icm42688_read_reg(imu, reg);
+  }
+  icm42688_write_reg(imu, reg, data);
+  return 0x00;
+}
+
+void spi_emulator_icm42688_init(spi_emulator_icm42688_t *imu) {
+  memset(imu, 0, sizeof(spi_emulator_icm42688_t));
+  imu->dev.select = icm42688_select;
+  imu->dev.transfer = icm42688_transfer;
+  icm42688_reset(imu);
+}
+
+static void icm42688_put_be16(uint8_t *buf, int16_t val) {
+  buf[0] = (uint16_t)val >> 8;
+  buf[1] = val & 0xFF;
+}
+
+void spi_emulator_icm42688_push(spi_emulator_icm42688_t *imu, const int16_t accel[3], const int16_t gyro[3], int16_t temp) {
+  uint8_t *regs = imu->regs[0];
+
+  icm42688_put_be16(&regs[ICM42605_TEMP_DATA1], temp);
+  for (uint32_t i = 0; i < 3; i++) {
+    icm42688_put_be16(&regs[ICM42605_ACCEL_DATA_X1 + i * 2], accel[i]);
+    icm42688_put_be16(&regs[ICM42605_GYRO_DATA_X1 + i * 2], gyro[i]);
+  }
+  regs[ICM42605_INT_STATUS] |= 0x08; // DATA_RDY_INT
+
+  // bypass mode, or no room for the whole packet
+  if ((regs[ICM42605_FIFO_CONFIG] >> 6) == 0 || imu->fifo_count + FIFO_PACKET_SIZE > SPI_EMULATOR_ICM42688_FIFO_SIZE) {
+    return;
+  }
+
+  uint8_t packet[FIFO_PACKET_SIZE];
+  packet[0] = FIFO_HEADER_ACCEL_GYRO;
+  for (uint32_t i = 0; i < 3; i++) {
+    icm42688_put_be16(&packet[1 + i * 2], accel[i]);
+    icm42688_put_be16(&packet[7 + i * 2], gyro[i]);
+  }
+  packet[13] = temp >> 8;
+  packet[14] = 0;
+  packet[15] = 0;
+
+  for (uint32_t i = 0; i < FIFO_PACKET_SIZE; i++) {
+    imu->fifo[(imu->fifo_tail + imu->fifo_count) % SPI_EMULATOR_ICM42688_FIFO_SIZE] = packet[i];
+    imu->fifo_count++;
+  }
+}
@@ -0,0 +1,162 @@
+#include "driver/mcu/native/spi_emulator.h"
+
+#include <string.h>
+
+#include "driver/blackbox/m25p16.h"
+
+#define JEDEC_ID_MICRON_M25P16 0x202015
+
+#define SECTOR_SIZE (64 * 1024)
+
+// typical timings from the m25p16 datasheet
+#define PAGE_PROGRAM_NS 640000ULL
+#define SECTOR_ERASE_NS 600000000ULL
+#define BULK_ERASE_NS 13000000000ULL
+
+static bool m25p16_busy(const spi_emulator_m25p16_t *flash) {
+  return spi_emulator_time_ns() < flash->busy_until_ns;
+}
+
+static void m25p16_select(spi_emulator_device_t *dev) {
+  spi_emulator_m25p16_t *flash = (spi_emulator_m25p16_t *)dev;
+  flash->pos = 0;
+  flash->addr = 0;
+  flash->page_bytes = 0;
+}
+
+static uint8_t m25p16_transfer(spi_emulator_device_t *dev, uint8_t data) {
+  spi_emulator_m25p16_t *flash = (spi_emulator_m25p16_t *)dev;
+
+  const uint32_t pos = flash->pos++;
+  if (pos == 0) {
+    flash->cmd = data;
+    switch (data) {
+    case M25P16_WRITE_ENABLE:
+      if (!m25p16_busy(flash)) {
+        flash->write_enable = true;
+      }
+      break;
+
+    case M25P16_WRITE_DISABLE:
+      if (!m25p16_busy(flash)) {
+        flash->write_enable = false;
+      }
+      break;
+    }
+    return 0xFF;
+  }
+
+  switch (flash->cmd) {
+  case M25P16_READ_STATUS_REGISTER:
+    return (flash->write_enable ? 0x02 : 0x00) | (m25p16_busy(flash) ? 0x01 : 0x00);
+
+  case M25P16_READ_IDENTIFICATION:
+    if (pos > 3) {
+      return 0x00;
+    }
+    return flash->jedec_id >> ((3 - pos) * 8);
+
+  case M25P16_READ_DATA_BYTES:
+  case M25P16_READ_DATA_BYTES_BURST:
+  case M25P16_PAGE_PROGRAM:
+  case M25P16_SECTOR_ERASE:
+    break;
+
+  default:
+    return 0xFF;
+  }
+
+  if (pos <= 3) {
+    flash->addr = (flash->addr << 8) | data;
+    return 0xFF;
+  }
+
+  switch (flash->cmd) {
+  case M25P16_READ_DATA_BYTES_BURST:
+    // one dummy byte before the data
+    if (pos == 4) {
+      return 0xFF;
+    }
+    __attribute__((fallthrough));
+  case M25P16_READ_DATA_BYTES: {
+    if (m25p16_busy(flash)) {
+      return 0xFF;
+    }
+    const uint8_t val = flash->memory[flash->addr % SPI_EMULATOR_M25P16_SIZE];
+    flash->addr++;
+    return val;
+  }
+
+  case M25P16_PAGE_PROGRAM: {
+    // the address wraps inside the page, the last bytes sent win
+    const uint32_t offset = (flash->addr + pos - 4) % SPI_EMULATOR_M25P16_PAGE_SIZE;
+    if (flash->page_bytes == 0) {
+      memset(flash->page, 0xFF, SPI_EMULATOR_M25P16_PAGE_SIZE);
+    }
+    flash->page[offset] = data;
+    if (flash->page_bytes < SPI_EMULATOR_M25P16_PAGE_SIZE) {
+      flash->page_bytes++;
+    }
+    return 0xFF;
+  }
+
+  default:
+    return 0xFF;
+  }
+}
+
+// program and erase only start once the chip select goes high
+static void m25p16_deselect(spi_emulator_device_t *dev) {
+  spi_emulator_m25p16_t *flash = (spi_emulator_m25p16_t *)dev;
+  if (flash->pos == 0 || !flash->write_enable || m25p16_busy(flash)) {
+    return;
+  }
+
+  const uint64_t now = spi_emulator_time_ns();
+  switch (flash->cmd) {
+  case M25P16_PAGE_PROGRAM: {
+    if (flash->pos < 4 || flash->page_bytes == 0) {
+      return;
+    }
+    uint8_t *page = flash->memory + (flash->addr % SPI_EMULATOR_M25P16_SIZE) / SPI_EMULATOR_M25P16_PAGE_SIZE * SPI_EMULATOR_M25P16_PAGE_SIZE;
+    for (uint32_t i = 0; i < SPI_EMULATOR_M25P16_PAGE_SIZE; i++) {
+      page[i] &= flash->page[i];
+    }
+    flash->programs++;
+    flash->busy_until_ns = now + PAGE_PROGRAM_NS;
+    break;
+  }
+
+  case M25P16_SECTOR_ERASE: {
+    if (flash->pos < 4) {
+      return;
+    }
+    const uint32_t sector = (flash->addr % SPI_EMULATOR_M25P16_SIZE) / SECTOR_SIZE;
+    memset(flash->memory + sector * SECTOR_SIZE, 0xFF, SECTOR_SIZE);
+    flash->erases++;
+    flash->busy_until_ns = now + SECTOR_ERASE_NS;
+    break;
+  }
+
+  case M25P16_BULK_ERASE:
+    memset(flash->memory, 0xFF, SPI_EMULATOR_M25P16_SIZE);
+    flash->erases++;
+    flash->busy_until_ns = now + BULK_ERASE_NS;
+    break;
+
+  default:
+    return;
+  }
+
+  flash->write_enable = false;
+}
+
+void spi_emulator_m25p16_init(spi_emulator_m25p16_t *flash) {
+  memset(flash, 0, sizeof(spi_emulator_m25p16_t));
+  memset(flash->memory, 0xFF, SPI_EMULATOR_M25P16_SIZE);
+  flash->jedec_id = JEDEC_ID_MICRON_M25P16;
+
+  flash->dev.select = m25p16_select;
+  flash->dev.transfer = m25p16_transfer;
+  flash->dev.deselect = m25p16_deselect;
+}
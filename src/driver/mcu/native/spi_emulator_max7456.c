@@ -0,0 +1,148 @@
+#include "driver/mcu/native/spi_emulator.h"
+
+#include <string.h>
+
+#include "driver/osd/max7456.h"
+
+#define STAT_R 0xA0
+#define OSDBL_DEFAULT 0x1F
+
+#define DMM_AUTO_INCREMENT 0x01
+#define DMM_CLEAR 0x04
+
+static void max7456_reset(spi_emulator_max7456_t *osd) {
+  memset(osd->regs, 0, sizeof(osd->regs));
+  osd->black_level = OSDBL_DEFAULT;
+  osd->display_addr = 0;
+  memset(osd->display, 0, sizeof(osd->display));
+  memset(osd->attrs, 0, sizeof(osd->attrs));
+}
+
+static uint8_t max7456_read_reg(spi_emulator_max7456_t *osd, uint8_t addr) {
+  switch (addr) {
+  case OSDBL_R:
+    return osd->black_level;
+
+  // the driver polls the status at A2h
+  case STAT_R:
+  case STAT:
+    return osd->stat;
+
+  case DMDO:
+    return osd->display[osd->display_addr % SPI_EMULATOR_MAX7456_CHARS];
+
+  case CMDO:
+    return osd->char_ram[osd->regs[CMAL] & 0x3F];
+
+  default:
+    return osd->regs[addr & 0x0F];
+  }
+}
+
+static void max7456_write_display(spi_emulator_max7456_t *osd, uint8_t data) {
+  const uint8_t dmm = osd->regs[DMM];
+
+  if (dmm & DMM_AUTO_INCREMENT) {
+    // 0xff is no character, it ends auto increment mode
+    if (data == 0xFF) {
+      osd->regs[DMM] &= ~DMM_AUTO_INCREMENT;
+      return;
+    }
+  }
+
+  const uint16_t pos = osd->display_addr % SPI_EMULATOR_MAX7456_CHARS;
+  osd->display[pos] = data;
+  osd->attrs[pos] = (dmm >> 3) & 0x07;
+
+  if (dmm & DMM_AUTO_INCREMENT) {
+    osd->display_addr++;
+  }
+}
+
+static void max7456_write_reg(spi_emulator_max7456_t *osd, uint8_t addr, uint8_t data) {
+  switch (addr) {
+  case VM0:
+    if (data & 0x02) {
+      max7456_reset(osd);
+      return;
+    }
+    osd->regs[VM0] = data;
+    break;
+
+  case DMM:
+    osd->regs[DMM] = data & ~DMM_CLEAR;
+    if (data & DMM_CLEAR) {
+      memset(osd->display, 0, sizeof(osd->display));
+      memset(osd->attrs, 0, sizeof(osd->attrs));
+      osd->clears++;
+    }
+    break;
+
+  case DMAH:
+    osd->display_addr = (osd->display_addr & 0xFF) | ((data & 0x01) << 8);
+    break;
+
+  case DMAL:
+    osd->display_addr = (osd->display_addr & 0x100) | data;
+    break;
+
+  case DMDI:
+    max7456_write_display(osd, data);
+    break;
+
+  case CMM:
+    // character memory is read into or written from the shadow ram
+    if (data == 0x50) {
+      memcpy(osd->char_ram, osd->nvm[osd->regs[CMAH]], sizeof(osd->char_ram));
+    } else if (data == 0xA0) {
+      memcpy(osd->nvm[osd->regs[CMAH]], osd->char_ram, sizeof(osd->char_ram));
+    }
+    break;
+
+  case CMDI:
+    osd->char_ram[osd->regs[CMAL] & 0x3F] = data;
+    break;
+
+  case OSDBL_W:
+    osd->black_level = data;
+    break;
+
+  default:
+    if (addr < sizeof(osd->regs)) {
+      osd->regs[addr] = data;
+    }
+    break;
+  }
+}
+
+static void max7456_select(spi_emulator_device_t *dev) {
+  spi_emulator_max7456_t *osd = (spi_emulator_max7456_t *)dev;
+  osd->has_addr = false;
+}
+
+// every access is an address byte followed by one data byte
+static uint8_t max7456_transfer(spi_emulator_device_t *dev, uint8_t data) {
+  spi_emulator_max7456_t *osd = (spi_emulator_max7456_t *)dev;
+
+  if (!osd->has_addr) {
+    osd->has_addr = true;
+    osd->addr = data;
+    return 0x00;
+  }
+  osd->has_addr = false;
+
+  if (osd->addr & MAX7456_READ_FLAG) {
+    return max7456_read_reg(osd, osd->addr);
+  }
+  max7456_write_reg(osd, osd->addr, data);
+  return 0x00;
+}
+
+void spi_emulator_max7456_init(spi_emulator_max7456_t *osd, uint8_t stat) {
+  memset(osd, 0, sizeof(spi_emulator_max7456_t));
+  osd->stat = stat;
+  max7456_reset(osd);
+
+  osd->dev.select = max7456_select;
+  osd->dev.transfer = max7456_transfer;
+}
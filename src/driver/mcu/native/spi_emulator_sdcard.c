@@ -0,0 +1,235 @@
+#include "driver/mcu/native/spi_emulator.h"
+
+#include <string.h>
+
+#include "driver/blackbox/sdcard.h"
+
+#define BLOCK_COUNT (SPI_EMULATOR_SDCARD_SIZE / SPI_EMULATOR_SDCARD_BLOCK_SIZE)
+
+#define TOKEN_START_BLOCK 0xFE
+#define TOKEN_START_MULTIPLE 0xFC
+#define TOKEN_STOP_TRAN 0xFD
+#define DATA_ACCEPTED 0x05
+
+#define OCR_SDHC 0xC0FF8000
+
+#define BLOCK_PROGRAM_NS 200000ULL
+#define STOP_TRAN_NS 500000ULL
+
+static void sdcard_queue(spi_emulator_sdcard_t *card, const uint8_t *data, uint32_t len) {
+  if (card->out_pos > 0) {
+    memmove(card->out, card->out + card->out_pos, card->out_len - card->out_pos);
+    card->out_len -= card->out_pos;
+    card->out_pos = 0;
+  }
+  if (card->out_len + len > sizeof(card->out)) {
+    return;
+  }
+  memcpy(card->out + card->out_len, data, len);
+  card->out_len += len;
+}
+
+static void sdcard_queue_byte(spi_emulator_sdcard_t *card, uint8_t data) {
+  sdcard_queue(card, &data, 1);
+}
+
+// a data block after the access time, crc is not checked by the driver
+static void sdcard_queue_block(spi_emulator_sdcard_t *card, const uint8_t *data, uint32_t len) {
+  sdcard_queue_byte(card, 0xFF);
+  sdcard_queue_byte(card, TOKEN_START_BLOCK);
+  sdcard_queue(card, data, len);
+  sdcard_queue_byte(card, 0xFF);
+  sdcard_queue_byte(card, 0xFF);
+}
+
+static void sdcard_queue_read_block(spi_emulator_sdcard_t *card) {
+  sdcard_queue_block(card, card->memory + (card->block % BLOCK_COUNT) * SPI_EMULATOR_SDCARD_BLOCK_SIZE, SPI_EMULATOR_SDCARD_BLOCK_SIZE);
+  card->block++;
+  card->blocks_read++;
+}
+
+static void sdcard_queue_csd(spi_emulator_sdcard_t *card) {
+  // csd version 2, c_size counts 512k units
+  const uint32_t c_size = SPI_EMULATOR_SDCARD_SIZE / (512 * 1024) - 1;
+  const uint8_t csd[16] = {
+      0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00,
+      (c_size >> 16) & 0x3F, (c_size >> 8) & 0xFF, c_size & 0xFF,
+      0x7F, 0x80, 0x0A, 0x40, 0x00, 0x01};
+  sdcard_queue_block(card, csd, 16);
+}
+
+static void sdcard_queue_cid(spi_emulator_sdcard_t *card) {
+  const uint8_t cid[16] = {0x03, 'S', 'D', 'E', 'M', 'U', 'L', 'A', 0x10, 0x00, 0x00, 0x00, 0x01, 0x01, 0x6A, 0x01};
+  sdcard_queue_block(card, cid, 16);
+}
+
+static void sdcard_command(spi_emulator_sdcard_t *card) {
+  const uint8_t cmd = card->cmd[0] & 0x3F;
+  const uint32_t arg = (card->cmd[1] << 24) | (card->cmd[2] << 16) | (card->cmd[3] << 8) | card->cmd[4];
+
+  const bool app_cmd = card->app_cmd;
+  card->app_cmd = false;
+
+  if (cmd == SDCARD_STOP_TRANSMISSION) {
+    // drops the rest of the block, r1 follows the stuff byte
+    card->out_pos = card->out_len = 0;
+    card->state = SPI_EMULATOR_SDCARD_COMMAND;
+    sdcard_queue_byte(card, 0xFF);
+  }
+
+  // one byte of command response time before r1
+  sdcard_queue_byte(card, 0xFF);
+
+  const uint8_t r1 = card->idle ? SDCARD_R1_IDLE : 0x00;
+  if (card->idle && cmd != SDCARD_GO_IDLE && cmd != SDCARD_IF_COND && cmd != SDCARD_APP_CMD && cmd != SDCARD_OCR && !(app_cmd && cmd == SDCARD_ACMD_OD_COND)) {
+    sdcard_queue_byte(card, r1 | SDCARD_R1_ILLEGAL_COMMAND);
+    return;
+  }
+
+  switch (cmd) {
+  case SDCARD_GO_IDLE:
+    card->idle = true;
+    card->state = SPI_EMULATOR_SDCARD_COMMAND;
+    sdcard_queue_byte(card, SDCARD_R1_IDLE);
+    break;
+
+  case SDCARD_IF_COND: {
+    const uint8_t r7[5] = {r1, 0x00, 0x00, (arg >> 8) & 0x0F, arg & 0xFF};
+    sdcard_queue(card, r7, 5);
+    break;
+  }
+
+  case SDCARD_APP_CMD:
+    card->app_cmd = true;
+    sdcard_queue_byte(card, r1);
+    break;
+
+  case SDCARD_ACMD_OD_COND:
+    if (!app_cmd) {
+      sdcard_queue_byte(card, r1 | SDCARD_R1_ILLEGAL_COMMAND);
+      break;
+    }
+    card->idle = false;
+    sdcard_queue_byte(card, 0x00);
+    break;
+
+  case SDCARD_OCR: {
+    const uint8_t r3[5] = {r1, OCR_SDHC >> 24, (OCR_SDHC >> 16) & 0xFF, (OCR_SDHC >> 8) & 0xFF, OCR_SDHC & 0xFF};
+    sdcard_queue(card, r3, 5);
+    break;
+  }
+
+  case SDCARD_CSD:
+    sdcard_queue_byte(card, r1);
+    sdcard_queue_csd(card);
+    break;
+
+  case SDCARD_CID:
+    sdcard_queue_byte(card, r1);
+    sdcard_queue_cid(card);
+    break;
+
+  case SDACARD_SET_BLOCK_LEN:
+  case SDCARD_STOP_TRANSMISSION:
+    sdcard_queue_byte(card, r1);
+    break;
+
+  case SDCARD_READ_BLOCK:
+    sdcard_queue_byte(card, r1);
+    card->block = arg;
+    sdcard_queue_read_block(card);
+    break;
+
+  case SDCARD_READ_MULTIPLE_BLOCK:
+    sdcard_queue_byte(card, r1);
+    card->block = arg;
+    card->state = SPI_EMULATOR_SDCARD_READ_MULTIPLE;
+    break;
+
+  case SDCARD_WRITE_BLOCK:
+  case SDCARD_WRITE_MULTIPLE_BLOCK:
+    sdcard_queue_byte(card, r1);
+    card->block = arg;
+    card->write_multiple = cmd == SDCARD_WRITE_MULTIPLE_BLOCK;
+    card->state = SPI_EMULATOR_SDCARD_WRITE_TOKEN;
+    break;
+
+  default:
+    if (app_cmd && cmd == SDCARD_ACMD_SET_WR_BLK_ERASE_COUNT) {
+      sdcard_queue_byte(card, r1);
+      break;
+    }
+    sdcard_queue_byte(card, r1 | SDCARD_R1_ILLEGAL_COMMAND);
+    break;
+  }
+}
+
+static void sdcard_receive(spi_emulator_sdcard_t *card, uint8_t data) {
+  switch (card->state) {
+  case SPI_EMULATOR_SDCARD_WRITE_TOKEN:
+    if (data == TOKEN_STOP_TRAN && card->write_multiple) {
+      // busy starts one byte after the stop token
+      card->busy_until_ns = spi_emulator_time_ns() + STOP_TRAN_NS;
+      card->out_pos = card->out_len = 0;
+      sdcard_queue_byte(card, 0xFF);
+      card->state = SPI_EMULATOR_SDCARD_COMMAND;
+    } else if (data == (card->write_multiple ? TOKEN_START_MULTIPLE : TOKEN_START_BLOCK)) {
+      card->data_len = 0;
+      card->state = SPI_EMULATOR_SDCARD_WRITE_DATA;
+    }
+    return;
+
+  case SPI_EMULATOR_SDCARD_WRITE_DATA:
+    card->data[card->data_len++] = data;
+    if (card->data_len < sizeof(card->data)) {
+      return;
+    }
+
+    memcpy(card->memory + (card->block % BLOCK_COUNT) * SPI_EMULATOR_SDCARD_BLOCK_SIZE, card->data, SPI_EMULATOR_SDCARD_BLOCK_SIZE);
+    card->block++;
+    card->blocks_written++;
+
+    sdcard_queue_byte(card, DATA_ACCEPTED);
+    card->busy_until_ns = spi_emulator_time_ns() + BLOCK_PROGRAM_NS;
+    card->state = card->write_multiple ? SPI_EMULATOR_SDCARD_WRITE_TOKEN : SPI_EMULATOR_SDCARD_COMMAND;
+    return;
+
+  case SPI_EMULATOR_SDCARD_COMMAND:
+  case SPI_EMULATOR_SDCARD_READ_MULTIPLE:
+    // commands are also taken while a read streams blocks
+    if (card->cmd_len == 0 && (data & 0xC0) != 0x40) {
+      return;
+    }
+    card->cmd[card->cmd_len++] = data;
+    if (card->cmd_len == 6) {
+      card->cmd_len = 0;
+      sdcard_command(card);
+    }
+    return;
+  }
+}
+
+static uint8_t sdcard_transfer(spi_emulator_device_t *dev, uint8_t data) {
+  spi_emulator_sdcard_t *card = (spi_emulator_sdcard_t *)dev;
+
+  if (card->out_pos == card->out_len && card->state == SPI_EMULATOR_SDCARD_READ_MULTIPLE) {
+    sdcard_queue_read_block(card);
+  }
+
+  uint8_t out = 0xFF;
+  if (card->out_pos < card->out_len) {
+    out = card->out[card->out_pos++];
+  } else if (spi_emulator_time_ns() < card->busy_until_ns) {
+    // miso is held low while programming
+    out = 0x00;
+  }
+
+  sdcard_receive(card, data);
+  return out;
+}
+
+void spi_emulator_sdcard_init(spi_emulator_sdcard_t *card) {
+  memset(card, 0, sizeof(spi_emulator_sdcard_t));
+  card->idle = true;
+  card->dev.transfer = sdcard_transfer;
+}
@@ -0,0 +1,181 @@
+#include "driver/mcu/native/spi_emulator.h"
+
+#include <string.h>
+
+#include "driver/rx/sx128x.h"
+
+// circuit modes of the status byte
+#define CIRCUIT_STDBY_RC 0x2
+#define CIRCUIT_STDBY_XOSC 0x3
+#define CIRCUIT_FS 0x4
+#define CIRCUIT_RX 0x5
+#define CIRCUIT_TX 0x6
+
+#define COMMAND_DATA_AVAILABLE 0x2
+#define COMMAND_SUCCESS 0x1
+
+#define FIRMWARE_VERSION 0xA9B5
+
+static uint8_t sx1280_status(const spi_emulator_sx1280_t *radio) {
+  const uint8_t cmd_status = (radio->irq & SX1280_IRQ_RX_DONE) ? COMMAND_DATA_AVAILABLE : COMMAND_SUCCESS;
+  return (radio->mode << 5) | (cmd_status << 2);
+}
+
+static void sx1280_select(spi_emulator_device_t *dev) {
+  spi_emulator_sx1280_t *radio = (spi_emulator_sx1280_t *)dev;
+  radio->pos = 0;
+}
+
+// data commands act on every byte, the rest run on deselect with their parameters
+static uint8_t sx1280_transfer(spi_emulator_device_t *dev, uint8_t data) {
+  spi_emulator_sx1280_t *radio = (spi_emulator_sx1280_t *)dev;
+
+  const uint8_t status = sx1280_status(radio);
+  const uint32_t pos = radio->pos++;
+  if (pos == 0) {
+    radio->cmd = data;
+    return status;
+  }
+
+  switch (radio->cmd) {
+  case SX1280_RADIO_WRITE_REGISTER:
+    if (pos <= 2) {
+      radio->addr = (radio->addr << 8) | data;
+      return status;
+    }
+    radio->regs[radio->addr++ % sizeof(radio->regs)] = data;
+    return status;
+
+  case SX1280_RADIO_READ_REGISTER:
+    if (pos <= 2) {
+      radio->addr = (radio->addr << 8) | data;
+      return status;
+    }
+    if (pos == 3) {
+      return status;
+    }
+    return radio->regs[radio->addr++ % sizeof(radio->regs)];
+
+  case SX1280_RADIO_WRITE_BUFFER:
+    if (pos == 1) {
+      radio->addr = data;
+      return status;
+    }
+    radio->buffer[radio->addr++ & 0xFF] = data;
+    return status;
+
+  case SX1280_RADIO_READ_BUFFER:
+    if (pos == 1) {
+      radio->addr = data;
+      return status;
+    }
+    if (pos == 2) {
+      return status;
+    }
+    return radio->buffer[radio->addr++ & 0xFF];
+
+  case SX1280_RADIO_GET_IRQSTATUS:
+    if (pos == 2) {
+      return radio->irq >> 8;
+    }
+    if (pos == 3) {
+      return radio->irq & 0xFF;
+    }
+    return status;
+
+  case SX1280_RADIO_GET_RXBUFFERSTATUS:
+    if (pos == 2) {
+      return radio->rx_len;
+    }
+    if (pos == 3) {
+      return radio->rx_base;
+    }
+    return status;
+
+  case SX1280_RADIO_GET_PACKETSTATUS:
+    if (pos == 2) {
+      return -radio->rssi * 2;
+    }
+    return pos == 1 ? status : 0x00;
+
+  case SX1280_RADIO_GET_STATUS:
+    return status;
+
+  default:
+    if (pos <= sizeof(radio->params)) {
+      radio->params[pos - 1] = data;
+    }
+    return status;
+  }
+}
+
+static void sx1280_deselect(spi_emulator_device_t *dev) {
+  spi_emulator_sx1280_t *radio = (spi_emulator_sx1280_t *)dev;
+  if (radio->pos == 0) {
+    return;
+  }
+
+  const uint8_t *params = radio->params;
+  switch (radio->cmd) {
+  case SX1280_RADIO_SET_STANDBY:
+    radio->mode = params[0] ? CIRCUIT_STDBY_XOSC : CIRCUIT_STDBY_RC;
+    break;
+
+  case SX1280_RADIO_SET_FS:
+    radio->mode = CIRCUIT_FS;
+    break;
+
+  case SX1280_RADIO_SET_RX:
+    radio->mode = CIRCUIT_RX;
+    break;
+
+  case SX1280_RADIO_SET_TX:
+    // the packet is on air instantly
+    radio->irq |= SX1280_IRQ_TX_DONE & radio->irq_mask;
+    radio->mode = CIRCUIT_FS;
+    break;
+
+  case SX1280_RADIO_SET_BUFFERBASEADDRESS:
+    radio->tx_base = params[0];
+    radio->rx_base = params[1];
+    break;
+
+  case SX1280_RADIO_SET_DIOIRQPARAMS:
+    radio->irq_mask = (params[0] << 8) | params[1];
+    radio->dio1_mask = (params[2] << 8) | params[3];
+    break;
+
+  case SX1280_RADIO_CLR_IRQSTATUS:
+    radio->irq &= ~((params[0] << 8) | params[1]);
+    break;
+  }
+}
+
+void spi_emulator_sx1280_init(spi_emulator_sx1280_t *radio) {
+  memset(radio, 0, sizeof(spi_emulator_sx1280_t));
+  radio->mode = CIRCUIT_STDBY_RC;
+  radio->regs[SX128x_LR_FIRMWARE_VERSION_MSB] = FIRMWARE_VERSION >> 8;
+  radio->regs[SX128x_LR_FIRMWARE_VERSION_MSB + 1] = FIRMWARE_VERSION & 0xFF;
+
+  radio->dev.select = sx1280_select;
+  radio->dev.transfer = sx1280_transfer;
+  radio->dev.deselect = sx1280_deselect;
+}
+
+bool spi_emulator_sx1280_receive(spi_emulator_sx1280_t *radio, const uint8_t *data, uint8_t len, int8_t rssi) {
+  if (radio->mode != CIRCUIT_RX) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < len; i++) {
+    radio->buffer[(radio->rx_base + i) & 0xFF] = data[i];
+  }
+  radio->rx_len = len;
+  radio->rssi = rssi;
+  radio->irq |= SX1280_IRQ_RX_DONE & radio->irq_mask;
+  return true;
+}
+
+bool spi_emulator_sx1280_dio1(const spi_emulator_sx1280_t *radio) {
+  return (radio->irq & radio->dio1_mask) != 0;
+}
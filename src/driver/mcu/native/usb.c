@@ -67,3 +67,15 @@ void usb_serial_write(uint8_t *data, uint32_t len) {
     usb_drv_update();
   }
 }
+
+// websocket frames are copied by mongoose anyway, stage them in a plain buffer
+static uint8_t reserve_buffer[USB_BUFFER_SIZE];
+
+uint32_t usb_serial_write_reserve(uint8_t **data) {
+  *data = reserve_buffer;
+  return USB_BUFFER_SIZE;
+}
+
+void usb_serial_write_commit(uint32_t len) {
+  usb_serial_write(reserve_buffer, len);
+}
@@ -23,7 +23,7 @@
 
 #define FLASH_PTR(offset) (_config_flash + FLASH_ALIGN(offset))
 
-uint8_t __attribute__((section(".config_flash"))) _config_flash[16384];
+uint8_t __attribute__((section(".config_flash"))) _config_flash[FMC_BANK_SIZE * FMC_BANK_COUNT];
 
 void fmc_lock() {
   HAL_FLASH_Lock();
@@ -33,7 +33,12 @@ void fmc_unlock() {
   HAL_FLASH_Unlock();
 }
 
-void fmc_erase() {
+void fmc_erase(uint32_t bank) {
+  if (bank >= FMC_BANK_COUNT) {
+    fmc_lock();
+    failloop(FAILLOOP_FAULT);
+  }
+
   // clear error status
   __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
 #if defined(STM32G4)
@@ -41,8 +46,8 @@ void fmc_erase() {
   FLASH_EraseInitTypeDef erase_init;
   erase_init.TypeErase = FLASH_TYPEERASE_PAGES;
   erase_init.Banks = FLASH_BANK_1;
-  erase_init.Page = 24;
-  erase_init.NbPages = 8;
+  erase_init.Page = 24 + bank * (FMC_BANK_SIZE / FLASH_PAGE_SIZE);
+  erase_init.NbPages = FMC_BANK_SIZE / FLASH_PAGE_SIZE;
   HAL_FLASHEx_Erase(&erase_init, &page_error);
 #elif defined(STM32H7)
   FLASH_Erase_Sector(FLASH_SECTOR_1, FLASH_BANK_BOTH, FLASH_VOLTAGE_RANGE_3);
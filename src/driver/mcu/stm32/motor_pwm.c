@@ -25,6 +25,9 @@ void motor_pwm_init() {
 
   for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
     const gpio_pins_t pin = target.motor_pins[i];
+    if (pin == PIN_NONE) {
+      continue;
+    }
 
     for (uint32_t j = 0; j < GPIO_AF_MAX; j++) {
       const gpio_af_t *func = &gpio_pin_afs[j];
@@ -61,6 +64,9 @@ void motor_pwm_write(float *values) {
     const uint16_t pwm = constrain(values[i] * PWM_TOP, 0, PWM_TOP);
 
     const resource_tag_t tag = timer_tags[i];
+    if (tag == 0) {
+      continue;
+    }
     switch (TIMER_TAG_CH(tag)) {
     case TIMER_CH1:
     case TIMER_CH1N:
@@ -201,7 +201,7 @@ void spi_reconfigure(spi_bus_device_t *bus) {
   }
 }
 
-void spi_dma_transfer_begin(spi_ports_t port, uint8_t *buffer, uint32_t length, bool has_rx) {
+void spi_dma_transfer_begin(spi_ports_t port, const uint8_t *tx_data, uint8_t *rx_data, uint32_t length) {
 #if !defined(STM32H7)
   while (LL_SPI_IsActiveFlag_BSY(spi_port_defs[port].channel))
     ;
@@ -212,25 +212,25 @@ void spi_dma_transfer_begin(spi_ports_t port, uint8_t *buffer, uint32_t length,
 
   const dma_stream_def_t *dma_tx = &dma_stream_defs[target.dma[spi_port_defs[port].dma_tx].dma];
   dma_clear_flag_tc(dma_tx);
-  dma_prepare_tx_memory(buffer, length);
+  dma_prepare_tx_memory((void *)tx_data, length);
 
   while (LL_DMA_IsEnabledStream(dma_tx->port, dma_tx->stream_index))
     ;
 
-  LL_DMA_SetMemoryAddress(dma_tx->port, dma_tx->stream_index, (uint32_t)buffer);
+  LL_DMA_SetMemoryAddress(dma_tx->port, dma_tx->stream_index, (uint32_t)tx_data);
   LL_DMA_SetDataLength(dma_tx->port, dma_tx->stream_index, length);
   LL_DMA_EnableStream(dma_tx->port, dma_tx->stream_index);
   LL_SPI_EnableDMAReq_TX(spi_port_defs[port].channel);
 
-  if (has_rx) {
+  if (rx_data) {
     const dma_stream_def_t *dma_rx = &dma_stream_defs[target.dma[spi_port_defs[port].dma_rx].dma];
     dma_clear_flag_tc(dma_rx);
-    dma_prepare_rx_memory(buffer, length);
+    dma_prepare_rx_memory(rx_data, length);
 
     while (LL_DMA_IsEnabledStream(dma_rx->port, dma_rx->stream_index))
       ;
 
-    LL_DMA_SetMemoryAddress(dma_rx->port, dma_rx->stream_index, (uint32_t)buffer);
+    LL_DMA_SetMemoryAddress(dma_rx->port, dma_rx->stream_index, (uint32_t)rx_data);
     LL_DMA_SetDataLength(dma_rx->port, dma_rx->stream_index, length);
     LL_DMA_EnableStream(dma_rx->port, dma_rx->stream_index);
     LL_SPI_EnableDMAReq_RX(spi_port_defs[port].channel);
@@ -293,7 +293,7 @@ void spi_device_init(spi_ports_t port) {
 }
 
 void spi_seg_submit_wait_ex(spi_bus_device_t *bus, const spi_txn_segment_t *segs, const uint32_t count) {
-  spi_txn_wait(bus);
+  spi_txn_wait_port(bus->port);
 
   while (!spi_txn_can_send(bus, false))
     ;
@@ -4,6 +4,7 @@
 #include "driver/gpio.h"
 #include "driver/interrupt.h"
 #include "driver/time.h"
+#include "util/util.h"
 
 #include <string.h>
 
@@ -271,11 +272,13 @@ static void cdc_kickoff_rx() {
 static void cdc_txonly(usbd_device *dev, uint8_t event, uint8_t ep) {
   static volatile bool did_zlp = false;
 
-  static uint8_t buf[CDC_DATA_SZ];
-  const uint32_t len = ring_buffer_read_multi(&usb_tx_buffer, buf, CDC_DATA_SZ);
+  // packets are copied into the endpoint memory straight from the ring
+  uint8_t *buf = NULL;
+  const uint32_t len = min(ring_buffer_read_reserve(&usb_tx_buffer, &buf), CDC_DATA_SZ);
 
   if (len) {
     usbd_ep_write(dev, ep, buf, len);
+    ring_buffer_read_commit(&usb_tx_buffer, len);
     tx_stalled = false;
 
     // transfers smaller than max size count as zlp
@@ -394,3 +397,15 @@ void usb_serial_write(uint8_t *data, uint32_t len) {
     cdc_kickoff_tx();
   }
 }
+
+uint32_t usb_serial_write_reserve(uint8_t **data) {
+  return ring_buffer_write_reserve(&usb_tx_buffer, data);
+}
+
+void usb_serial_write_commit(uint32_t len) {
+  if (len == 0) {
+    return;
+  }
+  ring_buffer_write_commit(&usb_tx_buffer, len);
+  cdc_kickoff_tx();
+}
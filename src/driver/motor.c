@@ -1,5 +1,6 @@
 #include "driver/motor.h"
 
+#include "core/profile.h"
 #include "core/project.h"
 #include "util/util.h"
 
@@ -13,7 +14,7 @@ extern void motor_dshot_init();
 extern void motor_dshot_wait_for_ready();
 extern void motor_dshot_write(float *values);
 extern void motor_dshot_set_direction(motor_direction_t dir);
-extern bool motor_dshot_direction_change_done();
+extern motor_esc_command_result_t motor_dshot_command(uint8_t command);
 extern void motor_dshot_beep();
 
 void motor_init() {
@@ -54,6 +55,17 @@ void motor_beep() {
   }
 }
 
+// at least a quad, at most one motor per pin
+uint32_t motor_count() {
+  if (profile.motor.motor_count < 4) {
+    return 4;
+  }
+  if (profile.motor.motor_count > MOTOR_PIN_MAX) {
+    return MOTOR_PIN_MAX;
+  }
+  return profile.motor.motor_count;
+}
+
 void motor_set(motor_position_t pos, float pwm) {
   if ((uint8_t)pos >= MOTOR_PIN_MAX) {
     return;
@@ -63,10 +75,9 @@ void motor_set(motor_position_t pos, float pwm) {
 }
 
 void motor_set_all(float pwm) {
-  motor_set(MOTOR_BL, pwm);
-  motor_set(MOTOR_FL, pwm);
-  motor_set(MOTOR_FR, pwm);
-  motor_set(MOTOR_BR, pwm);
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    motor_set(i, pwm);
+  }
 }
 
 void motor_update() {
@@ -98,11 +109,11 @@ void motor_set_direction(motor_direction_t dir) {
 #endif
 }
 
-bool motor_direction_change_done() {
+motor_esc_command_result_t motor_esc_command(uint8_t command) {
 #ifdef USE_MOTOR_DSHOT
   if (target.brushless) {
-    return motor_dshot_direction_change_done();
+    return motor_dshot_command(command);
   }
 #endif
-  return true;
+  return MOTOR_ESC_COMMAND_UNSUPPORTED;
 }
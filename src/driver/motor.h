@@ -17,14 +17,23 @@ typedef enum {
   MOTOR_FR,
 } motor_position_t;
 
+typedef enum {
+  MOTOR_ESC_COMMAND_OK,
+  MOTOR_ESC_COMMAND_UNSUPPORTED,
+  MOTOR_ESC_COMMAND_INVALID,
+  MOTOR_ESC_COMMAND_ARMED,
+  MOTOR_ESC_COMMAND_QUEUE_FULL,
+} motor_esc_command_result_t;
+
 // driver functions
 void motor_init();
 void motor_wait_for_ready();
 void motor_beep();
 void motor_set_direction(motor_direction_t dir);
-bool motor_direction_change_done();
+motor_esc_command_result_t motor_esc_command(uint8_t command);
 
 // generic functions
+uint32_t motor_count();
 void motor_set(motor_position_t pos, float pwm);
 void motor_set_all(float pwm);
 void motor_update();
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "driver/motor_dshot.h"
 
+#include <string.h>
+
 #include "core/profile.h"
 #include "core/project.h"
 #include "driver/dma.h"
@@ -7,16 +9,18 @@
 #include "driver/spi.h"
 #include "driver/time.h"
 #include "flight/control.h"
+#include "io/blackbox.h"
 #include "util/util.h"
 
 #ifdef USE_MOTOR_DSHOT
 
-typedef enum {
-  DIR_CHANGE_START,
-  DIR_CHANGE_DELAY,
-  DIR_CHANGE_CMD,
-  DIR_CHANGE_STOP,
-} dir_change_state_t;
+#define DSHOT_TELEMETRY_WINDOW 1000
+
+// escs ignore commands until they are done booting
+#define DSHOT_EDT_ENABLE_DELAY_MS 2000
+
+// an esc beeps for about 260ms after a beep command
+#define DSHOT_BEACON_INTERVAL_MS 500
 
 volatile uint32_t dshot_phase = 0;
 
@@ -30,11 +34,15 @@ dshot_gpio_port_t dshot_gpio_ports[DSHOT_MAX_PORT_COUNT] = {
 volatile DMA_RAM uint16_t dshot_input_buffer[DSHOT_MAX_PORT_COUNT][GCR_DMA_BUFFER_SIZE];
 volatile DMA_RAM uint32_t dshot_output_buffer[DSHOT_MAX_PORT_COUNT][DSHOT_DMA_BUFFER_SIZE];
 
-static uint16_t dshot_packet[MOTOR_PIN_MAX]; // 16bits dshot data for 4 motors
+static uint16_t dshot_packet[MOTOR_PIN_MAX]; // 16bits dshot data per motor
 static dshot_pin_t dshot_pins[MOTOR_PIN_MAX];
+static dshot_bitbang_lut_t dshot_lut;
+
+static dshot_cmd_queue_t dshot_cmd_queue;
 
 static motor_direction_t motor_dir = MOTOR_FORWARD;
-static bool dir_change_done = true;
+static bool edt_enable_queued = false;
+static bool dshot_armed = false;
 
 const dshot_gpio_port_t *dshot_gpio_for_device(const dma_device_t dev) {
   return &dshot_gpio_ports[dev - DMA_DEVICE_DSHOT_CH1];
@@ -59,6 +67,12 @@ void dshot_gpio_init_input(gpio_pins_t pin) {
 }
 
 static void dshot_init_motor_pin(uint32_t index) {
+  // no masks, the pin is left out of every port word
+  memset(&dshot_pins[index], 0, sizeof(dshot_pin_t));
+  if (target.motor_pins[index] == PIN_NONE) {
+    return;
+  }
+
   dshot_gpio_init_output(target.motor_pins[index]);
   if (profile.motor.dshot_telemetry)
     gpio_pin_set(target.motor_pins[index]);
@@ -113,30 +127,39 @@ static void dshot_make_packet_all(uint16_t value, bool telemetry) {
   }
 }
 
+// a failed frame keeps the last rpm, the error rate of the last window goes to blackbox debug
+static void dshot_decode_telemetry(uint32_t motor, const uint16_t *dma_buffer) {
+  static uint32_t window_frames[MOTOR_PIN_MAX];
+  static uint32_t window_errors[MOTOR_PIN_MAX];
+
+  uint16_t value = 0;
+  const dshot_gcr_result_t result = dshot_decode_gcr(dma_buffer, dshot_pins[motor].pin_mask, &value);
+  dshot_telemetry_update(motor, result, value);
+
+  if (++window_frames[motor] >= DSHOT_TELEMETRY_WINDOW) {
+    // errors per thousand frames
+    blackbox_set_debug(BBOX_DEBUG_DSHOT_TELEMETRY, motor, (state.dshot_telemetry_errors[motor] - window_errors[motor]) * 1000 / DSHOT_TELEMETRY_WINDOW);
+    window_errors[motor] = state.dshot_telemetry_errors[motor];
+    window_frames[motor] = 0;
+  }
+}
+
 // make dshot dma packet, then fire
 void dshot_dma_start() {
   if (profile.motor.dshot_telemetry) {
     for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+      if (target.motor_pins[i] == PIN_NONE) {
+        continue;
+      }
       const uint32_t port = dshot_pins[i].dshot_port;
-      state.dshot_rpm[i] = dshot_decode_eRPM_telemetry_value(dshot_decode_gcr((uint16_t *)dshot_input_buffer[port], dshot_pins[i].pin_mask));
+      dshot_decode_telemetry(i, (uint16_t *)dshot_input_buffer[port]);
       dshot_gpio_init_output(target.motor_pins[i]);
     }
   }
 
-  for (uint8_t i = 0; i < 16; i++) {
-    for (uint32_t j = 0; j < dshot_gpio_port_count; j++) {
-      dshot_output_buffer[j][i * 3 + 1] = 0; // clear middle bit
-    }
-    for (uint8_t motor = 0; motor < MOTOR_PIN_MAX; motor++) {
-      // for 1 hold the line high for two timeunits
-      // first timeunit is already applied
-      const bool bit = dshot_packet[motor] & 0x8000;
-      const uint32_t port = dshot_pins[motor].dshot_port;
-      dshot_output_buffer[port][i * 3 + 1] |= bit ? dshot_pins[motor].set_mask : dshot_pins[motor].reset_mask;
-
-      dshot_packet[motor] <<= 1;
-    }
-  }
+  // for 1 hold the line high for two timeunits
+  // first timeunit is already applied
+  dshot_bitbang_encode(&dshot_lut, dshot_packet, dshot_gpio_port_count, dshot_output_buffer);
 
   dma_prepare_tx_memory((void *)dshot_output_buffer, sizeof(dshot_output_buffer));
   dma_prepare_rx_memory((void *)dshot_input_buffer, sizeof(dshot_input_buffer));
@@ -154,64 +177,57 @@ void dshot_dma_start() {
   }
 }
 
-static void dshot_handle_dir_change() {
-  static uint8_t counter = 0;
-  static uint32_t dir_change_time = 0;
-  static dir_change_state_t state = DIR_CHANGE_START;
-
-  switch (state) {
-  case DIR_CHANGE_START: {
-    if (counter < 100) {
-      dshot_make_packet_all(0, false);
-      dshot_dma_start();
-      counter++;
-    } else {
-      state = DIR_CHANGE_DELAY;
-      counter = 0;
-    }
-    dir_change_time = time_micros();
+// settings only stick after the esc has seen them a few times, everything else is sent once
+static bool dshot_command_queue(uint8_t command) {
+  dshot_cmd_t cmd = {
+      .command = command,
+      .repeat = 1,
+      .delay_us = 0,
+      .spacing_us = 0,
+  };
+
+  switch (command) {
+  case DSHOT_CMD_SPIN_DIRECTION_1:
+  case DSHOT_CMD_SPIN_DIRECTION_2:
+  case DSHOT_CMD_3D_MODE_OFF:
+  case DSHOT_CMD_3D_MODE_ON:
+  case DSHOT_CMD_SAVE_SETTINGS:
+  case DSHOT_CMD_EXTENDED_TELEMETRY_ENABLE:
+  case DSHOT_CMD_EXTENDED_TELEMETRY_DISABLE:
+  case DSHOT_CMD_ROTATE_NORMAL:
+  case DSHOT_CMD_ROTATE_REVERSE:
+    cmd.repeat = DSHOT_CMD_REPEAT_COUNT;
+    cmd.delay_us = DSHOT_CMD_IDLE_TIME_US;
+    cmd.spacing_us = DSHOT_CMD_SPACING_US;
     break;
   }
 
-  case DIR_CHANGE_DELAY:
-    if ((time_micros() - dir_change_time) < DSHOT_DIR_CHANGE_IDLE_TIME_US) {
-      break;
-    }
-    state = DIR_CHANGE_CMD;
-    dir_change_time = time_micros();
-    break;
-
-  case DIR_CHANGE_CMD: {
-    if ((time_micros() - dir_change_time) < DSHOT_DIR_CHANGE_CMD_TIME_US) {
-      break;
-    }
+  return dshot_cmd_queue_push(&dshot_cmd_queue, &cmd);
+}
 
-    const uint16_t value = motor_dir == MOTOR_REVERSE ? DSHOT_CMD_ROTATE_REVERSE : DSHOT_CMD_ROTATE_NORMAL;
-    if (counter < 10) {
-      dshot_make_packet_all(value, true);
-      dshot_dma_start();
-      counter++;
-    } else {
-      state = DIR_CHANGE_STOP;
-      counter = 0;
-    }
-    dir_change_time = time_micros();
-    break;
+// queued commands take over the output until they are through
+static bool dshot_command_output() {
+  uint8_t command = DSHOT_CMD_MOTOR_STOP;
+  const dshot_cmd_state_t state = dshot_cmd_queue_update(&dshot_cmd_queue, time_micros(), &command);
+  if (state == DSHOT_CMD_STATE_IDLE) {
+    return false;
   }
 
-  case DIR_CHANGE_STOP:
-    dir_change_done = true;
-    state = DIR_CHANGE_START;
-    break;
-  }
+  dshot_make_packet_all(command, state == DSHOT_CMD_STATE_SEND);
+  dshot_dma_start();
+  return true;
 }
 
 void motor_dshot_init() {
   dshot_gpio_port_count = 0;
+  dshot_cmd_queue_reset(&dshot_cmd_queue);
+  edt_enable_queued = false;
+  dshot_armed = false;
   motor_dir = MOTOR_FORWARD;
   for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
     dshot_init_motor_pin(i);
   }
+  dshot_bitbang_lut_init(&dshot_lut, dshot_pins);
 
   for (uint32_t j = 0; j < dshot_gpio_port_count; j++) {
     dshot_gpio_port_t *port = &dshot_gpio_ports[j];
@@ -233,9 +249,31 @@ void motor_dshot_init() {
   motor_dir = MOTOR_FORWARD;
 }
 
+static bool dshot_motors_off(const float *values) {
+  for (uint32_t i = 0; i < motor_count(); i++) {
+    if (values[i] >= 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void motor_dshot_write(float *values) {
-  if (!dir_change_done) {
-    return dshot_handle_dir_change();
+  if (profile.motor.dshot_telemetry && !edt_enable_queued && time_millis() > DSHOT_EDT_ENABLE_DELAY_MS && dshot_motors_off(values)) {
+    edt_enable_queued = dshot_command_queue(DSHOT_CMD_EXTENDED_TELEMETRY_ENABLE);
+  }
+
+  // settings queued while disarmed would hold the motors stopped after arming
+  if (flags.arm_state && !dshot_armed) {
+    if (dshot_cmd_queue_pending(&dshot_cmd_queue, DSHOT_CMD_EXTENDED_TELEMETRY_ENABLE)) {
+      edt_enable_queued = false;
+    }
+    dshot_cmd_queue_flush(&dshot_cmd_queue);
+  }
+  dshot_armed = flags.arm_state;
+
+  if (dshot_command_output()) {
+    return;
   }
 
   for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
@@ -258,31 +296,44 @@ void motor_dshot_wait_for_ready() {
 }
 
 void motor_dshot_set_direction(motor_direction_t dir) {
-  if (dir_change_done) {
+  const uint8_t command = dir == MOTOR_REVERSE ? DSHOT_CMD_ROTATE_REVERSE : DSHOT_CMD_ROTATE_NORMAL;
+  if (dir == motor_dir && dshot_cmd_queue_pending(&dshot_cmd_queue, command)) {
+    return;
+  }
+  if (dshot_command_queue(command)) {
     motor_dir = dir;
-    dir_change_done = false;
   }
 }
 
-bool motor_dshot_direction_change_done() {
-  return dir_change_done;
+// only while disarmed, the motors stop for as long as the command takes
+motor_esc_command_result_t motor_dshot_command(uint8_t command) {
+  if (command > DSHOT_CMD_MAX) {
+    return MOTOR_ESC_COMMAND_INVALID;
+  }
+  if (flags.arm_state) {
+    return MOTOR_ESC_COMMAND_ARMED;
+  }
+  if (!dshot_command_queue(command)) {
+    return MOTOR_ESC_COMMAND_QUEUE_FULL;
+  }
+  return MOTOR_ESC_COMMAND_OK;
 }
 
 void motor_dshot_beep() {
   static uint32_t last_time = 0;
-  const uint32_t time = time_millis() - last_time;
-
   static uint8_t beep_command = DSHOT_CMD_BEEP1;
-  dshot_make_packet_all(beep_command, true);
-  dshot_dma_start();
 
-  if (time >= 500) {
+  if ((time_millis() - last_time) >= DSHOT_BEACON_INTERVAL_MS && dshot_command_queue(beep_command)) {
     beep_command++;
     if (beep_command > DSHOT_CMD_BEEP5) {
       beep_command = DSHOT_CMD_BEEP1;
     }
-
     last_time = time_millis();
   }
+
+  if (!dshot_command_output()) {
+    dshot_make_packet_all(DSHOT_CMD_MOTOR_STOP, false);
+    dshot_dma_start();
+  }
 }
 #endif
\ No newline at end of file
@@ -25,17 +25,66 @@ typedef struct {
   dma_device_t dma_device;
 } dshot_gpio_port_t;
 
+// one lookup per group of motors turns a bit of each packet into the bsrr word of a port
+#define DSHOT_BITBANG_GROUP_SIZE 4
+#define DSHOT_BITBANG_GROUPS ((MOTOR_PIN_MAX + DSHOT_BITBANG_GROUP_SIZE - 1) / DSHOT_BITBANG_GROUP_SIZE)
+
+#define DSHOT_CMD_MOTOR_STOP 0
 #define DSHOT_CMD_BEEP1 1
 #define DSHOT_CMD_BEEP2 2
 #define DSHOT_CMD_BEEP3 3
 #define DSHOT_CMD_BEEP4 4
 #define DSHOT_CMD_BEEP5 5 // 5 currently uses the same tone as 4 in BLHeli_S.
+#define DSHOT_CMD_ESC_INFO 6
+#define DSHOT_CMD_SPIN_DIRECTION_1 7
+#define DSHOT_CMD_SPIN_DIRECTION_2 8
+#define DSHOT_CMD_3D_MODE_OFF 9
+#define DSHOT_CMD_3D_MODE_ON 10
+#define DSHOT_CMD_SETTINGS_REQUEST 11
+#define DSHOT_CMD_SAVE_SETTINGS 12
+#define DSHOT_CMD_EXTENDED_TELEMETRY_ENABLE 13
+#define DSHOT_CMD_EXTENDED_TELEMETRY_DISABLE 14
 
 #define DSHOT_CMD_ROTATE_NORMAL 20
 #define DSHOT_CMD_ROTATE_REVERSE 21
+#define DSHOT_CMD_LED0_ON 22
+#define DSHOT_CMD_LED0_OFF 26
+#define DSHOT_CMD_LED_COUNT 4
+
+// values above are throttle
+#define DSHOT_CMD_MAX 47
+
+// settings commands are repeated with the motors stopped before and in between
+#define DSHOT_CMD_REPEAT_COUNT 10
+#define DSHOT_CMD_IDLE_TIME_US 20000
+#define DSHOT_CMD_SPACING_US 1000
+
+#define DSHOT_CMD_QUEUE_SIZE 8
 
-#define DSHOT_DIR_CHANGE_IDLE_TIME_US 10000
-#define DSHOT_DIR_CHANGE_CMD_TIME_US 1000
+typedef struct {
+  uint8_t command;
+  uint8_t repeat;
+  uint16_t delay_us;   // motors held stopped before the first frame
+  uint16_t spacing_us; // motors held stopped in between the frames
+} dshot_cmd_t;
+
+// drained by the output task, one frame per motor update
+typedef struct {
+  dshot_cmd_t entries[DSHOT_CMD_QUEUE_SIZE];
+  uint8_t head;
+  uint8_t tail;
+
+  bool active;
+  uint8_t sent;
+  uint32_t wait_start_us;
+  uint32_t wait_us;
+} dshot_cmd_queue_t;
+
+typedef enum {
+  DSHOT_CMD_STATE_IDLE, // nothing queued, the motors run as usual
+  DSHOT_CMD_STATE_WAIT, // motors stopped until the next frame is due
+  DSHOT_CMD_STATE_SEND, // the command frame goes out
+} dshot_cmd_state_t;
 
 #define DSHOT_TIME profile.motor.dshot_time
 #define DSHOT_SYMBOL_TIME (PWM_CLOCK_FREQ_HZ / (3 * DSHOT_TIME * 1000) - 1)
@@ -45,6 +94,11 @@ typedef struct {
 #define DSHOT_DMA_SYMBOLS (16)
 #define DSHOT_DMA_BUFFER_SIZE (3 * DSHOT_DMA_SYMBOLS)
 
+typedef struct {
+  uint32_t words[DSHOT_MAX_PORT_COUNT][DSHOT_BITBANG_GROUPS][1 << DSHOT_BITBANG_GROUP_SIZE];
+  uint32_t group_count; // groups with at least one pin, a quad only ever walks the first
+} dshot_bitbang_lut_t;
+
 #define GCR_TIME ((DSHOT_TIME * 5) / 4)
 #define GCR_SYMBOL_TIME (PWM_CLOCK_FREQ_HZ / (3 * GCR_TIME * 1000 - 1))
 
@@ -52,6 +106,30 @@ typedef struct {
 #define GCR_SYMBOL_TIME_MAX (((DSHOT_TIME_MAX * 5) / 4) * 3)
 #define GCR_DMA_BUFFER_SIZE (((30 + 5) * GCR_SYMBOL_TIME_MAX) / 1000 + 21 * 3)
 
+// consecutive bad frames after which the rpm of a motor is zeroed
+#define DSHOT_TELEMETRY_MAX_MISSES 20
+
+typedef enum {
+  DSHOT_GCR_OK,
+  DSHOT_GCR_NO_FRAME,
+  DSHOT_GCR_BAD_LENGTH,
+  DSHOT_GCR_BAD_SYMBOL,
+  DSHOT_GCR_BAD_CHECKSUM,
+} dshot_gcr_result_t;
+
+// extended telemetry frames are sent in between erpm frames,
+// the upper nibble is the type and the lower byte the data
+typedef enum {
+  DSHOT_EDT_NONE = 0x00,
+  DSHOT_EDT_TEMPERATURE = 0x02,
+  DSHOT_EDT_VOLTAGE = 0x04,
+  DSHOT_EDT_CURRENT = 0x06,
+  DSHOT_EDT_DEBUG1 = 0x08,
+  DSHOT_EDT_DEBUG2 = 0x0A,
+  DSHOT_EDT_STRESS = 0x0C,
+  DSHOT_EDT_STATUS = 0x0E,
+} dshot_edt_type_t;
+
 extern volatile uint32_t dshot_phase;
 
 extern uint8_t dshot_gpio_port_count;
@@ -70,5 +148,18 @@ void dshot_dma_setup_output(uint32_t index);
 void dshot_gpio_init_input(gpio_pins_t pin);
 void dshot_dma_setup_input(uint32_t index);
 
+void dshot_bitbang_lut_init(dshot_bitbang_lut_t *lut, const dshot_pin_t *pins);
+void dshot_bitbang_encode(const dshot_bitbang_lut_t *lut, const uint16_t *packets, uint32_t port_count, volatile uint32_t (*buffer)[DSHOT_DMA_BUFFER_SIZE]);
+
 uint32_t dshot_decode_eRPM_telemetry_value(uint16_t value);
-uint32_t dshot_decode_gcr(uint16_t *dma_buffer, uint32_t pin_mask);
+dshot_edt_type_t dshot_edt_type(uint16_t value);
+void dshot_edt_update(uint32_t motor, dshot_edt_type_t type, uint8_t data);
+void dshot_telemetry_update(uint32_t motor, dshot_gcr_result_t result, uint16_t value);
+
+void dshot_cmd_queue_reset(dshot_cmd_queue_t *queue);
+bool dshot_cmd_queue_push(dshot_cmd_queue_t *queue, const dshot_cmd_t *cmd);
+void dshot_cmd_queue_flush(dshot_cmd_queue_t *queue);
+bool dshot_cmd_queue_pending(const dshot_cmd_queue_t *queue, uint8_t command);
+dshot_cmd_state_t dshot_cmd_queue_update(dshot_cmd_queue_t *queue, uint32_t now_us, uint8_t *command);
+
+dshot_gcr_result_t dshot_decode_gcr(const uint16_t *dma_buffer, uint32_t pin_mask, uint16_t *out);
@@ -0,0 +1,61 @@
+#include "driver/motor_dshot.h"
+
+#include <string.h>
+
+// moves bit n of the packet to bit 4n, the packets of a group then sit side by side in each nibble
+static uint64_t dshot_spread_bits(uint16_t packet) {
+  uint64_t x = packet;
+  x = (x | (x << 24)) & 0x000000FF000000FFULL;
+  x = (x | (x << 12)) & 0x000F000F000F000FULL;
+  x = (x | (x << 6)) & 0x0303030303030303ULL;
+  x = (x | (x << 3)) & 0x1111111111111111ULL;
+  return x;
+}
+
+void dshot_bitbang_lut_init(dshot_bitbang_lut_t *lut, const dshot_pin_t *pins) {
+  memset(lut, 0, sizeof(dshot_bitbang_lut_t));
+
+  for (uint32_t motor = 0; motor < MOTOR_PIN_MAX; motor++) {
+    const dshot_pin_t *pin = &pins[motor];
+    const uint32_t group = motor / DSHOT_BITBANG_GROUP_SIZE;
+    const uint32_t bit = 1 << (motor % DSHOT_BITBANG_GROUP_SIZE);
+    if (pin->pin_mask == 0) {
+      continue;
+    }
+    if (group + 1 > lut->group_count) {
+      lut->group_count = group + 1;
+    }
+
+    for (uint32_t nibble = 0; nibble < 16; nibble++) {
+      lut->words[pin->dshot_port][group][nibble] |= (nibble & bit) ? pin->set_mask : pin->reset_mask;
+    }
+  }
+}
+
+// fills the data word of every symbol, start and stop words are set up once at init
+void dshot_bitbang_encode(const dshot_bitbang_lut_t *lut, const uint16_t *packets, uint32_t port_count, volatile uint32_t (*buffer)[DSHOT_DMA_BUFFER_SIZE]) {
+  const uint32_t group_count = lut->group_count;
+  const uint32_t motor_count = group_count * DSHOT_BITBANG_GROUP_SIZE;
+
+  uint64_t bits[DSHOT_BITBANG_GROUPS] = {0};
+  for (uint32_t motor = 0; motor < motor_count; motor++) {
+    bits[motor / DSHOT_BITBANG_GROUP_SIZE] |= dshot_spread_bits(packets[motor]) << (motor % DSHOT_BITBANG_GROUP_SIZE);
+  }
+
+  for (uint32_t i = 0; i < DSHOT_DMA_SYMBOLS; i++) {
+    // msb first
+    uint8_t nibbles[DSHOT_BITBANG_GROUPS];
+    for (uint32_t group = 0; group < group_count; group++) {
+      nibbles[group] = bits[group] >> 60;
+      bits[group] <<= 4;
+    }
+
+    for (uint32_t port = 0; port < port_count; port++) {
+      uint32_t word = 0;
+      for (uint32_t group = 0; group < group_count; group++) {
+        word |= lut->words[port][group][nibbles[group]];
+      }
+      buffer[port][i * 3 + 1] = word;
+    }
+  }
+}
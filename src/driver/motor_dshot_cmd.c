@@ -0,0 +1,81 @@
+#include "driver/motor_dshot.h"
+
+#include <string.h>
+
+void dshot_cmd_queue_reset(dshot_cmd_queue_t *queue) {
+  memset(queue, 0, sizeof(dshot_cmd_queue_t));
+}
+
+bool dshot_cmd_queue_push(dshot_cmd_queue_t *queue, const dshot_cmd_t *cmd) {
+  if (cmd->command > DSHOT_CMD_MAX || cmd->repeat == 0) {
+    return false;
+  }
+
+  const uint8_t head = (queue->head + 1) % DSHOT_CMD_QUEUE_SIZE;
+  if (head == queue->tail) {
+    return false;
+  }
+
+  queue->entries[queue->head] = *cmd;
+  queue->head = head;
+  return true;
+}
+
+// drops everything but direction changes, the motors must not spin up the wrong way.
+// the command being sent is abandoned too, the esc ignores a setting it saw too few times
+void dshot_cmd_queue_flush(dshot_cmd_queue_t *queue) {
+  uint8_t head = queue->tail;
+  for (uint8_t i = queue->tail; i != queue->head; i = (i + 1) % DSHOT_CMD_QUEUE_SIZE) {
+    const dshot_cmd_t *cmd = &queue->entries[i];
+    if (cmd->command != DSHOT_CMD_ROTATE_NORMAL && cmd->command != DSHOT_CMD_ROTATE_REVERSE) {
+      if (i == queue->tail) {
+        queue->active = false;
+      }
+      continue;
+    }
+
+    queue->entries[head] = *cmd;
+    head = (head + 1) % DSHOT_CMD_QUEUE_SIZE;
+  }
+  queue->head = head;
+}
+
+// includes the command currently being sent
+bool dshot_cmd_queue_pending(const dshot_cmd_queue_t *queue, uint8_t command) {
+  for (uint8_t i = queue->tail; i != queue->head; i = (i + 1) % DSHOT_CMD_QUEUE_SIZE) {
+    if (queue->entries[i].command == command) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// never blocks, while a command is due the motors are held stopped frame by frame
+dshot_cmd_state_t dshot_cmd_queue_update(dshot_cmd_queue_t *queue, uint32_t now_us, uint8_t *command) {
+  if (queue->tail == queue->head) {
+    return DSHOT_CMD_STATE_IDLE;
+  }
+
+  const dshot_cmd_t *cmd = &queue->entries[queue->tail];
+  if (!queue->active) {
+    queue->active = true;
+    queue->sent = 0;
+    queue->wait_start_us = now_us;
+    queue->wait_us = cmd->delay_us;
+  }
+
+  if ((now_us - queue->wait_start_us) < queue->wait_us) {
+    *command = DSHOT_CMD_MOTOR_STOP;
+    return DSHOT_CMD_STATE_WAIT;
+  }
+
+  *command = cmd->command;
+  queue->wait_start_us = now_us;
+  queue->wait_us = cmd->spacing_us;
+
+  if (++queue->sent >= cmd->repeat) {
+    queue->tail = (queue->tail + 1) % DSHOT_CMD_QUEUE_SIZE;
+    queue->active = false;
+  }
+  return DSHOT_CMD_STATE_SEND;
+}
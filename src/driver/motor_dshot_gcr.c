@@ -1,5 +1,8 @@
 #include "motor_dshot.h"
 
+#include "flight/control.h"
+#include "io/blackbox.h"
+
 #ifdef SRAM_BB_BASE
 typedef struct {
   uint32_t value;
@@ -9,16 +12,20 @@ typedef struct {
 #define DSHOT_BITBAND
 #define BITBAND_PIN(VAL) (__CLZ(__RBIT(VAL)))
 #define BITBAND_SRAM(a, b) ((SRAM_BB_BASE + (((a) - SRAM_BASE) << 5) + ((b) << 2)))
-#define pin_type dshot_bitband_t
 #define pin_value ((ptr++)->value)
 #else
-#define pin_type uint16_t
 #define pin_value (*ptr++ & pin_mask)
 #endif
 
 #define GCR_INVALID 0xffffffff
-#define GCR_MIN_VALID_COUNT ((21 - 2) * 3) // 57
-#define GCR_MAX_VALID_COUNT ((21 + 2) * 3) // 69
+#define GCR_FRAME_BITS 21
+#define GCR_MAX_VALID_COUNT ((GCR_FRAME_BITS + 2) * 3) // 69
+
+#define GCR_SKIP_SAMPLES 10
+#define GCR_SAMPLE_WORDS ((GCR_DMA_BUFFER_SIZE + 31) / 32)
+#define GCR_NO_EDGE 0xffffffff
+
+static uint32_t telemetry_misses[MOTOR_PIN_MAX];
 
 static const uint32_t gcr_dict[32] = {
     GCR_INVALID,
@@ -71,80 +78,200 @@ uint32_t dshot_decode_eRPM_telemetry_value(uint16_t value) {
   return (1000000 * 60 / 100 + value / 2) / value;
 }
 
-uint32_t dshot_decode_gcr(uint16_t *dma_buffer, uint32_t pin_mask) {
+// the esc normalizes the erpm mantissa, so its top bit is only clear with a zero exponent
+dshot_edt_type_t dshot_edt_type(uint16_t value) {
+  if ((value & 0x0100) || (value & 0x0e00) == 0) {
+    return DSHOT_EDT_NONE;
+  }
+  return value >> 8;
+}
+
+// blackbox only has debug slots for the temperature and voltage of the first four escs
+void dshot_edt_update(uint32_t motor, dshot_edt_type_t type, uint8_t data) {
+  switch (type) {
+  case DSHOT_EDT_TEMPERATURE:
+    state.dshot_temp[motor] = data;
+    if (motor < 4) {
+      blackbox_set_debug(BBOX_DEBUG_DSHOT_EDT, motor, data);
+    }
+    break;
+
+  case DSHOT_EDT_VOLTAGE:
+    // 0.25V per step
+    state.dshot_voltage[motor] = data * 0.25f;
+    if (motor < 4) {
+      blackbox_set_debug(BBOX_DEBUG_DSHOT_EDT, 4 + motor, data * 25);
+    }
+    break;
+
+  case DSHOT_EDT_CURRENT: {
+    state.dshot_current[motor] = data;
+
+    float current = 0;
+    for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+      current += state.dshot_current[i];
+    }
+    blackbox_set_debug(BBOX_DEBUG_DSHOT_EDT, 8, current * 10.0f);
+    break;
+  }
+
+  case DSHOT_EDT_DEBUG1:
+    state.dshot_debug1[motor] = data;
+    break;
+
+  case DSHOT_EDT_DEBUG2:
+    state.dshot_debug2[motor] = data;
+    break;
+
+  case DSHOT_EDT_STRESS:
+    state.dshot_stress[motor] = data;
+    break;
+
+  case DSHOT_EDT_STATUS:
+    state.dshot_status[motor] = data;
+    break;
+
+  default:
+    break;
+  }
+}
+
+// a stale rpm is worse than none, it is dropped once the esc stops answering
+void dshot_telemetry_update(uint32_t motor, dshot_gcr_result_t result, uint16_t value) {
+  if (result != DSHOT_GCR_OK) {
+    state.dshot_telemetry_errors[motor]++;
+    if (++telemetry_misses[motor] >= DSHOT_TELEMETRY_MAX_MISSES) {
+      telemetry_misses[motor] = DSHOT_TELEMETRY_MAX_MISSES;
+      state.dshot_rpm[motor] = 0;
+    }
+    return;
+  }
+
+  telemetry_misses[motor] = 0;
+  state.dshot_telemetry_ok[motor]++;
+
+  const dshot_edt_type_t type = dshot_edt_type(value);
+  if (type == DSHOT_EDT_NONE) {
+    state.dshot_rpm[motor] = dshot_decode_eRPM_telemetry_value(value);
+  } else {
+    dshot_edt_update(motor, type, value & 0xff);
+  }
+}
+
+// packs the level of the pin into one bit per sample, sample n is bit n % 32 of word n / 32
+static void dshot_gcr_pack(uint32_t *samples, const uint16_t *dma_buffer, uint32_t pin_mask) {
 #ifdef DSHOT_BITBAND
-  const dshot_bitband_t *buf = (dshot_bitband_t *)BITBAND_SRAM((uint32_t)dma_buffer, BITBAND_PIN(pin_mask));
+  const dshot_bitband_t *ptr = (dshot_bitband_t *)BITBAND_SRAM((uint32_t)dma_buffer, BITBAND_PIN(pin_mask));
 #else
-  const uint16_t *buf = dma_buffer;
+  const uint16_t *ptr = dma_buffer;
 #endif
 
-  const pin_type *ptr = buf + 10;
-  const pin_type *ptr_end = buf + (GCR_DMA_BUFFER_SIZE - GCR_MIN_VALID_COUNT);
+  uint32_t index = 0;
+  for (uint32_t w = 0; w < GCR_SAMPLE_WORDS; w++) {
+    uint32_t word = 0;
+    for (uint32_t i = 0; i < 32 && index < GCR_DMA_BUFFER_SIZE; i++, index++) {
+      word |= (pin_value ? 1U : 0U) << i;
+    }
+    samples[w] = word;
+  }
+}
+
+// a valid run is at least two samples long, so a sample that disagrees with both of its
+// neighbours is a glitch. the majority of three merges it into the surrounding run.
+static void dshot_gcr_filter(uint32_t *samples) {
+  uint32_t carry = samples[0] & 0x1;
+  for (uint32_t w = 0; w < GCR_SAMPLE_WORDS; w++) {
+    const uint32_t word = samples[w];
+    const uint32_t next = w + 1 < GCR_SAMPLE_WORDS ? samples[w + 1] & 0x1 : word >> 31;
 
-  // find falling edge
-  while (ptr < ptr_end) {
-    if (pin_value == 0 ||
-        pin_value == 0 ||
-        pin_value == 0 ||
-        pin_value == 0) {
-      break;
+    const uint32_t before = (word << 1) | carry;
+    const uint32_t after = (word >> 1) | (next << 31);
+    samples[w] = (before & word) | (word & after) | (before & after);
+    carry = word >> 31;
+  }
+}
+
+// bit n is set where sample n differs from sample n - 1
+static void dshot_gcr_edges(uint32_t *edges, const uint32_t *samples) {
+  uint32_t carry = samples[0] & 0x1;
+  for (uint32_t w = 0; w < GCR_SAMPLE_WORDS; w++) {
+    edges[w] = samples[w] ^ ((samples[w] << 1) | carry);
+    carry = samples[w] >> 31;
+  }
+
+  // the first samples still see the pin switching to input
+  edges[0] &= ~((1U << GCR_SKIP_SAMPLES) - 1);
+  // the padding of the last word is not sampled
+  if (GCR_DMA_BUFFER_SIZE % 32) {
+    edges[GCR_SAMPLE_WORDS - 1] &= (1U << (GCR_DMA_BUFFER_SIZE % 32)) - 1;
+  }
+}
+
+static uint32_t dshot_gcr_next_edge(const uint32_t *edges, uint32_t from) {
+  uint32_t w = from / 32;
+  if (w >= GCR_SAMPLE_WORDS) {
+    return GCR_NO_EDGE;
+  }
+
+  uint32_t word = edges[w] & (0xFFFFFFFF << (from % 32));
+  while (word == 0) {
+    if (++w >= GCR_SAMPLE_WORDS) {
+      return GCR_NO_EDGE;
     }
+    word = edges[w];
   }
-  if (ptr >= ptr_end) {
-    return 0;
+  return w * 32 + __builtin_ctz(word);
+}
+
+static bool dshot_gcr_sample(const uint32_t *samples, uint32_t index) {
+  return samples[index / 32] & (1U << (index % 32));
+}
+
+// finds the edges of the oversampled line and turns the runs between them into bits.
+// a run of n samples is rounded to the nearest whole bit, so each edge may be off by a sample.
+dshot_gcr_result_t dshot_decode_gcr(const uint16_t *dma_buffer, uint32_t pin_mask, uint16_t *out) {
+  uint32_t samples[GCR_SAMPLE_WORDS];
+  uint32_t edges[GCR_SAMPLE_WORDS];
+  dshot_gcr_pack(samples, dma_buffer, pin_mask);
+  dshot_gcr_filter(samples);
+  dshot_gcr_edges(edges, samples);
+
+  // the line idles high, the frame starts at the first falling edge
+  uint32_t last = dshot_gcr_next_edge(edges, 0);
+  while (last != GCR_NO_EDGE && dshot_gcr_sample(samples, last)) {
+    last = dshot_gcr_next_edge(edges, last + 1);
+  }
+  if (last == GCR_NO_EDGE) {
+    return DSHOT_GCR_NO_FRAME;
   }
 
-  ptr_end = ptr + GCR_MAX_VALID_COUNT;
+  const uint32_t end = last + GCR_MAX_VALID_COUNT;
 
   uint32_t value = 0;
   uint32_t bit_len = 0;
-  const pin_type *last_ptr = ptr;
-  while (ptr < ptr_end) {
-    // find rising edge
-    while (ptr < ptr_end) {
-      if (pin_value != 0 ||
-          pin_value != 0 ||
-          pin_value != 0 ||
-          pin_value != 0) {
-        break;
-      }
-    }
-    if (ptr >= ptr_end) {
+  uint32_t level = 0;
+  while (bit_len <= GCR_FRAME_BITS) {
+    const uint32_t edge = dshot_gcr_next_edge(edges, last + 1);
+    if (edge == GCR_NO_EDGE || edge >= end) {
       break;
     }
-    {
-      const uint32_t len = max((ptr - last_ptr + 1) / 3, 1);
-      value <<= len;
-      last_ptr = ptr;
-      bit_len += len;
-    }
 
-    // find falling edge
-    while (ptr < ptr_end) {
-      if (pin_value == 0 ||
-          pin_value == 0 ||
-          pin_value == 0 ||
-          pin_value == 0) {
-        break;
-      }
-    }
-    if (ptr >= ptr_end) {
-      break;
-    }
-    {
-      const uint32_t len = max((ptr - last_ptr + 1) / 3, 1);
-      value <<= len;
+    const uint32_t len = max((edge - last + 1) / 3, 1);
+    value <<= len;
+    if (level) {
       value |= (0x1 << len) - 1;
-      last_ptr = ptr;
-      bit_len += len;
     }
+    bit_len += len;
+    level ^= 1;
+    last = edge;
   }
 
-  if (bit_len < 18 || bit_len > 21) {
-    return 0;
+  // the trailing ones run into the idle level
+  if (bit_len < 18 || bit_len > GCR_FRAME_BITS) {
+    return DSHOT_GCR_BAD_LENGTH;
   }
 
-  const uint32_t fill_len = (21 - bit_len);
+  const uint32_t fill_len = (GCR_FRAME_BITS - bit_len);
   value <<= fill_len;
   value |= (0x1 << fill_len) - 1;
   value = (value ^ (value >> 1));
@@ -154,14 +281,17 @@ uint32_t dshot_decode_gcr(uint16_t *dma_buffer, uint32_t pin_mask) {
       gcr_dict[(value >> 5) & 0x1f] << 4 |
       gcr_dict[(value >> 10) & 0x1f] << 8 |
       gcr_dict[(value >> 15) & 0x1f] << 12;
+  if (decoded > 0xffff) {
+    return DSHOT_GCR_BAD_SYMBOL;
+  }
 
   uint32_t csum = decoded;
   csum = csum ^ (csum >> 8);
   csum = csum ^ (csum >> 4);
-
-  if ((csum & 0xf) != 0xf || decoded > 0xffff) {
-    return 0;
+  if ((csum & 0xf) != 0xf) {
+    return DSHOT_GCR_BAD_CHECKSUM;
   }
 
-  return decoded >> 4;
-}
\ No newline at end of file
+  *out = decoded >> 4;
+  return DSHOT_GCR_OK;
+}
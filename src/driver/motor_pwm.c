@@ -10,12 +10,12 @@ void motor_pwm_beep() {
 
   const uint32_t time = time_millis();
   if (!beepon && (time % 2000 < 125)) {
-    for (uint32_t i = 0; i <= 3; i++) {
+    for (uint32_t i = 0; i < motor_count(); i++) {
       motor_set(i, MOTOR_PWM_BEEPS_ON);
       beepon = 1;
     }
   } else {
-    for (uint32_t i = 0; i <= 3; i++) {
+    for (uint32_t i = 0; i < motor_count(); i++) {
       motor_set(i, MOTOR_PWM_BEEPS_OFF);
       beepon = 0;
     }
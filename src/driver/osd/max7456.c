@@ -11,13 +11,19 @@
 
 #ifdef USE_MAX7456
 
-#define DMA_BUFFER_SIZE 128
+// a full screen in one run plus some attribute and address changes
+#define DMA_BUFFER_SIZE DMA_ALIGN(MAX7456_COLS * MAX7456_ROWS * 2 + 64)
 #define MAX7456_BAUD_RATE MHZ_TO_HZ(10.5)
 
+// clean characters up to this gap are rewritten, setting the address again costs 4 bytes
+#define DISPLAY_GAP_FILL 2
+
 static osd_system_t last_osd_system = OSD_SYS_NONE;
 
 static spi_bus_device_t bus = {};
 
+static DMA_RAM uint8_t dma_buffer[DMA_BUFFER_SIZE];
+
 static uint8_t max7456_map_attr(uint8_t attr) {
   // we always want at least text
   uint8_t val = TEXT;
@@ -33,6 +39,17 @@ static uint8_t max7456_map_attr(uint8_t attr) {
   return val;
 }
 
+static uint16_t max7456_display_pos(uint8_t x, uint8_t y) {
+  // NTSC adjustment 3 lines up if after line 12 or maybe this should be 8
+  if (last_osd_system != OSD_SYS_PAL && y > 12) {
+    y = y - 2;
+  }
+  if (y > MAX7456_ROWS - 1) {
+    y = MAX7456_ROWS - 1;
+  }
+  return x + y * MAX7456_COLS;
+}
+
 // blocking dma read of a single register
 static uint8_t max7456_dma_spi_read(uint8_t reg) {
   spi_bus_device_reconfigure(&bus, SPI_MODE_LEADING_EDGE, MAX7456_BAUD_RATE);
@@ -90,6 +107,7 @@ static bool max7456_init_display() {
 bool max7456_init() {
   bus.port = target.osd.port;
   bus.nss = target.osd.nss;
+  bus.lane = SPI_LANE_BULK;
   spi_bus_device_init(&bus);
   spi_bus_device_reconfigure(&bus, SPI_MODE_LEADING_EDGE, MAX7456_BAUD_RATE);
 
@@ -156,7 +174,7 @@ bool max7456_clear_async() {
   }
 
   // No clear in progress, start a new one
-  if (!spi_txn_has_free()) {
+  if (!spi_txn_has_free(&bus)) {
     return false;
   }
 
@@ -223,9 +241,8 @@ void max7456_intro() {
 }
 
 uint32_t max7456_can_fit() {
-  // Reserve at least 8 slots for critical devices (gyro, etc)
-  // This prevents OSD from starving real-time SPI devices
-  if (spi_txn_free_count() <= 8) {
+  // the bulk lane leaves SPI_TXN_RESERVED transactions to the gyro
+  if (!spi_txn_has_free(&bus)) {
     return 0;
   }
   // MAX7456 protocol overhead per string:
@@ -238,19 +255,11 @@ uint32_t max7456_can_fit() {
 
 bool max7456_push_string(uint8_t attr, uint8_t x, uint8_t y, const uint8_t *data, uint8_t size) {
   // Check if we have transactions available before building the buffer
-  if (!spi_txn_has_free()) {
+  if (!spi_txn_has_free(&bus)) {
     // No free transactions, let the caller retry later
     return false;
   }
 
-  // NTSC adjustment 3 lines up if after line 12 or maybe this should be 8
-  if (last_osd_system != OSD_SYS_PAL && y > 12) {
-    y = y - 2;
-  }
-  if (y > MAX7456_ROWS - 1) {
-    y = MAX7456_ROWS - 1;
-  }
-
   spi_bus_device_reconfigure(&bus, SPI_MODE_LEADING_EDGE, MAX7456_BAUD_RATE);
 
   uint32_t offset = 0;
@@ -259,7 +268,7 @@ bool max7456_push_string(uint8_t attr, uint8_t x, uint8_t y, const uint8_t *data
   buf[offset++] = DMM;
   buf[offset++] = max7456_map_attr(attr);
 
-  const uint16_t pos = x + y * MAX7456_COLS;
+  const uint16_t pos = max7456_display_pos(x, y);
   buf[offset++] = DMAH;
   buf[offset++] = (pos >> 8) & 0xFF;
   buf[offset++] = DMAL;
@@ -282,6 +291,93 @@ bool max7456_push_string(uint8_t attr, uint8_t x, uint8_t y, const uint8_t *data
   return true;
 }
 
+// sends every dirty character of the screen as one auto increment stream.
+// the address is only set where a run starts, the chip carries it across
+// columns and rows on its own. dirty bits are cleared as they are queued,
+// returns true once nothing is left.
+bool max7456_push_display(const osd_char_t *display, uint64_t *dirty_rows, uint8_t rows) {
+  // the previous stream is still read from the buffer
+  if (!max7456_is_ready() || !spi_txn_has_free(&bus)) {
+    return false;
+  }
+
+  uint32_t offset = 0;
+  uint16_t addr = UINT16_MAX;
+  uint8_t dmm = 0;
+  bool is_done = true;
+
+  for (uint8_t y = 0; y < rows && is_done; y++) {
+    const osd_char_t *row = &display[y * MAX7456_COLS];
+    uint64_t dirty_mask = dirty_rows[y];
+
+    while (dirty_mask) {
+      const uint8_t x = __builtin_ctzll(dirty_mask);
+      const uint16_t pos = max7456_display_pos(x, y);
+      const uint8_t attr = max7456_map_attr(row[x].attr);
+
+      uint8_t gap = 0;
+      if (pos > addr && pos - addr <= DISPLAY_GAP_FILL && pos - addr <= x) {
+        gap = pos - addr;
+        for (uint8_t i = x - gap; i < x; i++) {
+          if (max7456_map_attr(row[i].attr) != dmm) {
+            gap = 0;
+            break;
+          }
+        }
+      }
+
+      const bool set_addr = pos != addr && gap == 0;
+      const uint32_t size = (attr != dmm ? 2 : 0) + (set_addr ? 4 : 0) + gap * 2 + 2;
+      // keep room for the terminator
+      if (offset + size + 2 > DMA_BUFFER_SIZE) {
+        is_done = false;
+        break;
+      }
+
+      for (uint8_t i = x - gap; i < x; i++) {
+        dma_buffer[offset++] = DMDI;
+        dma_buffer[offset++] = row[i].val;
+      }
+      if (attr != dmm) {
+        // keeps the auto increment bit set
+        dma_buffer[offset++] = DMM;
+        dma_buffer[offset++] = attr;
+        dmm = attr;
+      }
+      if (set_addr) {
+        dma_buffer[offset++] = DMAH;
+        dma_buffer[offset++] = (pos >> 8) & 0xFF;
+        dma_buffer[offset++] = DMAL;
+        dma_buffer[offset++] = pos & 0xFF;
+      }
+      dma_buffer[offset++] = DMDI;
+      dma_buffer[offset++] = row[x].val;
+
+      addr = pos + 1;
+      dirty_mask &= ~(1ULL << x);
+    }
+
+    dirty_rows[y] = dirty_mask;
+  }
+
+  if (offset == 0) {
+    return true;
+  }
+
+  // off autoincrement mode
+  dma_buffer[offset++] = DMDI;
+  dma_buffer[offset++] = 0xFF;
+
+  spi_bus_device_reconfigure(&bus, SPI_MODE_LEADING_EDGE, MAX7456_BAUD_RATE);
+
+  const spi_txn_segment_t segs[] = {
+      spi_make_seg_dma(NULL, dma_buffer, offset),
+  };
+  spi_seg_submit_continue(&bus, segs);
+
+  return is_done;
+}
+
 bool max7456_flush() {
   return true;
 }
@@ -51,6 +51,7 @@ osd_system_t max7456_check_system();
 
 uint32_t max7456_can_fit();
 bool max7456_push_string(uint8_t attr, uint8_t x, uint8_t y, const uint8_t *data, uint8_t size);
+bool max7456_push_display(const osd_char_t *display, uint64_t *dirty_rows, uint8_t rows);
 bool max7456_flush();
 
 void osd_read_character(uint8_t addr, uint8_t *out, const uint8_t size);
@@ -31,10 +31,10 @@ void osd_device_init() {
     cols = DISPLAYPORT_COLS;
     rows = DISPLAYPORT_ROWS;
     displayport_init();
-  }
+  } else
 #endif
 #ifdef USE_MAX7456
-  else if (target_spi_device_valid(&target.osd) && max7456_init()) {
+      if (target_spi_device_valid(&target.osd) && max7456_init()) {
     target_set_feature(FEATURE_OSD);
     osd_device = OSD_DEVICE_MAX7456;
     cols = MAX7456_COLS;
@@ -321,6 +321,13 @@ static bool osd_update_display() {
     return true;
   }
 
+#ifdef USE_MAX7456
+  // the max7456 takes all dirty rows in one auto increment stream
+  if (osd_device == OSD_DEVICE_MAX7456) {
+    return max7456_push_display(display, display_dirty_rows, rows);
+  }
+#endif
+
   // Process rows until we run out of dirty rows
   while (true) {
     // Find next dirty row
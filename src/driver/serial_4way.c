@@ -12,8 +12,9 @@
 #include "driver/usb.h"
 #include "io/led.h"
 #include "util/cbor_helper.h"
+#include "util/crc.h"
 
-#ifdef USE_MOTOR_DSHOT
+#ifdef USE_SERIAL_4WAY
 
 #define RX_LED_OFF led_off(1)
 #define RX_LED_ON led_on(1)
@@ -31,30 +32,17 @@
 #define INTF_MODE_IDX 3 // index for DeviceInfostate
 #define BLHELI_SETTINGS_SIZE 0xFF
 
+#define FRAME_HEADER_SIZE 5
+
 static serial_esc4way_device_t device;
 static gpio_pins_t esc_pins[MOTOR_PIN_MAX] = {PIN_NONE};
+static uint8_t esc_count = 0;
 
-#define ESC_PIN (esc_pins[device.selected_esc])
-
-#define write_byte(b) \
-  { *out_buf_ptr++ = b; }
+// escs connected with SERIAL_4WAY_ALL_ESCS, erase and write go to all of them at once
+static gpio_pins_t parallel_pins[MOTOR_PIN_MAX];
+static uint8_t parallel_count = 0;
 
-#define write_byte_crc(crc, b)          \
-  {                                     \
-    write_byte(b);                      \
-    *crc = _crc_xmodem_update(*crc, b); \
-  }
-
-static uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data) {
-  crc = crc ^ ((uint16_t)data << 8);
-  for (uint8_t i = 0; i < 8; i++) {
-    if (crc & 0x8000)
-      crc = (crc << 1) ^ 0x1021;
-    else
-      crc <<= 1;
-  }
-  return crc;
-}
+#define ESC_PIN (esc_pins[device.selected_esc])
 
 bool device_is_connected() {
   return device.info[0] > 0 && device.info[1] > 0;
@@ -62,6 +50,17 @@ bool device_is_connected() {
 
 static void device_set_disconnected() {
   memset(device.info, 0, SERIAL_4WAY_DEVICE_INFO_SIZE);
+  parallel_count = 0;
+}
+
+// pins the current command goes to
+static uint8_t device_pins(const gpio_pins_t **pins) {
+  if (parallel_count) {
+    *pins = parallel_pins;
+    return parallel_count;
+  }
+  *pins = &ESC_PIN;
+  return 1;
 }
 
 static uint32_t device_settings_offset() {
@@ -94,17 +93,11 @@ static uint32_t device_page_multiplier() {
   }
 }
 
-static uint8_t read_byte() {
-  uint8_t byte = 0;
-  while (usb_serial_read(&byte, 1) == 0)
-    ;
-  return byte;
-}
-
-static uint8_t read_byte_crc(uint16_t *crc) {
-  uint8_t b = read_byte();
-  *crc = _crc_xmodem_update(*crc, b);
-  return b;
+static void read_bytes(uint8_t *buf, uint32_t size) {
+  uint32_t read = 0;
+  while (read < size) {
+    read += usb_serial_read(buf + read, size - read);
+  }
 }
 
 static uint8_t connect_esc(gpio_pins_t pin, uint8_t *data) {
@@ -128,19 +121,59 @@ static uint8_t connect_esc(gpio_pins_t pin, uint8_t *data) {
   return 0;
 }
 
+// every esc has to run the same bootloader on the same mcu to be written in parallel.
+// returns a mask of the escs that connected, the rest are left out of every write.
+static uint8_t connect_all_escs() {
+  uint8_t info[SERIAL_4WAY_DEVICE_INFO_SIZE];
+  uint8_t first_info[SERIAL_4WAY_DEVICE_INFO_SIZE];
+  uint8_t count = 0;
+  uint8_t connected = 0;
+
+  // device.info stays clear until the end, the boot init frames go out without crc
+  for (uint8_t i = 0; i < esc_count; i++) {
+    if (!connect_esc(esc_pins[i], info)) {
+      continue;
+    }
+
+    const uint16_t signature = (info[1] << 8) | (uint16_t)info[0];
+    if (count == 0) {
+      memcpy(first_info, info, SERIAL_4WAY_DEVICE_INFO_SIZE);
+      device.signature = signature;
+      device.selected_esc = i;
+    } else if (signature != device.signature) {
+      // leave none of them waiting in the bootloader
+      avr_bl_send_restart(esc_pins[i], info);
+      for (uint8_t j = 0; j < count; j++) {
+        avr_bl_send_restart(parallel_pins[j], info);
+      }
+      return 0;
+    }
+    parallel_pins[count++] = esc_pins[i];
+    connected |= 1 << i;
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  memcpy(device.info, first_info, SERIAL_4WAY_DEVICE_INFO_SIZE);
+  parallel_count = count;
+  return connected;
+}
+
 uint8_t serial_4way_init() {
   motor_set_all(MOTOR_OFF);
   motor_wait_for_ready();
 
   time_delay_ms(250);
 
-  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+  esc_count = motor_count();
+  for (uint32_t i = 0; i < esc_count; i++) {
     const gpio_pins_t pin = target.motor_pins[profile.motor.motor_pins[i]];
     esc_pins[i] = pin;
     avr_bl_init_pin(pin);
   }
 
-  return MOTOR_PIN_MAX;
+  return esc_count;
 }
 
 void serial_4way_release() {
@@ -165,8 +198,12 @@ serial_esc4way_ack_t serial_4way_send(uint8_t cmd, uint16_t addr, const uint8_t
       case ESC4WAY_ATM_BLB:
       case ESC4WAY_SIL_BLB:
       case ESC4WAY_ARM_BLB: {
-        if (!avr_bl_send_keepalive(ESC_PIN)) {
-          ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
+        const gpio_pins_t *pins;
+        const uint8_t count = device_pins(&pins);
+        for (uint8_t i = 0; i < count; i++) {
+          if (!avr_bl_send_keepalive(pins[i])) {
+            ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
+          }
         }
         break;
       }
@@ -216,7 +253,17 @@ serial_esc4way_ack_t serial_4way_send(uint8_t cmd, uint16_t addr, const uint8_t
   }
 
   case ESC4WAY_DEVICE_RESET: {
-    if (input[0] >= MOTOR_PIN_MAX) {
+    if (input[0] == SERIAL_4WAY_ALL_ESCS && parallel_count) {
+      for (uint8_t i = 0; i < parallel_count; i++) {
+        avr_bl_send_restart(parallel_pins[i], device.info);
+        if (addr) {
+          avr_bl_reboot(parallel_pins[i]);
+        }
+      }
+      device_set_disconnected();
+      break;
+    }
+    if (input[0] >= esc_count) {
       return ESC4WAY_ACK_I_INVALID_CHANNEL;
     }
 
@@ -248,7 +295,23 @@ serial_esc4way_ack_t serial_4way_send(uint8_t cmd, uint16_t addr, const uint8_t
   case ESC4WAY_DEVICE_INIT_FLASH: {
     device_set_disconnected();
 
-    if (input[0] >= MOTOR_PIN_MAX) {
+    if (input[0] == SERIAL_4WAY_ALL_ESCS) {
+      const uint8_t connected = connect_all_escs();
+      if (connected) {
+        device.info[INTF_MODE_IDX] = device.mode;
+      } else {
+        ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
+        device_set_disconnected();
+      }
+
+      // the host has to know which escs the following writes reach
+      *output_size = SERIAL_4WAY_DEVICE_INFO_SIZE + 1;
+      memcpy(output, device.info, SERIAL_4WAY_DEVICE_INFO_SIZE);
+      output[SERIAL_4WAY_DEVICE_INFO_SIZE] = connected;
+      break;
+    }
+
+    if (input[0] >= esc_count) {
       return ESC4WAY_ACK_I_INVALID_CHANNEL;
     }
 
@@ -284,7 +347,9 @@ serial_esc4way_ack_t serial_4way_send(uint8_t cmd, uint16_t addr, const uint8_t
         full_addr = (addr << 1) << 8;
       }
 
-      if (!avr_bl_page_erase(ESC_PIN, full_addr)) {
+      const gpio_pins_t *pins;
+      const uint8_t count = device_pins(&pins);
+      if (!avr_bl_page_erase_multi(pins, count, full_addr)) {
         ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
       }
       break;
@@ -340,7 +405,9 @@ serial_esc4way_ack_t serial_4way_send(uint8_t cmd, uint16_t addr, const uint8_t
     case ESC4WAY_SIL_BLB:
     case ESC4WAY_ATM_BLB:
     case ESC4WAY_ARM_BLB: {
-      if (!avr_bl_write_flash(ESC_PIN, addr, input, input_size)) {
+      const gpio_pins_t *pins;
+      const uint8_t count = device_pins(&pins);
+      if (!avr_bl_write_flash_multi(pins, count, addr, input, input_size)) {
         ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
       }
       break;
@@ -360,8 +427,14 @@ serial_esc4way_ack_t serial_4way_send(uint8_t cmd, uint16_t addr, const uint8_t
       break;
     }
     case ESC4WAY_ATM_BLB: {
-      if (avr_bl_write_eeprom(ESC_PIN, addr, input, input_size)) {
-        ack_out = ESC4WAY_ACK_OK;
+      const gpio_pins_t *pins;
+      const uint8_t count = device_pins(&pins);
+
+      ack_out = ESC4WAY_ACK_OK;
+      for (uint8_t i = 0; i < count; i++) {
+        if (!avr_bl_write_eeprom(pins[i], addr, input, input_size)) {
+          ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
+        }
       }
       break;
     }
@@ -374,16 +447,20 @@ serial_esc4way_ack_t serial_4way_send(uint8_t cmd, uint16_t addr, const uint8_t
   case ESC4WAY_DEVICE_VERIFY: {
     switch (device.mode) {
     case ESC4WAY_ARM_BLB: {
-      switch (avr_bl_verify_flash(ESC_PIN, addr, input, input_size)) {
-      case brSUCCESS:
-        ack_out = ESC4WAY_ACK_OK;
-        break;
-      case brERRORVERIFY:
-        ack_out = ESC4WAY_ACK_I_VERIFY_ERROR;
-        break;
-      default:
-        ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
-        break;
+      const gpio_pins_t *pins;
+      const uint8_t count = device_pins(&pins);
+
+      for (uint8_t i = 0; i < count && ack_out == ESC4WAY_ACK_OK; i++) {
+        switch (avr_bl_verify_flash(pins[i], addr, input, input_size)) {
+        case brSUCCESS:
+          break;
+        case brERRORVERIFY:
+          ack_out = ESC4WAY_ACK_I_VERIFY_ERROR;
+          break;
+        default:
+          ack_out = ESC4WAY_ACK_D_GENERAL_ERROR;
+          break;
+        }
       }
       break;
     }
@@ -555,33 +632,35 @@ void serial_4way_process() {
   uint8_t output_buffer[256];
   uint8_t output_size = 0;
 
-  uint16_t crc_in = 0;
-  uint16_t crc_out = 0;
-
   RX_LED_OFF;
   TX_LED_OFF;
 
   while (1) {
     // restart looking for new sequence from host
-    uint8_t magic;
+    uint8_t header[FRAME_HEADER_SIZE];
     do {
       RX_LED_ON;
-      crc_in = 0;
-      magic = read_byte_crc(&crc_in);
+      read_bytes(header, 1);
       RX_LED_OFF;
-    } while (magic != ESC4WAY_LOCAL_ESCAPE);
+    } while (header[0] != ESC4WAY_LOCAL_ESCAPE);
 
     RX_LED_ON;
 
-    const uint8_t cmd = read_byte_crc(&crc_in);
-    const uint16_t addr = (read_byte_crc(&crc_in) << 8) | (uint16_t)(read_byte_crc(&crc_in));
+    // the rest of the frame is pulled from the usb ring in bulk
+    read_bytes(header + 1, FRAME_HEADER_SIZE - 1);
 
-    const uint8_t size = read_byte_crc(&crc_in);
-    for (uint16_t i = 0; i < (size == 0 ? 256 : size); i++) {
-      input_buffer[i] = read_byte_crc(&crc_in);
-    }
+    const uint8_t cmd = header[1];
+    const uint16_t addr = (header[2] << 8) | (uint16_t)(header[3]);
+
+    const uint8_t size = header[4];
+    const uint32_t len = size == 0 ? 256 : size;
+    read_bytes(input_buffer, len);
 
-    const uint16_t their_crc = (uint16_t)(read_byte() << 8) | (uint16_t)(read_byte());
+    uint8_t crc_buf[2];
+    read_bytes(crc_buf, 2);
+
+    const uint16_t their_crc = (uint16_t)(crc_buf[0] << 8) | (uint16_t)(crc_buf[1]);
+    const uint16_t crc_in = crc16_xmodem_data(crc16_xmodem_data(0, header, FRAME_HEADER_SIZE), input_buffer, len);
 
     memset(output_buffer, 0, 256);
 
@@ -595,27 +674,25 @@ void serial_4way_process() {
       ack_out = ESC4WAY_ACK_I_INVALID_CRC;
     }
 
-    crc_out = 0;
-
     {
-      uint8_t out_buf[512];
-      uint8_t *out_buf_ptr = out_buf;
+      uint8_t out_buf[FRAME_HEADER_SIZE + 256 + 3];
 
-      write_byte_crc(&crc_out, ESC4WAY_REMOTE_ESCAPE);
-      write_byte_crc(&crc_out, cmd);
-      write_byte_crc(&crc_out, addr >> 8);
-      write_byte_crc(&crc_out, addr & 0xFF);
+      out_buf[0] = ESC4WAY_REMOTE_ESCAPE;
+      out_buf[1] = cmd;
+      out_buf[2] = addr >> 8;
+      out_buf[3] = addr & 0xFF;
+      out_buf[4] = output_size;
 
-      write_byte_crc(&crc_out, output_size);
-      for (uint16_t i = 0; i < (output_size == 0 ? 256 : output_size); i++) {
-        write_byte_crc(&crc_out, output_buffer[i]);
-      }
+      const uint32_t output_len = output_size == 0 ? 256 : output_size;
+      memcpy(out_buf + FRAME_HEADER_SIZE, output_buffer, output_len);
+      out_buf[FRAME_HEADER_SIZE + output_len] = ack_out;
 
-      write_byte_crc(&crc_out, ack_out);
-      write_byte(crc_out >> 8);
-      write_byte(crc_out & 0xFF);
+      const uint32_t crc_offset = FRAME_HEADER_SIZE + output_len + 1;
+      const uint16_t crc_out = crc16_xmodem_data(0, out_buf, crc_offset);
+      out_buf[crc_offset] = crc_out >> 8;
+      out_buf[crc_offset + 1] = crc_out & 0xFF;
 
-      usb_serial_write(out_buf, out_buf_ptr - out_buf);
+      usb_serial_write(out_buf, crc_offset + 2);
     }
 
     TX_LED_OFF;
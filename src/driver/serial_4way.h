@@ -20,6 +20,10 @@
 
 #define SERIAL_4WAY_DEVICE_INFO_SIZE 4
 
+// channel for init flash and reset that selects every esc, erase and write then run in parallel.
+// init flash on it appends a mask of the escs that connected to the device info.
+#define SERIAL_4WAY_ALL_ESCS 0xFF
+
 typedef enum {
   ESC4WAY_SIL_C2 = 0,
   ESC4WAY_SIL_BLB = 1,
@@ -4,8 +4,10 @@
 #include "driver/serial_4way.h"
 #include "driver/serial_esc.h"
 #include "driver/time.h"
+#include "util/crc.h"
+#include "util/ring_buffer.h"
 
-#ifdef USE_MOTOR_DSHOT
+#ifdef USE_SERIAL_4WAY
 
 #define BOOT_MSG_LEN 4
 #define DevSignHi (BOOT_MSG_LEN)
@@ -34,83 +36,113 @@
 #define CMD_BOOTSIGN 0x08
 
 #define ESC_BAUD 19200
-#define START_BIT_TIMEOUT_MS 2
+// errors are sent right after a frame, two byte times are enough to rule them out
+#define NO_ACK_TIMEOUT_US (2 * 10 * 1000000 / ESC_BAUD)
 
 extern bool device_is_connected();
 
-static uint16_t crc_update(uint8_t data, uint16_t crc) {
-  for (uint8_t i = 0; i < 8; i++) {
-    if (((data & 0x01) ^ (crc & 0x0001)) != 0) {
-      crc = crc >> 1;
-      crc = crc ^ 0xA001;
-    } else {
-      crc = crc >> 1;
-    }
-    data = data >> 1;
-  }
-  return crc;
-}
+// a whole frame, its crc and the ack fit in either ring
+#define FRAME_RING_SIZE (256 + 4)
+
+static uint8_t tx_ring_data[FRAME_RING_SIZE];
+static ring_buffer_t tx_ring = {
+    .buffer = tx_ring_data,
+    .head = 0,
+    .tail = 0,
+    .size = FRAME_RING_SIZE,
+};
+
+static uint8_t rx_ring_data[FRAME_RING_SIZE];
+static ring_buffer_t rx_ring = {
+    .buffer = rx_ring_data,
+    .head = 0,
+    .tail = 0,
+    .size = FRAME_RING_SIZE,
+};
 
 static uint8_t avr_bl_read(gpio_pins_t esc, uint8_t *buf, uint8_t size) {
-  uint16_t crc = 0;
-
   // len 0 means 256
-  for (uint16_t i = 0; i < (size == 0 ? 256 : size); i++) {
-    if (!serial_esc_read(esc, ESC_BAUD, buf + i)) {
-      return 0;
-    }
-    crc = crc_update(buf[i], crc);
+  const uint32_t len = size == 0 ? 256 : size;
+  // With CRC read 3 more, the frame is received in one go and checked once it is in
+  const uint32_t crc_len = device_is_connected() ? 2 : 0;
+
+  ring_buffer_clear(&rx_ring);
+  if (serial_esc_read_ring(esc, ESC_BAUD, &rx_ring, len + crc_len + 1) != len + crc_len + 1) {
+    return 0;
   }
+  ring_buffer_read_multi(&rx_ring, buf, len);
 
-  uint8_t ack = brNONE;
-  if (device_is_connected()) {
-    // With CRC read 3 more
+  if (crc_len) {
     uint8_t crc_buf[2];
-    if (!serial_esc_read(esc, ESC_BAUD, &crc_buf[0])) {
-      return 0;
-    }
-    if (!serial_esc_read(esc, ESC_BAUD, &crc_buf[1])) {
-      return 0;
-    }
+    ring_buffer_read_multi(&rx_ring, crc_buf, 2);
 
     uint16_t their_crc = (uint16_t)(crc_buf[1] << 8) | crc_buf[0];
-    if (their_crc != crc) {
+    if (their_crc != crc16_arc_data(0, buf, len)) {
       return 0;
     }
   }
 
-  if (!serial_esc_read(esc, ESC_BAUD, &ack)) {
-    return 0;
-  }
+  uint8_t ack = brNONE;
+  ring_buffer_read(&rx_ring, &ack);
   return ack == brSUCCESS;
 }
 
-static void avr_bl_write(gpio_pins_t esc, const uint8_t *buf, const uint8_t size) {
-  serial_esc_set_output(esc);
+// writes the same frame to every pin at once, the crc follows without a gap
+static void avr_bl_write_multi(const gpio_pins_t *pins, uint8_t count, const uint8_t *buf, const uint8_t size) {
+  const uint32_t len = size == 0 ? 256 : size;
 
-  uint16_t crc = 0;
-  for (uint16_t i = 0; i < (size == 0 ? 256 : size); i++) {
-    serial_esc_write(esc, ESC_BAUD, buf[i]);
-    crc = crc_update(buf[i], crc);
+  ring_buffer_clear(&tx_ring);
+  ring_buffer_write_multi(&tx_ring, buf, len);
+  if (device_is_connected()) {
+    const uint16_t crc = crc16_arc_data(0, buf, len);
+    const uint8_t crc_buf[2] = {crc & 0xFF, crc >> 8};
+    ring_buffer_write_multi(&tx_ring, crc_buf, 2);
   }
 
-  if (device_is_connected()) {
-    serial_esc_write(esc, ESC_BAUD, (crc >> 0) & 0xFF);
-    serial_esc_write(esc, ESC_BAUD, (crc >> 8) & 0xFF);
+  for (uint8_t i = 0; i < count; i++) {
+    serial_esc_set_output(pins[i]);
   }
 
-  serial_esc_set_input(esc);
+  serial_esc_write_ring(pins, count, ESC_BAUD, &tx_ring);
+
+  for (uint8_t i = 0; i < count; i++) {
+    serial_esc_set_input(pins[i]);
+  }
 }
 
-static uint8_t avr_bl_get_ack(gpio_pins_t pin, uint32_t timeout) {
-  uint8_t ack = brNONE;
-  while (!serial_esc_read(pin, ESC_BAUD, &ack) && timeout) {
-    timeout--;
-  };
-  return ack;
+static void avr_bl_write(gpio_pins_t esc, const uint8_t *buf, const uint8_t size) {
+  avr_bl_write_multi(&esc, 1, buf, size);
+}
+
+// returns the ack all pins agree on, brNONE if none answered and brERRORCOMMAND if they disagree
+static uint8_t avr_bl_get_ack_multi(const gpio_pins_t *pins, uint8_t count, uint32_t timeout_us) {
+  if (count == 1) {
+    uint8_t ack = brNONE;
+    serial_esc_read_timeout(pins[0], ESC_BAUD, &ack, timeout_us);
+    return ack;
+  }
+
+  uint8_t acks[MOTOR_PIN_MAX];
+  const uint32_t received = serial_esc_read_multi(pins, count, ESC_BAUD, acks, timeout_us);
+  if (received == 0) {
+    return brNONE;
+  }
+  if (received != (1U << count) - 1) {
+    return brERRORCOMMAND;
+  }
+  for (uint8_t i = 1; i < count; i++) {
+    if (acks[i] != acks[0]) {
+      return brERRORCOMMAND;
+    }
+  }
+  return acks[0];
 }
 
-static uint8_t avr_bl_send_set_addr(gpio_pins_t pin, uint16_t addr) {
+static uint8_t avr_bl_get_ack(gpio_pins_t pin, uint32_t timeout_us) {
+  return avr_bl_get_ack_multi(&pin, 1, timeout_us);
+}
+
+static uint8_t avr_bl_send_set_addr(const gpio_pins_t *pins, uint8_t count, uint16_t addr) {
   if (addr == 0xFFFF) {
     return 1;
   }
@@ -121,12 +153,12 @@ static uint8_t avr_bl_send_set_addr(gpio_pins_t pin, uint16_t addr) {
       (addr >> 8) & 0xFF,
       addr & 0xFF,
   };
-  avr_bl_write(pin, buf, 4);
+  avr_bl_write_multi(pins, count, buf, 4);
 
-  return avr_bl_get_ack(pin, 2) == brSUCCESS;
+  return avr_bl_get_ack_multi(pins, count, 6 * 1000) == brSUCCESS;
 }
 
-static uint8_t avr_bl_send_set_buffer(gpio_pins_t pin, const uint8_t *data, uint8_t size) {
+static uint8_t avr_bl_send_set_buffer(const gpio_pins_t *pins, uint8_t count, const uint8_t *data, uint8_t size) {
   uint8_t buf[] = {
       CMD_SET_BUFFER,
       0,
@@ -137,14 +169,15 @@ static uint8_t avr_bl_send_set_buffer(gpio_pins_t pin, const uint8_t *data, uint
     // set high byte
     buf[2] = 1;
   }
-  avr_bl_write(pin, buf, 4);
+  avr_bl_write_multi(pins, count, buf, 4);
 
-  if (avr_bl_get_ack(pin, 2) != brNONE)
+  // the bootloader does not ack this, only wait long enough to catch an error
+  if (avr_bl_get_ack_multi(pins, count, NO_ACK_TIMEOUT_US) != brNONE)
     return 0;
 
-  avr_bl_write(pin, data, size);
+  avr_bl_write_multi(pins, count, data, size);
 
-  return avr_bl_get_ack(pin, 40) == brSUCCESS;
+  return avr_bl_get_ack_multi(pins, count, 80 * 1000) == brSUCCESS;
 }
 
 void avr_bl_init_pin(gpio_pins_t pin) {
@@ -181,7 +214,7 @@ uint8_t avr_bl_send_keepalive(gpio_pins_t pin) {
   uint8_t buf[] = {CMD_KEEP_ALIVE, 0};
   avr_bl_write(pin, buf, 2);
 
-  if (avr_bl_get_ack(pin, 1) != brERRORCOMMAND) {
+  if (avr_bl_get_ack(pin, 4 * 1000) != brERRORCOMMAND) {
     return 0;
   }
 
@@ -209,7 +242,7 @@ void avr_bl_reboot(gpio_pins_t pin) {
 }
 
 static uint8_t avr_bl_read_cmd(gpio_pins_t pin, uint8_t cmd, uint16_t addr, uint8_t *data, uint8_t size) {
-  if (!avr_bl_send_set_addr(pin, addr)) {
+  if (!avr_bl_send_set_addr(&pin, 1, addr)) {
     return 0;
   }
 
@@ -219,19 +252,19 @@ static uint8_t avr_bl_read_cmd(gpio_pins_t pin, uint8_t cmd, uint16_t addr, uint
   return avr_bl_read(pin, data, size);
 }
 
-static uint8_t avr_bl_write_cmd(gpio_pins_t pin, uint8_t cmd, uint16_t addr, const uint8_t *data, uint8_t size, uint32_t timeout) {
-  if (!avr_bl_send_set_addr(pin, addr)) {
+static uint8_t avr_bl_write_cmd(const gpio_pins_t *pins, uint8_t count, uint8_t cmd, uint16_t addr, const uint8_t *data, uint8_t size, uint32_t timeout_us) {
+  if (!avr_bl_send_set_addr(pins, count, addr)) {
     return 0;
   }
 
-  if (!avr_bl_send_set_buffer(pin, data, size)) {
+  if (!avr_bl_send_set_buffer(pins, count, data, size)) {
     return 0;
   }
 
   uint8_t buf[] = {cmd, 0x01};
-  avr_bl_write(pin, buf, 2);
+  avr_bl_write_multi(pins, count, buf, 2);
 
-  return avr_bl_get_ack(pin, timeout) == brSUCCESS;
+  return avr_bl_get_ack_multi(pins, count, timeout_us) == brSUCCESS;
 }
 
 uint8_t avr_bl_read_flash(gpio_pins_t pin, uint8_t interface_mode, uint16_t addr, uint8_t *data, uint8_t size) {
@@ -246,38 +279,46 @@ uint8_t avr_bl_read_eeprom(gpio_pins_t pin, uint16_t addr, uint8_t *data, uint8_
   return avr_bl_read_cmd(pin, CMD_READ_EEPROM, addr, data, size);
 }
 
-uint8_t avr_bl_page_erase(gpio_pins_t pin, uint16_t addr) {
-  if (!avr_bl_send_set_addr(pin, addr)) {
+uint8_t avr_bl_page_erase_multi(const gpio_pins_t *pins, uint8_t count, uint16_t addr) {
+  if (!avr_bl_send_set_addr(pins, count, addr)) {
     return 0;
   }
 
   uint8_t buf[] = {CMD_ERASE_FLASH, 0x01};
-  avr_bl_write(pin, buf, 2);
+  avr_bl_write_multi(pins, count, buf, 2);
 
-  return avr_bl_get_ack(pin, (3000 / START_BIT_TIMEOUT_MS)) == brSUCCESS;
+  return avr_bl_get_ack_multi(pins, count, 3000 * 1000) == brSUCCESS;
+}
+
+uint8_t avr_bl_page_erase(gpio_pins_t pin, uint16_t addr) {
+  return avr_bl_page_erase_multi(&pin, 1, addr);
 }
 
 uint8_t avr_bl_write_eeprom(gpio_pins_t pin, uint16_t addr, const uint8_t *data, uint8_t size) {
-  return avr_bl_write_cmd(pin, CMD_PROG_EEPROM, addr, data, size, (3000 / START_BIT_TIMEOUT_MS));
+  return avr_bl_write_cmd(&pin, 1, CMD_PROG_EEPROM, addr, data, size, 3000 * 1000);
+}
+
+uint8_t avr_bl_write_flash_multi(const gpio_pins_t *pins, uint8_t count, uint16_t addr, const uint8_t *data, uint8_t size) {
+  return avr_bl_write_cmd(pins, count, CMD_PROG_FLASH, addr, data, size, 500 * 1000);
 }
 
 uint8_t avr_bl_write_flash(gpio_pins_t pin, uint16_t addr, const uint8_t *data, uint8_t size) {
-  return avr_bl_write_cmd(pin, CMD_PROG_FLASH, addr, data, size, (500 / START_BIT_TIMEOUT_MS));
+  return avr_bl_write_flash_multi(&pin, 1, addr, data, size);
 }
 
 uint8_t avr_bl_verify_flash(gpio_pins_t pin, uint16_t addr, const uint8_t *data, uint8_t size) {
-  if (!avr_bl_send_set_addr(pin, addr)) {
+  if (!avr_bl_send_set_addr(&pin, 1, addr)) {
     return 0;
   }
 
-  if (!avr_bl_send_set_buffer(pin, data, size)) {
+  if (!avr_bl_send_set_buffer(&pin, 1, data, size)) {
     return 0;
   }
 
   uint8_t buf[] = {CMD_VERIFY_FLASH_ARM, 0x01};
   avr_bl_write(pin, buf, 2);
 
-  return avr_bl_get_ack(pin, 40 / START_BIT_TIMEOUT_MS);
+  return avr_bl_get_ack(pin, 40 * 1000);
 }
 
 #endif
\ No newline at end of file
@@ -23,6 +23,8 @@ void avr_bl_reboot(gpio_pins_t pin);
 uint8_t avr_bl_read_flash(gpio_pins_t pin, uint8_t interface_mode, uint16_t addr, uint8_t *data, uint8_t size);
 uint8_t avr_bl_read_eeprom(gpio_pins_t pin, uint16_t addr, uint8_t *data, uint8_t size);
 uint8_t avr_bl_page_erase(gpio_pins_t pin, uint16_t addr);
+uint8_t avr_bl_page_erase_multi(const gpio_pins_t *pins, uint8_t count, uint16_t addr);
 uint8_t avr_bl_write_eeprom(gpio_pins_t pin, uint16_t addr, const uint8_t *data, uint8_t size);
 uint8_t avr_bl_write_flash(gpio_pins_t pin, uint16_t addr, const uint8_t *data, uint8_t size);
+uint8_t avr_bl_write_flash_multi(const gpio_pins_t *pins, uint8_t count, uint16_t addr, const uint8_t *data, uint8_t size);
 uint8_t avr_bl_verify_flash(gpio_pins_t pin, uint16_t addr, const uint8_t *data, uint8_t size);
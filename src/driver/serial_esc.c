@@ -4,6 +4,7 @@
 #include "core/target.h"
 #include "driver/motor.h"
 #include "driver/usb.h"
+#include "util/util.h"
 
 #define START_BIT_TIMEOUT_MS 2
 
@@ -33,11 +34,53 @@ void serial_esc_set_output(gpio_pins_t pin) {
 }
 
 bool serial_esc_read(gpio_pins_t pin, uint32_t baud, uint8_t *bt) {
-  uint32_t start_time = time_millis();
+  return serial_esc_read_timeout(pin, baud, bt, START_BIT_TIMEOUT_MS * 1000);
+}
+
+// samples up to size bytes straight into the ring storage, stops at the first byte that
+// does not arrive. returns the number of bytes received.
+uint32_t serial_esc_read_ring(gpio_pins_t pin, uint32_t baud, ring_buffer_t *rx, uint32_t size) {
+  uint32_t received = 0;
+  while (received < size) {
+    uint8_t *data = NULL;
+    const uint32_t space = min(ring_buffer_write_reserve(rx, &data), size - received);
+    if (space == 0) {
+      break;
+    }
+
+    uint32_t count = 0;
+    while (count < space && serial_esc_read(pin, baud, data + count)) {
+      count++;
+    }
+    ring_buffer_write_commit(rx, count);
+    received += count;
+
+    if (count < space) {
+      break;
+    }
+  }
+  return received;
+}
+
+// drains the ring onto every pin, a frame queued into an empty ring goes out in one piece
+void serial_esc_write_ring(const gpio_pins_t *pins, uint32_t count, uint32_t baud, ring_buffer_t *tx) {
+  uint8_t *data = NULL;
+  uint32_t size = 0;
+  while ((size = ring_buffer_read_reserve(tx, &data)) > 0) {
+    serial_esc_write_buf(pins, count, baud, data, size);
+    ring_buffer_read_commit(tx, size);
+  }
+}
+
+// the simulator emulates the other end of the wire in driver/mcu/native/serial_esc.c
+#ifndef SIMULATOR
+
+bool serial_esc_read_timeout(gpio_pins_t pin, uint32_t baud, uint8_t *bt, uint32_t timeout_us) {
+  uint32_t start_time = time_cycles();
 
   while (serial_esc_is_high(pin)) {
     // check for startbit begin
-    if (time_millis() - start_time > START_BIT_TIMEOUT_MS) {
+    if (time_cycles() - start_time > US_TO_CYCLES(timeout_us)) {
       return false;
     }
   }
@@ -76,6 +119,64 @@ bool serial_esc_read(gpio_pins_t pin, uint32_t baud, uint8_t *bt) {
   return true;
 }
 
+// receives one byte from each pin, all pins are sampled from the same polling loop.
+// returns a mask of the pins that delivered a valid byte.
+uint32_t serial_esc_read_multi(const gpio_pins_t *pins, uint32_t count, uint32_t baud, uint8_t *bytes, uint32_t timeout_us) {
+  const uint32_t bit_time = BIT_TIME(baud);
+
+  uint32_t sample_time[MOTOR_PIN_MAX];
+  uint16_t bitmask[MOTOR_PIN_MAX] = {0};
+  uint8_t bit[MOTOR_PIN_MAX] = {0};
+
+  uint32_t started = 0;
+  uint32_t pending = (1 << count) - 1;
+  uint32_t received = 0;
+
+  const uint32_t start_time = time_cycles();
+  while (pending) {
+    const uint32_t now = time_cycles();
+
+    for (uint32_t i = 0; i < count; i++) {
+      const uint32_t mask = 1 << i;
+      if (!(pending & mask)) {
+        continue;
+      }
+
+      if (!(started & mask)) {
+        if (!serial_esc_is_high(pins[i])) {
+          started |= mask;
+          sample_time[i] = now + START_BIT_TIME(baud);
+        } else if (now - start_time > US_TO_CYCLES(timeout_us)) {
+          pending &= ~mask;
+        }
+        continue;
+      }
+
+      if ((int32_t)(now - sample_time[i]) < 0) {
+        continue;
+      }
+      if (serial_esc_is_high(pins[i])) {
+        bitmask[i] |= (1 << bit[i]);
+      }
+      sample_time[i] += bit_time;
+
+      if (++bit[i] < 10) {
+        continue;
+      }
+      pending &= ~mask;
+
+      // check start bit and stop bit
+      if ((bitmask[i] & 1) || !(bitmask[i] & (1 << 9))) {
+        continue;
+      }
+      bytes[i] = bitmask[i] >> 1;
+      received |= mask;
+    }
+  }
+
+  return received;
+}
+
 void serial_esc_write(gpio_pins_t pin, uint32_t baud, uint8_t data) {
   const uint32_t bit_time = BIT_TIME(baud);
 
@@ -99,6 +200,43 @@ void serial_esc_write(gpio_pins_t pin, uint32_t baud, uint8_t data) {
   }
 }
 
+static void serial_esc_write_bit(const gpio_pins_t *pins, uint32_t count, bool high) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (high) {
+      serial_esc_set_high(pins[i]);
+    } else {
+      serial_esc_set_low(pins[i]);
+    }
+  }
+}
+
+// shifts the buffer out back to back on every pin at once. bit edges are scheduled
+// from a single start time, so per byte overhead does not accumulate into drift.
+void serial_esc_write_buf(const gpio_pins_t *pins, uint32_t count, uint32_t baud, const uint8_t *buf, uint32_t size) {
+  const uint32_t bit_time = BIT_TIME(baud);
+  const uint32_t start_time = time_cycles();
+
+  // one idle bit so the receivers see a clean start bit edge
+  serial_esc_write_bit(pins, count, true);
+  uint32_t btime = bit_time;
+
+  for (uint32_t i = 0; i < size; i++) {
+    const uint16_t frame = (buf[i] << 1) | (1 << 9);
+    for (uint8_t bit = 0; bit < 10; bit++) {
+      while (time_cycles() - start_time < btime)
+        ;
+      serial_esc_write_bit(pins, count, (frame >> bit) & 0x1);
+      btime += bit_time;
+    }
+  }
+
+  // let the last stop bit finish before the pins are turned around
+  while (time_cycles() - start_time < btime)
+    ;
+}
+
+#endif
+
 void serial_esc_process(uint8_t index, uint32_t baud) {
   const gpio_pins_t pin = target.motor_pins[profile.motor.motor_pins[index]];
 
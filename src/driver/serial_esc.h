@@ -3,6 +3,7 @@
 #include <stdint.h>
 
 #include "driver/gpio.h"
+#include "util/ring_buffer.h"
 
 static inline bool serial_esc_is_high(gpio_pins_t pin) {
   return gpio_pin_read(pin) > 0;
@@ -20,6 +21,22 @@ void serial_esc_set_input(gpio_pins_t pin);
 void serial_esc_set_output(gpio_pins_t pin);
 
 bool serial_esc_read(gpio_pins_t pin, uint32_t baud, uint8_t *bt);
-void serial_esc_write(gpio_pins_t pin, uint32_t baud, uint8_t data);
+bool serial_esc_read_timeout(gpio_pins_t pin, uint32_t baud, uint8_t *bt, uint32_t timeout_us);
+uint32_t serial_esc_read_ring(gpio_pins_t pin, uint32_t baud, ring_buffer_t *rx, uint32_t size);
+uint32_t serial_esc_read_multi(const gpio_pins_t *pins, uint32_t count, uint32_t baud, uint8_t *bytes, uint32_t timeout_us);
 
-void serial_esc_process(uint8_t index, uint32_t baud);
\ No newline at end of file
+void serial_esc_write(gpio_pins_t pin, uint32_t baud, uint8_t data);
+void serial_esc_write_buf(const gpio_pins_t *pins, uint32_t count, uint32_t baud, const uint8_t *buf, uint32_t size);
+void serial_esc_write_ring(const gpio_pins_t *pins, uint32_t count, uint32_t baud, ring_buffer_t *tx);
+
+void serial_esc_process(uint8_t index, uint32_t baud);
+
+#ifdef SIMULATOR
+// blheli bootloader emulator behind every pin, time is what the transfers would take on the wire
+void esc_emulator_reset();
+uint32_t esc_emulator_time_us();
+uint8_t *esc_emulator_flash(gpio_pins_t pin);
+void esc_emulator_set_absent(gpio_pins_t pin, bool absent);
+void esc_emulator_set_signature(gpio_pins_t pin, uint16_t signature);
+bool esc_emulator_connected(gpio_pins_t pin);
+#endif
\ No newline at end of file
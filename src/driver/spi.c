@@ -6,19 +6,28 @@
 #include "driver/dma.h"
 #include "driver/interrupt.h"
 #include "driver/motor_dshot.h"
+#include "driver/time.h"
+#include "util/cbor_helper.h"
 
 #ifdef USE_SPI
 
 FAST_RAM spi_device_t spi_dev[SPI_PORT_MAX] = {
-    [RANGE_INIT(0, SPI_PORT_MAX)] = {.is_init = false, .dma_done = true, .txn_head = 0, .txn_tail = 0},
+    [RANGE_INIT(0, SPI_PORT_MAX)] = {.is_init = false, .dma_done = true},
 };
 FAST_RAM spi_txn_t txn_pool[SPI_TXN_MAX];
 DMA_RAM uint8_t txn_buffers[SPI_TXN_MAX][SPI_TXN_BUFFER_SIZE];
 static volatile uint32_t txn_free_bitmap = 0xFFFFFFFF; // All 32 bits set = all free
 
+// lanes in the order they are served
+static const spi_lane_t lane_order[SPI_LANE_MAX] = {
+    SPI_LANE_REALTIME,
+    SPI_LANE_NORMAL,
+    SPI_LANE_BULK,
+};
+
 extern void spi_device_init(spi_ports_t port);
 extern void spi_reconfigure(spi_bus_device_t *bus);
-extern void spi_dma_transfer_begin(spi_ports_t port, uint8_t *buffer, uint32_t length, bool has_rx);
+extern void spi_dma_transfer_begin(spi_ports_t port, const uint8_t *tx_data, uint8_t *rx_data, uint32_t length);
 
 static inline __attribute__((always_inline)) spi_txn_t *spi_txn_pop(spi_bus_device_t *bus) {
   spi_txn_t *txn = NULL;
@@ -37,12 +46,57 @@ static inline __attribute__((always_inline)) spi_txn_t *spi_txn_pop(spi_bus_devi
   return txn;
 }
 
-bool spi_txn_has_free(void) {
-  return txn_free_bitmap != 0;
+uint8_t spi_txn_free_count(const spi_bus_device_t *bus) {
+  const uint8_t count = __builtin_popcount(txn_free_bitmap);
+  if (bus->lane != SPI_LANE_BULK) {
+    return count;
+  }
+  return count > SPI_TXN_RESERVED ? count - SPI_TXN_RESERVED : 0;
+}
+
+bool spi_txn_has_free(const spi_bus_device_t *bus) {
+  return spi_txn_free_count(bus) > 0;
 }
 
-uint8_t spi_txn_free_count(void) {
-  return __builtin_popcount(txn_free_bitmap);
+void spi_lane_stats_reset(spi_ports_t port) {
+  ATOMIC_BLOCK_ALL {
+    memset(spi_dev[port].stats, 0, sizeof(spi_dev[port].stats));
+  }
+}
+
+// every initialised port keyed by its number, with one entry per lane
+cbor_result_t cbor_encode_spi_lane_stats(cbor_value_t *enc) {
+  CBOR_CHECK_ERROR(cbor_result_t res = cbor_encode_map_indefinite(enc));
+
+  for (uint32_t port = SPI_PORT1; port < SPI_PORT_MAX; port++) {
+    if (!spi_dev[port].is_init) {
+      continue;
+    }
+
+    spi_lane_stats_t stats[SPI_LANE_MAX];
+    ATOMIC_BLOCK_ALL {
+      memcpy(stats, spi_dev[port].stats, sizeof(stats));
+    }
+
+    CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &port));
+    CBOR_CHECK_ERROR(res = cbor_encode_array(enc, SPI_LANE_MAX));
+    for (uint32_t i = 0; i < SPI_LANE_MAX; i++) {
+      CBOR_CHECK_ERROR(res = cbor_encode_map(enc, 3));
+
+      CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "count"));
+      CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &stats[i].count));
+
+      CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "wait_max"));
+      CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &stats[i].wait_max_us));
+
+      CBOR_CHECK_ERROR(res = cbor_encode_str(enc, "wait_avg"));
+      const uint32_t wait_avg = stats[i].count ? stats[i].wait_total_us / stats[i].count : 0;
+      CBOR_CHECK_ERROR(res = cbor_encode_uint32_t(enc, &wait_avg));
+    }
+  }
+
+  CBOR_CHECK_ERROR(res = cbor_encode_end_indefinite(enc));
+  return res;
 }
 
 bool spi_txn_can_send(spi_bus_device_t *bus, bool dma) {
@@ -72,17 +126,55 @@ void spi_txn_wait(spi_bus_device_t *bus) {
   }
 }
 
+static bool spi_port_is_idle(spi_ports_t port) {
+  const spi_device_t *dev = &spi_dev[port];
+  for (uint32_t i = 0; i < SPI_LANE_MAX; i++) {
+    if (dev->lanes[i].txn_head != dev->lanes[i].txn_tail) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// waits for every lane, needed before a blocking transfer takes over the port
+void spi_txn_wait_port(spi_ports_t port) {
+  while (!spi_port_is_idle(port)) {
+    spi_txn_continue_port(port);
+  }
+}
+
 bool spi_txn_continue_port(spi_ports_t port) {
   spi_device_t *dev = &spi_dev[port];
   spi_txn_t *txn = NULL;
 
+#ifdef SIMULATOR
+  // there is no interrupt to finish the transfer, it is played while the port is polled
+  spi_emulator_poll(port);
+#endif
+
   ATOMIC_BLOCK_ALL {
-    if (dev->txn_head == dev->txn_tail) {
+    // txn_lane belongs to the transfer in progress until it finishes
+    if (!dev->dma_done) {
       return false;
     }
 
-    txn = dev->txns[(dev->txn_tail + 1) % SPI_TXN_MAX];
-    if (txn == NULL || txn->status != TXN_READY) {
+    // preempts lower lanes at transaction boundaries
+    for (uint32_t i = 0; i < SPI_LANE_MAX; i++) {
+      const spi_lane_t lane = lane_order[i];
+      const spi_txn_lane_t *l = &dev->lanes[lane];
+      if (l->txn_head == l->txn_tail) {
+        continue;
+      }
+
+      txn = l->txns[(l->txn_tail + 1) % SPI_TXN_MAX];
+      if (txn == NULL || txn->status != TXN_READY) {
+        return false;
+      }
+
+      dev->txn_lane = lane;
+      break;
+    }
+    if (txn == NULL) {
       return false;
     }
 
@@ -90,6 +182,14 @@ bool spi_txn_continue_port(spi_ports_t port) {
       return false;
     }
 
+    spi_lane_stats_t *stats = &dev->stats[dev->txn_lane];
+    const uint32_t wait = time_micros() - txn->queued_at;
+    stats->count++;
+    stats->wait_total_us += wait;
+    if (wait > stats->wait_max_us) {
+      stats->wait_max_us = wait;
+    }
+
     txn->status = TXN_IN_PROGRESS;
     dev->dma_done = false;
   }
@@ -97,7 +197,9 @@ bool spi_txn_continue_port(spi_ports_t port) {
   spi_reconfigure(txn->bus);
   spi_csn_enable(txn->bus);
 
-  spi_dma_transfer_begin(port, txn->buffer, txn->size, txn->flags & TXN_DELAYED_RX);
+  const spi_txn_chunk_t *chunk = &txn->chunks[0];
+  txn->chunk_index = 0;
+  spi_dma_transfer_begin(port, chunk->tx_data, chunk->rx_data, chunk->size);
 
   return true;
 }
@@ -112,12 +214,43 @@ void spi_seg_submit_ex(spi_bus_device_t *bus, const spi_txn_opts_t opts) {
   txn->size = 0;
   txn->flags = 0;
   txn->segment_count = opts.seg_count;
+  txn->chunk_count = 0;
   txn->done_fn = opts.done_fn;
   txn->done_fn_arg = opts.done_fn_arg;
 
+  spi_txn_chunk_t *chunk = NULL;
   for (uint32_t i = 0; i < opts.seg_count; i++) {
     const spi_txn_segment_t *seg = &opts.segs[i];
     spi_txn_segment_t *txn_seg = &txn->segments[i];
+    txn_seg->type = seg->type;
+    txn_seg->size = seg->size;
+
+    if (seg->type == TXN_DMA) {
+      txn_seg->rx_data = NULL;
+      txn_seg->tx_data = NULL;
+      if (seg->size == 0) {
+        continue;
+      }
+      if (seg->tx_data == NULL) {
+        memset(seg->rx_data, 0xFF, seg->size);
+      }
+
+      chunk = &txn->chunks[txn->chunk_count++];
+      chunk->tx_data = seg->tx_data ? seg->tx_data : seg->rx_data;
+      chunk->rx_data = seg->rx_data;
+      chunk->size = seg->size;
+
+      // the next copied segment starts a new chunk
+      chunk = NULL;
+      continue;
+    }
+
+    if (chunk == NULL) {
+      chunk = &txn->chunks[txn->chunk_count++];
+      chunk->tx_data = txn->buffer + txn->size;
+      chunk->rx_data = NULL;
+      chunk->size = 0;
+    }
 
     // Check if this segment will fit in the buffer
     if ((txn->size + seg->size) > SPI_TXN_BUFFER_SIZE) {
@@ -140,21 +273,28 @@ void spi_seg_submit_ex(spi_bus_device_t *bus, const spi_txn_opts_t opts) {
         memset(txn->buffer + txn->size, 0xFF, seg->size);
       }
       break;
+
+    case TXN_DMA:
+      break;
     }
 
     if (txn_seg->rx_data) {
       txn->flags |= TXN_DELAYED_RX;
+      // copied segments are received in place
+      chunk->rx_data = (uint8_t *)chunk->tx_data;
     }
 
-    txn_seg->size = seg->size;
+    chunk->size += seg->size;
     txn->size += seg->size;
   }
 
+  txn->queued_at = time_micros();
+
   ATOMIC_BLOCK_ALL {
-    spi_device_t *dev = &spi_dev[bus->port];
-    const uint8_t head = (dev->txn_head + 1) % SPI_TXN_MAX;
-    dev->txns[head] = txn;
-    dev->txn_head = head;
+    spi_txn_lane_t *lane = &spi_dev[bus->port].lanes[bus->lane];
+    const uint8_t head = (lane->txn_head + 1) % SPI_TXN_MAX;
+    lane->txns[head] = txn;
+    lane->txn_head = head;
     // Memory barrier to ensure all writes complete before setting status
     MEMORY_BARRIER();
     // Set status last to ensure transaction is fully queued before marking ready
@@ -164,15 +304,24 @@ void spi_seg_submit_ex(spi_bus_device_t *bus, const spi_txn_opts_t opts) {
 
 // only called from dma isr
 void spi_txn_finish(spi_ports_t port) {
-  spi_device_t *dev = &spi_dev[port];
+  spi_txn_lane_t *lane = &spi_dev[port].lanes[spi_dev[port].txn_lane];
 
-  const uint32_t tail = (dev->txn_tail + 1) % SPI_TXN_MAX;
-  spi_txn_t *txn = dev->txns[tail];
+  const uint32_t tail = (lane->txn_tail + 1) % SPI_TXN_MAX;
+  spi_txn_t *txn = lane->txns[tail];
+
+  if (++txn->chunk_index < txn->chunk_count) {
+    const spi_txn_chunk_t *chunk = &txn->chunks[txn->chunk_index];
+    spi_dma_transfer_begin(port, chunk->tx_data, chunk->rx_data, chunk->size);
+    return;
+  }
 
   if (txn->flags & TXN_DELAYED_RX) {
     uint32_t txn_size = 0;
     for (uint32_t i = 0; i < txn->segment_count; ++i) {
       spi_txn_segment_t *seg = &txn->segments[i];
+      if (seg->type == TXN_DMA) {
+        continue;
+      }
       if (seg->rx_data) {
         memcpy(seg->rx_data, (uint8_t *)txn->buffer + txn_size, seg->size);
       }
@@ -185,8 +334,8 @@ void spi_txn_finish(spi_ports_t port) {
   }
 
   // Remove from queue first to prevent reuse while still queued
-  dev->txns[tail] = NULL;
-  dev->txn_tail = tail;
+  lane->txns[tail] = NULL;
+  lane->txn_tail = tail;
 
   // Mark as idle after removing from queue
   txn->status = TXN_IDLE;
@@ -3,6 +3,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include <cbor.h>
+
 #include "core/project.h"
 #include "driver/dma.h"
 #include "driver/gpio.h"
@@ -25,11 +27,16 @@ typedef struct {
 
 #define SPI_TXN_MAX 32
 #define SPI_TXN_SEG_MAX 8
-#define SPI_TXN_BUFFER_SIZE DMA_ALIGN(512)
+// fits a full sdcard block including token, crc and busy poll
+#define SPI_TXN_BUFFER_SIZE DMA_ALIGN(512 + 32)
 
 typedef enum {
   TXN_CONST,
   TXN_BUFFER,
+  // dma straight from and to the caller buffers, they have to be dma reachable and
+  // stay untouched until the transaction is done. without tx data the rx buffer is
+  // filled with 0xFF and sent in place.
+  TXN_DMA,
 } spi_txn_segment_type_t;
 
 typedef struct {
@@ -50,6 +57,8 @@ typedef struct {
   (spi_txn_segment_t) { .type = TXN_CONST, .bytes = {_bytes}, .size = sizeof((uint8_t[]){_bytes}) }
 #define spi_make_seg_buffer(_rx_data, _tx_data, _size) \
   (spi_txn_segment_t) { .type = TXN_BUFFER, .rx_data = (_rx_data), .tx_data = (_tx_data), .size = (_size) }
+#define spi_make_seg_dma(_rx_data, _tx_data, _size) \
+  (spi_txn_segment_t) { .type = TXN_DMA, .rx_data = (_rx_data), .tx_data = (_tx_data), .size = (_size) }
 
 struct spi_bus_device;
 
@@ -66,10 +75,18 @@ typedef enum {
 
 typedef void (*spi_txn_done_fn_t)(void *arg);
 
+// one dma transfer, consecutive copied segments share one chunk of the txn buffer
+typedef struct {
+  const uint8_t *tx_data;
+  uint8_t *rx_data;
+  uint32_t size;
+} spi_txn_chunk_t;
+
 typedef struct {
   struct spi_bus_device *bus;
 
   volatile spi_txn_status_t status;
+  uint32_t queued_at;
 
   uint8_t flags;
   spi_txn_segment_t segments[SPI_TXN_SEG_MAX];
@@ -78,6 +95,11 @@ typedef struct {
   uint8_t *buffer;
   uint32_t size;
 
+  // chained from the isr with chip select held
+  spi_txn_chunk_t chunks[SPI_TXN_SEG_MAX];
+  uint8_t chunk_count;
+  volatile uint8_t chunk_index;
+
   spi_txn_done_fn_t done_fn;
   void *done_fn_arg;
 } spi_txn_t;
@@ -90,9 +112,20 @@ typedef struct {
   uint32_t seg_count;
 } spi_txn_opts_t;
 
+// a started transaction always runs to the end, the next one is taken from the highest lane with work
+typedef enum {
+  SPI_LANE_NORMAL,
+  SPI_LANE_REALTIME, // gyro reads, never wait behind more than one transaction
+  SPI_LANE_BULK,     // osd and blackbox, may not take the last SPI_TXN_RESERVED transactions
+  SPI_LANE_MAX,
+} spi_lane_t;
+
+#define SPI_TXN_RESERVED 8
+
 typedef struct spi_bus_device {
   spi_ports_t port;
   gpio_pins_t nss;
+  spi_lane_t lane;
 
   bool (*poll_fn)();
 
@@ -101,15 +134,30 @@ typedef struct spi_bus_device {
 } spi_bus_device_t;
 
 typedef struct {
-  bool is_init;
-  volatile bool dma_done;
-
   // only modified by the main loop
   volatile uint8_t txn_head;
   // only modified by the intterupt or protected code
   volatile uint8_t txn_tail;
 
   spi_txn_t *txns[SPI_TXN_MAX];
+} spi_txn_lane_t;
+
+// time from submit to the start of the transfer
+typedef struct {
+  uint32_t count;
+  uint32_t wait_max_us;
+  uint32_t wait_total_us;
+} spi_lane_stats_t;
+
+typedef struct {
+  bool is_init;
+  volatile bool dma_done;
+
+  spi_txn_lane_t lanes[SPI_LANE_MAX];
+  // lane of the transaction in progress
+  volatile uint8_t txn_lane;
+
+  spi_lane_stats_t stats[SPI_LANE_MAX];
 
   spi_mode_t mode;
   uint32_t hz;
@@ -121,6 +169,7 @@ extern const spi_port_def_t spi_port_defs[SPI_PORT_MAX];
 void spi_bus_device_init(const spi_bus_device_t *bus);
 
 void spi_txn_wait(spi_bus_device_t *bus);
+void spi_txn_wait_port(spi_ports_t port);
 bool spi_txn_continue_port(spi_ports_t port);
 
 void spi_seg_submit_ex(spi_bus_device_t *bus, const spi_txn_opts_t opts);
@@ -141,13 +190,41 @@ static inline bool spi_dma_is_ready(spi_ports_t port) {
   return dev->dma_done;
 }
 
+// only waits for the lane of the bus, other devices on the port may still be busy
 static inline bool spi_txn_ready(spi_bus_device_t *bus) {
-  const spi_device_t *dev = &spi_dev[bus->port];
-  return dev->txn_head == dev->txn_tail;
+  const spi_txn_lane_t *lane = &spi_dev[bus->port].lanes[bus->lane];
+  return lane->txn_head == lane->txn_tail;
 }
 
-bool spi_txn_has_free(void);
-uint8_t spi_txn_free_count(void);
+bool spi_txn_has_free(const spi_bus_device_t *bus);
+uint8_t spi_txn_free_count(const spi_bus_device_t *bus);
+
+void spi_lane_stats_reset(spi_ports_t port);
+cbor_result_t cbor_encode_spi_lane_stats(cbor_value_t *enc);
+
+#ifdef SIMULATOR
+void spi_device_init(spi_ports_t port);
+void spi_dma_complete_port(spi_ports_t port);
+
+// chip model behind a chip select, bytes are clocked through it one at a time
+typedef struct spi_emulator_device {
+  void (*select)(struct spi_emulator_device *dev);
+  uint8_t (*transfer)(struct spi_emulator_device *dev, uint8_t data);
+  void (*deselect)(struct spi_emulator_device *dev);
+
+  uint32_t bytes;
+  uint32_t selects;
+} spi_emulator_device_t;
+
+// the dma isr of a port with a model attached fires once the transfer is over on
+// the wire plus the isr latency, either when the port is polled or time is advanced
+void spi_emulator_reset();
+void spi_emulator_attach(spi_ports_t port, gpio_pins_t nss, spi_emulator_device_t *dev);
+void spi_emulator_set_isr_latency(uint32_t ns);
+uint64_t spi_emulator_time_ns();
+void spi_emulator_advance(uint32_t us);
+void spi_emulator_poll(spi_ports_t port);
+#endif
 
 #define spi_seg_submit_wait(_bus, _segs)                                                                            \
   {                                                                                                                 \
@@ -14,5 +14,7 @@ void usb_init();
 uint8_t usb_detect();
 uint32_t usb_serial_read(uint8_t *data, uint32_t len);
 void usb_serial_write(uint8_t *data, uint32_t len);
+uint32_t usb_serial_write_reserve(uint8_t **data);
+void usb_serial_write_commit(uint32_t len);
 void usb_serial_printf(const char *fmt, ...);
 void usb_serial_print(char *str);
\ No newline at end of file
@@ -380,8 +380,8 @@ void control() {
   }
 
   if (flags.motortest_override) {
-    motor_test_calc(motortest_usb, state.motor_mix.axis);
-    motor_output_calc(state.motor_mix.axis);
+    motor_test_calc(motortest_usb, state.motor_mix);
+    motor_output_calc(state.motor_mix);
   } else if (!flags.arm_state || flags.failsafe || (state.throttle < 0.001f)) {
     // CONDITION: disarmed OR failsafe OR throttle off
     flags.on_ground = 1;
@@ -390,6 +390,7 @@ void control() {
     state.throttle = 0;
     state.thrsum = 0;
 
+    motor_mixer_update();
     motor_set_all(MOTOR_OFF);
   } else {
     // motors on - normal flight
@@ -405,8 +406,8 @@ void control() {
       }
     }
 
-    motor_mixer_calc(state.motor_mix.axis);
-    motor_output_calc(state.motor_mix.axis);
+    motor_mixer_calc(state.motor_mix);
+    motor_output_calc(state.motor_mix);
   }
 
 #ifdef MOTOR_BEEPS
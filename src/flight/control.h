@@ -92,6 +92,9 @@ typedef struct {
   vec3_t gyro;             // filtered gyro reading
   vec3_t gyro_delta_angle; // angle covered in  last time interval
 
+  vec3_t gyro_bias;           // online estimate of the residual gyro bias in rad/s
+  float gyro_bias_confidence; // 0 - 1, how recently the estimate was confirmed
+
   vec3_t GEstG; // gravity vector
   vec3_t attitude;
 
@@ -103,12 +106,23 @@ typedef struct {
   vec3_t pid_d_term;
   vec3_t pidoutput; // combinded output of the pid controller
 
-  vec4_t motor_mix;
+  float motor_mix[MOTOR_PIN_MAX];
 
   vec3_t angle_error;
   vec3_t stick_vector;
 
-  uint32_t dshot_rpm[4];
+  uint32_t dshot_rpm[MOTOR_PIN_MAX];
+  uint32_t dshot_telemetry_ok[MOTOR_PIN_MAX];     // telemetry frames decoded per motor
+  uint32_t dshot_telemetry_errors[MOTOR_PIN_MAX]; // telemetry frames lost to framing, gcr or checksum errors
+
+  // extended dshot telemetry
+  uint8_t dshot_temp[MOTOR_PIN_MAX];  // esc temperature in degree celsius
+  float dshot_voltage[MOTOR_PIN_MAX]; // esc supply in volts
+  float dshot_current[MOTOR_PIN_MAX]; // esc current in amps
+  uint8_t dshot_debug1[MOTOR_PIN_MAX];
+  uint8_t dshot_debug2[MOTOR_PIN_MAX];
+  uint8_t dshot_stress[MOTOR_PIN_MAX]; // esc stress level, 0 - 255
+  uint8_t dshot_status[MOTOR_PIN_MAX]; // alert, warning and error flags plus the max stress level
 } control_state_t;
 
 #define STATE_MEMBERS                         \
@@ -149,6 +163,8 @@ typedef struct {
   MEMBER(gyro_raw, vec3_t)                    \
   MEMBER(gyro, vec3_t)                        \
   MEMBER(gyro_delta_angle, vec3_t)            \
+  MEMBER(gyro_bias, vec3_t)                   \
+  MEMBER(gyro_bias_confidence, float)         \
   MEMBER(GEstG, vec3_t)                       \
   MEMBER(attitude, vec3_t)                    \
   MEMBER(setpoint, vec3_t)                    \
@@ -157,10 +173,19 @@ typedef struct {
   MEMBER(pid_i_term, vec3_t)                  \
   MEMBER(pid_d_term, vec3_t)                  \
   MEMBER(pidoutput, vec3_t)                   \
-  MEMBER(motor_mix, vec4_t)                   \
+  ARRAY_MEMBER(motor_mix, MOTOR_PIN_MAX, float) \
   MEMBER(angle_error, vec3_t)                 \
   MEMBER(stick_vector, vec3_t)                \
-  ARRAY_MEMBER(dshot_rpm, 4, uint32_t)
+  ARRAY_MEMBER(dshot_rpm, MOTOR_PIN_MAX, uint32_t)              \
+  ARRAY_MEMBER(dshot_telemetry_ok, MOTOR_PIN_MAX, uint32_t)     \
+  ARRAY_MEMBER(dshot_telemetry_errors, MOTOR_PIN_MAX, uint32_t) \
+  ARRAY_MEMBER(dshot_temp, MOTOR_PIN_MAX, uint8_t)              \
+  ARRAY_MEMBER(dshot_voltage, MOTOR_PIN_MAX, float)             \
+  ARRAY_MEMBER(dshot_current, MOTOR_PIN_MAX, float)             \
+  ARRAY_MEMBER(dshot_debug1, MOTOR_PIN_MAX, uint8_t)            \
+  ARRAY_MEMBER(dshot_debug2, MOTOR_PIN_MAX, uint8_t)            \
+  ARRAY_MEMBER(dshot_stress, MOTOR_PIN_MAX, uint8_t)            \
+  ARRAY_MEMBER(dshot_status, MOTOR_PIN_MAX, uint8_t)
 
 typedef struct {
   uint8_t active;
@@ -0,0 +1,117 @@
+#include "flight/gyro_bias.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "util/util.h"
+
+// a window is still if every axis stays below this deviation
+#define STILL_DEVIATION (0.5f * DEGTORAD)
+// larger means are slow rotation rather than bias
+#define STILL_MEAN (5.0f * DEGTORAD)
+// how much of an accepted window goes into the estimate
+#define STILL_GAIN 0.25f
+
+// integral gain on the gravity error in 1/s
+#define GRAVITY_GAIN 0.02f
+// accel is only a gravity reference near 1g and at moderate rates
+#define GRAVITY_ACCEL_MIN 0.9f
+#define GRAVITY_ACCEL_MAX 1.1f
+#define GRAVITY_RATE_MAX (200.0f * DEGTORAD)
+
+// estimate is clamped to this per axis
+#define BIAS_LIMIT (10.0f * DEGTORAD)
+// time for the confidence to fade without stationary windows in s
+#define CONFIDENCE_DECAY 600.0f
+
+static void gyro_bias_clear_window(gyro_bias_t *b) {
+  b->sum = (vec3_t){{0, 0, 0}};
+  b->sum_sq = (vec3_t){{0, 0, 0}};
+  b->count = 0;
+}
+
+void gyro_bias_reset(gyro_bias_t *b) {
+  memset(b, 0, sizeof(gyro_bias_t));
+  // the boot calibration leaves no residual bias
+  b->confidence = 1.0f;
+}
+
+static void gyro_bias_apply(gyro_bias_t *b, const uint32_t axis, const float delta) {
+  b->bias.axis[axis] = constrain(b->bias.axis[axis] + delta, -BIAS_LIMIT, BIAS_LIMIT);
+}
+
+// accumulates the residual gyro rate, a window that stayed still is averaged into the bias
+static void gyro_bias_update_still(gyro_bias_t *b, const vec3_t *gyro) {
+  for (uint32_t i = 0; i < 3; i++) {
+    b->sum.axis[i] += gyro->axis[i];
+    b->sum_sq.axis[i] += gyro->axis[i] * gyro->axis[i];
+  }
+  if (++b->count < GYRO_BIAS_WINDOW) {
+    return;
+  }
+
+  vec3_t mean;
+  bool still = true;
+  for (uint32_t i = 0; i < 3; i++) {
+    mean.axis[i] = b->sum.axis[i] / b->count;
+    const float var = b->sum_sq.axis[i] / b->count - mean.axis[i] * mean.axis[i];
+    still = still && var < (STILL_DEVIATION * STILL_DEVIATION) && fabsf(mean.axis[i]) < STILL_MEAN;
+  }
+
+  gyro_bias_clear_window(b);
+  if (!still) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < 3; i++) {
+    gyro_bias_apply(b, i, mean.axis[i] * STILL_GAIN);
+  }
+  b->confidence += (1.0f - b->confidence) * STILL_GAIN;
+}
+
+// integral part of a complementary filter, the gyro propagated gravity is pulled
+// towards the accel and the rotation needed for that is residual bias.
+// rotation about the gravity vector is not observable and stays untouched.
+// the accel has to be unnormalised, its magnitude is what rejects manoeuvres.
+static void gyro_bias_update_gravity(gyro_bias_t *b, const vec3_t *gyro, const vec3_t *accel, const vec3_t *gravity, float dt) {
+  vec3_t a = *accel;
+  vec3_t g = *gravity;
+
+  const float accel_mag = vec3_magnitude(&a);
+  if (accel_mag < GRAVITY_ACCEL_MIN || accel_mag > GRAVITY_ACCEL_MAX) {
+    return;
+  }
+  for (uint32_t i = 0; i < 3; i++) {
+    if (fabsf(gyro->axis[i]) > GRAVITY_RATE_MAX) {
+      return;
+    }
+  }
+
+  const float gravity_mag = vec3_magnitude(&g);
+  if (gravity_mag == 0) {
+    return;
+  }
+  a = vec3_mul(a, 1.0f / accel_mag);
+  g = vec3_mul(g, 1.0f / gravity_mag);
+
+  // the imu rotates gravity by {-pitch, roll, yaw}, map the error back to gyro axes
+  const vec3_t err = vec3_cross(g, a);
+  gyro_bias_apply(b, 0, -err.pitch * GRAVITY_GAIN * dt);
+  gyro_bias_apply(b, 1, err.roll * GRAVITY_GAIN * dt);
+  gyro_bias_apply(b, 2, -err.yaw * GRAVITY_GAIN * dt);
+}
+
+void gyro_bias_update(gyro_bias_t *b, gyro_bias_mode_t mode, const vec3_t *gyro, const vec3_t *accel, const vec3_t *gravity, float dt) {
+  if (mode == GYRO_BIAS_STILL) {
+    gyro_bias_update_still(b, gyro);
+  } else {
+    // stationary windows never span an arm
+    gyro_bias_clear_window(b);
+  }
+
+  if (mode == GYRO_BIAS_GRAVITY) {
+    gyro_bias_update_gravity(b, gyro, accel, gravity, dt);
+  }
+
+  b->confidence = max(b->confidence - dt / CONFIDENCE_DECAY, 0.0f);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/vector.h"
+
+// estimator runs every n-th imu loop
+#define GYRO_BIAS_DIVIDER 8
+
+// samples per stationary window
+#define GYRO_BIAS_WINDOW 512
+
+typedef enum {
+  GYRO_BIAS_IDLE,    // no reference, only the confidence decays
+  GYRO_BIAS_STILL,   // disarmed, windows of low variance are averaged
+  GYRO_BIAS_GRAVITY, // in flight, accel is used as the gravity reference
+} gyro_bias_mode_t;
+
+typedef struct {
+  vec3_t bias;      // in rad/s, subtracted from the calibrated gyro
+  float confidence; // 0 - 1, drops while no stationary window was accepted
+
+  vec3_t sum;
+  vec3_t sum_sq;
+  uint32_t count;
+} gyro_bias_t;
+
+void gyro_bias_reset(gyro_bias_t *b);
+void gyro_bias_update(gyro_bias_t *b, gyro_bias_mode_t mode, const vec3_t *gyro, const vec3_t *accel, const vec3_t *gravity, float dt);
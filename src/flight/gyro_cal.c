@@ -0,0 +1,76 @@
+#include "flight/gyro_cal.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "util/util.h"
+
+static bool gyro_cal_valid(const gyro_cal_model_t *m) {
+  return m->magic == GYRO_CAL_MAGIC && m->count > 0 && m->count <= GYRO_CAL_POINTS;
+}
+
+void gyro_cal_reset(gyro_cal_model_t *m) {
+  memset(m, 0, sizeof(gyro_cal_model_t));
+  m->magic = GYRO_CAL_MAGIC;
+}
+
+// keeps one point per temperature bin, a full model replaces the point closest in temperature
+void gyro_cal_add(gyro_cal_model_t *m, float temp, const float bias[3]) {
+  if (!gyro_cal_valid(m)) {
+    gyro_cal_reset(m);
+  }
+
+  uint32_t index = 0;
+  for (uint32_t i = 1; i < m->count; i++) {
+    if (fabsf(m->points[i].temp - temp) < fabsf(m->points[index].temp - temp)) {
+      index = i;
+    }
+  }
+  if (m->count == 0 || (fabsf(m->points[index].temp - temp) > GYRO_CAL_TEMP_BIN && m->count < GYRO_CAL_POINTS)) {
+    index = m->count++;
+  }
+
+  m->points[index].temp = temp;
+  memcpy(m->points[index].bias, bias, sizeof(m->points[index].bias));
+}
+
+// least squares line through the points, clamped to the measured temperature range
+bool gyro_cal_predict(const gyro_cal_model_t *m, float temp, float bias[3]) {
+  if (!gyro_cal_valid(m)) {
+    return false;
+  }
+
+  float temp_min = m->points[0].temp;
+  float temp_max = m->points[0].temp;
+  float temp_mean = 0;
+  for (uint32_t i = 0; i < m->count; i++) {
+    temp_min = min(temp_min, m->points[i].temp);
+    temp_max = max(temp_max, m->points[i].temp);
+    temp_mean += m->points[i].temp;
+  }
+  temp_mean /= m->count;
+
+  const float t = constrain(temp, temp_min, temp_max) - temp_mean;
+  for (uint32_t axis = 0; axis < 3; axis++) {
+    float bias_mean = 0;
+    for (uint32_t i = 0; i < m->count; i++) {
+      bias_mean += m->points[i].bias[axis];
+    }
+    bias_mean /= m->count;
+
+    float slope = 0;
+    if ((temp_max - temp_min) >= GYRO_CAL_TEMP_SPREAD) {
+      float cov = 0;
+      float var = 0;
+      for (uint32_t i = 0; i < m->count; i++) {
+        const float dt = m->points[i].temp - temp_mean;
+        cov += dt * (m->points[i].bias[axis] - bias_mean);
+        var += dt * dt;
+      }
+      slope = cov / var;
+    }
+
+    bias[axis] = bias_mean + slope * t;
+  }
+  return true;
+}
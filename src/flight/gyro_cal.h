@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GYRO_CAL_MAGIC 0x47434C01
+#define GYRO_CAL_POINTS 4
+
+// calibrations closer than this replace each other
+#define GYRO_CAL_TEMP_BIN 3.0f
+// below this spread the bias is taken as constant over temperature
+#define GYRO_CAL_TEMP_SPREAD 5.0f
+
+typedef struct {
+  float temp;
+  float bias[3];
+} gyro_cal_point_t;
+
+// raw gyro bias measured at a few temperatures, stored with the accel calibration
+typedef struct {
+  uint32_t magic;
+  uint32_t count;
+  gyro_cal_point_t points[GYRO_CAL_POINTS];
+} gyro_cal_model_t;
+
+void gyro_cal_reset(gyro_cal_model_t *m);
+void gyro_cal_add(gyro_cal_model_t *m, float temp, const float bias[3]);
+bool gyro_cal_predict(const gyro_cal_model_t *m, float temp, float bias[3]);
@@ -11,7 +11,9 @@
 #include "driver/time.h"
 #include "flight/control.h"
 #include "flight/filter.h"
+#include "flight/gyro_bias.h"
 #include "flight/sixaxis.h"
+#include "io/blackbox.h"
 #include "util/util.h"
 #include "util/vector.h"
 
@@ -32,6 +34,8 @@
 #define ACC_MIN 0.7f
 #define ACC_MAX 1.3f
 
+static gyro_bias_t gyro_bias;
+
 #ifdef QUICKSILVER_IMU
 static filter_lp_pt1 filter;
 static filter_state_t filter_pass1[3];
@@ -39,6 +43,8 @@ static filter_state_t filter_pass2[3];
 #endif
 
 void imu_init() {
+  imu_gyro_bias_reset();
+
   // init the gravity vector with accel values
   for (int xx = 0; xx < 100; xx++) {
     sixaxis_read();
@@ -55,6 +61,38 @@ void imu_init() {
 #endif
 }
 
+void imu_gyro_bias_reset() {
+  gyro_bias_reset(&gyro_bias);
+  state.gyro_bias = gyro_bias.bias;
+  state.gyro_bias_confidence = gyro_bias.confidence;
+}
+
+// runs at a fraction of the imu rate, sixaxis subtracts the estimate from the next gyro reads
+static void imu_gyro_bias_update() {
+  static uint32_t counter = 0;
+  if (++counter < GYRO_BIAS_DIVIDER) {
+    return;
+  }
+  counter = 0;
+
+  gyro_bias_mode_t mode = GYRO_BIAS_IDLE;
+  if (!flags.arm_state) {
+    mode = GYRO_BIAS_STILL;
+  } else if (flags.in_air) {
+    mode = GYRO_BIAS_GRAVITY;
+  }
+  // state.accel is already normalised, only the raw magnitude tells a manoeuvre from gravity
+  gyro_bias_update(&gyro_bias, mode, &state.gyro_raw, &state.accel_raw, &state.GEstG, state.looptime * GYRO_BIAS_DIVIDER);
+
+  state.gyro_bias = gyro_bias.bias;
+  state.gyro_bias_confidence = gyro_bias.confidence;
+
+  for (uint32_t i = 0; i < 3; i++) {
+    blackbox_set_debug(BBOX_DEBUG_GYRO_BIAS, i, state.gyro_bias.axis[i] * RADTODEG * 100.0f);
+  }
+  blackbox_set_debug(BBOX_DEBUG_GYRO_BIAS, 3, state.gyro_bias_confidence * 1000.0f);
+}
+
 #ifdef SILVERWARE_IMU
 void imu_calc() {
   const vec3_t rot = {{
@@ -116,6 +154,8 @@ void imu_calc() {
     state.attitude.roll = atan2approx(state.GEstG.roll, state.GEstG.yaw);
     state.attitude.pitch = atan2approx(state.GEstG.pitch, state.GEstG.yaw);
   }
+
+  imu_gyro_bias_update();
 }
 #endif
 
@@ -169,5 +209,7 @@ void imu_calc() {
     state.attitude.roll = atan2approx(state.GEstG.roll, state.GEstG.yaw);
     state.attitude.pitch = atan2approx(state.GEstG.pitch, state.GEstG.yaw);
   }
+
+  imu_gyro_bias_update();
 }
 #endif
\ No newline at end of file
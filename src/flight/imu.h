@@ -3,4 +3,5 @@
 #define ACC_1G 1.0f
 
 void imu_init();
-void imu_calc();
\ No newline at end of file
+void imu_calc();
+void imu_gyro_bias_reset();
\ No newline at end of file
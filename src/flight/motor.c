@@ -1,6 +1,7 @@
 #include "motor.h"
 
 #include <float.h>
+#include <math.h>
 
 #include "core/profile.h"
 #include "core/project.h"
@@ -31,10 +32,32 @@
 #define MIX_THROTTLE_INCREASE_MAX 0.2f
 #endif
 
+// thrust steps in the linearisation table
+#define THRUST_LUT_SIZE 32
+
+// per cell voltage the sag compensation scales towards, and the lowest it compensates for
+#define VBAT_SAG_CELL_FULL 4.2f
+#define VBAT_SAG_CELL_MIN 3.0f
+// below this the reading is missing or broken and no compensation is applied
+#define VBAT_SAG_CELL_VALID 2.5f
+
 extern profile_t profile;
 
+// command for evenly spaced thrust from 0 to 1
+static float thrust_lut[THRUST_LUT_SIZE + 1];
+static float thrust_lut_linear = -1.0f;
+
+// the default x quad, mixed with adds and subtracts instead of going through the matrix
+static const profile_mixer_t mixer_quad_x = {
+    .roll = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = 1.0f, [MOTOR_BR] = -1.0f, [MOTOR_FR] = -1.0f},
+    .pitch = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = -1.0f, [MOTOR_BR] = 1.0f, [MOTOR_FR] = -1.0f},
+    .yaw = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = -1.0f, [MOTOR_BR] = -1.0f, [MOTOR_FR] = 1.0f},
+    .throttle = {[MOTOR_BL] = 1.0f, [MOTOR_FL] = 1.0f, [MOTOR_BR] = 1.0f, [MOTOR_FR] = 1.0f},
+};
+static bool mixer_is_quad_x = false;
+
 static float motord(float in, int x) {
-  static float lastratexx[4][4];
+  static float lastratexx[MOTOR_PIN_MAX][4];
 
   const float factor = profile.motor.torque_boost;
   const float out = (+0.125f * in + 0.250f * lastratexx[x][0] - 0.250f * lastratexx[x][2] - (0.125f) * lastratexx[x][3]) * factor;
@@ -46,7 +69,32 @@ static float motord(float in, int x) {
   return in + out;
 }
 
-static void motor_brushless_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_MAX]) {
+// motor rpm follows the pack voltage, commands are scaled up as it sags below a full cell
+static FORCE_INLINE float motor_vbat_sag_factor() {
+  const float amount = profile.voltage.vbat_sag_compensation * 0.01f;
+  if (amount <= 0.0f || state.lipo_cell_count == 0 || state.vbat_cell_avg < VBAT_SAG_CELL_VALID) {
+    return 1.0f;
+  }
+
+  const float cell = max(state.vbat_cell_avg, VBAT_SAG_CELL_MIN);
+  return 1.0f + amount * (VBAT_SAG_CELL_FULL / cell - 1.0f);
+}
+
+// highest thrust the mixer may ask for so the sag scaled command still fits
+static FORCE_INLINE float motor_vbat_sag_thrust_limit() {
+  const float sag_factor = motor_vbat_sag_factor();
+  if (sag_factor <= 1.0f) {
+    return 1.0f;
+  }
+
+  // the forward thrust curve, the inverse of the linearisation applied on output
+  const float command = 1.0f / sag_factor;
+  const float k = profile.motor.thrust_linear * 0.01f;
+  return (1.0f - k) * command + k * command * command;
+}
+
+// unit_throttle skips the per motor throttle factors when they are known to be all one
+static FORCE_INLINE void motor_brushless_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_MAX], uint32_t count, bool unit_throttle) {
   // only enable once really in the air
   if (flags.on_ground || !flags.in_air) {
     return;
@@ -55,35 +103,36 @@ static void motor_brushless_mixer_scale_calc(float throttle, float mix[MOTOR_PIN
   float min = FLT_MAX;
   float max = FLT_MIN;
 
-  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
-    if (mix[i] < min) {
-      min = mix[i];
-    }
-    if (mix[i] > max) {
-      max = mix[i];
-    }
+#pragma GCC unroll 4
+  for (uint32_t i = 0; i < count; i++) {
+    min = mix[i] < min ? mix[i] : min;
+    max = mix[i] > max ? mix[i] : max;
   }
 
+  // keep the headroom the sag compensation needs, otherwise the output clips it away
+  const float limit = motor_vbat_sag_thrust_limit();
   const float range = max - min;
-  const float scale = range > 1.0f ? 1.0f / range : 1.0f;
+  const float scale = range > limit ? limit / range : 1.0f;
 
   const float scaled_min = min * scale;
   const float scaled_max = max * scale;
-  const float scaled_throttle = constrain(throttle, -scaled_min, 1.0f - scaled_max);
+  const float scaled_throttle = constrain(throttle, -scaled_min, limit - scaled_max);
 
-  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
-    mix[i] = mix[i] * scale + scaled_throttle;
+  const float *throttle_factor = profile.mixer.throttle;
+#pragma GCC unroll 4
+  for (uint32_t i = 0; i < count; i++) {
+    mix[i] = mix[i] * scale + (unit_throttle ? scaled_throttle : scaled_throttle * throttle_factor[i]);
   }
 }
 
-static void motor_brushed_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_MAX]) {
+static void motor_brushed_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_MAX], uint32_t count) {
   // throttle reduction
   float overthrottle = 0;
   float underthrottle = 0.001f;
   static float overthrottlefilt = 0;
 
-  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
-    mix[i] += throttle;
+  for (uint32_t i = 0; i < count; i++) {
+    mix[i] += throttle * profile.mixer.throttle[i];
 
     if (mix[i] > overthrottle)
       overthrottle = mix[i];
@@ -116,7 +165,7 @@ static void motor_brushed_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_M
 
   if (overthrottle > 0) { // exceeding max motor thrust
     float temp = overthrottle;
-    for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    for (uint32_t i = 0; i < count; i++) {
       mix[i] -= temp;
     }
   }
@@ -125,7 +174,7 @@ static void motor_brushed_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_M
   if (flags.in_air == 1) {
     float underthrottle = 0;
 
-    for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    for (uint32_t i = 0; i < count; i++) {
       if (mix[i] < underthrottle)
         underthrottle = mix[i];
     }
@@ -135,81 +184,148 @@ static void motor_brushed_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_M
       underthrottle = -(float)MIX_THROTTLE_INCREASE_MAX;
 
     if (underthrottle < 0.0f) {
-      for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++)
+      for (uint32_t i = 0; i < count; i++)
         mix[i] -= underthrottle;
     }
   }
 }
 
-static void motor_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_MAX]) {
+static FORCE_INLINE void motor_mixer_scale_calc(float throttle, float mix[MOTOR_PIN_MAX], uint32_t count, bool unit_throttle) {
   if (target.brushless) {
-    return motor_brushless_mixer_scale_calc(throttle, mix);
+    return motor_brushless_mixer_scale_calc(throttle, mix, count, unit_throttle);
+  }
+  return motor_brushed_mixer_scale_calc(throttle, mix, count);
+}
+
+// a stick pushed towards a motor turns it off
+static bool motor_test_stick_off(float stick, float factor) {
+  if (factor > 0.0f) {
+    return stick > 0.5f;
+  }
+  if (factor < 0.0f) {
+    return stick < -0.5f;
   }
-  return motor_brushed_mixer_scale_calc(throttle, mix);
+  return false;
 }
 
 void motor_test_calc(bool motortest_usb, float mix[MOTOR_PIN_MAX]) {
-  if (motortest_usb) {
-    // set mix according to values we got via usb
-    mix[MOTOR_FR] = motor_test.value[MOTOR_FR];
-    mix[MOTOR_FL] = motor_test.value[MOTOR_FL];
-    mix[MOTOR_BR] = motor_test.value[MOTOR_BR];
-    mix[MOTOR_BL] = motor_test.value[MOTOR_BL];
-  } else {
-    // set mix according to sticks
-    if (state.rx_filtered.roll < -0.5f || state.rx_filtered.pitch < -0.5f) {
-      mix[MOTOR_FR] = 0;
-    } else {
-      mix[MOTOR_FR] = state.throttle;
-    }
+  const uint32_t count = motor_count();
 
-    if (state.rx_filtered.roll > 0.5f || state.rx_filtered.pitch < -0.5f) {
-      mix[MOTOR_FL] = 0;
-    } else {
-      mix[MOTOR_FL] = state.throttle;
+  for (uint32_t i = 0; i < count; i++) {
+    if (motortest_usb) {
+      // set mix according to values we got via usb
+      mix[i] = motor_test.value[i];
+      continue;
     }
 
-    if (state.rx_filtered.roll < -0.5f || state.rx_filtered.pitch > 0.5f) {
-      mix[MOTOR_BR] = 0;
+    // set mix according to sticks
+    const profile_mixer_t *mixer = &profile.mixer;
+    if (motor_test_stick_off(state.rx_filtered.roll, mixer->roll[i]) || motor_test_stick_off(state.rx_filtered.pitch, mixer->pitch[i])) {
+      mix[i] = 0;
     } else {
-      mix[MOTOR_BR] = state.throttle;
+      mix[i] = state.throttle;
     }
+  }
+}
 
-    if (state.rx_filtered.roll > 0.5f || state.rx_filtered.pitch > 0.5f) {
-      mix[MOTOR_BL] = 0;
-    } else {
-      mix[MOTOR_BL] = state.throttle;
-    }
+// kept out of line so the mixer itself does not need to save registers for the call
+static void motor_torque_boost_calc(float mix[MOTOR_PIN_MAX], uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    mix[i] = motord(mix[i], i);
   }
 }
 
-void motor_mixer_calc(float mix[MOTOR_PIN_MAX]) {
+static FORCE_INLINE void motor_mixer_calc_count(float mix[MOTOR_PIN_MAX], uint32_t count) {
+  const float roll = state.pidoutput.roll;
+  const float pitch = state.pidoutput.pitch;
   const float yaw = profile.motor.invert_yaw ? -state.pidoutput.yaw : state.pidoutput.yaw;
 
-#ifndef MOTOR_PLUS_CONFIGURATION
-  // normal mode, we set mix according to pidoutput
-  mix[MOTOR_FR] = -state.pidoutput.roll - state.pidoutput.pitch + yaw; // FR
-  mix[MOTOR_FL] = +state.pidoutput.roll - state.pidoutput.pitch - yaw; // FL
-  mix[MOTOR_BR] = -state.pidoutput.roll + state.pidoutput.pitch - yaw; // BR
-  mix[MOTOR_BL] = +state.pidoutput.roll + state.pidoutput.pitch + yaw; // BL
-#else
-  // plus mode, we set mix according to pidoutput
-  mix[MOTOR_FR] = -state.pidoutput.pitch + yaw; // FRONT
-  mix[MOTOR_FL] = +state.pidoutput.roll - yaw;  // LEFT
-  mix[MOTOR_BR] = -state.pidoutput.roll - yaw;  // RIGHT
-  mix[MOTOR_BL] = +state.pidoutput.pitch + yaw; // BACK
-#endif
+  // the columns are contiguous, this compiles to straight multiply adds over the motors
+  const profile_mixer_t *mixer = &profile.mixer;
+#pragma GCC unroll 4
+  for (uint32_t i = 0; i < count; i++) {
+    mix[i] = mixer->roll[i] * roll + mixer->pitch[i] * pitch + mixer->yaw[i] * yaw;
+  }
+
+  if (profile.motor.torque_boost > 0.0f) {
+    motor_torque_boost_calc(mix, count);
+  }
+
+  motor_mixer_scale_calc(state.throttle, mix, count, false);
+}
+
+static FORCE_INLINE void motor_mixer_quad_x_calc(float mix[MOTOR_PIN_MAX]) {
+  const float roll = state.pidoutput.roll;
+  const float pitch = state.pidoutput.pitch;
+  const float yaw = profile.motor.invert_yaw ? -state.pidoutput.yaw : state.pidoutput.yaw;
+
+  mix[MOTOR_FR] = -roll - pitch + yaw;
+  mix[MOTOR_FL] = +roll - pitch - yaw;
+  mix[MOTOR_BR] = -roll + pitch - yaw;
+  mix[MOTOR_BL] = +roll + pitch + yaw;
 
   if (profile.motor.torque_boost > 0.0f) {
-    for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
-      mix[i] = motord(mix[i], i);
+    motor_torque_boost_calc(mix, 4);
+  }
+
+  motor_mixer_scale_calc(state.throttle, mix, 4, true);
+}
+
+// the profile is only changed on the ground, the control loop calls this there
+// so the mixer does not have to compare the matrix on every run
+void motor_mixer_update() {
+  mixer_is_quad_x = profile.motor.motor_count <= 4;
+  for (uint32_t i = 0; i < 4; i++) {
+    if (profile.mixer.roll[i] != mixer_quad_x.roll[i] ||
+        profile.mixer.pitch[i] != mixer_quad_x.pitch[i] ||
+        profile.mixer.yaw[i] != mixer_quad_x.yaw[i] ||
+        profile.mixer.throttle[i] != mixer_quad_x.throttle[i]) {
+      mixer_is_quad_x = false;
     }
   }
+}
+
+void motor_mixer_calc(float mix[MOTOR_PIN_MAX]) {
+  if (mixer_is_quad_x) {
+    return motor_mixer_quad_x_calc(mix);
+  }
 
-  motor_mixer_scale_calc(state.throttle, mix);
+  // motor_count() clamps to at least four, quads skip the call and get a
+  // constant count so every loop unrolls like the old fixed mixer
+  if (profile.motor.motor_count <= 4) {
+    return motor_mixer_calc_count(mix, 4);
+  }
+  return motor_mixer_calc_count(mix, motor_count());
 }
 
 //********************************MOTOR OUTPUT***********************************************************
+// thrust is modelled as (1 - k) * x + k * x^2, the table holds its inverse
+static void motor_thrust_lut_update() {
+  if (profile.motor.thrust_linear == thrust_lut_linear) {
+    return;
+  }
+  thrust_lut_linear = profile.motor.thrust_linear;
+
+  const float k = constrain(thrust_lut_linear * 0.01f, 0.0f, 0.95f);
+  for (uint32_t i = 0; i <= THRUST_LUT_SIZE; i++) {
+    const float thrust = (float)i / (float)THRUST_LUT_SIZE;
+    if (k < 0.001f) {
+      thrust_lut[i] = thrust;
+    } else {
+      thrust_lut[i] = (sqrtf((1.0f - k) * (1.0f - k) + 4.0f * k * thrust) - (1.0f - k)) / (2.0f * k);
+    }
+  }
+}
+
+// expects thrust in 0 - 1, full thrust interpolates to the end of the last step
+static inline float motor_thrust_linearize(float thrust) {
+  const float pos = thrust * (float)THRUST_LUT_SIZE;
+  const uint32_t index = min((uint32_t)pos, (uint32_t)(THRUST_LUT_SIZE - 1));
+  const float frac = pos - (float)index;
+  return thrust_lut[index] + (thrust_lut[index + 1] - thrust_lut[index]) * frac;
+}
+
+
 void motor_output_calc(float mix[MOTOR_PIN_MAX]) {
   state.thrsum = 0; // reset throttle sum for voltage monitoring logic in main loop
 
@@ -220,12 +336,18 @@ void motor_output_calc(float mix[MOTOR_PIN_MAX]) {
     motor_min_value = 0.0001f + (float)profile.motor.digital_idle * 0.01f;
   }
 
+  const uint32_t count = motor_count();
+
+  motor_thrust_lut_update();
+  const float sag_factor = motor_vbat_sag_factor();
+
   // Begin for-loop to send motor commands
-  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+  for (uint32_t i = 0; i < count; i++) {
     if (!flags.motortest_override) {
       // use values as supplied in motor test mode
-      mix[i] = constrain(mix[i], 0, 1);
-      mix[i] = mapf(mix[i], 0.0f, 1.0f, motor_min_value, profile.motor.motor_limit * 0.01f);
+      const float thrust = constrain(mix[i], 0.0f, 1.0f);
+      const float command = constrain(motor_thrust_linearize(thrust) * sag_factor, 0.0f, 1.0f);
+      mix[i] = mapf(command, 0.0f, 1.0f, motor_min_value, profile.motor.motor_limit * 0.01f);
     }
 
 #ifndef NOMOTORS
@@ -234,6 +356,14 @@ void motor_output_calc(float mix[MOTOR_PIN_MAX]) {
     state.thrsum += mix[i];
   }
 
+  // pins without a motor stay off
+  for (uint32_t i = count; i < MOTOR_PIN_MAX; i++) {
+    mix[i] = 0;
+#ifndef NOMOTORS
+    motor_set(i, MOTOR_OFF);
+#endif
+  }
+
   // calculate throttle sum for voltage monitoring logic in main loop
-  state.thrsum = state.thrsum / MOTOR_PIN_MAX;
+  state.thrsum = state.thrsum / count;
 }
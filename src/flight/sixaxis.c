@@ -15,6 +15,8 @@
 #include "driver/time.h"
 #include "flight/control.h"
 #include "flight/filter.h"
+#include "flight/gyro_cal.h"
+#include "flight/imu.h"
 #include "flight/sdft.h"
 #include "flight/sixaxis.h"
 #include "io/blackbox.h"
@@ -28,6 +30,10 @@
 #define GYRO_BIAS_LIMIT 800
 #define ACCEL_BIAS_LIMIT 800
 
+#define CHECK_TIME 50000     // quick stillness check against the stored model in us
+#define CHECK_INTERVAL 1000  // time between measurements in us
+#define CHECK_TOLERANCE 0.5f // allowed model error in deg/s
+
 // gyro has +-2000 divided over 16bit.
 #define GYRO_RANGE (1.f / (65536.f / 4000.f))
 #define ACCEL_RANGE (1.f / 2048.0f)
@@ -145,9 +151,9 @@ void sixaxis_read() {
   state.gyro_raw.pitch = data.gyro.pitch - gyrocal[1];
   state.gyro_raw.yaw = data.gyro.yaw - gyrocal[2];
   state.gyro_raw = sixaxis_apply_matrix(state.gyro_raw);
-  state.gyro.roll = state.gyro_raw.roll = state.gyro_raw.roll * GYRO_RANGE * DEGTORAD;
-  state.gyro.pitch = state.gyro_raw.pitch = -state.gyro_raw.pitch * GYRO_RANGE * DEGTORAD;
-  state.gyro.yaw = state.gyro_raw.yaw = -state.gyro_raw.yaw * GYRO_RANGE * DEGTORAD;
+  state.gyro.roll = state.gyro_raw.roll = state.gyro_raw.roll * GYRO_RANGE * DEGTORAD - state.gyro_bias.roll;
+  state.gyro.pitch = state.gyro_raw.pitch = -state.gyro_raw.pitch * GYRO_RANGE * DEGTORAD - state.gyro_bias.pitch;
+  state.gyro.yaw = state.gyro_raw.yaw = -state.gyro_raw.yaw * GYRO_RANGE * DEGTORAD - state.gyro_bias.yaw;
 
   state.gyro_temp = data.temp;
 
@@ -239,7 +245,34 @@ static bool sixaxis_wait_for_still(uint32_t timeout) {
   return loop_counter < 20;
 }
 
-void sixaxis_gyro_cal() {
+// averages the gyro over a short window, returns false if it moved
+static bool sixaxis_gyro_check(float bias[3], float *temp) {
+  float sum[3] = {0, 0, 0};
+  uint32_t count = 0;
+  bool did_move = false;
+
+  gyro_data_t last_data = gyro_read();
+  for (uint32_t t = 0; t < CHECK_TIME; t += CHECK_INTERVAL) {
+    time_delay_us(CHECK_INTERVAL);
+
+    const gyro_data_t data = gyro_read();
+    did_move |= test_gyro_move(&last_data, &data);
+    for (uint8_t i = 0; i < 3; i++) {
+      sum[i] += data.gyro.axis[i];
+    }
+    *temp = data.temp;
+    last_data = data;
+    count++;
+  }
+
+  for (uint8_t i = 0; i < 3; i++) {
+    bias[i] = sum[i] / count;
+  }
+  return !did_move;
+}
+
+// returns false if it never saw enough still samples
+static bool sixaxis_gyro_cal_full() {
   for (uint8_t retry = 0; retry < 15; ++retry) {
     if (sixaxis_wait_for_still(CAL_INTERVAL)) {
       // break only if it's already still, otherwise, wait and try again
@@ -261,13 +294,54 @@ void sixaxis_gyro_cal() {
         lpf(&gyrocal[i], data.gyro.axis[i], lpfcalc(CAL_INTERVAL, 0.5 * 1e6));
       }
       if (cal_counter++ == CAL_COUNT) {
-        break;
+        return true;
       }
     }
 
     time_delay_us(CAL_INTERVAL);
     last_data = data;
   }
+  return false;
+}
+
+// full calibration, the result is added to the bias model when it completed
+void sixaxis_gyro_cal() {
+  if (!sixaxis_gyro_cal_full()) {
+    return;
+  }
+  gyro_cal_add(&flash_storage.gyro_cal, gyro_read().temp, gyrocal);
+  imu_gyro_bias_reset();
+}
+
+// the stored bias model is used unless a still quad measures something else,
+// so a quad booted on a moving platform still gets a usable calibration
+void sixaxis_gyro_cal_boot() {
+  float temp = 0;
+  float measured[3];
+  const bool still = sixaxis_gyro_check(measured, &temp);
+
+  float predicted[3];
+  if (gyro_cal_predict(&flash_storage.gyro_cal, temp, predicted)) {
+    bool agrees = true;
+    for (uint8_t i = 0; i < 3; i++) {
+      agrees &= fabsf(measured[i] - predicted[i]) * GYRO_RANGE < CHECK_TOLERANCE;
+    }
+
+    if (!still || agrees) {
+      memcpy(gyrocal, predicted, sizeof(gyrocal));
+      return;
+    }
+  }
+
+  if (still) {
+    memcpy(gyrocal, measured, sizeof(gyrocal));
+  }
+
+  const gyro_cal_model_t model = flash_storage.gyro_cal;
+  sixaxis_gyro_cal();
+  if (memcmp(&model, &flash_storage.gyro_cal, sizeof(gyro_cal_model_t)) != 0) {
+    flash_save();
+  }
 }
 
 void sixaxis_acc_cal() {
@@ -320,6 +394,9 @@ void sixaxis_read() {}
 void sixaxis_gyro_cal() {
   time_delay_ms(1500);
 }
+void sixaxis_gyro_cal_boot() {
+  sixaxis_gyro_cal();
+}
 void sixaxis_acc_cal() {
   time_delay_ms(1500);
 }
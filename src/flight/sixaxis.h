@@ -7,4 +7,5 @@ void sixaxis_init();
 void sixaxis_read();
 
 void sixaxis_gyro_cal();
+void sixaxis_gyro_cal_boot();
 void sixaxis_acc_cal();
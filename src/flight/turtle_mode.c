@@ -89,11 +89,6 @@ void turtle_mode_update() {
     state.rx_override.yaw = 0;
     state.rx_override.throttle = 0;
 
-    if (!motor_direction_change_done()) {
-      // wait for the motor to sucessfully change
-      break;
-    }
-
     if (fabsf(state.rx.roll) > 0.5f || fabsf(state.rx.pitch) > 0.5f) {
       if (fabsf(state.rx.roll) < fabsf(state.rx.pitch)) {
         turtle_axis = 1;
@@ -1,5 +1,8 @@
 #include "io/blackbox.h"
 
+#include <stddef.h>
+#include <string.h>
+
 #include "driver/time.h"
 #include "flight/control.h"
 #include "io/blackbox_device.h"
@@ -124,6 +127,10 @@ cbor_result_t cbor_encode_blackbox_frame(cbor_value_t *enc, const blackbox_t *cu
       active_fields |= (1 << BBOX_FIELD_MOTOR);
     }
     
+    if ((field_flags & (1 << BBOX_FIELD_MOTOR_EXT)) && compute_and_check_vec4_delta(&deltas.motor_ext, &current->motor_ext, &previous->motor_ext)) {
+      active_fields |= (1 << BBOX_FIELD_MOTOR_EXT);
+    }
+
     // Check CPU load
     if (field_flags & (1 << BBOX_FIELD_CPU_LOAD)) {
       deltas.cpu_load = current->cpu_load - previous->cpu_load;
@@ -193,10 +200,88 @@ cbor_result_t cbor_encode_blackbox_frame(cbor_value_t *enc, const blackbox_t *cu
     }
   }
 
+  CBOR_CHECK_ERROR(res = encode_vec4_field_if_present(enc, active_flags, BBOX_FIELD_MOTOR_EXT, &source->motor_ext));
+
   CBOR_CHECK_ERROR(res = cbor_encode_end_indefinite(enc));
   return res;
 }
 
+// raw little endian layout of each field, in field order
+static const struct {
+  uint8_t offset;
+  uint8_t size;
+} blackbox_raw_fields[BBOX_FIELD_MAX] = {
+    [BBOX_FIELD_LOOP] = {offsetof(blackbox_t, loop), sizeof(uint32_t)},
+    [BBOX_FIELD_TIME] = {offsetof(blackbox_t, time), sizeof(uint32_t)},
+    [BBOX_FIELD_PID_P_TERM] = {offsetof(blackbox_t, pid_p_term), sizeof(compact_vec3_t)},
+    [BBOX_FIELD_PID_I_TERM] = {offsetof(blackbox_t, pid_i_term), sizeof(compact_vec3_t)},
+    [BBOX_FIELD_PID_D_TERM] = {offsetof(blackbox_t, pid_d_term), sizeof(compact_vec3_t)},
+    [BBOX_FIELD_RX] = {offsetof(blackbox_t, rx), sizeof(compact_vec4_t)},
+    [BBOX_FIELD_SETPOINT] = {offsetof(blackbox_t, setpoint), sizeof(compact_vec4_t)},
+    [BBOX_FIELD_ACCEL_RAW] = {offsetof(blackbox_t, accel_raw), sizeof(compact_vec3_t)},
+    [BBOX_FIELD_ACCEL_FILTER] = {offsetof(blackbox_t, accel_filter), sizeof(compact_vec3_t)},
+    [BBOX_FIELD_GYRO_RAW] = {offsetof(blackbox_t, gyro_raw), sizeof(compact_vec3_t)},
+    [BBOX_FIELD_GYRO_FILTER] = {offsetof(blackbox_t, gyro_filter), sizeof(compact_vec3_t)},
+    [BBOX_FIELD_MOTOR] = {offsetof(blackbox_t, motor), sizeof(compact_vec4_t)},
+    [BBOX_FIELD_CPU_LOAD] = {offsetof(blackbox_t, cpu_load), sizeof(uint16_t)},
+    [BBOX_FIELD_DEBUG] = {offsetof(blackbox_t, debug), sizeof(int16_t) * BLACKBOX_DEBUG_SIZE},
+    [BBOX_FIELD_MOTOR_EXT] = {offsetof(blackbox_t, motor_ext), sizeof(compact_vec4_t)},
+};
+
+uint32_t blackbox_raw_size(const uint32_t field_flags) {
+  uint32_t size = 0;
+  for (uint32_t i = 0; i < BBOX_FIELD_MAX; i++) {
+    if (field_flags & (1 << i)) {
+      size += blackbox_raw_fields[i].size;
+    }
+  }
+  return size;
+}
+
+// packs the selected fields without any framing, buf has to hold blackbox_raw_size() bytes
+uint32_t blackbox_encode_raw(uint8_t *buf, const blackbox_t *b, const uint32_t field_flags) {
+  uint32_t size = 0;
+  for (uint32_t i = 0; i < BBOX_FIELD_MAX; i++) {
+    if (field_flags & (1 << i)) {
+      memcpy(buf + size, (const uint8_t *)b + blackbox_raw_fields[i].offset, blackbox_raw_fields[i].size);
+      size += blackbox_raw_fields[i].size;
+    }
+  }
+  return size;
+}
+
+// fills every field but loop and time from the current state
+void blackbox_sample(blackbox_t *b) {
+  vec3_compress(&b->pid_p_term, &state.pid_p_term, BLACKBOX_SCALE);
+  vec3_compress(&b->pid_i_term, &state.pid_i_term, BLACKBOX_SCALE);
+  vec3_compress(&b->pid_d_term, &state.pid_d_term, BLACKBOX_SCALE);
+
+  vec4_compress(&b->rx, &state.rx, BLACKBOX_SCALE);
+
+  b->setpoint.roll = state.setpoint.roll * BLACKBOX_SCALE;
+  b->setpoint.pitch = state.setpoint.pitch * BLACKBOX_SCALE;
+  b->setpoint.yaw = state.setpoint.yaw * BLACKBOX_SCALE;
+  b->setpoint.throttle = state.throttle * BLACKBOX_SCALE;
+
+  vec3_compress(&b->gyro_filter, &state.gyro, BLACKBOX_SCALE);
+  vec3_compress(&b->gyro_raw, &state.gyro_raw, BLACKBOX_SCALE);
+
+  vec3_compress(&b->accel_filter, &state.accel, BLACKBOX_SCALE);
+  vec3_compress(&b->accel_raw, &state.accel_raw, BLACKBOX_SCALE);
+
+  vec4_t motor;
+  vec4_from_array(&motor, state.motor_mix);
+  vec4_compress(&b->motor, &motor, BLACKBOX_SCALE);
+  vec4_from_array(&motor, state.motor_mix + 4);
+  vec4_compress(&b->motor_ext, &motor, BLACKBOX_SCALE);
+
+  b->cpu_load = state.cpu_load;
+
+  if (b != &blackbox) {
+    memcpy(b->debug, blackbox.debug, sizeof(blackbox.debug));
+  }
+}
+
 void blackbox_init() {
   blackbox_device_init();
 }
@@ -246,27 +331,7 @@ void blackbox_update() {
 
   blackbox.loop++;
   blackbox.time = time_micros();
-
-  vec3_compress(&blackbox.pid_p_term, &state.pid_p_term, BLACKBOX_SCALE);
-  vec3_compress(&blackbox.pid_i_term, &state.pid_i_term, BLACKBOX_SCALE);
-  vec3_compress(&blackbox.pid_d_term, &state.pid_d_term, BLACKBOX_SCALE);
-
-  vec4_compress(&blackbox.rx, &state.rx, BLACKBOX_SCALE);
-
-  blackbox.setpoint.roll = state.setpoint.roll * BLACKBOX_SCALE;
-  blackbox.setpoint.pitch = state.setpoint.pitch * BLACKBOX_SCALE;
-  blackbox.setpoint.yaw = state.setpoint.yaw * BLACKBOX_SCALE;
-  blackbox.setpoint.throttle = state.throttle * BLACKBOX_SCALE;
-
-  vec3_compress(&blackbox.gyro_filter, &state.gyro, BLACKBOX_SCALE);
-  vec3_compress(&blackbox.gyro_raw, &state.gyro_raw, BLACKBOX_SCALE);
-
-  vec3_compress(&blackbox.accel_filter, &state.accel, BLACKBOX_SCALE);
-  vec3_compress(&blackbox.accel_raw, &state.accel_raw, BLACKBOX_SCALE);
-
-  vec4_compress(&blackbox.motor, &state.motor_mix, BLACKBOX_SCALE);
-
-  blackbox.cpu_load = state.cpu_load;
+  blackbox_sample(&blackbox);
 
   // Determine frame type based on blackbox.loop counter
   // First frame (loop == 1) is always an I-frame, then every BLACKBOX_I_FRAME_INTERVAL frames
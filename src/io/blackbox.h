@@ -23,12 +23,16 @@ typedef enum {
   BBOX_FIELD_MOTOR,
   BBOX_FIELD_CPU_LOAD,
   BBOX_FIELD_DEBUG,
+  BBOX_FIELD_MOTOR_EXT, // motors 5 - 8
 
   BBOX_FIELD_MAX,
 } blackbox_field_t;
 
 typedef enum {
   BBOX_DEBUG_DYN_NOTCH = 0x1 << 0,
+  BBOX_DEBUG_GYRO_BIAS = 0x1 << 1,
+  BBOX_DEBUG_DSHOT_TELEMETRY = 0x1 << 2,
+  BBOX_DEBUG_DSHOT_EDT = 0x1 << 3,
 } blackbox_debug_flag_t;
 
 typedef struct {
@@ -53,6 +57,8 @@ typedef struct {
   uint16_t cpu_load;
 
   int16_t debug[BLACKBOX_DEBUG_SIZE];
+
+  compact_vec4_t motor_ext;
 } blackbox_t;
 
 // Frame types for I-frame/P-frame encoding
@@ -68,6 +74,10 @@ typedef enum {
 
 cbor_result_t cbor_encode_blackbox_frame(cbor_value_t *enc, const blackbox_t *current, const blackbox_t *previous, blackbox_frame_type_t frame_type, const uint32_t field_flags);
 
+uint32_t blackbox_raw_size(const uint32_t field_flags);
+uint32_t blackbox_encode_raw(uint8_t *buf, const blackbox_t *b, const uint32_t field_flags);
+
 void blackbox_init();
+void blackbox_sample(blackbox_t *b);
 void blackbox_set_debug(blackbox_debug_flag_t flag, uint8_t index, int16_t data);
 void blackbox_update();
\ No newline at end of file
@@ -0,0 +1,405 @@
+#include "io/blackbox_decode.h"
+
+#include <string.h>
+
+#ifdef SIMULATOR
+
+#define CBOR_ARRAY_INDEFINITE 0x9F
+#define CBOR_BREAK 0xFF
+
+// loop and time are the first two slots
+#define UNSIGNED_SLOTS 2
+
+typedef enum {
+  SLOT_UINT32,
+  SLOT_UINT16,
+  SLOT_INT16,
+} blackbox_decode_slot_type_t;
+
+typedef struct {
+  const char *name;
+  uint8_t slot;
+  uint8_t size;
+  uint8_t type;
+} blackbox_decode_field_t;
+
+// must follow blackbox_field_t, frames encode fields in this order
+static const blackbox_decode_field_t fields[BBOX_FIELD_MAX] = {
+    [BBOX_FIELD_LOOP] = {"loop", 0, 1, SLOT_UINT32},
+    [BBOX_FIELD_TIME] = {"time", 1, 1, SLOT_UINT32},
+    [BBOX_FIELD_PID_P_TERM] = {"pid_p_term", 2, 3, SLOT_INT16},
+    [BBOX_FIELD_PID_I_TERM] = {"pid_i_term", 5, 3, SLOT_INT16},
+    [BBOX_FIELD_PID_D_TERM] = {"pid_d_term", 8, 3, SLOT_INT16},
+    [BBOX_FIELD_RX] = {"rx", 11, 4, SLOT_INT16},
+    [BBOX_FIELD_SETPOINT] = {"setpoint", 15, 4, SLOT_INT16},
+    [BBOX_FIELD_ACCEL_RAW] = {"accel_raw", 19, 3, SLOT_INT16},
+    [BBOX_FIELD_ACCEL_FILTER] = {"accel_filter", 22, 3, SLOT_INT16},
+    [BBOX_FIELD_GYRO_RAW] = {"gyro_raw", 25, 3, SLOT_INT16},
+    [BBOX_FIELD_GYRO_FILTER] = {"gyro_filter", 28, 3, SLOT_INT16},
+    [BBOX_FIELD_MOTOR] = {"motor", 31, 4, SLOT_INT16},
+    [BBOX_FIELD_CPU_LOAD] = {"cpu_load", 35, 1, SLOT_UINT16},
+    [BBOX_FIELD_DEBUG] = {"debug", 36, BLACKBOX_DEBUG_SIZE, SLOT_INT16},
+    [BBOX_FIELD_MOTOR_EXT] = {"motor_ext", 36 + BLACKBOX_DEBUG_SIZE, 4, SLOT_INT16},
+};
+
+static const char digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+// cbor head of an int or array, returns 0 on truncated and -1 on unsupported input
+static inline int32_t blackbox_decode_head(const uint8_t **p, const uint8_t *end, uint8_t *type, uint32_t *val) {
+  if (*p >= end) {
+    return 0;
+  }
+
+  const uint8_t b = **p;
+  const uint8_t info = b & 0x1F;
+  *type = b >> 5;
+
+  if (info < 24) {
+    *val = info;
+    *p += 1;
+    return 1;
+  }
+  if (info > 26) {
+    return -1;
+  }
+
+  const uint32_t bytes = 1 << (info - 24);
+  if ((uint32_t)(end - *p) <= bytes) {
+    return 0;
+  }
+
+  uint32_t v = 0;
+  for (uint32_t i = 1; i <= bytes; i++) {
+    v = (v << 8) | (*p)[i];
+  }
+  *p += 1 + bytes;
+  *val = v;
+  return 1;
+}
+
+static inline int32_t blackbox_decode_int(const uint8_t **p, const uint8_t *end, int32_t *val) {
+  uint8_t type;
+  uint32_t raw;
+  const int32_t res = blackbox_decode_head(p, end, &type, &raw);
+  if (res <= 0) {
+    return res;
+  }
+  if (type == CBOR_TYPE_UINT) {
+    *val = (int32_t)raw;
+    return 1;
+  }
+  if (type == CBOR_TYPE_NINT) {
+    *val = -1 - (int32_t)raw;
+    return 1;
+  }
+  return -1;
+}
+
+static void blackbox_decode_flush(blackbox_decoder_t *d) {
+  if (d->buffer_len == 0) {
+    return;
+  }
+  d->write(d->buffer, d->buffer_len, d->priv);
+  d->buffer_len = 0;
+}
+
+static void blackbox_decode_put(blackbox_decoder_t *d, const void *data, const uint32_t len) {
+  if (d->buffer_len + len > BLACKBOX_DECODE_BUFFER_SIZE) {
+    blackbox_decode_flush(d);
+  }
+  memcpy(d->buffer + d->buffer_len, data, len);
+  d->buffer_len += len;
+}
+
+static inline uint8_t *blackbox_decode_utoa(uint8_t *out, uint32_t v) {
+  uint8_t tmp[10];
+  uint8_t *p = tmp + sizeof(tmp);
+
+  while (v >= 100) {
+    const uint32_t pair = (v % 100) * 2;
+    v /= 100;
+    *--p = digit_pairs[pair + 1];
+    *--p = digit_pairs[pair];
+  }
+  if (v >= 10) {
+    *--p = digit_pairs[v * 2 + 1];
+    *--p = digit_pairs[v * 2];
+  } else {
+    *--p = '0' + v;
+  }
+
+  const uint32_t len = tmp + sizeof(tmp) - p;
+  memcpy(out, p, len);
+  return out + len;
+}
+
+static inline uint8_t *blackbox_decode_itoa(uint8_t *out, const int32_t v) {
+  if (v < 0) {
+    *out++ = '-';
+    return blackbox_decode_utoa(out, -(uint32_t)v);
+  }
+  return blackbox_decode_utoa(out, v);
+}
+
+static void blackbox_decode_column_name(blackbox_decoder_t *d, const blackbox_field_t field, const uint8_t index) {
+  blackbox_decode_put(d, fields[field].name, strlen(fields[field].name));
+  if (fields[field].size > 1) {
+    uint8_t name[8];
+    uint8_t *p = name;
+    *p++ = '[';
+    p = blackbox_decode_utoa(p, index);
+    *p++ = ']';
+    blackbox_decode_put(d, name, p - name);
+  }
+}
+
+static void blackbox_decode_block(blackbox_decoder_t *d) {
+  if (d->rows == 0) {
+    return;
+  }
+
+  const uint32_t head[2] = {d->rows, d->column_count};
+  blackbox_decode_put(d, head, sizeof(head));
+  blackbox_decode_flush(d);
+
+  for (uint8_t i = 0; i < d->column_count; i++) {
+    d->write((const uint8_t *)d->columns[i], d->rows * sizeof(int32_t), d->priv);
+  }
+  d->rows = 0;
+}
+
+static void blackbox_decode_row(blackbox_decoder_t *d) {
+  if (d->format == BLACKBOX_DECODE_COLUMNAR) {
+    for (uint8_t i = 0; i < d->column_count; i++) {
+      d->columns[i][d->rows] = d->values[d->column_slot[i]];
+    }
+    d->rows++;
+    if (d->rows == BLACKBOX_DECODE_BLOCK_ROWS) {
+      blackbox_decode_block(d);
+    }
+    return;
+  }
+
+  // worst case of 11 chars plus separator per column
+  if (d->buffer_len + d->column_count * 12 > BLACKBOX_DECODE_BUFFER_SIZE) {
+    blackbox_decode_flush(d);
+  }
+
+  uint8_t *out = d->buffer + d->buffer_len;
+  for (uint8_t i = 0; i < d->column_count; i++) {
+    const uint8_t slot = d->column_slot[i];
+    if (slot < UNSIGNED_SLOTS) {
+      out = blackbox_decode_utoa(out, d->values[slot]);
+    } else {
+      out = blackbox_decode_itoa(out, d->values[slot]);
+    }
+    *out++ = ',';
+  }
+  out[-1] = '\n';
+  d->buffer_len = out - d->buffer;
+}
+
+void blackbox_decoder_init(blackbox_decoder_t *d, const uint32_t field_flags, const blackbox_decode_format_t format, blackbox_decode_write_fn_t write, void *priv) {
+  d->format = format;
+  d->write = write;
+  d->priv = priv;
+
+  // loop and time are always present
+  d->field_flags = (field_flags | (1 << BBOX_FIELD_LOOP) | (1 << BBOX_FIELD_TIME)) & ~BLACKBOX_FRAME_TYPE_BIT;
+  d->synced = false;
+  memset(d->values, 0, sizeof(d->values));
+
+  d->frames = 0;
+  d->skipped = 0;
+  d->rows = 0;
+  d->buffer_len = 0;
+
+  d->column_count = 0;
+  for (uint32_t field = 0; field < BBOX_FIELD_MAX; field++) {
+    if (!(d->field_flags & (1 << field))) {
+      continue;
+    }
+    for (uint8_t i = 0; i < fields[field].size; i++) {
+      d->column_slot[d->column_count++] = fields[field].slot + i;
+    }
+  }
+
+  if (format == BLACKBOX_DECODE_COLUMNAR) {
+    const uint32_t head[2] = {BLACKBOX_DECODE_COLUMNAR_MAGIC, d->column_count};
+    blackbox_decode_put(d, head, sizeof(head));
+  }
+
+  uint8_t column = 0;
+  for (uint32_t field = 0; field < BBOX_FIELD_MAX; field++) {
+    if (!(d->field_flags & (1 << field))) {
+      continue;
+    }
+    for (uint8_t i = 0; i < fields[field].size; i++) {
+      blackbox_decode_column_name(d, field, i);
+
+      column++;
+      if (format == BLACKBOX_DECODE_COLUMNAR) {
+        blackbox_decode_put(d, "", 1);
+      } else {
+        blackbox_decode_put(d, column == d->column_count ? "\n" : ",", 1);
+      }
+    }
+  }
+}
+
+// returns bytes consumed, 0 if the frame is incomplete and -1 if it is malformed
+static int32_t blackbox_decode_frame(blackbox_decoder_t *d, const uint8_t *data, const uint8_t *end) {
+  const uint8_t *p = data;
+  if (*p++ != CBOR_ARRAY_INDEFINITE) {
+    return -1;
+  }
+
+#define DECODE_INT(val)                                     \
+  {                                                         \
+    const int32_t res = blackbox_decode_int(&p, end, &val); \
+    if (res <= 0) {                                         \
+      return res;                                           \
+    }                                                       \
+  }
+
+  int32_t flags;
+  DECODE_INT(flags);
+
+  const bool is_p_frame = (uint32_t)flags & BLACKBOX_FRAME_TYPE_BIT;
+  const uint32_t active = (uint32_t)flags & ~BLACKBOX_FRAME_TYPE_BIT;
+
+  int32_t loop, time;
+  DECODE_INT(loop);
+  DECODE_INT(time);
+
+  // decode into a copy, a truncated frame must not leave a half applied state
+  int32_t values[BLACKBOX_DECODE_COLUMNS_MAX];
+  memcpy(values, d->values, sizeof(values));
+
+  if (is_p_frame) {
+    values[0] = (uint32_t)values[0] + (uint32_t)loop;
+    values[1] = (uint32_t)values[1] + (uint32_t)time;
+  } else {
+    values[0] = loop;
+    values[1] = time;
+  }
+
+  for (uint32_t field = BBOX_FIELD_PID_P_TERM; field < BBOX_FIELD_MAX; field++) {
+    if (!(active & (1 << field))) {
+      continue;
+    }
+
+    const blackbox_decode_field_t *f = &fields[field];
+    if (f->size > 1) {
+      uint8_t type;
+      uint32_t count;
+      const int32_t res = blackbox_decode_head(&p, end, &type, &count);
+      if (res <= 0) {
+        return res;
+      }
+      if (type != CBOR_TYPE_ARRAY || count != f->size) {
+        return -1;
+      }
+    }
+
+    int32_t *slot = values + f->slot;
+    for (uint8_t i = 0; i < f->size; i++) {
+      int32_t val;
+      DECODE_INT(val);
+
+      // deltas wrap like the int16 values they were computed from
+      const int32_t next = is_p_frame ? slot[i] + val : val;
+      slot[i] = f->type == SLOT_UINT16 ? (uint16_t)next : (int16_t)next;
+    }
+  }
+
+#undef DECODE_INT
+
+  if (p >= end) {
+    return 0;
+  }
+  if (*p++ != CBOR_BREAK) {
+    return -1;
+  }
+
+  memcpy(d->values, values, sizeof(values));
+  if (!is_p_frame) {
+    d->synced = true;
+  }
+  if (d->synced) {
+    d->frames++;
+    blackbox_decode_row(d);
+  } else {
+    // deltas without a base frame
+    d->skipped++;
+  }
+  return p - data;
+}
+
+// decodes all complete frames, the caller keeps the rest for the next call
+uint32_t blackbox_decoder_feed(blackbox_decoder_t *d, const uint8_t *data, const uint32_t len) {
+  const uint8_t *end = data + len;
+  const uint8_t *p = data;
+
+  while (p < end) {
+    const int32_t res = blackbox_decode_frame(d, p, end);
+    if (res == 0) {
+      break;
+    }
+    if (res > 0) {
+      p += res;
+      continue;
+    }
+
+    // resync on the next frame start, the following p-frames are useless until an i-frame
+    d->skipped++;
+    d->synced = false;
+    p++;
+    while (p < end && *p != CBOR_ARRAY_INDEFINITE) {
+      p++;
+    }
+  }
+
+  return p - data;
+}
+
+void blackbox_decoder_finish(blackbox_decoder_t *d) {
+  if (d->format == BLACKBOX_DECODE_COLUMNAR) {
+    blackbox_decode_block(d);
+  }
+  blackbox_decode_flush(d);
+}
+
+// image starts with the blackbox_device_header_t, file offsets are relative to it
+int32_t blackbox_decode_image(blackbox_decoder_t *d, const uint8_t *image, const uint32_t size, const uint8_t file_index, const blackbox_decode_format_t format, blackbox_decode_write_fn_t write, void *priv) {
+  if (size < sizeof(blackbox_device_header_t)) {
+    return -1;
+  }
+
+  blackbox_device_header_t header;
+  memcpy(&header, image, sizeof(blackbox_device_header_t));
+  if (header.magic != BLACKBOX_HEADER_MAGIC || file_index >= header.file_num || header.file_num > BLACKBOX_DEVICE_MAX_FILES) {
+    return -1;
+  }
+
+  const blackbox_device_file_t *file = &header.files[file_index];
+  if (file->start > size || file->size > size - file->start) {
+    return -1;
+  }
+
+  blackbox_decoder_init(d, file->field_flags, format, write, priv);
+  blackbox_decoder_feed(d, image + file->start, file->size);
+  blackbox_decoder_finish(d);
+  return d->frames;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "io/blackbox.h"
+#include "io/blackbox_device.h"
+
+// loop, time, 3x3 pid terms, 2x4 rx/setpoint, 4x3 accel/gyro, 4 motors, cpu load, debug and 4 more motors
+#define BLACKBOX_DECODE_COLUMNS_MAX (2 + 3 * 3 + 4 * 2 + 3 * 4 + 4 + 1 + BLACKBOX_DEBUG_SIZE + 4)
+// keeps a whole block of columns cache resident while rows are transposed into it
+#define BLACKBOX_DECODE_BLOCK_ROWS 256
+#define BLACKBOX_DECODE_BUFFER_SIZE 65536
+
+// columnar layout, all little endian:
+//  header: magic, column count, column names as nul terminated strings
+//  blocks: row count, column count, then every column as row count int32s
+// loop and time columns hold uint32 values
+#define BLACKBOX_DECODE_COLUMNAR_MAGIC 0x43425351
+
+typedef enum {
+  BLACKBOX_DECODE_CSV,
+  BLACKBOX_DECODE_COLUMNAR,
+} blackbox_decode_format_t;
+
+typedef void (*blackbox_decode_write_fn_t)(const uint8_t *data, uint32_t len, void *priv);
+
+typedef struct {
+  blackbox_decode_format_t format;
+  blackbox_decode_write_fn_t write;
+  void *priv;
+
+  uint32_t field_flags;
+  bool synced;
+
+  uint32_t frames;
+  uint32_t skipped;
+
+  // reconstructed frame, one slot per possible column in blackbox_field_t order
+  int32_t values[BLACKBOX_DECODE_COLUMNS_MAX];
+
+  uint8_t column_count;
+  uint8_t column_slot[BLACKBOX_DECODE_COLUMNS_MAX];
+
+  uint32_t rows;
+  int32_t columns[BLACKBOX_DECODE_COLUMNS_MAX][BLACKBOX_DECODE_BLOCK_ROWS];
+
+  uint32_t buffer_len;
+  uint8_t buffer[BLACKBOX_DECODE_BUFFER_SIZE];
+} blackbox_decoder_t;
+
+void blackbox_decoder_init(blackbox_decoder_t *d, const uint32_t field_flags, const blackbox_decode_format_t format, blackbox_decode_write_fn_t write, void *priv);
+uint32_t blackbox_decoder_feed(blackbox_decoder_t *d, const uint8_t *data, const uint32_t len);
+void blackbox_decoder_finish(blackbox_decoder_t *d);
+
+int32_t blackbox_decode_image(blackbox_decoder_t *d, const uint8_t *image, const uint32_t size, const uint8_t file_index, const blackbox_decode_format_t format, blackbox_decode_write_fn_t write, void *priv);
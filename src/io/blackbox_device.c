@@ -59,7 +59,7 @@ ring_buffer_t blackbox_encode_buffer = {
     .tail = 0,
     .size = BLACKBOX_ENCODE_BUFFER_SIZE,
 };
-uint8_t blackbox_write_buffer[BLACKBOX_WRITE_BUFFER_SIZE];
+DMA_RAM uint8_t blackbox_write_buffer[BLACKBOX_WRITE_BUFFER_SIZE];
 
 static blackbox_device_vtable_t *dev = NULL;
 
@@ -131,14 +131,14 @@ bool blackbox_device_restart(uint32_t field_flags, uint32_t blackbox_rate, float
     return false;
   }
 
-  if (blackbox_device_header.file_num >= BLACKBOX_DEVICE_MAX_FILES) {
-    return false;
-  }
   if (!dev->ready()) {
     return false;
   }
 
-  const uint32_t offset = MEMORY_ALIGN(blackbox_device_usage(), blackbox_bounds.page_size);
+  const uint32_t offset = dev->alloc != NULL ? dev->alloc() : MEMORY_ALIGN(blackbox_device_usage(), blackbox_bounds.page_size);
+  if (blackbox_device_header.file_num >= BLACKBOX_DEVICE_MAX_FILES) {
+    return false;
+  }
   if (offset >= blackbox_bounds.total_size) {
     // flash is full
     return false;
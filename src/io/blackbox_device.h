@@ -30,6 +30,8 @@ typedef struct {
   void (*stop)();
 
   uint32_t (*usage)();
+  // optional, returns the start offset of the next file
+  uint32_t (*alloc)();
   bool (*ready)();
 
   void (*read)(const uint32_t file_index, const uint32_t offset, uint8_t *buffer, const uint32_t size);
@@ -1,5 +1,7 @@
 #include "blackbox_device_flash.h"
 
+#include <string.h>
+
 #include "core/project.h"
 #include "driver/blackbox/m25p16.h"
 #include "util/util.h"
@@ -7,6 +9,7 @@
 #ifdef USE_DATA_FLASH
 
 #define FILES_SECTOR_OFFSET blackbox_bounds.sector_size
+#define FILES_SIZE (blackbox_bounds.total_size - FILES_SECTOR_OFFSET)
 #define PAGE_SIZE M25P16_PAGE_SIZE
 #define MAX_WRITE_SIZE (128)
 
@@ -16,9 +19,9 @@ typedef enum {
 
   STATE_WRITE,
 
-  STATE_READ_HEADER,
+  STATE_ERASE_SECTOR,
 
-  STATE_ERASE_CHIP,
+  STATE_READ_HEADER,
 
   STATE_ERASE_HEADER,
   STATE_WRITE_HEADER,
@@ -33,6 +36,71 @@ typedef enum {
 static blackbox_device_state_t state = STATE_DETECT;
 static blackbox_device_phase_t phase = PHASE_IDLE;
 
+// files are kept in a circular log, everything between the write head and
+// the erase head is erased and ready to be programmed.
+static uint32_t erase_offset = 0;
+
+static uint32_t blackbox_device_flash_addr(const uint32_t offset) {
+  if (offset >= blackbox_bounds.total_size) {
+    return offset - FILES_SIZE;
+  }
+  return offset;
+}
+
+static uint32_t blackbox_device_flash_write_offset() {
+  if (blackbox_device_header.file_num == 0) {
+    return FILES_SECTOR_OFFSET;
+  }
+  return blackbox_device_flash_addr(blackbox_current_file()->start + blackbox_current_file()->size);
+}
+
+static uint32_t blackbox_device_flash_erased_ahead() {
+  const uint32_t offset = blackbox_device_flash_write_offset();
+  if (erase_offset >= offset) {
+    return erase_offset - offset;
+  }
+  return erase_offset + FILES_SIZE - offset;
+}
+
+static bool blackbox_device_flash_file_overlaps(const blackbox_device_file_t *file, const uint32_t addr, const uint32_t size) {
+  // files may wrap around the end of flash, check the wrapped address range too
+  const uint32_t end = file->start + file->size;
+  if (addr < end && (addr + size) > file->start) {
+    return true;
+  }
+  const uint32_t wrapped = addr + FILES_SIZE;
+  return wrapped < end && (wrapped + size) > file->start;
+}
+
+static void blackbox_device_flash_evict_file() {
+  blackbox_device_header.file_num--;
+  memmove(&blackbox_device_header.files[0], &blackbox_device_header.files[1], blackbox_device_header.file_num * sizeof(blackbox_device_file_t));
+}
+
+// checks if the sector at the erase head can be erased.
+// while logging the oldest files are evicted to make room for the current one.
+static bool blackbox_device_flash_can_erase(bool *evicted) {
+  const bool logging = phase != PHASE_IDLE && blackbox_device_header.file_num > 0;
+  if (logging && (blackbox_current_file()->size + blackbox_device_flash_erased_ahead() + blackbox_bounds.sector_size) > FILES_SIZE) {
+    // current file would overwrite itself, flash is full
+    return false;
+  }
+
+  const uint8_t keep = logging ? 1 : 0;
+  while (blackbox_device_header.file_num > keep) {
+    if (!blackbox_device_flash_file_overlaps(&blackbox_device_header.files[0], erase_offset, blackbox_bounds.sector_size)) {
+      break;
+    }
+    if (!logging) {
+      // never evict files while idle
+      return false;
+    }
+    blackbox_device_flash_evict_file();
+    *evicted = true;
+  }
+  return true;
+}
+
 void blackbox_device_flash_init() {
   m25p16_init();
 
@@ -41,6 +109,7 @@ void blackbox_device_flash_init() {
 
 bool blackbox_device_flash_update() {
   static uint32_t write_size = 0;
+  static bool evicted = false;
 
   switch (state) {
   case STATE_DETECT:
@@ -51,6 +120,10 @@ bool blackbox_device_flash_update() {
     return false;
 
   case STATE_IDLE: {
+    if (blackbox_device_flash_erased_ahead() <= blackbox_bounds.sector_size && blackbox_device_flash_can_erase(&evicted)) {
+      state = STATE_ERASE_SECTOR;
+      break;
+    }
     if (phase == PHASE_IDLE) {
       break;
     }
@@ -73,13 +146,13 @@ bool blackbox_device_flash_update() {
   }
 
   case STATE_WRITE: {
-    const uint32_t offset = blackbox_current_file()->start + blackbox_current_file()->size;
-    if (offset >= blackbox_bounds.total_size) {
+    if (blackbox_device_flash_erased_ahead() < write_size) {
+      // flash is full, drop data
       write_size = 0;
       state = STATE_IDLE;
       break;
     }
-    if (m25p16_page_program(offset, blackbox_write_buffer, write_size)) {
+    if (m25p16_page_program(blackbox_device_flash_write_offset(), blackbox_write_buffer, write_size)) {
       blackbox_current_file()->size += write_size;
       write_size = 0;
       state = STATE_IDLE;
@@ -87,6 +160,20 @@ bool blackbox_device_flash_update() {
     break;
   }
 
+  case STATE_ERASE_SECTOR: {
+    if (m25p16_write_addr(M25P16_SECTOR_ERASE, erase_offset, NULL, 0)) {
+      erase_offset = blackbox_device_flash_addr(erase_offset + blackbox_bounds.sector_size);
+      if (evicted) {
+        // persist the eviction before the sectors are reused
+        state = STATE_ERASE_HEADER;
+        evicted = false;
+      } else {
+        state = STATE_IDLE;
+      }
+    }
+    break;
+  }
+
   case STATE_READ_HEADER:
     if (!m25p16_is_ready()) {
       return false;
@@ -97,18 +184,15 @@ bool blackbox_device_flash_update() {
       blackbox_device_header.magic = BLACKBOX_HEADER_MAGIC;
       blackbox_device_header.file_num = 0;
 
-      state = STATE_ERASE_CHIP;
+      erase_offset = FILES_SECTOR_OFFSET;
+      state = STATE_ERASE_HEADER;
     } else {
+      // the sector containing the write head was erased before it was written
+      erase_offset = blackbox_device_flash_addr(MEMORY_ALIGN(blackbox_device_flash_write_offset(), blackbox_bounds.sector_size));
       state = STATE_IDLE;
     }
     return false;
 
-  case STATE_ERASE_CHIP:
-    if (m25p16_chip_erase()) {
-      state = STATE_WRITE_HEADER;
-    }
-    return false;
-
   case STATE_ERASE_HEADER: {
     if (m25p16_write_addr(M25P16_SECTOR_ERASE, 0x0, NULL, 0)) {
       state = STATE_WRITE_HEADER;
@@ -128,18 +212,30 @@ bool blackbox_device_flash_update() {
 }
 
 void blackbox_device_flash_reset() {
-  while (!m25p16_chip_erase())
-    ;
-  m25p16_wait_for_ready();
-
-  state = STATE_WRITE_HEADER;
+  // sectors are erased ahead of the write head, no need for a full chip erase
+  erase_offset = FILES_SECTOR_OFFSET;
+  phase = PHASE_IDLE;
+  state = STATE_ERASE_HEADER;
 }
 
 uint32_t blackbox_device_flash_usage() {
+  uint32_t usage = FILES_SECTOR_OFFSET;
+  for (uint32_t i = 0; i < blackbox_device_header.file_num; i++) {
+    usage += MEMORY_ALIGN(blackbox_device_header.files[i].size, PAGE_SIZE);
+  }
+  return usage;
+}
+
+uint32_t blackbox_device_flash_alloc() {
+  if (blackbox_device_header.file_num == BLACKBOX_DEVICE_MAX_FILES) {
+    blackbox_device_flash_evict_file();
+  }
   if (blackbox_device_header.file_num == 0) {
-    return FILES_SECTOR_OFFSET;
+    return blackbox_device_flash_write_offset();
   }
-  return blackbox_current_file()->start + blackbox_current_file()->size;
+
+  const blackbox_device_file_t *file = blackbox_current_file();
+  return blackbox_device_flash_addr(MEMORY_ALIGN(file->start + file->size, PAGE_SIZE));
 }
 
 void blackbox_device_flash_stop() {
@@ -168,9 +264,9 @@ void blackbox_device_flash_read(const uint32_t file_index, const uint32_t offset
 
   uint32_t read = 0;
   while (read < size) {
-    const uint32_t read_size = min(size - read, PAGE_SIZE);
+    const uint32_t abs_offset = blackbox_device_flash_addr(file->start + offset + read);
+    const uint32_t read_size = min(size - read, PAGE_SIZE - (abs_offset % PAGE_SIZE));
 
-    const uint32_t abs_offset = file->start + offset + read;
     m25p16_read_addr(M25P16_READ_DATA_BYTES, abs_offset, buffer + read, read_size);
 
     read += read_size;
@@ -186,6 +282,7 @@ blackbox_device_vtable_t blackbox_device_flash = {
     .stop = blackbox_device_flash_stop,
 
     .usage = blackbox_device_flash_usage,
+    .alloc = blackbox_device_flash_alloc,
     .ready = blackbox_device_flash_ready,
 
     .read = blackbox_device_flash_read,
@@ -6,29 +6,258 @@
 
 #include "core/project.h"
 #include "driver/blackbox/sdcard.h"
+#include "util/fat32.h"
+#include "util/util.h"
 
-#define FLUSH_INTERVAL 8
+// pages pre-erased per multi-block write, the write is restarted once exceeded
+#define WRITE_PAGES 1024
 #define FILES_SECTOR_OFFSET 1
 #define PAGE_SIZE SDCARD_PAGE_SIZE
 
+// clusters reserved up front for every log on fat32 cards
+#define FAT_PREALLOC_SIZE (512 * 1024 * 1024)
+// first sector of every log file holds its blackbox_device_file_t
+#define FAT_META_PAGES 1
+
 typedef enum {
   STATE_DETECT,
   STATE_IDLE,
 
   STATE_START_WRITE,
-  STATE_FILL_WRITE_BUFFER,
-  STATE_CONTINUE_WRITE,
+  STATE_WRITE,
   STATE_FINISH_WRITE,
 
   STATE_READ_HEADER,
 
   STATE_ERASE_HEADER,
   STATE_WRITE_HEADER,
+
+  STATE_FAT_READ_VOLUME,
+  STATE_FAT_READ_DIR,
+  STATE_FAT_READ_DIR_FAT,
+  STATE_FAT_READ_META,
+  STATE_FAT_READ_FSINFO,
+  STATE_FAT_SCAN_FREE,
+
+  STATE_FAT_WRITE_META,
+  STATE_FAT_DELETE,
+
+  STATE_FAT_COMMIT_FAT_READ,
+  STATE_FAT_COMMIT_FAT_WRITE,
+  STATE_FAT_COMMIT_DIR_READ,
+  STATE_FAT_COMMIT_DIR_WRITE,
+  STATE_FAT_COMMIT_FSINFO_READ,
+  STATE_FAT_COMMIT_FSINFO_WRITE,
 } blackbox_device_state_t;
 
+typedef struct {
+  uint32_t number;
+  uint32_t dir_lba;
+  uint8_t dir_index;
+  uint32_t cluster;
+  uint32_t size;
+} fat_file_t;
+
+typedef struct {
+  uint32_t magic;
+  blackbox_device_file_t file;
+} fat_meta_t;
+
+// pending directory and fat update, shared by closing and deleting logs
+typedef struct {
+  uint32_t dir_lba;
+  uint8_t dir_index;
+  fat32_dir_entry_t entry;
+  uint32_t cluster;
+  uint32_t clusters;
+  bool allocate;
+
+  uint8_t fat_copy;
+  uint32_t fat_sector;
+} fat_commit_t;
+
 static blackbox_device_state_t state = STATE_DETECT;
 static uint8_t should_flush = 0;
 
+// bytes staged in blackbox_write_buffer for the next page
+static uint32_t write_size = 0;
+
+// set once sector 0 turned out to hold a fat32 volume instead of our header
+static bool fat_mode = false;
+static uint32_t fat_volume_lba = 0;
+static fat32_volume_t fat_vol;
+
+// header.files[i] is backed by fat_files[i]
+static fat_file_t fat_files[BLACKBOX_DEVICE_MAX_FILES];
+static uint32_t fat_next_number = 1;
+static int8_t fat_open_file = -1;
+
+static uint32_t fat_dir_cluster = 0;
+static uint32_t fat_dir_sector = 0;
+static uint32_t fat_free_dir_lba = 0;
+static uint8_t fat_free_dir_index = 0;
+static uint8_t fat_meta_index = 0;
+
+// contiguous free clusters the next log is written into
+static fat32_run_t fat_run;
+static fat32_run_t fat_scan_current;
+static fat32_run_t fat_scan_best;
+static uint32_t fat_scan_sector = 0;
+static uint32_t fat_scan_count = 0;
+
+static fat_commit_t fat_commit;
+static bool fat_reset = false;
+static uint8_t fat_delete_index = 0;
+static uint8_t fat_delete_num = 0;
+
+static uint32_t blackbox_device_sdcard_fat_prealloc() {
+  return fat32_clusters_for(&fat_vol, FAT_PREALLOC_SIZE);
+}
+
+static bool blackbox_device_sdcard_fat_parse_name(const uint8_t *name, uint32_t *number) {
+  if (memcmp(name, "LOG", 3) != 0 || memcmp(name + 8, "BFL", 3) != 0) {
+    return false;
+  }
+
+  uint32_t val = 0;
+  for (uint32_t i = 3; i < 8; i++) {
+    if (name[i] < '0' || name[i] > '9') {
+      return false;
+    }
+    val = val * 10 + (name[i] - '0');
+  }
+
+  *number = val;
+  return true;
+}
+
+static void blackbox_device_sdcard_fat_make_name(char *name, uint32_t number) {
+  memcpy(name, "LOG00000BFL", 11);
+  for (int32_t i = 7; i >= 3; i--) {
+    name[i] = '0' + number % 10;
+    number /= 10;
+  }
+}
+
+// only the newest files are listed, older logs stay on the card untouched
+static void blackbox_device_sdcard_fat_add(const fat_file_t *file) {
+  if (file->number >= fat_next_number) {
+    fat_next_number = file->number + 1;
+  }
+
+  uint8_t index = blackbox_device_header.file_num;
+  if (index == BLACKBOX_DEVICE_MAX_FILES) {
+    index = 0;
+    for (uint8_t i = 1; i < BLACKBOX_DEVICE_MAX_FILES; i++) {
+      if (fat_files[i].number < fat_files[index].number) {
+        index = i;
+      }
+    }
+    if (fat_files[index].number > file->number) {
+      return;
+    }
+  } else {
+    blackbox_device_header.file_num++;
+  }
+
+  fat_files[index] = *file;
+}
+
+static void blackbox_device_sdcard_fat_sort() {
+  for (uint8_t i = 1; i < blackbox_device_header.file_num; i++) {
+    const fat_file_t file = fat_files[i];
+
+    uint8_t j = i;
+    for (; j > 0 && fat_files[j - 1].number > file.number; j--) {
+      fat_files[j] = fat_files[j - 1];
+    }
+    fat_files[j] = file;
+  }
+}
+
+static void blackbox_device_sdcard_fat_remove(const uint8_t index) {
+  const uint8_t count = blackbox_device_header.file_num - index - 1;
+  memmove(&fat_files[index], &fat_files[index + 1], count * sizeof(fat_file_t));
+  memmove(&blackbox_device_header.files[index], &blackbox_device_header.files[index + 1], count * sizeof(blackbox_device_file_t));
+  blackbox_device_header.file_num--;
+}
+
+static void blackbox_device_sdcard_fat_scan() {
+  blackbox_device_header.magic = BLACKBOX_HEADER_MAGIC;
+  blackbox_device_header.file_num = 0;
+
+  fat_next_number = 1;
+  fat_free_dir_lba = 0;
+  fat_dir_cluster = fat_vol.root_cluster;
+  fat_dir_sector = 0;
+  state = STATE_FAT_READ_DIR;
+}
+
+static void blackbox_device_sdcard_fat_close() {
+  const int8_t index = fat_open_file;
+  fat_open_file = -1;
+
+  if (index < 0 || index >= blackbox_device_header.file_num) {
+    // file was empty and already removed, nothing to commit
+    state = STATE_IDLE;
+    return;
+  }
+
+  fat_file_t *file = &fat_files[index];
+  file->size = FAT_META_PAGES * PAGE_SIZE + blackbox_device_header.files[index].size;
+
+  char name[11];
+  blackbox_device_sdcard_fat_make_name(name, file->number);
+
+  fat_commit.dir_lba = file->dir_lba;
+  fat_commit.dir_index = file->dir_index;
+  fat32_make_dir_entry(&fat_commit.entry, name, file->cluster, file->size);
+  fat_commit.cluster = file->cluster;
+  fat_commit.clusters = fat32_clusters_for(&fat_vol, file->size);
+  fat_commit.allocate = true;
+
+  fat_run.start += fat_commit.clusters;
+  fat_run.count -= fat_commit.clusters;
+
+  // the dir slot is spent, the rescan after the commit finds the next one
+  fat_free_dir_lba = 0;
+
+  fat_commit.fat_copy = 0;
+  fat_commit.fat_sector = fat_commit.cluster / FAT32_ENTRIES_PER_SECTOR;
+  state = STATE_FAT_COMMIT_FAT_READ;
+}
+
+// logs stop at the preallocated run, anything past it is dropped
+static bool blackbox_device_sdcard_full() {
+  if (!fat_mode || fat_open_file < 0) {
+    return false;
+  }
+  const uint32_t capacity = fat_run.count * fat32_cluster_size(&fat_vol) - FAT_META_PAGES * PAGE_SIZE;
+  return blackbox_current_file()->size + PAGE_SIZE > capacity;
+}
+
+// raw files start at a byte offset, fat32 files at a sector as byte offsets overflow past 4GB
+static uint32_t blackbox_device_sdcard_page(const blackbox_device_file_t *file, const uint32_t offset) {
+  if (fat_mode) {
+    return file->start + offset / PAGE_SIZE;
+  }
+  return (file->start + offset) / PAGE_SIZE;
+}
+
+// stages the next page, called while the card is still busy with the last one
+static void blackbox_device_sdcard_stage() {
+  if (write_size != 0 || !sdcard_write_buffer_free()) {
+    return;
+  }
+
+  const uint32_t to_write = ring_buffer_available(&blackbox_encode_buffer);
+  if (to_write >= PAGE_SIZE) {
+    write_size = ring_buffer_read_multi(&blackbox_encode_buffer, blackbox_write_buffer, PAGE_SIZE);
+  } else if (should_flush == 1 && to_write > 0) {
+    write_size = ring_buffer_read_multi(&blackbox_encode_buffer, blackbox_write_buffer, to_write);
+  }
+}
+
 void blackbox_device_sdcard_init() {
   sdcard_init();
 
@@ -36,14 +265,18 @@ void blackbox_device_sdcard_init() {
 }
 
 bool blackbox_device_sdcard_update() {
-  static uint32_t offset = 0;
-  static uint32_t write_size = PAGE_SIZE;
+  static uint32_t pages = 0;
+
+  if (state == STATE_WRITE) {
+    blackbox_device_sdcard_stage();
+  }
 
   const uint32_t to_write = ring_buffer_available(&blackbox_encode_buffer);
 
   sdcard_status_t sdcard_status = sdcard_update();
   if (sdcard_status != SDCARD_IDLE) {
-    return false;
+    // keep logging while the card is busy programming
+    return sdcard_status == SDCARD_WAIT && (state == STATE_START_WRITE || state == STATE_WRITE || state == STATE_FINISH_WRITE);
   }
 
 sdcard_do_more:
@@ -59,6 +292,12 @@ sdcard_do_more:
       memcpy((uint8_t *)&blackbox_device_header, blackbox_write_buffer, sizeof(blackbox_device_header_t));
 
       if (blackbox_device_header.magic != BLACKBOX_HEADER_MAGIC) {
+        if (fat32_find_volume(blackbox_write_buffer, &fat_volume_lba)) {
+          // formatted card, log into files and leave sector 0 alone
+          state = STATE_FAT_READ_VOLUME;
+          break;
+        }
+
         blackbox_device_header.magic = BLACKBOX_HEADER_MAGIC;
         blackbox_device_header.file_num = 0;
 
@@ -72,7 +311,278 @@ sdcard_do_more:
     break;
   }
 
+  case STATE_FAT_READ_VOLUME: {
+    if (sdcard_read_pages(blackbox_write_buffer, fat_volume_lba, 1)) {
+      if (!fat32_parse_volume(&fat_vol, blackbox_write_buffer, fat_volume_lba)) {
+        blackbox_device_header.magic = BLACKBOX_HEADER_MAGIC;
+        blackbox_device_header.file_num = 0;
+
+        state = STATE_ERASE_HEADER;
+        break;
+      }
+
+      fat_mode = true;
+      fat_run.count = 0;
+      blackbox_device_sdcard_fat_scan();
+    }
+    return false;
+  }
+
+  case STATE_FAT_READ_DIR: {
+    const uint32_t lba = fat32_cluster_lba(&fat_vol, fat_dir_cluster) + fat_dir_sector;
+    if (!sdcard_read_pages(blackbox_write_buffer, lba, 1)) {
+      return false;
+    }
+
+    bool end = false;
+    for (uint8_t i = 0; i < FAT32_DIR_ENTRIES_PER_SECTOR; i++) {
+      const fat32_dir_entry_t *entry = (const fat32_dir_entry_t *)(blackbox_write_buffer + i * sizeof(fat32_dir_entry_t));
+      if (entry->name[0] == FAT32_DIR_ENTRY_END || entry->name[0] == FAT32_DIR_ENTRY_DELETED) {
+        if (fat_free_dir_lba == 0) {
+          fat_free_dir_lba = lba;
+          fat_free_dir_index = i;
+        }
+        if (entry->name[0] == FAT32_DIR_ENTRY_END) {
+          end = true;
+          break;
+        }
+        continue;
+      }
+
+      // skips long names and the volume label too
+      if (entry->attr & (FAT32_ATTR_VOLUME_ID | FAT32_ATTR_DIRECTORY)) {
+        continue;
+      }
+
+      fat_file_t file = {
+          .dir_lba = lba,
+          .dir_index = i,
+          .cluster = fat32_dir_entry_cluster(entry),
+          .size = entry->file_size,
+      };
+      if (blackbox_device_sdcard_fat_parse_name(entry->name, &file.number)) {
+        blackbox_device_sdcard_fat_add(&file);
+      }
+    }
+
+    fat_dir_sector++;
+    if (end) {
+      blackbox_device_sdcard_fat_sort();
+      fat_meta_index = 0;
+      state = STATE_FAT_READ_META;
+    } else if (fat_dir_sector == fat_vol.sectors_per_cluster) {
+      state = STATE_FAT_READ_DIR_FAT;
+    }
+    return false;
+  }
+
+  case STATE_FAT_READ_DIR_FAT: {
+    if (!sdcard_read_pages(blackbox_write_buffer, fat_vol.fat_lba + fat_dir_cluster / FAT32_ENTRIES_PER_SECTOR, 1)) {
+      return false;
+    }
+
+    const uint32_t next = fat32_entry(blackbox_write_buffer, fat_dir_cluster);
+    if (next < FAT32_CLUSTER_FIRST || next >= fat_vol.cluster_count + FAT32_CLUSTER_FIRST) {
+      // end of chain, a full root directory leaves no free slot
+      blackbox_device_sdcard_fat_sort();
+      fat_meta_index = 0;
+      state = STATE_FAT_READ_META;
+    } else {
+      fat_dir_cluster = next;
+      fat_dir_sector = 0;
+      state = STATE_FAT_READ_DIR;
+    }
+    return false;
+  }
+
+  case STATE_FAT_READ_META: {
+    if (fat_meta_index == blackbox_device_header.file_num) {
+      if (fat_reset && blackbox_device_header.file_num > 0) {
+        // older logs surfaced after the last batch was deleted
+        fat_delete_index = 0;
+        fat_delete_num = blackbox_device_header.file_num;
+        state = STATE_FAT_DELETE;
+      } else if (fat_run.count < blackbox_device_sdcard_fat_prealloc() / 4) {
+        fat_reset = false;
+        state = STATE_FAT_READ_FSINFO;
+      } else {
+        fat_reset = false;
+        state = STATE_IDLE;
+      }
+      return false;
+    }
+
+    const fat_file_t *file = &fat_files[fat_meta_index];
+    if (file->size < FAT_META_PAGES * PAGE_SIZE || file->cluster < FAT32_CLUSTER_FIRST) {
+      blackbox_device_sdcard_fat_remove(fat_meta_index);
+      return false;
+    }
+
+    const uint32_t lba = fat32_cluster_lba(&fat_vol, file->cluster);
+    if (!sdcard_read_pages(blackbox_write_buffer, lba, 1)) {
+      return false;
+    }
+
+    fat_meta_t meta;
+    memcpy(&meta, blackbox_write_buffer, sizeof(fat_meta_t));
+    if (meta.magic != BLACKBOX_HEADER_MAGIC) {
+      blackbox_device_sdcard_fat_remove(fat_meta_index);
+      return false;
+    }
+
+    blackbox_device_file_t *entry = &blackbox_device_header.files[fat_meta_index];
+    *entry = meta.file;
+    entry->start = lba + FAT_META_PAGES;
+    entry->size = file->size - FAT_META_PAGES * PAGE_SIZE;
+    fat_meta_index++;
+    return false;
+  }
+
+  case STATE_FAT_READ_FSINFO: {
+    if (!sdcard_read_pages(blackbox_write_buffer, fat_vol.fsinfo_lba, 1)) {
+      return false;
+    }
+
+    uint32_t hint = fat32_fsinfo_next_free(blackbox_write_buffer);
+    if (hint < FAT32_CLUSTER_FIRST || hint >= fat_vol.cluster_count + FAT32_CLUSTER_FIRST) {
+      hint = FAT32_CLUSTER_FIRST;
+    }
+
+    fat_scan_sector = hint / FAT32_ENTRIES_PER_SECTOR;
+    fat_scan_count = 0;
+    fat_scan_current.count = 0;
+    fat_scan_best.count = 0;
+    state = STATE_FAT_SCAN_FREE;
+    return false;
+  }
+
+  case STATE_FAT_SCAN_FREE: {
+    if (!sdcard_read_pages(blackbox_write_buffer, fat_vol.fat_lba + fat_scan_sector, 1)) {
+      return false;
+    }
+
+    fat32_scan_free(&fat_vol, blackbox_write_buffer, fat_scan_sector, &fat_scan_current, &fat_scan_best);
+
+    fat_scan_count++;
+    fat_scan_sector++;
+    if (fat_scan_sector == fat_vol.fat_sectors) {
+      // wrap around once, runs do not continue across the end
+      fat_scan_sector = 0;
+      fat_scan_current.count = 0;
+    }
+
+    const uint32_t prealloc = blackbox_device_sdcard_fat_prealloc();
+    if (fat_scan_best.count >= prealloc || fat_scan_count == fat_vol.fat_sectors) {
+      if (fat_scan_best.count > fat_run.count) {
+        fat_run.start = fat_scan_best.start;
+        fat_run.count = min(fat_scan_best.count, prealloc);
+      }
+      state = STATE_IDLE;
+    }
+    return false;
+  }
+
+  case STATE_FAT_WRITE_META: {
+    const blackbox_device_file_t *file = blackbox_current_file();
+    if (sdcard_write_page(blackbox_write_buffer, file->start - FAT_META_PAGES)) {
+      state = STATE_IDLE;
+    }
+    return false;
+  }
+
+  case STATE_FAT_DELETE: {
+    if (fat_delete_index == fat_delete_num) {
+      fat_delete_num = 0;
+      // freed clusters might make for a longer run
+      fat_run.count = 0;
+      blackbox_device_sdcard_fat_scan();
+      return false;
+    }
+
+    const fat_file_t *file = &fat_files[fat_delete_index++];
+    fat_commit.dir_lba = file->dir_lba;
+    fat_commit.dir_index = file->dir_index;
+    fat_commit.cluster = file->cluster;
+    fat_commit.clusters = fat32_clusters_for(&fat_vol, file->size);
+    fat_commit.allocate = false;
+
+    fat_commit.fat_copy = 0;
+    fat_commit.fat_sector = fat_commit.cluster / FAT32_ENTRIES_PER_SECTOR;
+    state = fat_commit.clusters > 0 ? STATE_FAT_COMMIT_FAT_READ : STATE_FAT_COMMIT_DIR_READ;
+    return false;
+  }
+
+  case STATE_FAT_COMMIT_FAT_READ: {
+    const uint32_t lba = fat_vol.fat_lba + fat_commit.fat_copy * fat_vol.fat_sectors + fat_commit.fat_sector;
+    if (sdcard_read_pages(blackbox_write_buffer, lba, 1)) {
+      fat32_set_chain(blackbox_write_buffer, fat_commit.fat_sector, fat_commit.cluster, fat_commit.clusters, fat_commit.allocate);
+      state = STATE_FAT_COMMIT_FAT_WRITE;
+    }
+    return false;
+  }
+
+  case STATE_FAT_COMMIT_FAT_WRITE: {
+    const uint32_t lba = fat_vol.fat_lba + fat_commit.fat_copy * fat_vol.fat_sectors + fat_commit.fat_sector;
+    if (!sdcard_write_page(blackbox_write_buffer, lba)) {
+      return false;
+    }
+
+    fat_commit.fat_sector++;
+    if (fat_commit.fat_sector > (fat_commit.cluster + fat_commit.clusters - 1) / FAT32_ENTRIES_PER_SECTOR) {
+      // chain is written, mirror it into the next fat copy
+      fat_commit.fat_copy++;
+      fat_commit.fat_sector = fat_commit.cluster / FAT32_ENTRIES_PER_SECTOR;
+    }
+    state = fat_commit.fat_copy == fat_vol.fat_count ? STATE_FAT_COMMIT_DIR_READ : STATE_FAT_COMMIT_FAT_READ;
+    return false;
+  }
+
+  case STATE_FAT_COMMIT_DIR_READ: {
+    if (sdcard_read_pages(blackbox_write_buffer, fat_commit.dir_lba, 1)) {
+      uint8_t *entry = blackbox_write_buffer + fat_commit.dir_index * sizeof(fat32_dir_entry_t);
+      if (fat_commit.allocate) {
+        memcpy(entry, &fat_commit.entry, sizeof(fat32_dir_entry_t));
+      } else {
+        entry[0] = FAT32_DIR_ENTRY_DELETED;
+      }
+      state = STATE_FAT_COMMIT_DIR_WRITE;
+    }
+    return false;
+  }
+
+  case STATE_FAT_COMMIT_DIR_WRITE: {
+    if (sdcard_write_page(blackbox_write_buffer, fat_commit.dir_lba)) {
+      state = STATE_FAT_COMMIT_FSINFO_READ;
+    }
+    return false;
+  }
+
+  case STATE_FAT_COMMIT_FSINFO_READ: {
+    if (sdcard_read_pages(blackbox_write_buffer, fat_vol.fsinfo_lba, 1)) {
+      fat32_update_fsinfo(blackbox_write_buffer, fat_run.start);
+      state = STATE_FAT_COMMIT_FSINFO_WRITE;
+    }
+    return false;
+  }
+
+  case STATE_FAT_COMMIT_FSINFO_WRITE: {
+    if (!sdcard_write_page(blackbox_write_buffer, fat_vol.fsinfo_lba)) {
+      return false;
+    }
+
+    if (fat_delete_num > 0) {
+      state = STATE_FAT_DELETE;
+    } else {
+      blackbox_device_sdcard_fat_scan();
+    }
+    return false;
+  }
+
   case STATE_IDLE:
+    if (to_write > 0 && blackbox_device_sdcard_full()) {
+      ring_buffer_clear(&blackbox_encode_buffer);
+      break;
+    }
     if (to_write >= PAGE_SIZE) {
       state = STATE_START_WRITE;
       goto sdcard_do_more;
@@ -82,50 +592,44 @@ sdcard_do_more:
       goto sdcard_do_more;
     }
     if (should_flush == 1) {
-      state = STATE_ERASE_HEADER;
       should_flush = 0;
+      if (fat_mode) {
+        blackbox_device_sdcard_fat_close();
+        break;
+      }
+      state = STATE_ERASE_HEADER;
       goto sdcard_do_more;
     }
     break;
 
   case STATE_START_WRITE: {
-    offset = (blackbox_current_file()->start + blackbox_current_file()->size) / PAGE_SIZE;
-    if (sdcard_write_pages_start(offset, FLUSH_INTERVAL)) {
-      state = STATE_FILL_WRITE_BUFFER;
+    const uint32_t offset = blackbox_device_sdcard_page(blackbox_current_file(), blackbox_current_file()->size);
+    if (sdcard_write_pages_start(offset, WRITE_PAGES)) {
+      pages = 0;
+      state = STATE_WRITE;
+      goto sdcard_do_more;
     }
     break;
   }
 
-  case STATE_FILL_WRITE_BUFFER: {
-    write_size = PAGE_SIZE;
-    if (to_write < PAGE_SIZE) {
-      if (should_flush == 0) {
-        break;
-      }
-      if (to_write == 0) {
+  case STATE_WRITE: {
+    blackbox_device_sdcard_stage();
+    if (write_size == 0) {
+      if (should_flush == 1) {
         state = STATE_FINISH_WRITE;
         goto sdcard_do_more;
       }
-
-      write_size = to_write;
+      // keep the write open until more data arrives
+      break;
     }
 
-    ring_buffer_read_multi(&blackbox_encode_buffer, blackbox_write_buffer, write_size);
-    state = STATE_CONTINUE_WRITE;
-    break;
-  }
-
-  case STATE_CONTINUE_WRITE: {
-    static uint32_t counter = 0;
     if (sdcard_write_pages_continue(blackbox_write_buffer)) {
       blackbox_current_file()->size += write_size;
+      write_size = 0;
 
-      counter++;
-      if (counter == FLUSH_INTERVAL) {
-        counter = 0;
+      pages++;
+      if (pages == WRITE_PAGES || blackbox_device_sdcard_full()) {
         state = STATE_FINISH_WRITE;
-      } else {
-        state = STATE_FILL_WRITE_BUFFER;
       }
     }
     break;
@@ -156,10 +660,26 @@ sdcard_do_more:
 }
 
 void blackbox_device_sdcard_reset() {
+  write_size = 0;
+  if (fat_mode) {
+    // delete our logs, everything else on the card is kept
+    fat_reset = true;
+    fat_delete_index = 0;
+    fat_delete_num = blackbox_device_header.file_num;
+    state = STATE_FAT_DELETE;
+    return;
+  }
   state = STATE_ERASE_HEADER;
 }
 
 uint32_t blackbox_device_sdcard_usage() {
+  if (fat_mode) {
+    uint32_t usage = 0;
+    for (uint8_t i = 0; i < blackbox_device_header.file_num; i++) {
+      usage += fat_files[i].size;
+    }
+    return usage;
+  }
   if (blackbox_device_header.file_num == 0) {
     return FILES_SECTOR_OFFSET * PAGE_SIZE;
   }
@@ -170,11 +690,48 @@ void blackbox_device_sdcard_stop() {
   should_flush = 1;
 }
 
+uint32_t blackbox_device_sdcard_alloc() {
+  if (!fat_mode) {
+    return MEMORY_ALIGN(blackbox_device_sdcard_usage(), PAGE_SIZE);
+  }
+
+  if (blackbox_device_header.file_num == BLACKBOX_DEVICE_MAX_FILES) {
+    // stop listing the oldest log, it stays on the card
+    blackbox_device_sdcard_fat_remove(0);
+  }
+  return fat32_cluster_lba(&fat_vol, fat_run.start) + FAT_META_PAGES;
+}
+
 void blackbox_device_sdcard_start() {
-  state = STATE_ERASE_HEADER;
+  write_size = 0;
+  if (!fat_mode) {
+    state = STATE_ERASE_HEADER;
+    return;
+  }
+
+  fat_open_file = blackbox_device_header.file_num - 1;
+
+  fat_file_t *file = &fat_files[fat_open_file];
+  file->number = fat_next_number++;
+  file->dir_lba = fat_free_dir_lba;
+  file->dir_index = fat_free_dir_index;
+  file->cluster = fat_run.start;
+  file->size = 0;
+
+  fat_meta_t meta = {
+      .magic = BLACKBOX_HEADER_MAGIC,
+      .file = *blackbox_current_file(),
+  };
+  memset(blackbox_write_buffer, 0, PAGE_SIZE);
+  memcpy(blackbox_write_buffer, &meta, sizeof(fat_meta_t));
+  state = STATE_FAT_WRITE_META;
 }
 
 bool blackbox_device_sdcard_ready() {
+  if (fat_mode && (fat_free_dir_lba == 0 || fat_run.count == 0)) {
+    // no directory slot or free clusters left
+    return false;
+  }
   return state == STATE_IDLE;
 }
 
@@ -189,7 +746,7 @@ void blackbox_device_sdcard_write(const uint8_t *buffer, const uint8_t size) {
 void blackbox_device_sdcard_read(const uint32_t file_index, const uint32_t offset, uint8_t *buffer, const uint32_t size) {
   const blackbox_device_file_t *file = &blackbox_device_header.files[file_index];
 
-  const uint32_t sector_offset = (file->start + offset) / PAGE_SIZE;
+  const uint32_t sector_offset = blackbox_device_sdcard_page(file, offset);
   const uint32_t sectors = size / PAGE_SIZE + (size % PAGE_SIZE ? 1 : 0);
 
   while (1) {
@@ -210,6 +767,7 @@ blackbox_device_vtable_t blackbox_device_sdcard = {
     .stop = blackbox_device_sdcard_stop,
 
     .usage = blackbox_device_sdcard_usage,
+    .alloc = blackbox_device_sdcard_alloc,
     .ready = blackbox_device_sdcard_ready,
 
     .read = blackbox_device_sdcard_read,
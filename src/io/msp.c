@@ -197,7 +197,7 @@ static void msp_process_serial_cmd(msp_t *msp, msp_magic_t magic, uint16_t cmd,
     break;
   }
   case MSP_MOTOR: {
-    // we always have 4 motors, but blheli expects 8
+    // blheli always expects 8 motors
     // these are pwm values
     uint16_t data[8];
     memset(data, 0, 8 * sizeof(uint16_t));
@@ -363,7 +363,7 @@ static void msp_process_serial_cmd(msp_t *msp, msp_magic_t magic, uint16_t cmd,
 #ifdef USE_MOTOR_DSHOT
     default:
     case MSP_PASSTHROUGH_ESC_4WAY: {
-      uint8_t data[1] = {MOTOR_PIN_MAX};
+      uint8_t data[1] = {motor_count()};
       msp_send_reply(msp, magic, cmd, data, 1);
 
       motor_test.active = 0;
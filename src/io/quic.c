@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "core/boot_profile.h"
 #include "core/debug.h"
 #include "core/flash.h"
 #include "core/profile.h"
@@ -13,6 +14,8 @@
 #include "driver/serial.h"
 #include "driver/serial_4way.h"
 #include "driver/serial_esc.h"
+#include "driver/spi.h"
+#include "driver/time.h"
 #include "driver/usb.h"
 #include "flight/control.h"
 #include "flight/sixaxis.h"
@@ -22,13 +25,35 @@
 #include "osd/render.h"
 #include "util/cbor_helper.h"
 
-#define ENCODE_BUFFER_SIZE 2048
+// responses larger than this are split into continuation frames
+#define ENCODE_BUFFER_SIZE 512
+
+#define TELEMETRY_RATE_MAX 1000
+// every sample is prefixed with the running count of dropped samples
+#define TELEMETRY_DROPPED_SIZE sizeof(uint32_t)
 
 #define quic_errorf(cmd, args...) quic_send_strf(quic, cmd, QUIC_FLAG_ERROR, args)
 
 static uint8_t frame_encode_buffer[ENCODE_BUFFER_SIZE + QUIC_HEADER_LEN];
 static uint8_t *encode_buffer = frame_encode_buffer + QUIC_HEADER_LEN;
 
+static struct {
+  quic_t *quic;
+  quic_command cmd;
+
+  // payload start of a frame encoded in place in the transport buffer
+  uint8_t *slot;
+} quic_stream;
+
+#ifdef USE_BLACKBOX
+static struct {
+  uint32_t field_flags;
+  uint32_t interval_us;
+  uint32_t next_us;
+  uint32_t dropped;
+} telemetry;
+#endif
+
 #define check_cbor_error(cmd)               \
   if (res < CBOR_OK) {                      \
     quic_errorf(cmd, "CBOR ERROR %d", res); \
@@ -49,11 +74,16 @@ static cbor_result_t cbor_encode_motor_test_t(cbor_value_t *enc, const motor_tes
   return res;
 }
 
+static void quic_encode_header(uint8_t *buf, quic_command cmd, quic_flag flag, uint32_t len) {
+  buf[0] = QUIC_MAGIC;
+  buf[1] = (cmd & (0xff >> 3)) | (flag & (0xff >> 5)) << 5;
+  buf[2] = (len >> 8) & 0xFF;
+  buf[3] = len & 0xFF;
+}
+
 static void quic_send_header(quic_t *quic, quic_command cmd, quic_flag flag, uint32_t len) {
-  frame_encode_buffer[0] = QUIC_MAGIC;
-  frame_encode_buffer[1] = (cmd & (0xff >> 3)) | (flag & (0xff >> 5)) << 5;
-  frame_encode_buffer[2] = (len >> 8) & 0xFF;
-  frame_encode_buffer[3] = len & 0xFF;
+  quic_stream.slot = NULL;
+  quic_encode_header(frame_encode_buffer, cmd, flag, len);
 
   if (quic->send) {
     quic->send(frame_encode_buffer, QUIC_HEADER_LEN, quic->priv_data);
@@ -61,10 +91,17 @@ static void quic_send_header(quic_t *quic, quic_command cmd, quic_flag flag, uin
 }
 
 static void quic_send(quic_t *quic, quic_command cmd, quic_flag flag, uint8_t *data, uint32_t len) {
-  frame_encode_buffer[0] = QUIC_MAGIC;
-  frame_encode_buffer[1] = (cmd & (0xff >> 3)) | (flag & (0xff >> 5)) << 5;
-  frame_encode_buffer[2] = (len >> 8) & 0xFF;
-  frame_encode_buffer[3] = len & 0xFF;
+  if (quic_stream.slot != NULL && quic_stream.slot == data) {
+    quic_encode_header(data - QUIC_HEADER_LEN, cmd, flag, len);
+    quic->commit(QUIC_HEADER_LEN + len, quic->priv_data);
+    quic_stream.slot = NULL;
+    return;
+  }
+
+  // any other write lands on top of a pending slot
+  quic_stream.slot = NULL;
+
+  quic_encode_header(frame_encode_buffer, cmd, flag, len);
 
   if ((frame_encode_buffer + QUIC_HEADER_LEN) != data) {
     memcpy(frame_encode_buffer + QUIC_HEADER_LEN, data, len);
@@ -75,6 +112,40 @@ static void quic_send(quic_t *quic, quic_command cmd, quic_flag flag, uint8_t *d
   }
 }
 
+// encodes straight into the transport when it has a whole frame of contiguous space
+static void quic_encoder_target(quic_t *quic, cbor_value_t *enc) {
+  uint8_t *data = NULL;
+  if (quic->reserve != NULL && quic->reserve(&data, quic->priv_data) >= (QUIC_HEADER_LEN + ENCODE_BUFFER_SIZE)) {
+    quic_stream.slot = data + QUIC_HEADER_LEN;
+  } else {
+    quic_stream.slot = NULL;
+  }
+
+  enc->start = quic_stream.slot != NULL ? quic_stream.slot : encode_buffer;
+  enc->end = enc->start + ENCODE_BUFFER_SIZE;
+}
+
+static void quic_send_continuation(const uint8_t *data, uint32_t len, void *priv) {
+  quic_send(quic_stream.quic, quic_stream.cmd, QUIC_FLAG_CONTINUATION, (uint8_t *)data, len);
+  quic_encoder_target(quic_stream.quic, (cbor_value_t *)priv);
+}
+
+// full buffers are flushed as continuation frames, the final quic_send_encoded carries the remainder.
+// nothing else may write to the transport until then, it would land on top of the slot
+static void quic_encoder_init(quic_t *quic, cbor_value_t *enc, quic_command cmd) {
+  quic_stream.quic = quic;
+  quic_stream.cmd = cmd;
+
+  cbor_encoder_init(enc, encode_buffer, ENCODE_BUFFER_SIZE);
+  cbor_encoder_set_flush(enc, quic_send_continuation, enc);
+  quic_encoder_target(quic, enc);
+  enc->curr = enc->start;
+}
+
+static void quic_send_encoded(quic_t *quic, quic_command cmd, quic_flag flag, cbor_value_t *enc) {
+  quic_send(quic, cmd, flag, enc->start, cbor_encoder_len(enc));
+}
+
 cbor_result_t quic_send_str(quic_t *quic, quic_command cmd, quic_flag flag, const char *str) {
   const uint32_t size = strlen(str) + 128;
   uint8_t buffer[size];
@@ -103,11 +174,19 @@ static cbor_result_t quic_send_strf(quic_t *quic, quic_command cmd, quic_flag fl
   return quic_send_str(quic, cmd, flag, str);
 }
 
+// requests for config structs may append encoder flags, eg CBOR_FLAG_INT_KEYS
+static void quic_decode_encoder_flags(cbor_value_t *dec, cbor_value_t *enc) {
+  uint32_t flags = 0;
+  if (cbor_decode_uint32_t(dec, &flags) >= CBOR_OK) {
+    enc->flags = flags & CBOR_FLAG_INT_KEYS;
+  }
+}
+
 static void get_quic(quic_t *quic, cbor_value_t *dec) {
   cbor_result_t res = CBOR_OK;
 
   cbor_value_t enc;
-  cbor_encoder_init(&enc, encode_buffer, ENCODE_BUFFER_SIZE);
+  quic_encoder_init(quic, &enc, QUIC_CMD_GET);
 
   quic_values value = QUIC_CMD_INVALID;
   res = cbor_decode_uint8_t(dec, &value);
@@ -118,30 +197,34 @@ static void get_quic(quic_t *quic, cbor_value_t *dec) {
 
   switch (value) {
   case QUIC_VAL_PROFILE: {
+    quic_decode_encoder_flags(dec, &enc);
+
     res = cbor_encode_profile_t(&enc, &profile);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   }
   case QUIC_VAL_DEFAULT_PROFILE: {
+    quic_decode_encoder_flags(dec, &enc);
+
     res = cbor_encode_profile_t(&enc, &default_profile);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   }
   case QUIC_VAL_INFO:
     res = cbor_encode_target_info_t(&enc, &target_info);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   case QUIC_VAL_STATE:
     res = cbor_encode_control_state_t(&enc, &state);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   case QUIC_VAL_PID_RATE_PRESETS:
     res = cbor_encode_array(&enc, pid_rate_presets_count);
@@ -151,19 +234,19 @@ static void get_quic(quic_t *quic, cbor_value_t *dec) {
       check_cbor_error(QUIC_CMD_GET);
     }
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
 #ifdef USE_VTX
   case QUIC_VAL_VTX_SETTINGS:
     res = cbor_encode_vtx_settings_t(&enc, &vtx_settings);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
 #endif
 #ifdef USE_MOTOR_DSHOT
   case QUIC_VAL_BLHEL_SETTINGS: {
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_STREAMING, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_STREAMING, &enc);
 
     const uint8_t count = serial_4way_init();
     time_delay_ms(500);
@@ -175,11 +258,11 @@ static void get_quic(quic_t *quic, cbor_value_t *dec) {
         continue;
       }
 
-      cbor_encoder_init(&enc, encode_buffer, ENCODE_BUFFER_SIZE);
+      quic_encoder_init(quic, &enc, QUIC_CMD_GET);
       res = cbor_encode_blheli_settings_t(&enc, &settings);
       check_cbor_error(QUIC_CMD_GET);
 
-      quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_STREAMING, encode_buffer, cbor_encoder_len(&enc));
+      quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_STREAMING, &enc);
     }
 
     serial_4way_release();
@@ -192,14 +275,14 @@ static void get_quic(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_rx_bind_storage_t(&enc, &bind_storage);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   }
 #ifdef DEBUG
   case QUIC_VAL_PERF_COUNTERS: {
     res = cbor_encode_task_stats(&enc);
     check_cbor_error(QUIC_CMD_GET);
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   }
 #endif
@@ -211,14 +294,64 @@ static void get_quic(quic_t *quic, cbor_value_t *dec) {
       check_cbor_error(QUIC_CMD_GET);
     }
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   }
   case QUIC_VAL_TARGET: {
+    quic_decode_encoder_flags(dec, &enc);
+
     res = cbor_encode_target_t(&enc, &target);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
+    break;
+  }
+  case QUIC_VAL_PROFILE_CHANGES: {
+    uint32_t since = 0;
+    res = cbor_decode_uint32_t(dec, &since);
+    check_cbor_error(QUIC_CMD_GET);
+
+    // older hosts only send the generation
+    uint32_t session = 0;
+    if (dec->curr < dec->end) {
+      res = cbor_decode_uint32_t(dec, &session);
+      check_cbor_error(QUIC_CMD_GET);
+    }
+
+    res = cbor_encode_profile_changes(&enc, session, since);
+    check_cbor_error(QUIC_CMD_GET);
+
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
+    break;
+  }
+  case QUIC_VAL_KEY_TABLE: {
+    res = cbor_encode_map_indefinite(&enc);
+    check_cbor_error(QUIC_CMD_GET);
+
+    res = cbor_encode_profile_key_tables(&enc);
+    check_cbor_error(QUIC_CMD_GET);
+
+    res = cbor_encode_target_key_tables(&enc);
+    check_cbor_error(QUIC_CMD_GET);
+
+    res = cbor_encode_end_indefinite(&enc);
+    check_cbor_error(QUIC_CMD_GET);
+
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
+    break;
+  }
+  case QUIC_VAL_BOOT_PROFILE: {
+    res = cbor_encode_boot_profile(&enc);
+    check_cbor_error(QUIC_CMD_GET);
+
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
+    break;
+  }
+  case QUIC_VAL_SPI_STATS: {
+    res = cbor_encode_spi_lane_stats(&enc);
+    check_cbor_error(QUIC_CMD_GET);
+
+    quic_send_encoded(quic, QUIC_CMD_GET, QUIC_FLAG_NONE, &enc);
     break;
   }
   default:
@@ -231,7 +364,7 @@ static void set_quic(quic_t *quic, cbor_value_t *dec) {
   cbor_result_t res = CBOR_OK;
 
   cbor_value_t enc;
-  cbor_encoder_init(&enc, encode_buffer, ENCODE_BUFFER_SIZE);
+  quic_encoder_init(quic, &enc, QUIC_CMD_SET);
 
   quic_values value;
   res = cbor_decode_uint8_t(dec, &value);
@@ -253,7 +386,24 @@ static void set_quic(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_profile_t(&enc, &profile);
     check_cbor_error(QUIC_CMD_SET);
 
-    quic_send(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, &enc);
+    break;
+  }
+  case QUIC_VAL_PROFILE_PATCH: {
+    res = profile_patch(dec);
+    check_cbor_error(QUIC_CMD_SET);
+
+    flash_save();
+
+    osd_clear();
+    osd_display_reset();
+
+    // only the new generation is echoed, GET QUIC_VAL_PROFILE_CHANGES returns the values
+    const uint32_t generation = profile_update_generation();
+    res = cbor_encode_uint32_t(&enc, &generation);
+    check_cbor_error(QUIC_CMD_SET);
+
+    quic_send_encoded(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, &enc);
     break;
   }
 #ifdef USE_VTX
@@ -269,7 +419,7 @@ static void set_quic(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_vtx_settings_t(&enc, &vtx_settings);
     check_cbor_error(QUIC_CMD_SET);
 
-    quic_send(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, &enc);
     break;
   }
 #endif
@@ -295,7 +445,7 @@ static void set_quic(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_str(&enc, "OK");
     check_cbor_error(QUIC_CMD_SET);
 
-    quic_send(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, &enc);
     break;
   }
 #endif
@@ -309,7 +459,7 @@ static void set_quic(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_rx_bind_storage_t(&enc, &bind_storage);
     check_cbor_error(QUIC_CMD_SET);
 
-    quic_send(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, &enc);
     break;
   }
   case QUIC_VAL_TARGET: {
@@ -322,7 +472,7 @@ static void set_quic(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_target_t(&enc, &target);
     check_cbor_error(QUIC_CMD_SET);
 
-    quic_send(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_SET, QUIC_FLAG_NONE, &enc);
     break;
   }
   default:
@@ -331,11 +481,45 @@ static void set_quic(quic_t *quic, cbor_value_t *dec) {
   }
 }
 
+#ifdef USE_BLACKBOX
+// reads pages straight into the transport buffer, the copying path is only taken when it cannot fit one
+static void quic_stream_blackbox(quic_t *quic, const uint8_t file_index, uint32_t offset, const uint32_t end) {
+  const uint32_t page_size = blackbox_bounds.page_size;
+  const uint32_t max_frame = (0xFFFF / page_size) * page_size;
+
+  while (offset < end) {
+    uint8_t *data = NULL;
+    const uint32_t space = quic->reserve != NULL ? quic->reserve(&data, quic->priv_data) : 0;
+
+    // devices always read whole pages, they have to fit the reserved space
+    uint32_t pages_size = 0;
+    if (space > QUIC_HEADER_LEN) {
+      pages_size = min((space - QUIC_HEADER_LEN) / page_size * page_size, max_frame);
+    }
+
+    if (pages_size == 0) {
+      // buffer is full or about to wrap, a blocking send waits for the transport
+      const uint32_t size = min(end - offset, page_size);
+      blackbox_device_read(file_index, offset, encode_buffer, size);
+      quic_send(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_STREAMING, encode_buffer, size);
+      offset += size;
+      continue;
+    }
+
+    const uint32_t size = min(end - offset, pages_size);
+    quic_encode_header(data, QUIC_CMD_BLACKBOX, QUIC_FLAG_STREAMING, size);
+    blackbox_device_read(file_index, offset, data + QUIC_HEADER_LEN, size);
+    quic->commit(QUIC_HEADER_LEN + size, quic->priv_data);
+    offset += size;
+  }
+}
+#endif
+
 static void process_blackbox(quic_t *quic, cbor_value_t *dec) {
   cbor_result_t res = CBOR_OK;
 
   cbor_value_t enc;
-  cbor_encoder_init(&enc, encode_buffer, ENCODE_BUFFER_SIZE);
+  quic_encoder_init(quic, &enc, QUIC_CMD_BLACKBOX);
 
   quic_blackbox_command cmd;
   res = cbor_decode_uint8_t(dec, &cmd);
@@ -375,7 +559,7 @@ static void process_blackbox(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_end_indefinite(&enc);
     check_cbor_error(QUIC_CMD_BLACKBOX);
 
-    quic_send(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_NONE, &enc);
     break;
   case QUIC_BLACKBOX_GET: {
     extern blackbox_device_header_t blackbox_device_header;
@@ -384,7 +568,7 @@ static void process_blackbox(quic_t *quic, cbor_value_t *dec) {
     res = cbor_decode_uint8_t(dec, &file_index);
     check_cbor_error(QUIC_CMD_BLACKBOX);
 
-    quic_send(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_STREAMING, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_STREAMING, &enc);
 
     if (blackbox_device_header.file_num > file_index) {
       const blackbox_device_file_t *file = &blackbox_device_header.files[file_index];
@@ -403,6 +587,50 @@ static void process_blackbox(quic_t *quic, cbor_value_t *dec) {
     quic_send_header(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_STREAMING, 0);
     break;
   }
+  case QUIC_BLACKBOX_STREAM: {
+    uint8_t file_index;
+    res = cbor_decode_uint8_t(dec, &file_index);
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+
+    uint32_t offset;
+    res = cbor_decode_uint32_t(dec, &offset);
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+
+    uint32_t size;
+    res = cbor_decode_uint32_t(dec, &size);
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+
+    if (file_index >= blackbox_device_header.file_num) {
+      quic_errorf(QUIC_CMD_BLACKBOX, "INVALID FILE %d", file_index);
+      break;
+    }
+
+    // resume from the start of the page holding offset, the host skips what it already has
+    const blackbox_device_file_t *file = &blackbox_device_header.files[file_index];
+    offset = min(offset - offset % blackbox_bounds.page_size, file->size);
+    size = min(size, file->size - offset);
+
+    res = cbor_encode_map_indefinite(&enc);
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+
+    res = cbor_encode_str(&enc, "offset");
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+    res = cbor_encode_uint32_t(&enc, &offset);
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+
+    res = cbor_encode_str(&enc, "size");
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+    res = cbor_encode_uint32_t(&enc, &size);
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+
+    res = cbor_encode_end_indefinite(&enc);
+    check_cbor_error(QUIC_CMD_BLACKBOX);
+
+    quic_send_encoded(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_STREAMING, &enc);
+    quic_stream_blackbox(quic, file_index, offset, offset + size);
+    quic_send_header(quic, QUIC_CMD_BLACKBOX, QUIC_FLAG_STREAMING, 0);
+    break;
+  }
 #endif
   default:
     quic_errorf(QUIC_CMD_BLACKBOX, "INVALID CMD %d", cmd);
@@ -414,7 +642,7 @@ static void process_motor_test(quic_t *quic, cbor_value_t *dec) {
   cbor_result_t res = CBOR_OK;
 
   cbor_value_t enc;
-  cbor_encoder_init(&enc, encode_buffer, ENCODE_BUFFER_SIZE);
+  quic_encoder_init(quic, &enc, QUIC_CMD_MOTOR);
 
   quic_motor_command cmd;
   res = cbor_decode_uint8_t(dec, &cmd);
@@ -425,7 +653,7 @@ static void process_motor_test(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_motor_test_t(&enc, &motor_test);
     check_cbor_error(QUIC_CMD_MOTOR);
 
-    quic_send(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, &enc);
     break;
 
   case QUIC_MOTOR_TEST_ENABLE:
@@ -437,7 +665,7 @@ static void process_motor_test(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_uint8_t(&enc, &motor_test.active);
     check_cbor_error(QUIC_CMD_MOTOR);
 
-    quic_send(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, &enc);
     break;
 
   case QUIC_MOTOR_TEST_DISABLE:
@@ -449,16 +677,24 @@ static void process_motor_test(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_uint8_t(&enc, &motor_test.active);
     check_cbor_error(QUIC_CMD_MOTOR);
 
-    quic_send(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, &enc);
     break;
 
   case QUIC_MOTOR_TEST_SET_VALUE: {
-    float values[MOTOR_PIN_MAX];
-    res = cbor_decode_float_array(dec, values, MOTOR_PIN_MAX);
+    cbor_container_t array;
+    res = cbor_decode_array(dec, &array);
     check_cbor_error(QUIC_CMD_MOTOR);
 
-    for (uint8_t i = 0; i < MOTOR_PIN_MAX; i++) {
-      const float val = constrain(values[i], 0.0f, 1.0f);
+    // older hosts send four values, motors they do not know about stay off
+    const uint32_t count = min(cbor_decode_array_size(dec, &array), motor_count());
+    for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+      float val = 0.0f;
+      if (i < count) {
+        res = cbor_decode_float(dec, &val);
+        check_cbor_error(QUIC_CMD_MOTOR);
+      }
+
+      val = constrain(val, 0.0f, 1.0f);
       if (val == 0.0f) {
         motor_test.value[i] = MOTOR_OFF;
       } else {
@@ -469,7 +705,35 @@ static void process_motor_test(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_float_array(&enc, motor_test.value, MOTOR_PIN_MAX);
     check_cbor_error(QUIC_CMD_MOTOR);
 
-    quic_send(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, &enc);
+    break;
+  }
+  case QUIC_MOTOR_ESC_COMMAND: {
+    uint8_t command = 0;
+    res = cbor_decode_uint8_t(dec, &command);
+    check_cbor_error(QUIC_CMD_MOTOR);
+
+    switch (motor_esc_command(command)) {
+    case MOTOR_ESC_COMMAND_OK:
+      break;
+    case MOTOR_ESC_COMMAND_UNSUPPORTED:
+      quic_errorf(QUIC_CMD_MOTOR, "ESC COMMANDS UNSUPPORTED");
+      return;
+    case MOTOR_ESC_COMMAND_INVALID:
+      quic_errorf(QUIC_CMD_MOTOR, "INVALID ESC COMMAND %d", command);
+      return;
+    case MOTOR_ESC_COMMAND_ARMED:
+      quic_errorf(QUIC_CMD_MOTOR, "ESC COMMAND WHILE ARMED");
+      return;
+    case MOTOR_ESC_COMMAND_QUEUE_FULL:
+      quic_errorf(QUIC_CMD_MOTOR, "ESC COMMAND QUEUE FULL");
+      return;
+    }
+
+    res = cbor_encode_uint8_t(&enc, &command);
+    check_cbor_error(QUIC_CMD_MOTOR);
+
+    quic_send_encoded(quic, QUIC_CMD_MOTOR, QUIC_FLAG_NONE, &enc);
     break;
   }
 #ifdef USE_MOTOR_DSHOT
@@ -479,7 +743,7 @@ static void process_motor_test(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_uint8_t(&enc, &count);
     check_cbor_error(QUIC_CMD_MOTOR);
 
-    quic_send(quic, QUIC_CMD_MOTOR, QUIC_FLAG_EXIT, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_MOTOR, QUIC_FLAG_EXIT, &enc);
 
     serial_4way_process();
     break;
@@ -501,7 +765,7 @@ static void process_motor_test(quic_t *quic, cbor_value_t *dec) {
     res = cbor_decode_uint32_t(dec, &baud);
     check_cbor_error(QUIC_CMD_MOTOR);
 
-    quic_send(quic, QUIC_CMD_MOTOR, QUIC_FLAG_EXIT, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_MOTOR, QUIC_FLAG_EXIT, &enc);
 
     serial_esc_process(index, baud);
     break;
@@ -517,7 +781,7 @@ static void process_osd(quic_t *quic, cbor_value_t *dec) {
   cbor_result_t res = CBOR_OK;
 
   cbor_value_t enc;
-  cbor_encoder_init(&enc, encode_buffer, ENCODE_BUFFER_SIZE);
+  quic_encoder_init(quic, &enc, QUIC_CMD_OSD);
 
   quic_osd_command cmd;
   res = cbor_decode_uint8_t(dec, &cmd);
@@ -535,7 +799,7 @@ static void process_osd(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_bstr(&enc, font, 54);
     check_cbor_error(QUIC_CMD_GET);
 
-    quic_send(quic, QUIC_CMD_OSD, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_OSD, QUIC_FLAG_NONE, &enc);
 
     osd_clear();
     osd_display_reset();
@@ -552,7 +816,7 @@ static void process_osd(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_str(&enc, "OK");
     check_cbor_error(QUIC_CMD_SET);
 
-    quic_send(quic, QUIC_CMD_OSD, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_OSD, QUIC_FLAG_NONE, &enc);
 
     osd_clear();
     osd_display_reset();
@@ -569,7 +833,7 @@ static void process_serial(quic_t *quic, cbor_value_t *dec) {
   cbor_result_t res = CBOR_OK;
 
   cbor_value_t enc;
-  cbor_encoder_init(&enc, encode_buffer, ENCODE_BUFFER_SIZE);
+  quic_encoder_init(quic, &enc, QUIC_CMD_SERIAL);
 
   quic_motor_command cmd;
   res = cbor_decode_uint8_t(dec, &cmd);
@@ -594,7 +858,7 @@ static void process_serial(quic_t *quic, cbor_value_t *dec) {
     res = cbor_encode_uint8_t(&enc, &port);
     check_cbor_error(QUIC_CMD_SERIAL);
 
-    quic_send(quic, QUIC_CMD_SERIAL, QUIC_FLAG_NONE, encode_buffer, cbor_encoder_len(&enc));
+    quic_send_encoded(quic, QUIC_CMD_SERIAL, QUIC_FLAG_NONE, &enc);
 
     usb_serial_passthrough(port, baudrate, stop_bits, half_duplex);
     break;
@@ -606,6 +870,116 @@ static void process_serial(quic_t *quic, cbor_value_t *dec) {
   }
 }
 
+static void process_telemetry(quic_t *quic, cbor_value_t *dec) {
+#ifdef USE_BLACKBOX
+  cbor_result_t res = CBOR_OK;
+
+  uint32_t field_flags = 0;
+  res = cbor_decode_uint32_t(dec, &field_flags);
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+
+  uint32_t rate_hz = 0;
+  res = cbor_decode_uint32_t(dec, &rate_hz);
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+
+  // a zero rate or empty mask unsubscribes
+  field_flags &= (1 << BBOX_FIELD_MAX) - 1;
+  rate_hz = min(rate_hz, TELEMETRY_RATE_MAX);
+  if (field_flags == 0 || rate_hz == 0) {
+    field_flags = 0;
+    rate_hz = 0;
+  }
+
+  telemetry.field_flags = field_flags;
+  telemetry.interval_us = rate_hz ? 1000000 / rate_hz : 0;
+  telemetry.next_us = time_micros();
+  telemetry.dropped = 0;
+
+  cbor_value_t enc;
+  quic_encoder_init(quic, &enc, QUIC_CMD_TELEMETRY);
+
+  res = cbor_encode_map_indefinite(&enc);
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+
+  res = cbor_encode_str(&enc, "field_flags");
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+  res = cbor_encode_uint32_t(&enc, &field_flags);
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+
+  res = cbor_encode_str(&enc, "rate_hz");
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+  res = cbor_encode_uint32_t(&enc, &rate_hz);
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+
+  const uint32_t size = TELEMETRY_DROPPED_SIZE + blackbox_raw_size(field_flags);
+  res = cbor_encode_str(&enc, "size");
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+  res = cbor_encode_uint32_t(&enc, &size);
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+
+  res = cbor_encode_end_indefinite(&enc);
+  check_cbor_error(QUIC_CMD_TELEMETRY);
+
+  quic_send_encoded(quic, QUIC_CMD_TELEMETRY, QUIC_FLAG_NONE, &enc);
+#else
+  quic_errorf(QUIC_CMD_TELEMETRY, "TELEMETRY UNSUPPORTED");
+#endif
+}
+
+// pushes at most one raw sample per call, samples are dropped rather than waiting on the transport.
+// the dropped count goes out with every sample so the host can tell gaps from a quiet quad
+void quic_telemetry_update(quic_t *quic) {
+#ifdef USE_BLACKBOX
+  if (telemetry.interval_us == 0) {
+    return;
+  }
+
+  const uint32_t now = time_micros();
+  if ((int32_t)(now - telemetry.next_us) < 0) {
+    return;
+  }
+
+  telemetry.next_us += telemetry.interval_us;
+  if ((int32_t)(now - telemetry.next_us) >= 0) {
+    // fell behind, skip the missed samples instead of bursting them out
+    telemetry.dropped += (now - telemetry.next_us) / telemetry.interval_us + 1;
+    telemetry.next_us = now + telemetry.interval_us;
+  }
+
+  const uint32_t len = QUIC_HEADER_LEN + TELEMETRY_DROPPED_SIZE + blackbox_raw_size(telemetry.field_flags);
+
+  uint8_t *frame = frame_encode_buffer;
+  if (quic->reserve != NULL) {
+    if (quic->reserve(&frame, quic->priv_data) < len) {
+      telemetry.dropped++;
+      return;
+    }
+  }
+
+  blackbox_t sample;
+  sample.loop = state.loop_counter;
+  sample.time = now;
+  blackbox_sample(&sample);
+
+  quic_encode_header(frame, QUIC_CMD_TELEMETRY, QUIC_FLAG_STREAMING, len - QUIC_HEADER_LEN);
+  memcpy(frame + QUIC_HEADER_LEN, &telemetry.dropped, TELEMETRY_DROPPED_SIZE);
+  blackbox_encode_raw(frame + QUIC_HEADER_LEN + TELEMETRY_DROPPED_SIZE, &sample, telemetry.field_flags);
+
+  if (quic->reserve != NULL) {
+    quic->commit(len, quic->priv_data);
+  } else if (quic->send) {
+    quic->send(frame, len, quic->priv_data);
+  }
+#endif
+}
+
+void quic_telemetry_stop() {
+#ifdef USE_BLACKBOX
+  telemetry.field_flags = 0;
+  telemetry.interval_us = 0;
+#endif
+}
+
 bool quic_process(quic_t *quic, uint8_t *data, uint32_t size) {
   if (size < 4) {
     return false;
@@ -662,6 +1036,9 @@ bool quic_process(quic_t *quic, uint8_t *data, uint32_t size) {
   case QUIC_CMD_SERIAL:
     process_serial(quic, &dec);
     break;
+  case QUIC_CMD_TELEMETRY:
+    process_telemetry(quic, &dec);
+    break;
   default:
     quic_errorf(QUIC_CMD_INVALID, "INVALID CMD %d", cmd);
     break;
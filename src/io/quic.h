@@ -8,7 +8,7 @@
 #define QUIC_MAGIC '#'
 #define QUIC_HEADER_LEN 4
 
-#define QUIC_PROTOCOL_VERSION MAKE_SEMVER(0, 2, 5)
+#define QUIC_PROTOCOL_VERSION MAKE_SEMVER(0, 2, 16)
 
 typedef enum {
   QUIC_CMD_INVALID,
@@ -21,12 +21,14 @@ typedef enum {
   QUIC_CMD_CAL_STICKS,
   QUIC_CMD_SERIAL,
   QUIC_CMD_OSD,
+  QUIC_CMD_TELEMETRY,
 } __attribute__((__packed__)) quic_command;
 
 typedef enum {
   QUIC_BLACKBOX_RESET,
   QUIC_BLACKBOX_LIST,
-  QUIC_BLACKBOX_GET
+  QUIC_BLACKBOX_GET,
+  QUIC_BLACKBOX_STREAM,
 } __attribute__((__packed__)) quic_blackbox_command;
 
 typedef enum {
@@ -36,6 +38,7 @@ typedef enum {
   QUIC_MOTOR_TEST_SET_VALUE,
   QUIC_MOTOR_ESC4WAY_IF,
   QUIC_MOTOR_SERIAL,
+  QUIC_MOTOR_ESC_COMMAND,
 } __attribute__((__packed__)) quic_motor_command;
 
 typedef enum {
@@ -52,6 +55,8 @@ typedef enum {
   QUIC_FLAG_ERROR,
   QUIC_FLAG_STREAMING,
   QUIC_FLAG_EXIT,
+  // payload continues in the next frame of the same command
+  QUIC_FLAG_CONTINUATION,
 } __attribute__((__packed__)) quic_flag;
 
 typedef enum {
@@ -68,15 +73,29 @@ typedef enum {
   QUIC_VAL_PERF_COUNTERS,
   QUIC_VAL_BLACKBOX_PRESETS,
   QUIC_VAL_TARGET,
+  QUIC_VAL_PROFILE_PATCH,
+  QUIC_VAL_PROFILE_CHANGES,
+  QUIC_VAL_KEY_TABLE,
+  QUIC_VAL_BOOT_PROFILE,
+  QUIC_VAL_SPI_STATS,
 } __attribute__((__packed__)) quic_values;
 
 typedef void (*quic_send_fn_t)(uint8_t *data, uint32_t len, void *priv);
+typedef uint32_t (*quic_reserve_fn_t)(uint8_t **data, void *priv);
+typedef void (*quic_commit_fn_t)(uint32_t len, void *priv);
 
 typedef struct {
   void *priv_data;
   quic_send_fn_t send;
+
+  // optional, lets bulk transfers encode straight into the transport buffer
+  quic_reserve_fn_t reserve;
+  quic_commit_fn_t commit;
 } quic_t;
 
 cbor_result_t quic_send_str(quic_t *quic, quic_command cmd, quic_flag flag, const char *str);
 
-bool quic_process(quic_t *quic, uint8_t *data, uint32_t size);
\ No newline at end of file
+bool quic_process(quic_t *quic, uint8_t *data, uint32_t size);
+
+void quic_telemetry_update(quic_t *quic);
+void quic_telemetry_stop();
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "driver/motor.h"
 #include "flight/control.h"
 
 typedef struct {
@@ -28,6 +29,10 @@ typedef struct {
   pthread_mutex_t mutex;
   simulation_state_t state;
   uint8_t osd[50 * 18];
+
+  // appended behind the osd, a quad only simulator never reads past it
+  uint8_t motor_count;
+  float motors_ext[MOTOR_PIN_MAX - 4];
 } shared_memory_t;
 
 float simulator_motor_values[MOTOR_PIN_MAX];
@@ -104,10 +109,13 @@ void simulator_update() {
   state.accel_raw.axis[1] = -(shared->state.accel[0] / 9.817);
   state.accel_raw.axis[2] = -(shared->state.accel[1] / 9.817);
 
-  shared->state.motors[0] = simulator_motor_values[0],
-  shared->state.motors[1] = simulator_motor_values[1],
-  shared->state.motors[2] = simulator_motor_values[2],
-  shared->state.motors[3] = simulator_motor_values[3],
+  for (uint32_t i = 0; i < 4; i++) {
+    shared->state.motors[i] = simulator_motor_values[i];
+  }
+  for (uint32_t i = 4; i < MOTOR_PIN_MAX; i++) {
+    shared->motors_ext[i - 4] = simulator_motor_values[i];
+  }
+  shared->motor_count = motor_count();
 
   memcpy(shared->osd, osd, sizeof(osd));
 
@@ -24,6 +24,24 @@
 #define MAX_USB_MSP_FRAME_SIZE 1024
 
 
+// builds the frame straight in the tx buffer, frames that would wrap it are written piecewise
+static void usb_msp_write_frame(const uint8_t *header, const uint32_t header_len, const uint8_t *data, const uint16_t len, uint8_t crc) {
+  const uint32_t size = header_len + len + 1;
+
+  uint8_t *frame = NULL;
+  if (usb_serial_write_reserve(&frame) >= size) {
+    memcpy(frame, header, header_len);
+    memcpy(frame + header_len, data, len);
+    frame[size - 1] = crc;
+    usb_serial_write_commit(size);
+    return;
+  }
+
+  usb_serial_write((uint8_t *)header, header_len);
+  usb_serial_write((uint8_t *)data, len);
+  usb_serial_write(&crc, 1);
+}
+
 void usb_msp_send(msp_magic_t magic, uint8_t direction, uint16_t cmd, const uint8_t *data, uint16_t len) {
 
   if (magic == MSP2_MAGIC) {
@@ -32,42 +50,38 @@ void usb_msp_send(msp_magic_t magic, uint8_t direction, uint16_t cmd, const uint
       return; // Frame too large
     }
 
-    uint8_t frame[MAX_USB_MSP_FRAME_SIZE];
-    frame[0] = '$';
-    frame[1] = MSP2_MAGIC;
-    frame[2] = '>';
-    frame[3] = 0; // flag
-    frame[4] = (cmd >> 0) & 0xFF;
-    frame[5] = (cmd >> 8) & 0xFF;
-    frame[6] = (len >> 0) & 0xFF;
-    frame[7] = (len >> 8) & 0xFF;
-
-    memcpy(frame + MSP2_HEADER_LEN, data, len);
-    frame[len + MSP2_HEADER_LEN] = crc8_dvb_s2_data(0, frame + 3, len + 5);
+    const uint8_t header[MSP2_HEADER_LEN] = {
+        '$',
+        MSP2_MAGIC,
+        '>',
+        0, // flag
+        (cmd >> 0) & 0xFF,
+        (cmd >> 8) & 0xFF,
+        (len >> 0) & 0xFF,
+        (len >> 8) & 0xFF,
+    };
 
-    usb_serial_write(frame, size);
+    const uint8_t crc = crc8_dvb_s2_data(crc8_dvb_s2_data(0, header + 3, 5), data, len);
+    usb_msp_write_frame(header, MSP2_HEADER_LEN, data, len, crc);
   } else {
     const uint16_t size = len + MSP_HEADER_LEN + 1;
     if (size > MAX_USB_MSP_FRAME_SIZE || len > (MAX_USB_MSP_FRAME_SIZE - MSP_HEADER_LEN - 1)) {
       return; // Frame too large
     }
 
-    uint8_t frame[MAX_USB_MSP_FRAME_SIZE];
-    frame[0] = '$';
-    frame[1] = MSP1_MAGIC;
-    frame[2] = '>';
-    frame[3] = len;
-    frame[4] = cmd;
-
-    memcpy(frame + MSP_HEADER_LEN, data, len);
+    const uint8_t header[MSP_HEADER_LEN] = {
+        '$',
+        MSP1_MAGIC,
+        '>',
+        len,
+        cmd,
+    };
 
-    uint8_t chksum = len;
-    for (uint8_t i = 4; i < (size - 1); i++) {
-      chksum ^= frame[i];
+    uint8_t chksum = len ^ cmd;
+    for (uint16_t i = 0; i < len; i++) {
+      chksum ^= data[i];
     }
-    frame[len + MSP_HEADER_LEN] = chksum;
-
-    usb_serial_write(frame, size);
+    usb_msp_write_frame(header, MSP_HEADER_LEN, data, len, chksum);
   }
 }
 
@@ -75,8 +89,18 @@ void usb_quic_send(uint8_t *data, uint32_t len, void *priv) {
   usb_serial_write(data, len);
 }
 
+static uint32_t usb_quic_reserve(uint8_t **data, void *priv) {
+  return usb_serial_write_reserve(data);
+}
+
+static void usb_quic_commit(uint32_t len, void *priv) {
+  usb_serial_write_commit(len);
+}
+
 static quic_t quic = {
     .send = usb_quic_send,
+    .reserve = usb_quic_reserve,
+    .commit = usb_quic_commit,
 };
 
 void usb_quic_logf(const char *fmt, ...) {
@@ -156,6 +180,7 @@ void usb_configurator() {
   if (!usb_detect()) {
     flags.usb_active = 0;
     motor_test.active = 0;
+    quic_telemetry_stop();
     return;
   }
 
@@ -166,6 +191,8 @@ void usb_configurator() {
   }
 #endif
 
+  quic_telemetry_update(&quic);
+
   uint32_t buffer_size = 1;
 
   uint8_t *buffer = (uint8_t *)malloc(BUFFER_SIZE);
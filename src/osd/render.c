@@ -7,6 +7,7 @@
 #include "core/profile.h"
 #include "core/project.h"
 #include "core/scheduler.h"
+#include "driver/motor_dshot.h"
 #include "driver/reset.h"
 #include "flight/control.h"
 #include "io/blackbox_device.h"
@@ -74,6 +75,7 @@ static const char *osd_element_labels[] = {
     "CROSSHAIR",
     "CURRENT DRAWN",
     "WATTS",  // Added watts label
+    "ESC TEMP",
 };
 
 static const char *aux_channel_labels[] = {
@@ -419,6 +421,18 @@ static void print_osd_watts(osd_element_t *el) {
   osd_write_char(ICON_WATT);
 }
 
+// hottest esc from extended dshot telemetry
+static void print_osd_esc_temp(osd_element_t *el) {
+  uint8_t temp = 0;
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    temp = max(temp, state.dshot_temp[i]);
+  }
+
+  osd_start_el(el);
+  osd_write_uint(temp, 3);
+  osd_write_char(ICON_CELSIUS);
+}
+
 void osd_init() {
   osd_device_init();
   osd_intro();
@@ -532,6 +546,11 @@ static void osd_display_regular() {
       osd_state.element++;
       break;
     }
+
+    case OSD_ESC_TEMP: {
+      print_osd_esc_temp(el);
+      break;
+    }
     
     }
   }
@@ -1201,11 +1220,48 @@ void osd_display() {
       profile.motor.motor_limit = osd_menu_adjust_float(profile.motor.motor_limit, 1, 0, 100);
     }
 
+    if (target.brushless) {
+      osd_menu_select_screen(4, 9, "ESC COMMANDS", OSD_SCREEN_ESC_COMMANDS);
+    }
+
     osd_menu_select_save_and_exit(4);
     osd_menu_finish();
     break;
   }
 
+  case OSD_SCREEN_ESC_COMMANDS:
+    osd_menu_start();
+    osd_menu_header("ESC COMMANDS");
+
+    if (osd_menu_button(4, 5, "3D MODE ON")) {
+      motor_esc_command(DSHOT_CMD_3D_MODE_ON);
+      osd_push_screen_replace(OSD_SCREEN_ESC_COMMANDS);
+    }
+    if (osd_menu_button(4, 6, "3D MODE OFF")) {
+      motor_esc_command(DSHOT_CMD_3D_MODE_OFF);
+      osd_push_screen_replace(OSD_SCREEN_ESC_COMMANDS);
+    }
+    if (osd_menu_button(4, 7, "LED ON")) {
+      for (uint8_t i = 0; i < DSHOT_CMD_LED_COUNT; i++) {
+        motor_esc_command(DSHOT_CMD_LED0_ON + i);
+      }
+      osd_push_screen_replace(OSD_SCREEN_ESC_COMMANDS);
+    }
+    if (osd_menu_button(4, 8, "LED OFF")) {
+      for (uint8_t i = 0; i < DSHOT_CMD_LED_COUNT; i++) {
+        motor_esc_command(DSHOT_CMD_LED0_OFF + i);
+      }
+      osd_push_screen_replace(OSD_SCREEN_ESC_COMMANDS);
+    }
+    if (osd_menu_button(4, 9, "SAVE TO ESC")) {
+      motor_esc_command(DSHOT_CMD_SAVE_SETTINGS);
+      osd_push_screen_replace(OSD_SCREEN_ESC_COMMANDS);
+    }
+
+    osd_menu_select_exit(4);
+    osd_menu_finish();
+    break;
+
   case OSD_SCREEN_THROTTLE_SETTINGS:
     osd_menu_start();
     osd_menu_header("THROTTLE SETTINGS");
@@ -30,6 +30,7 @@ typedef enum {
   OSD_SCREEN_LEVEL_MODE,
   OSD_SCREEN_MOTOR_BOOST,
   OSD_SCREEN_MOTOR_SETTINGS,
+  OSD_SCREEN_ESC_COMMANDS,
   OSD_SCREEN_THROTTLE_SETTINGS,
   OSD_SCREEN_LEVEL_MAX_ANGLE,
   OSD_SCREEN_LEVEL_STRENGTH,
@@ -73,6 +74,7 @@ typedef enum {
   OSD_CROSSHAIR,
   OSD_CURRENT_DRAWN,
   OSD_WATTS,
+  OSD_ESC_TEMP,
 
   OSD_ELEMENT_MAX
 } osd_elements_t;
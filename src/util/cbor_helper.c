@@ -65,3 +65,68 @@ cbor_result_t cbor_decode_bstr_copy(cbor_value_t *dec, uint8_t *buf, uint32_t si
   memcpy(buf, ptr, min(actual_size, size));
   return res;
 }
+
+cbor_result_t cbor_encode_key(cbor_value_t *enc, const char *name, uint32_t key) {
+  if (enc->flags & CBOR_FLAG_INT_KEYS) {
+    return cbor_encode_uint32_t(enc, &key);
+  }
+  return cbor_encode_str(enc, name);
+}
+
+// integer keys leave name at NULL, name keys start probing at the first member
+cbor_result_t cbor_decode_key(cbor_value_t *dec, uint32_t *key, const uint8_t **name, uint32_t *name_len) {
+  *key = 0;
+  *name = NULL;
+  *name_len = 0;
+
+  if (cbor_decode_type(dec) == CBOR_TYPE_UINT) {
+    return cbor_decode_uint32_t(dec, key);
+  }
+  return cbor_decode_tstr(dec, name, name_len);
+}
+
+void cbor_path_next(const uint8_t **path, uint32_t *path_len, const uint8_t **name, uint32_t *name_len) {
+  *name = *path;
+  *name_len = 0;
+  while (*name_len < *path_len && (*path)[*name_len] != '.') {
+    (*name_len)++;
+  }
+
+  const uint32_t consumed = min(*name_len + 1, *path_len);
+  *path += consumed;
+  *path_len -= consumed;
+}
+
+bool cbor_path_index(const uint8_t **path, uint32_t *path_len, uint32_t *index) {
+  const uint8_t *name;
+  uint32_t name_len;
+  cbor_path_next(path, path_len, &name, &name_len);
+  if (name_len == 0) {
+    return false;
+  }
+
+  *index = 0;
+  for (uint32_t i = 0; i < name_len; i++) {
+    if (name[i] < '0' || name[i] > '9') {
+      return false;
+    }
+    *index = *index * 10 + (name[i] - '0');
+  }
+  return true;
+}
+
+#define CBOR_LEAF_PATCHER(type)                                                                       \
+  cbor_result_t cbor_patch_##type(cbor_value_t *dec, type *o, const uint8_t *path, uint32_t path_len) { \
+    if (path_len != 0) {                                                                              \
+      return cbor_handle_error(CBOR_ERR_INVALID_TYPE);                                                \
+    }                                                                                                 \
+    return cbor_decode_##type(dec, o);                                                                \
+  }
+
+CBOR_LEAF_PATCHER(uint8_t)
+CBOR_LEAF_PATCHER(uint16_t)
+CBOR_LEAF_PATCHER(uint32_t)
+CBOR_LEAF_PATCHER(float)
+CBOR_LEAF_PATCHER(bool)
+
+#undef CBOR_LEAF_PATCHER
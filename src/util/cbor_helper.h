@@ -14,111 +14,135 @@ cbor_result_t cbor_handle_error(cbor_result_t err);
     return cbor_handle_error(res); \
   }
 
+// struct members are keyed by their position in the member list instead of their name
+#define CBOR_FLAG_INT_KEYS (1 << 0)
+
 #define CBOR_START_STRUCT_ENCODER(type)                                \
   cbor_result_t cbor_encode_##type(cbor_value_t *enc, const type *o) { \
     cbor_result_t res = CBOR_OK;                                       \
+    uint32_t key = 0;                                                  \
     CBOR_CHECK_ERROR(res = cbor_encode_map_indefinite(enc));
 
 #define CBOR_END_STRUCT_ENCODER()         \
   return cbor_encode_end_indefinite(enc); \
   }
 
-#define CBOR_ENCODE_MEMBER(member, type)                 \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member)); \
+#define CBOR_ENCODE_KEY(member) \
+  CBOR_CHECK_ERROR(res = cbor_encode_key(enc, #member, key++));
+
+#define CBOR_ENCODE_MEMBER(member, type) \
+  CBOR_ENCODE_KEY(member)                \
   CBOR_CHECK_ERROR(res = cbor_encode_##type(enc, &o->member));
 
-#define CBOR_ENCODE_STR_MEMBER(member)                   \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member)); \
+#define CBOR_ENCODE_STR_MEMBER(member) \
+  CBOR_ENCODE_KEY(member)              \
   CBOR_CHECK_ERROR(res = cbor_encode_str(enc, o->member));
 
-#define CBOR_ENCODE_TSTR_MEMBER(member, size)            \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member)); \
+#define CBOR_ENCODE_TSTR_MEMBER(member, size) \
+  CBOR_ENCODE_KEY(member)                     \
   CBOR_CHECK_ERROR(res = cbor_encode_tstr(enc, o->member, size));
 
-#define CBOR_ENCODE_BSTR_MEMBER(member, size)            \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member)); \
+#define CBOR_ENCODE_BSTR_MEMBER(member, size) \
+  CBOR_ENCODE_KEY(member)                     \
   CBOR_CHECK_ERROR(res = cbor_encode_bstr(enc, o->member, size));
 
 #define CBOR_ENCODE_ARRAY_MEMBER(member, size, type)                \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member));            \
+  CBOR_ENCODE_KEY(member)                                           \
   CBOR_CHECK_ERROR(res = cbor_encode_array(enc, size));             \
   for (uint32_t i = 0; i < size; i++) {                             \
     CBOR_CHECK_ERROR(res = cbor_encode_##type(enc, &o->member[i])); \
   }
 
 #define CBOR_ENCODE_INDEX_ARRAY_MEMBER(member, size, type)          \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member));            \
+  CBOR_ENCODE_KEY(member)                                           \
   CBOR_CHECK_ERROR(res = cbor_encode_array(enc, size - 1));         \
   for (uint32_t i = 1; i < size; i++) {                             \
     CBOR_CHECK_ERROR(res = cbor_encode_##type(enc, &o->member[i])); \
   }
 
 #define CBOR_ENCODE_STR_ARRAY_MEMBER(member, size)              \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member));        \
+  CBOR_ENCODE_KEY(member)                                       \
   CBOR_CHECK_ERROR(res = cbor_encode_array(enc, size));         \
   for (uint32_t i = 0; i < size; i++) {                         \
     CBOR_CHECK_ERROR(res = cbor_encode_str(enc, o->member[i])); \
   }
 
 #define CBOR_ENCODE_TSTR_ARRAY_MEMBER(member, size, str_size)                               \
-  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member));                                    \
+  CBOR_ENCODE_KEY(member)                                                                   \
   CBOR_CHECK_ERROR(res = cbor_encode_array(enc, size));                                     \
   for (uint32_t i = 0; i < size; i++) {                                                     \
     CBOR_CHECK_ERROR(res = cbor_encode_tstr(enc, (const uint8_t *)o->member[i], str_size)); \
   }
 
-#define CBOR_START_STRUCT_DECODER(type)                              \
-  cbor_result_t cbor_decode_##type(cbor_value_t *dec, type *o) {     \
-    cbor_result_t res = CBOR_OK;                                     \
-    cbor_container_t map;                                            \
-    CBOR_CHECK_ERROR(res = cbor_decode_map(dec, &map));              \
-    const uint8_t *name;                                             \
-    uint32_t name_len;                                               \
-    for (uint32_t i = 0; i < cbor_decode_map_size(dec, &map); i++) { \
-      CBOR_CHECK_ERROR(res = cbor_decode_tstr(dec, &name, &name_len));
-
-#define CBOR_END_STRUCT_DECODER()                \
-  CBOR_CHECK_ERROR(res = cbor_decode_skip(dec)); \
-  }                                              \
-  return res;                                    \
+// decoders accept both key kinds. integer keys jump straight to their member,
+// name keys are probed against one member after the other.
+#define CBOR_START_STRUCT_DECODER(type)                                     \
+  cbor_result_t cbor_decode_##type(cbor_value_t *dec, type *o) {            \
+    cbor_result_t res = CBOR_OK;                                            \
+    cbor_container_t map;                                                   \
+    CBOR_CHECK_ERROR(res = cbor_decode_map(dec, &map));                     \
+    enum { key_base = __COUNTER__ + 1 };                                    \
+    for (uint32_t i = 0; i < cbor_decode_map_size(dec, &map); i++) {        \
+      const uint8_t *name;                                                  \
+      uint32_t name_len;                                                    \
+      uint32_t key;                                                         \
+      CBOR_CHECK_ERROR(res = cbor_decode_key(dec, &key, &name, &name_len)); \
+      for (;; key++) {                                                      \
+        switch (key) {
+
+#define CBOR_END_STRUCT_DECODER()                  \
+  default:                                         \
+    CBOR_CHECK_ERROR(res = cbor_decode_skip(dec)); \
+    break;                                         \
+  }                                                \
+  break;                                           \
+  }                                                \
+  }                                                \
+  return res;                                      \
   }
 
+#define CBOR_DECODE_KEY(member)                                       \
+  case __COUNTER__ - key_base:                                        \
+    if (name != NULL && !buf_equal_string(name, name_len, #member)) { \
+      continue;                                                       \
+    }
+
 #define CBOR_DECODE_MEMBER(member, type)                         \
-  if (buf_equal_string(name, name_len, #member)) {               \
+  CBOR_DECODE_KEY(member) {                                      \
     CBOR_CHECK_ERROR(res = cbor_decode_##type(dec, &o->member)); \
-    continue;                                                    \
+    break;                                                       \
   }
 
 #define CBOR_DECODE_STR_MEMBER(member)                       \
-  if (buf_equal_string(name, name_len, #member)) {           \
+  CBOR_DECODE_KEY(member) {                                  \
     CBOR_CHECK_ERROR(res = cbor_decode_str(dec, o->member)); \
-    continue;                                                \
+    break;                                                   \
   }
 
 #define CBOR_DECODE_TSTR_MEMBER(member, size)                            \
-  if (buf_equal_string(name, name_len, #member)) {                       \
+  CBOR_DECODE_KEY(member) {                                              \
     CBOR_CHECK_ERROR(res = cbor_decode_tstr_copy(dec, o->member, size)); \
-    continue;                                                            \
+    break;                                                               \
   }
 
 #define CBOR_DECODE_BSTR_MEMBER(member, size)                            \
-  if (buf_equal_string(name, name_len, #member)) {                       \
+  CBOR_DECODE_KEY(member) {                                              \
     CBOR_CHECK_ERROR(res = cbor_decode_bstr_copy(dec, o->member, size)); \
-    continue;                                                            \
+    break;                                                               \
   }
 
 #define CBOR_DECODE_ARRAY_MEMBER(member, size, type)                                \
-  if (buf_equal_string(name, name_len, #member)) {                                  \
+  CBOR_DECODE_KEY(member) {                                                         \
     cbor_container_t array;                                                         \
     CBOR_CHECK_ERROR(res = cbor_decode_array(dec, &array));                         \
     for (uint32_t i = 0; i < min(size, cbor_decode_array_size(dec, &array)); i++) { \
       CBOR_CHECK_ERROR(res = cbor_decode_##type(dec, &o->member[i]));               \
     }                                                                               \
-    continue;                                                                       \
+    break;                                                                          \
   }
 
 #define CBOR_DECODE_INDEX_ARRAY_MEMBER(member, size, type)                          \
-  if (buf_equal_string(name, name_len, #member)) {                                  \
+  CBOR_DECODE_KEY(member) {                                                         \
     cbor_container_t array;                                                         \
     CBOR_CHECK_ERROR(res = cbor_decode_array(dec, &array));                         \
     for (uint32_t i = 0; i < min(size, cbor_decode_array_size(dec, &array)); i++) { \
@@ -129,29 +153,98 @@ cbor_result_t cbor_handle_error(cbor_result_t err);
       }                                                                             \
       o->member[tmp.index] = tmp;                                                   \
     }                                                                               \
-    continue;                                                                       \
+    break;                                                                          \
   }
 
 #define CBOR_DECODE_STR_ARRAY_MEMBER(member, size)                                  \
-  if (buf_equal_string(name, name_len, #member)) {                                  \
+  CBOR_DECODE_KEY(member) {                                                         \
     cbor_container_t array;                                                         \
     CBOR_CHECK_ERROR(res = cbor_decode_array(dec, &array));                         \
     for (uint32_t i = 0; i < min(size, cbor_decode_array_size(dec, &array)); i++) { \
       CBOR_CHECK_ERROR(res = cbor_decode_str(dec, &o->member[i]));                  \
     }                                                                               \
-    continue;                                                                       \
+    break;                                                                          \
   }
 
 #define CBOR_DECODE_TSTR_ARRAY_MEMBER(member, size, str_size)                                \
-  if (buf_equal_string(name, name_len, #member)) {                                           \
+  CBOR_DECODE_KEY(member) {                                                                  \
     cbor_container_t array;                                                                  \
     CBOR_CHECK_ERROR(res = cbor_decode_array(dec, &array));                                  \
     for (uint32_t i = 0; i < min(size, cbor_decode_array_size(dec, &array)); i++) {          \
       CBOR_CHECK_ERROR(res = cbor_decode_tstr_copy(dec, (uint8_t *)o->member[i], str_size)); \
     }                                                                                        \
-    continue;                                                                                \
+    break;                                                                                   \
+  }
+
+// key tables list the member names of a struct in key order, for hosts reading integer keyed maps
+#define CBOR_START_STRUCT_KEY_TABLE(type)                                \
+  static cbor_result_t cbor_encode_key_table_##type(cbor_value_t *enc) { \
+    cbor_result_t res = CBOR_OK;                                         \
+    CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #type));                 \
+    CBOR_CHECK_ERROR(res = cbor_encode_array_indefinite(enc));
+
+#define CBOR_END_STRUCT_KEY_TABLE()       \
+  return cbor_encode_end_indefinite(enc); \
+  }
+
+#define CBOR_KEY_TABLE_MEMBER(member, ...) \
+  CBOR_CHECK_ERROR(res = cbor_encode_str(enc, #member));
+
+// patchers decode a value into the member addressed by a dotted path, eg "pid.pid_rates.0.kp".
+// an empty path replaces the whole value.
+#define CBOR_START_STRUCT_PATCHER(type)                                                                 \
+  cbor_result_t cbor_patch_##type(cbor_value_t *dec, type *o, const uint8_t *path, uint32_t path_len) { \
+    if (path_len == 0) {                                                                                \
+      return cbor_decode_##type(dec, o);                                                                \
+    }                                                                                                   \
+    const uint8_t *name;                                                                                \
+    uint32_t name_len;                                                                                  \
+    cbor_path_next(&path, &path_len, &name, &name_len);
+
+#define CBOR_END_STRUCT_PATCHER()                  \
+  return cbor_handle_error(CBOR_ERR_INVALID_TYPE); \
   }
 
+#define CBOR_PATCH_MEMBER(member, type)                        \
+  if (buf_equal_string(name, name_len, #member)) {             \
+    return cbor_patch_##type(dec, &o->member, path, path_len); \
+  }
+
+#define CBOR_PATCH_TSTR_MEMBER(member, size)                        \
+  if (buf_equal_string(name, name_len, #member) && path_len == 0) { \
+    return cbor_decode_tstr_copy(dec, o->member, size);             \
+  }
+
+#define CBOR_PATCH_ARRAY_MEMBER(member, size, type)                                   \
+  if (buf_equal_string(name, name_len, #member)) {                                    \
+    if (path_len == 0) {                                                              \
+      cbor_result_t res = CBOR_OK;                                                    \
+      cbor_container_t array;                                                         \
+      CBOR_CHECK_ERROR(res = cbor_decode_array(dec, &array));                         \
+      for (uint32_t i = 0; i < min(size, cbor_decode_array_size(dec, &array)); i++) { \
+        CBOR_CHECK_ERROR(res = cbor_decode_##type(dec, &o->member[i]));               \
+      }                                                                               \
+      return res;                                                                     \
+    }                                                                                 \
+    uint32_t index = 0;                                                               \
+    if (!cbor_path_index(&path, &path_len, &index) || index >= size) {                \
+      return cbor_handle_error(CBOR_ERR_OVERFLOW);                                    \
+    }                                                                                 \
+    return cbor_patch_##type(dec, &o->member[index], path, path_len);                 \
+  }
+
+cbor_result_t cbor_encode_key(cbor_value_t *enc, const char *name, uint32_t key);
+cbor_result_t cbor_decode_key(cbor_value_t *dec, uint32_t *key, const uint8_t **name, uint32_t *name_len);
+
+void cbor_path_next(const uint8_t **path, uint32_t *path_len, const uint8_t **name, uint32_t *name_len);
+bool cbor_path_index(const uint8_t **path, uint32_t *path_len, uint32_t *index);
+
+cbor_result_t cbor_patch_uint8_t(cbor_value_t *dec, uint8_t *o, const uint8_t *path, uint32_t path_len);
+cbor_result_t cbor_patch_uint16_t(cbor_value_t *dec, uint16_t *o, const uint8_t *path, uint32_t path_len);
+cbor_result_t cbor_patch_uint32_t(cbor_value_t *dec, uint32_t *o, const uint8_t *path, uint32_t path_len);
+cbor_result_t cbor_patch_float(cbor_value_t *dec, float *o, const uint8_t *path, uint32_t path_len);
+cbor_result_t cbor_patch_bool(cbor_value_t *dec, bool *o, const uint8_t *path, uint32_t path_len);
+
 cbor_result_t cbor_encode_float_array(cbor_value_t *enc, const float *array, uint32_t size);
 cbor_result_t cbor_encode_uint8_array(cbor_value_t *enc, const uint8_t *array, uint32_t size);
 
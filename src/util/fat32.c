@@ -0,0 +1,202 @@
+#include "util/fat32.h"
+
+#include <string.h>
+
+#define FAT32_SIGNATURE 0xAA55
+
+#define FAT32_FSINFO_LEAD_SIG 0x41615252
+#define FAT32_FSINFO_STRUCT_SIG 0x61417272
+#define FAT32_FSINFO_UNKNOWN 0xFFFFFFFF
+
+// 1980-01-01, we have no clock to stamp files with
+#define FAT32_DATE_DEFAULT ((1 << 5) | 1)
+
+static uint16_t read_u16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_u32(uint8_t *p, const uint32_t val) {
+  p[0] = val;
+  p[1] = val >> 8;
+  p[2] = val >> 16;
+  p[3] = val >> 24;
+}
+
+static bool fat32_is_boot_record(const uint8_t *sector) {
+  if (sector[0] != 0xEB && sector[0] != 0xE9) {
+    return false;
+  }
+  // fat32 has no fixed root directory and no 16bit fat size
+  return read_u16(sector + 11) == FAT32_SECTOR_SIZE &&
+         read_u16(sector + 17) == 0 &&
+         read_u16(sector + 22) == 0 &&
+         read_u32(sector + 36) != 0;
+}
+
+// checks sector 0 for either a fat32 boot record or a mbr with a fat32 partition
+bool fat32_find_volume(const uint8_t *sector, uint32_t *lba) {
+  if (read_u16(sector + 510) != FAT32_SIGNATURE) {
+    return false;
+  }
+
+  if (fat32_is_boot_record(sector)) {
+    *lba = 0;
+    return true;
+  }
+
+  for (uint32_t i = 0; i < 4; i++) {
+    const uint8_t *part = sector + 446 + i * 16;
+    const uint8_t type = part[4];
+    if (type != 0x0B && type != 0x0C) {
+      continue;
+    }
+
+    *lba = read_u32(part + 8);
+    return *lba != 0;
+  }
+
+  return false;
+}
+
+bool fat32_parse_volume(fat32_volume_t *vol, const uint8_t *sector, const uint32_t lba) {
+  if (read_u16(sector + 510) != FAT32_SIGNATURE || !fat32_is_boot_record(sector)) {
+    return false;
+  }
+
+  const uint8_t sectors_per_cluster = sector[13];
+  const uint16_t reserved_sectors = read_u16(sector + 14);
+  const uint8_t fat_count = sector[16];
+  const uint32_t total_sectors = read_u32(sector + 32);
+  const uint32_t fat_sectors = read_u32(sector + 36);
+  if (sectors_per_cluster == 0 || fat_count == 0) {
+    return false;
+  }
+
+  const uint32_t meta_sectors = reserved_sectors + fat_count * fat_sectors;
+  if (total_sectors <= meta_sectors) {
+    return false;
+  }
+
+  vol->lba = lba;
+  vol->fat_lba = lba + reserved_sectors;
+  vol->fat_sectors = fat_sectors;
+  vol->fat_count = fat_count;
+  vol->sectors_per_cluster = sectors_per_cluster;
+  vol->data_lba = lba + meta_sectors;
+  vol->root_cluster = read_u32(sector + 44) & FAT32_CLUSTER_MASK;
+  vol->cluster_count = (total_sectors - meta_sectors) / sectors_per_cluster;
+  vol->fsinfo_lba = lba + read_u16(sector + 48);
+
+  // the fat has to cover every cluster, including the two reserved entries
+  if ((vol->cluster_count + FAT32_CLUSTER_FIRST) > fat_sectors * FAT32_ENTRIES_PER_SECTOR) {
+    vol->cluster_count = fat_sectors * FAT32_ENTRIES_PER_SECTOR - FAT32_CLUSTER_FIRST;
+  }
+  return vol->root_cluster >= FAT32_CLUSTER_FIRST;
+}
+
+uint32_t fat32_cluster_lba(const fat32_volume_t *vol, const uint32_t cluster) {
+  return vol->data_lba + (cluster - FAT32_CLUSTER_FIRST) * vol->sectors_per_cluster;
+}
+
+uint32_t fat32_cluster_size(const fat32_volume_t *vol) {
+  return vol->sectors_per_cluster * FAT32_SECTOR_SIZE;
+}
+
+uint32_t fat32_clusters_for(const fat32_volume_t *vol, const uint32_t size) {
+  const uint32_t cluster_size = fat32_cluster_size(vol);
+  return (size + cluster_size - 1) / cluster_size;
+}
+
+uint32_t fat32_entry(const uint8_t *fat_sector, const uint32_t cluster) {
+  return read_u32(fat_sector + (cluster % FAT32_ENTRIES_PER_SECTOR) * sizeof(uint32_t)) & FAT32_CLUSTER_MASK;
+}
+
+// links (or frees) the part of a contiguous chain that lives in this fat sector
+void fat32_set_chain(uint8_t *fat_sector, const uint32_t fat_sector_index, const uint32_t first, const uint32_t count, const bool allocate) {
+  const uint32_t last = first + count - 1;
+  for (uint32_t i = 0; i < FAT32_ENTRIES_PER_SECTOR; i++) {
+    const uint32_t cluster = fat_sector_index * FAT32_ENTRIES_PER_SECTOR + i;
+    if (cluster < first || cluster > last) {
+      continue;
+    }
+
+    uint32_t value = FAT32_CLUSTER_FREE;
+    if (allocate) {
+      value = cluster == last ? FAT32_CLUSTER_EOC : cluster + 1;
+    }
+
+    // upper four bits are reserved and have to be preserved
+    uint8_t *entry = fat_sector + i * sizeof(uint32_t);
+    write_u32(entry, (read_u32(entry) & ~FAT32_CLUSTER_MASK) | value);
+  }
+}
+
+// tracks runs of free clusters across consecutive fat sectors
+void fat32_scan_free(const fat32_volume_t *vol, const uint8_t *fat_sector, const uint32_t fat_sector_index, fat32_run_t *current, fat32_run_t *best) {
+  for (uint32_t i = 0; i < FAT32_ENTRIES_PER_SECTOR; i++) {
+    const uint32_t cluster = fat_sector_index * FAT32_ENTRIES_PER_SECTOR + i;
+    if (cluster < FAT32_CLUSTER_FIRST) {
+      continue;
+    }
+    if (cluster >= vol->cluster_count + FAT32_CLUSTER_FIRST) {
+      break;
+    }
+
+    if (fat32_entry(fat_sector, cluster) != FAT32_CLUSTER_FREE) {
+      current->count = 0;
+      continue;
+    }
+
+    if (current->count > 0 && (current->start + current->count) == cluster) {
+      current->count++;
+    } else {
+      current->start = cluster;
+      current->count = 1;
+    }
+
+    if (current->count > best->count) {
+      *best = *current;
+    }
+  }
+}
+
+uint32_t fat32_dir_entry_cluster(const fat32_dir_entry_t *entry) {
+  return ((uint32_t)entry->fst_clus_hi << 16) | entry->fst_clus_lo;
+}
+
+// name is in 8.3 directory format, eg "LOG00001BFL"
+void fat32_make_dir_entry(fat32_dir_entry_t *entry, const char *name, const uint32_t cluster, const uint32_t size) {
+  memset(entry, 0, sizeof(fat32_dir_entry_t));
+  memcpy(entry->name, name, sizeof(entry->name));
+  entry->attr = FAT32_ATTR_ARCHIVE;
+  entry->crt_date = FAT32_DATE_DEFAULT;
+  entry->wrt_date = FAT32_DATE_DEFAULT;
+  entry->lst_acc_date = FAT32_DATE_DEFAULT;
+  entry->fst_clus_hi = cluster >> 16;
+  entry->fst_clus_lo = cluster & 0xFFFF;
+  entry->file_size = size;
+}
+
+static bool fat32_fsinfo_valid(const uint8_t *sector) {
+  return read_u32(sector) == FAT32_FSINFO_LEAD_SIG && read_u32(sector + 484) == FAT32_FSINFO_STRUCT_SIG;
+}
+
+// the free count is invalidated instead of tracked, hosts recompute it
+void fat32_update_fsinfo(uint8_t *sector, const uint32_t next_free) {
+  if (!fat32_fsinfo_valid(sector)) {
+    return;
+  }
+  write_u32(sector + 488, FAT32_FSINFO_UNKNOWN);
+  write_u32(sector + 492, next_free);
+}
+
+uint32_t fat32_fsinfo_next_free(const uint8_t *sector) {
+  if (!fat32_fsinfo_valid(sector)) {
+    return FAT32_FSINFO_UNKNOWN;
+  }
+  return read_u32(sector + 492);
+}
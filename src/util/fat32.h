@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FAT32_SECTOR_SIZE 512
+#define FAT32_DIR_ENTRIES_PER_SECTOR (FAT32_SECTOR_SIZE / sizeof(fat32_dir_entry_t))
+#define FAT32_ENTRIES_PER_SECTOR (FAT32_SECTOR_SIZE / sizeof(uint32_t))
+
+#define FAT32_CLUSTER_FREE 0x0
+#define FAT32_CLUSTER_EOC 0x0FFFFFFF
+#define FAT32_CLUSTER_MASK 0x0FFFFFFF
+#define FAT32_CLUSTER_FIRST 2
+
+#define FAT32_DIR_ENTRY_END 0x00
+#define FAT32_DIR_ENTRY_DELETED 0xE5
+
+#define FAT32_ATTR_VOLUME_ID 0x08
+#define FAT32_ATTR_DIRECTORY 0x10
+#define FAT32_ATTR_ARCHIVE 0x20
+#define FAT32_ATTR_LONG_NAME 0x0F
+
+typedef struct {
+  uint32_t lba;
+  uint32_t fat_lba;
+  uint32_t fat_sectors;
+  uint8_t fat_count;
+  uint8_t sectors_per_cluster;
+  uint32_t data_lba;
+  uint32_t root_cluster;
+  uint32_t cluster_count;
+  uint32_t fsinfo_lba;
+} fat32_volume_t;
+
+typedef struct {
+  uint8_t name[11];
+  uint8_t attr;
+  uint8_t nt_res;
+  uint8_t crt_time_tenth;
+  uint16_t crt_time;
+  uint16_t crt_date;
+  uint16_t lst_acc_date;
+  uint16_t fst_clus_hi;
+  uint16_t wrt_time;
+  uint16_t wrt_date;
+  uint16_t fst_clus_lo;
+  uint32_t file_size;
+} __attribute__((packed)) fat32_dir_entry_t;
+
+typedef struct {
+  uint32_t start;
+  uint32_t count;
+} fat32_run_t;
+
+bool fat32_find_volume(const uint8_t *sector, uint32_t *lba);
+bool fat32_parse_volume(fat32_volume_t *vol, const uint8_t *sector, const uint32_t lba);
+
+uint32_t fat32_cluster_lba(const fat32_volume_t *vol, const uint32_t cluster);
+uint32_t fat32_cluster_size(const fat32_volume_t *vol);
+uint32_t fat32_clusters_for(const fat32_volume_t *vol, const uint32_t size);
+
+uint32_t fat32_entry(const uint8_t *fat_sector, const uint32_t cluster);
+void fat32_set_chain(uint8_t *fat_sector, const uint32_t fat_sector_index, const uint32_t first, const uint32_t count, const bool allocate);
+void fat32_scan_free(const fat32_volume_t *vol, const uint8_t *fat_sector, const uint32_t fat_sector_index, fat32_run_t *current, fat32_run_t *best);
+
+uint32_t fat32_dir_entry_cluster(const fat32_dir_entry_t *entry);
+void fat32_make_dir_entry(fat32_dir_entry_t *entry, const char *name, const uint32_t cluster, const uint32_t size);
+
+void fat32_update_fsinfo(uint8_t *sector, const uint32_t next_free);
+uint32_t fat32_fsinfo_next_free(const uint8_t *sector);
@@ -111,6 +111,18 @@ uint32_t ring_buffer_write_multi(ring_buffer_t *c, const uint8_t *data, const ui
   return written;
 }
 
+uint32_t ring_buffer_write_reserve(ring_buffer_t *c, uint8_t **data) {
+  *data = &c->buffer[c->head];
+  return ring_buffer_contiguous_write_space(c);
+}
+
+void ring_buffer_write_commit(ring_buffer_t *c, const uint32_t len) {
+  // Memory barrier to ensure the in place writes complete before updating head
+  MEMORY_BARRIER();
+
+  c->head = (c->head + len) % c->size;
+}
+
 uint32_t ring_buffer_available(ring_buffer_t *c) {
   // Take atomic snapshot of volatile pointers
   const uint32_t head = c->head;
@@ -168,6 +180,27 @@ uint32_t ring_buffer_read_multi(ring_buffer_t *c, uint8_t *data, const uint32_t
   return read_count;
 }
 
+uint32_t ring_buffer_read_reserve(ring_buffer_t *c, uint8_t **data) {
+  const uint32_t head = c->head;
+  const uint32_t tail = c->tail;
+
+  // Memory barrier to ensure the data is not read before head
+  MEMORY_BARRIER();
+
+  *data = &c->buffer[tail];
+  if (head >= tail) {
+    return head - tail;
+  }
+  return c->size - tail;
+}
+
+void ring_buffer_read_commit(ring_buffer_t *c, const uint32_t len) {
+  // Memory barrier to ensure the in place reads complete before updating tail
+  MEMORY_BARRIER();
+
+  c->tail = (c->tail + len) % c->size;
+}
+
 void ring_buffer_clear(ring_buffer_t *c) {
   ATOMIC_BLOCK_ALL {
     c->tail = c->head = 0;
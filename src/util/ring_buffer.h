@@ -25,9 +25,17 @@ uint32_t ring_buffer_free(ring_buffer_t *c);
 uint8_t ring_buffer_write(ring_buffer_t *c, uint8_t data);
 uint32_t ring_buffer_write_multi(ring_buffer_t *c, const uint8_t *data, const uint32_t len);
 
+// contiguous free space at the head, lets the producer fill the buffer in place
+uint32_t ring_buffer_write_reserve(ring_buffer_t *c, uint8_t **data);
+void ring_buffer_write_commit(ring_buffer_t *c, const uint32_t len);
+
 uint32_t ring_buffer_available(ring_buffer_t *c);
 uint8_t ring_buffer_read(ring_buffer_t *c, uint8_t *data);
 uint32_t ring_buffer_read_multi(ring_buffer_t *c, uint8_t *data, const uint32_t len);
 
+// contiguous data at the tail, lets the consumer hand it out in place before releasing it
+uint32_t ring_buffer_read_reserve(ring_buffer_t *c, uint8_t **data);
+void ring_buffer_read_commit(ring_buffer_t *c, const uint32_t len);
+
 // only function with internal blocking as both head & tail are written to
 void ring_buffer_clear(ring_buffer_t *c);
@@ -29,6 +29,19 @@ cbor_result_t cbor_decode_vec3_t(cbor_value_t *it, vec3_t *vec) {
   return res;
 }
 
+// a single axis can be addressed by index, eg "kp.0"
+cbor_result_t cbor_patch_vec3_t(cbor_value_t *dec, vec3_t *vec, const uint8_t *path, uint32_t path_len) {
+  if (path_len == 0) {
+    return cbor_decode_vec3_t(dec, vec);
+  }
+
+  uint32_t index = 0;
+  if (!cbor_path_index(&path, &path_len, &index) || index >= 3 || path_len != 0) {
+    return cbor_handle_error(CBOR_ERR_OVERFLOW);
+  }
+  return cbor_decode_float(dec, &vec->axis[index]);
+}
+
 float vec3_magnitude(vec3_t *v) {
   float max = 0;
   for (uint8_t axis = 0; axis < 3; axis++) {
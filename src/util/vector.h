@@ -13,6 +13,7 @@ typedef union {
 
 cbor_result_t cbor_encode_vec3_t(cbor_value_t *enc, const vec3_t *vec);
 cbor_result_t cbor_decode_vec3_t(cbor_value_t *dec, vec3_t *vec);
+cbor_result_t cbor_patch_vec3_t(cbor_value_t *dec, vec3_t *vec, const uint8_t *path, uint32_t path_len);
 
 float vec3_magnitude(vec3_t *v);
 
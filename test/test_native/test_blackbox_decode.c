@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+// Include the blackbox decoder
+#include "io/blackbox_decode.h"
+#include "util/cbor_helper.h"
+
+#define TEST_FRAMES 20000
+#define TEST_FIELD_FLAGS ((1 << BBOX_FIELD_MAX) - 1)
+
+static blackbox_decoder_t decoder;
+
+static blackbox_t frames[TEST_FRAMES];
+static uint8_t stream[TEST_FRAMES * BLACKBOX_MAX_SIZE];
+static uint32_t stream_len = 0;
+
+static uint8_t output[8 * 1024 * 1024];
+static uint32_t output_len = 0;
+
+static void output_write(const uint8_t *data, uint32_t len, void *priv) {
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(output), output_len + len);
+  memcpy(output + output_len, data, len);
+  output_len += len;
+}
+
+static void make_frame(blackbox_t *frame, uint32_t i) {
+  memset(frame, 0, sizeof(blackbox_t));
+  frame->loop = i + 1;
+  frame->time = 1000000 + i * 250;
+  for (uint32_t j = 0; j < 3; j++) {
+    frame->pid_p_term.axis[j] = (int16_t)((i * 7 + j * 100) % 2000) - 1000;
+    frame->pid_i_term.axis[j] = (int16_t)(i / 64 + j);
+    frame->pid_d_term.axis[j] = (int16_t)((i * 13) % 500) - 250;
+    frame->accel_raw.axis[j] = (int16_t)(i % 3 == 0 ? 1000 : 998);
+    frame->accel_filter.axis[j] = 999;
+    frame->gyro_raw.axis[j] = (int16_t)((i * 31 + j) % 4000) - 2000;
+    frame->gyro_filter.axis[j] = (int16_t)((i * 29 + j) % 3000) - 1500;
+  }
+  for (uint32_t j = 0; j < 4; j++) {
+    frame->rx.axis[j] = (int16_t)(i / 8 % 1000);
+    frame->setpoint.axis[j] = (int16_t)(i / 8 % 1000) * 2;
+    frame->motor.axis[j] = (int16_t)(200 + (i + j * 10) % 800);
+  }
+  frame->cpu_load = 50 + i % 20;
+  frame->debug[0] = (int16_t)i;
+}
+
+static void make_stream(uint32_t count) {
+  stream_len = 0;
+
+  blackbox_t previous;
+  memset(&previous, 0, sizeof(blackbox_t));
+
+  for (uint32_t i = 0; i < count; i++) {
+    make_frame(&frames[i], i);
+
+    const blackbox_frame_type_t type = (i == 0 || frames[i].loop % 32 == 0) ? BLACKBOX_FRAME_I : BLACKBOX_FRAME_P;
+
+    cbor_value_t enc;
+    cbor_encoder_init(&enc, stream + stream_len, BLACKBOX_MAX_SIZE);
+    TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_blackbox_frame(&enc, &frames[i], &previous, type, TEST_FIELD_FLAGS));
+    stream_len += cbor_encoder_len(&enc);
+
+    previous = frames[i];
+  }
+}
+
+static const int32_t *columnar_column(uint32_t block_offset, uint32_t rows, uint32_t column) {
+  return (const int32_t *)(output + block_offset + 8 + column * rows * sizeof(int32_t));
+}
+
+// Test I/P-frame reconstruction into the columnar layout
+void test_blackbox_decode_columnar(void) {
+  make_stream(TEST_FRAMES);
+
+  output_len = 0;
+  blackbox_decoder_init(&decoder, TEST_FIELD_FLAGS, BLACKBOX_DECODE_COLUMNAR, output_write, NULL);
+
+  const clock_t start = clock();
+  TEST_ASSERT_EQUAL_UINT32(stream_len, blackbox_decoder_feed(&decoder, stream, stream_len));
+  blackbox_decoder_finish(&decoder);
+  const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  TEST_ASSERT_EQUAL_UINT32(TEST_FRAMES, decoder.frames);
+  TEST_ASSERT_EQUAL_UINT32(0, decoder.skipped);
+  TEST_ASSERT_EQUAL_UINT32(BLACKBOX_DECODE_COLUMNS_MAX, decoder.column_count);
+
+  // header with magic, column count and names
+  uint32_t head[2];
+  memcpy(head, output, sizeof(head));
+  TEST_ASSERT_EQUAL_HEX32(BLACKBOX_DECODE_COLUMNAR_MAGIC, head[0]);
+  TEST_ASSERT_EQUAL_UINT32(BLACKBOX_DECODE_COLUMNS_MAX, head[1]);
+  TEST_ASSERT_EQUAL_STRING("loop", (const char *)output + 8);
+
+  uint32_t pos = 8;
+  for (uint32_t i = 0; i < head[1]; i++) {
+    pos += strlen((const char *)output + pos) + 1;
+  }
+
+  // walk all blocks, compare against the source frames
+  uint32_t row = 0;
+  while (pos < output_len) {
+    uint32_t block[2];
+    memcpy(block, output + pos, sizeof(block));
+    TEST_ASSERT_EQUAL_UINT32(BLACKBOX_DECODE_COLUMNS_MAX, block[1]);
+
+    const int32_t *loop = columnar_column(pos, block[0], 0);
+    const int32_t *time = columnar_column(pos, block[0], 1);
+    const int32_t *gyro_yaw = columnar_column(pos, block[0], 2 + 3 * 3 + 4 * 2 + 3 * 2 + 2);
+    const int32_t *motor = columnar_column(pos, block[0], 2 + 3 * 3 + 4 * 2 + 3 * 4);
+    const int32_t *cpu_load = columnar_column(pos, block[0], 2 + 3 * 3 + 4 * 2 + 3 * 4 + 4);
+    for (uint32_t i = 0; i < block[0]; i++, row++) {
+      TEST_ASSERT_EQUAL_UINT32(frames[row].loop, (uint32_t)loop[i]);
+      TEST_ASSERT_EQUAL_UINT32(frames[row].time, (uint32_t)time[i]);
+      TEST_ASSERT_EQUAL_INT32(frames[row].gyro_raw.yaw, gyro_yaw[i]);
+      TEST_ASSERT_EQUAL_INT32(frames[row].motor.axis[0], motor[i]);
+      TEST_ASSERT_EQUAL_INT32(frames[row].cpu_load, cpu_load[i]);
+    }
+    pos += 8 + block[0] * block[1] * sizeof(int32_t);
+  }
+  TEST_ASSERT_EQUAL_UINT32(TEST_FRAMES, row);
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "blackbox decode columnar: %.1f MB/s", seconds > 0 ? (stream_len / seconds) / (1024 * 1024) : 0);
+  TEST_MESSAGE(msg);
+}
+
+// Test CSV export from a device header image
+void test_blackbox_decode_csv_image(void) {
+  make_stream(64);
+
+  static uint8_t image[64 * BLACKBOX_MAX_SIZE + 1024];
+  memset(image, 0, sizeof(image));
+
+  blackbox_device_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic = BLACKBOX_HEADER_MAGIC;
+  header.file_num = 1;
+  header.files[0].field_flags = (1 << BBOX_FIELD_LOOP) | (1 << BBOX_FIELD_TIME) | (1 << BBOX_FIELD_MOTOR);
+  header.files[0].start = 1024;
+  header.files[0].size = stream_len;
+  memcpy(image, &header, sizeof(header));
+  memcpy(image + 1024, stream, stream_len);
+
+  output_len = 0;
+  TEST_ASSERT_EQUAL_INT32(64, blackbox_decode_image(&decoder, image, 1024 + stream_len, 0, BLACKBOX_DECODE_CSV, output_write, NULL));
+  output[output_len] = 0;
+
+  const char *expected = "loop,time,motor[0],motor[1],motor[2],motor[3]\n"
+                         "1,1000000,200,210,220,230\n"
+                         "2,1000250,201,211,221,231\n";
+  TEST_ASSERT_EQUAL_MEMORY(expected, output, strlen(expected));
+
+  // missing file
+  TEST_ASSERT_EQUAL_INT32(-1, blackbox_decode_image(&decoder, image, 1024 + stream_len, 1, BLACKBOX_DECODE_CSV, output_write, NULL));
+}
+
+// Test chunked feeding and resync after a corrupted frame
+void test_blackbox_decode_stream_resync(void) {
+  make_stream(128);
+
+  // break the frame for loop 10, frames up to the next i-frame at loop 32 are lost
+  uint32_t offset = 0;
+  cbor_value_t dec;
+  for (uint32_t i = 0; i < 9; i++) {
+    cbor_decoder_init(&dec, stream + offset, stream_len - offset);
+    cbor_decode_skip(&dec);
+    offset += dec.curr - dec.start;
+  }
+  stream[offset + 1] = 0xFC;
+
+  output_len = 0;
+  blackbox_decoder_init(&decoder, TEST_FIELD_FLAGS, BLACKBOX_DECODE_CSV, output_write, NULL);
+
+  // feed in small chunks, carrying over what was not consumed
+  uint8_t chunk[300];
+  uint32_t chunk_len = 0;
+  uint32_t pos = 0;
+  while (pos < stream_len) {
+    const uint32_t len = stream_len - pos < 97 ? stream_len - pos : 97;
+    memcpy(chunk + chunk_len, stream + pos, len);
+    chunk_len += len;
+    pos += len;
+
+    const uint32_t used = blackbox_decoder_feed(&decoder, chunk, chunk_len);
+    memmove(chunk, chunk + used, chunk_len - used);
+    chunk_len -= used;
+  }
+  blackbox_decoder_finish(&decoder);
+
+  TEST_ASSERT_EQUAL_UINT32(0, chunk_len);
+  TEST_ASSERT_EQUAL_UINT32(9 + (128 - 31), decoder.frames);
+  TEST_ASSERT_GREATER_THAN(0, decoder.skipped);
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "core/profile.h"
+#include "core/target.h"
+#include "util/cbor_helper.h"
+
+#define BENCH_ITERATIONS 2000
+
+extern cbor_result_t cbor_decode_profile_motor_t(cbor_value_t *dec, profile_motor_t *o);
+
+typedef cbor_result_t (*encode_fn_t)(cbor_value_t *enc, const void *o);
+typedef cbor_result_t (*decode_fn_t)(cbor_value_t *dec, void *o);
+
+static uint8_t name_buffer[16 * 1024];
+static uint8_t int_buffer[16 * 1024];
+
+static uint32_t encode_with(uint8_t *buf, uint32_t size, encode_fn_t encode, const void *o, uint32_t flags) {
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, buf, size);
+  enc.flags = flags;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, encode(&enc, o));
+  return cbor_encoder_len(&enc);
+}
+
+// decodes the integer keyed encoding and checks it encodes back to the name keyed one
+static void check_roundtrip(encode_fn_t encode, decode_fn_t decode, const void *o, void *tmp, uint32_t size) {
+  const uint32_t name_len = encode_with(name_buffer, sizeof(name_buffer), encode, o, 0);
+  const uint32_t int_len = encode_with(int_buffer, sizeof(int_buffer), encode, o, CBOR_FLAG_INT_KEYS);
+  TEST_ASSERT_LESS_THAN(name_len * 2 / 3, int_len);
+
+  memset(tmp, 0, size);
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, int_buffer, int_len);
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, decode(&dec, tmp));
+
+  static uint8_t check[16 * 1024];
+  TEST_ASSERT_EQUAL_UINT32(name_len, encode_with(check, sizeof(check), encode, tmp, 0));
+  TEST_ASSERT_EQUAL_MEMORY(name_buffer, check, name_len);
+}
+
+static void bench(const char *type, encode_fn_t encode, decode_fn_t decode, const void *o, void *tmp, uint32_t flags) {
+  uint8_t *buf = flags ? int_buffer : name_buffer;
+
+  uint32_t len = 0;
+  clock_t start = clock();
+  for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+    len = encode_with(buf, sizeof(name_buffer), encode, o, flags);
+  }
+  const float encode_us = (float)(clock() - start) * 1e6f / CLOCKS_PER_SEC / BENCH_ITERATIONS;
+
+  start = clock();
+  for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+    cbor_value_t dec;
+    cbor_decoder_init(&dec, buf, len);
+    decode(&dec, tmp);
+  }
+  const float decode_us = (float)(clock() - start) * 1e6f / CLOCKS_PER_SEC / BENCH_ITERATIONS;
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s %s keys: %u bytes, encode %.1f us, decode %.1f us", type, flags ? "int" : "name", len, (double)encode_us, (double)decode_us);
+  TEST_MESSAGE(msg);
+}
+
+// Test integer keyed profile encoding against the name keyed one
+void test_cbor_int_keys_profile(void) {
+  extern profile_t profile;
+  static profile_t tmp;
+
+  profile_set_defaults();
+  check_roundtrip((encode_fn_t)cbor_encode_profile_t, (decode_fn_t)cbor_decode_profile_t, &profile, &tmp, sizeof(tmp));
+
+  bench("profile_t", (encode_fn_t)cbor_encode_profile_t, (decode_fn_t)cbor_decode_profile_t, &profile, &tmp, 0);
+  bench("profile_t", (encode_fn_t)cbor_encode_profile_t, (decode_fn_t)cbor_decode_profile_t, &profile, &tmp, CBOR_FLAG_INT_KEYS);
+}
+
+// Test integer keyed target encoding against the name keyed one
+void test_cbor_int_keys_target(void) {
+  static target_t tmp;
+
+  check_roundtrip((encode_fn_t)cbor_encode_target_t, (decode_fn_t)cbor_decode_target_t, &target, &tmp, sizeof(tmp));
+
+  bench("target_t", (encode_fn_t)cbor_encode_target_t, (decode_fn_t)cbor_decode_target_t, &target, &tmp, 0);
+  bench("target_t", (encode_fn_t)cbor_encode_target_t, (decode_fn_t)cbor_decode_target_t, &target, &tmp, CBOR_FLAG_INT_KEYS);
+}
+
+// Test the key tables list members in key order
+void test_cbor_key_tables(void) {
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, name_buffer, sizeof(name_buffer));
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_map_indefinite(&enc));
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_profile_key_tables(&enc));
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_end_indefinite(&enc));
+
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, name_buffer, cbor_encoder_len(&enc));
+
+  cbor_container_t map;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_map(&dec, &map));
+
+  bool found = false;
+  for (uint32_t i = 0; i < cbor_decode_map_size(&dec, &map); i++) {
+    const uint8_t *type;
+    uint32_t type_len;
+    TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_tstr(&dec, &type, &type_len));
+    if (!buf_equal_string(type, type_len, "profile_motor_t")) {
+      TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_skip(&dec));
+      continue;
+    }
+
+    // the key of throttle_boost is its index in this list
+    cbor_container_t keys;
+    TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_array(&dec, &keys));
+
+    uint32_t key = 0;
+    for (; key < cbor_decode_array_size(&dec, &keys); key++) {
+      const uint8_t *name;
+      uint32_t name_len;
+      TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_tstr(&dec, &name, &name_len));
+      if (buf_equal_string(name, name_len, "throttle_boost")) {
+        found = true;
+        break;
+      }
+    }
+    TEST_ASSERT_TRUE(found);
+
+    // an integer keyed map with just that member decodes into it
+    uint8_t frame[16];
+    cbor_encoder_init(&enc, frame, sizeof(frame));
+    const float boost = 9.5f;
+    cbor_encode_map(&enc, 1);
+    cbor_encode_uint32_t(&enc, &key);
+    cbor_encode_float(&enc, &boost);
+
+    profile_motor_t motor = {};
+    cbor_decoder_init(&dec, frame, cbor_encoder_len(&enc));
+    TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_profile_motor_t(&dec, &motor));
+    TEST_ASSERT_EQUAL_FLOAT(boost, motor.throttle_boost);
+    break;
+  }
+  TEST_ASSERT_TRUE(found);
+}
@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "driver/motor_dshot.h"
+#include "driver/time.h"
+#include "flight/control.h"
+
+#define DSHOT_BENCH_LOOPS 100000
+#define DSHOT_TEST_NO_PIN 0xFF
+
+static uint32_t dshot_test_rand = 0x12345678;
+
+static uint16_t dshot_test_packet() {
+  dshot_test_rand = dshot_test_rand * 1664525 + 1013904223;
+  return dshot_test_rand >> 16;
+}
+
+static void dshot_test_pins(dshot_pin_t *pins, const uint8_t *ports, const uint8_t *pin_index, bool telemetry) {
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    if (pin_index[i] == DSHOT_TEST_NO_PIN) {
+      memset(&pins[i], 0, sizeof(dshot_pin_t));
+      continue;
+    }
+    const uint32_t pin_mask = 1 << pin_index[i];
+    pins[i].pin_mask = pin_mask;
+    pins[i].dshot_port = ports[i];
+    pins[i].set_mask = telemetry ? (pin_mask << 16) : pin_mask;
+    pins[i].reset_mask = telemetry ? pin_mask : (pin_mask << 16);
+  }
+}
+
+// the per bit, per motor loop the lookup replaces
+static void dshot_test_encode_reference(const dshot_pin_t *pins, const uint16_t *packets, uint32_t port_count, uint32_t (*buffer)[DSHOT_DMA_BUFFER_SIZE]) {
+  uint16_t packet[MOTOR_PIN_MAX];
+  memcpy(packet, packets, sizeof(packet));
+
+  for (uint8_t i = 0; i < 16; i++) {
+    for (uint32_t j = 0; j < port_count; j++) {
+      buffer[j][i * 3 + 1] = 0;
+    }
+    for (uint8_t motor = 0; motor < MOTOR_PIN_MAX; motor++) {
+      const bool bit = packet[motor] & 0x8000;
+      const uint32_t port = pins[motor].dshot_port;
+      buffer[port][i * 3 + 1] |= bit ? pins[motor].set_mask : pins[motor].reset_mask;
+      packet[motor] <<= 1;
+    }
+  }
+}
+
+static void dshot_test_compare(const uint8_t *ports, const uint8_t *pin_index, uint32_t port_count, bool telemetry) {
+  dshot_pin_t pins[MOTOR_PIN_MAX];
+  dshot_test_pins(pins, ports, pin_index, telemetry);
+
+  dshot_bitbang_lut_t lut;
+  dshot_bitbang_lut_init(&lut, pins);
+
+  for (uint32_t n = 0; n < 1000; n++) {
+    uint16_t packets[MOTOR_PIN_MAX];
+    for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+      packets[i] = dshot_test_packet();
+    }
+
+    uint32_t expected[DSHOT_MAX_PORT_COUNT][DSHOT_DMA_BUFFER_SIZE] = {0};
+    uint32_t actual[DSHOT_MAX_PORT_COUNT][DSHOT_DMA_BUFFER_SIZE] = {0};
+    dshot_test_encode_reference(pins, packets, port_count, expected);
+    dshot_bitbang_encode(&lut, packets, port_count, actual);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+  }
+}
+
+// Test the lookup produces the same buffers as the bit loop for different pin layouts
+void test_dshot_bitbang_encode(void) {
+  const uint8_t one_port[MOTOR_PIN_MAX] = {0, 0, 0, 0, 0, 0, 0, 0};
+  const uint8_t one_port_pins[MOTOR_PIN_MAX] = {0, 1, 8, 9, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN};
+  dshot_test_compare(one_port, one_port_pins, 1, false);
+  dshot_test_compare(one_port, one_port_pins, 1, true);
+
+  const uint8_t two_ports[MOTOR_PIN_MAX] = {0, 1, 1, 0, 0, 0, 0, 0};
+  const uint8_t two_ports_pins[MOTOR_PIN_MAX] = {6, 0, 1, 7, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN};
+  dshot_test_compare(two_ports, two_ports_pins, 2, false);
+
+  const uint8_t three_ports[MOTOR_PIN_MAX] = {2, 0, 1, 2, 0, 0, 0, 0};
+  const uint8_t three_ports_pins[MOTOR_PIN_MAX] = {15, 4, 4, 3, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN};
+  dshot_test_compare(three_ports, three_ports_pins, 3, true);
+
+  // a hex leaves a hole in the second group, an octo fills both
+  const uint8_t hex_ports[MOTOR_PIN_MAX] = {0, 0, 1, 1, 2, 2, 0, 0};
+  const uint8_t hex_pins[MOTOR_PIN_MAX] = {0, 1, 6, 7, 8, 9, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN};
+  dshot_test_compare(hex_ports, hex_pins, 3, true);
+
+  const uint8_t octo_ports[MOTOR_PIN_MAX] = {0, 0, 1, 1, 2, 2, 0, 1};
+  const uint8_t octo_pins[MOTOR_PIN_MAX] = {0, 1, 6, 7, 8, 9, 4, 3};
+  dshot_test_compare(octo_ports, octo_pins, 3, false);
+  dshot_test_compare(octo_ports, octo_pins, 3, true);
+}
+
+// Benchmark the lookup against the bit loop
+void test_dshot_bitbang_encode_benchmark(void) {
+  const uint8_t ports[MOTOR_PIN_MAX] = {0, 1, 1, 0, 0, 0, 0, 0};
+  const uint8_t pin_index[MOTOR_PIN_MAX] = {6, 0, 1, 7, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN, DSHOT_TEST_NO_PIN};
+  dshot_pin_t pins[MOTOR_PIN_MAX];
+  dshot_test_pins(pins, ports, pin_index, true);
+
+  dshot_bitbang_lut_t lut;
+  dshot_bitbang_lut_init(&lut, pins);
+
+  uint16_t initial[MOTOR_PIN_MAX];
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    initial[i] = dshot_test_packet();
+  }
+
+  uint16_t packets[MOTOR_PIN_MAX];
+  static uint32_t reference[DSHOT_MAX_PORT_COUNT][DSHOT_DMA_BUFFER_SIZE];
+  static volatile uint32_t buffer[DSHOT_MAX_PORT_COUNT][DSHOT_DMA_BUFFER_SIZE];
+
+  memcpy(packets, initial, sizeof(packets));
+  uint32_t start = time_micros();
+  for (uint32_t n = 0; n < DSHOT_BENCH_LOOPS; n++) {
+    packets[n % MOTOR_PIN_MAX] ^= n;
+    dshot_test_encode_reference(pins, packets, 2, reference);
+  }
+  const uint32_t reference_us = time_micros() - start;
+
+  memcpy(packets, initial, sizeof(packets));
+  start = time_micros();
+  for (uint32_t n = 0; n < DSHOT_BENCH_LOOPS; n++) {
+    packets[n % MOTOR_PIN_MAX] ^= n;
+    dshot_bitbang_encode(&lut, packets, 2, buffer);
+  }
+  const uint32_t lut_us = time_micros() - start;
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "bit loop: %u ns, lookup: %u ns per buffer", reference_us * 1000 / DSHOT_BENCH_LOOPS, lut_us * 1000 / DSHOT_BENCH_LOOPS);
+  TEST_MESSAGE(msg);
+
+  // both ran over the same packet sequence
+  TEST_ASSERT_EQUAL_MEMORY(reference, (const void *)buffer, sizeof(reference));
+}
+
+#define GCR_TEST_FRAMES 2000
+#define GCR_TEST_PIN_MASK (1 << 5)
+
+static const uint8_t gcr_test_quintets[16] = {
+    0x19, 0x1B, 0x12, 0x13, 0x1D, 0x15, 0x16, 0x17,
+    0x1A, 0x09, 0x0A, 0x0B, 0x1E, 0x0D, 0x0E, 0x0F,
+};
+
+typedef struct {
+  float jitter; // max edge displacement in samples
+  float drift;  // esc clock error
+  uint32_t glitches;
+} gcr_test_channel_t;
+
+static float dshot_test_uniform() {
+  return (dshot_test_packet() / 65535.0f) * 2.0f - 1.0f;
+}
+
+// oversampled answer of an esc, the other pins of the port toggle at random
+static void dshot_test_waveform(uint16_t *buffer, uint16_t value, uint32_t start, const gcr_test_channel_t *channel) {
+  const uint16_t csum = ~((value >> 8) ^ (value >> 4) ^ value) & 0xf;
+  const uint16_t frame = (value << 4) | csum;
+
+  uint32_t gcr = 0;
+  for (int32_t i = 3; i >= 0; i--) {
+    gcr = (gcr << 5) | gcr_test_quintets[(frame >> (i * 4)) & 0xf];
+  }
+
+  // the line starts low, every gcr one is a transition
+  uint32_t level[21];
+  level[0] = 0;
+  for (uint32_t k = 1; k < 21; k++) {
+    level[k] = level[k - 1] ^ ((gcr >> (20 - k)) & 0x1);
+  }
+
+  float edges[22];
+  for (uint32_t k = 0; k < 22; k++) {
+    edges[k] = k * 3.0f * (1.0f + channel->drift) + channel->jitter * dshot_test_uniform();
+  }
+
+  for (uint32_t n = 0; n < GCR_DMA_BUFFER_SIZE; n++) {
+    uint32_t high = 1;
+    const float t = (float)n - (float)start;
+    for (uint32_t k = 0; k < 21; k++) {
+      if (t >= edges[k] && t < edges[k + 1]) {
+        high = level[k];
+      }
+    }
+    buffer[n] = (dshot_test_packet() & ~GCR_TEST_PIN_MASK) | (high ? GCR_TEST_PIN_MASK : 0);
+  }
+
+  for (uint32_t i = 0; i < channel->glitches; i++) {
+    buffer[start + dshot_test_packet() % 63] ^= GCR_TEST_PIN_MASK;
+  }
+}
+
+static void dshot_test_gcr_corpus(const char *name, const gcr_test_channel_t *channel, uint32_t *errors, uint32_t *wrong) {
+  static uint16_t buffers[GCR_TEST_FRAMES][GCR_DMA_BUFFER_SIZE];
+  static uint16_t values[GCR_TEST_FRAMES];
+
+  for (uint32_t i = 0; i < GCR_TEST_FRAMES; i++) {
+    values[i] = dshot_test_packet() & 0xfff;
+    dshot_test_waveform(buffers[i], values[i], 12 + dshot_test_packet() % 60, channel);
+  }
+
+  *errors = 0;
+  *wrong = 0;
+
+  const uint32_t start = time_micros();
+  for (uint32_t i = 0; i < GCR_TEST_FRAMES; i++) {
+    uint16_t value = 0;
+    if (dshot_decode_gcr(buffers[i], GCR_TEST_PIN_MASK, &value) != DSHOT_GCR_OK) {
+      (*errors)++;
+    } else if (value != values[i]) {
+      (*wrong)++;
+    }
+  }
+  const uint32_t time_us = time_micros() - start;
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s: %u ns per frame, %u/%u rejected, %u wrong", name, time_us * 1000 / GCR_TEST_FRAMES, *errors, GCR_TEST_FRAMES, *wrong);
+  TEST_MESSAGE(msg);
+}
+
+// Test the gcr decoder against synthetic esc answers with edge jitter, clock drift and glitches
+void test_dshot_gcr_decode(void) {
+  uint32_t errors, wrong;
+
+  // the same corpus no matter how many packets the tests before drew
+  dshot_test_rand = 0x12345678;
+
+  const gcr_test_channel_t clean = {0};
+  dshot_test_gcr_corpus("clean", &clean, &errors, &wrong);
+  TEST_ASSERT_EQUAL_UINT32(0, errors);
+  TEST_ASSERT_EQUAL_UINT32(0, wrong);
+
+  const gcr_test_channel_t jitter = {.jitter = 0.4f, .drift = 0.02f};
+  dshot_test_gcr_corpus("jitter", &jitter, &errors, &wrong);
+  TEST_ASSERT_EQUAL_UINT32(0, errors);
+  TEST_ASSERT_EQUAL_UINT32(0, wrong);
+
+  const gcr_test_channel_t slow = {.jitter = 0.4f, .drift = -0.02f};
+  dshot_test_gcr_corpus("slow", &slow, &errors, &wrong);
+  TEST_ASSERT_EQUAL_UINT32(0, errors);
+  TEST_ASSERT_EQUAL_UINT32(0, wrong);
+
+  // single sample glitches are filtered, those on an edge are caught by framing, symbols and checksum
+  const gcr_test_channel_t glitch = {.jitter = 0.3f, .glitches = 1};
+  dshot_test_gcr_corpus("glitch", &glitch, &errors, &wrong);
+  TEST_ASSERT_LESS_THAN(GCR_TEST_FRAMES / 3, errors);
+  TEST_ASSERT_LESS_THAN(GCR_TEST_FRAMES / 100, wrong);
+
+  // an idle line holds no frame
+  uint16_t idle[GCR_DMA_BUFFER_SIZE];
+  for (uint32_t n = 0; n < GCR_DMA_BUFFER_SIZE; n++) {
+    idle[n] = GCR_TEST_PIN_MASK;
+  }
+  uint16_t value = 0;
+  TEST_ASSERT_EQUAL_INT(DSHOT_GCR_NO_FRAME, dshot_decode_gcr(idle, GCR_TEST_PIN_MASK, &value));
+}
+
+// Test extended telemetry frames are told apart from erpm and land in the state
+void test_dshot_edt(void) {
+  // erpm frames, idle and a normalized mantissa with and without exponent
+  TEST_ASSERT_EQUAL_INT(DSHOT_EDT_NONE, dshot_edt_type(0x0fff));
+  TEST_ASSERT_EQUAL_INT(DSHOT_EDT_NONE, dshot_edt_type((3 << 9) | 0x1a0));
+  TEST_ASSERT_EQUAL_INT(DSHOT_EDT_NONE, dshot_edt_type(0x0050));
+
+  TEST_ASSERT_EQUAL_INT(DSHOT_EDT_TEMPERATURE, dshot_edt_type(0x0200 | 45));
+  TEST_ASSERT_EQUAL_INT(DSHOT_EDT_VOLTAGE, dshot_edt_type(0x0400 | 64));
+  TEST_ASSERT_EQUAL_INT(DSHOT_EDT_STATUS, dshot_edt_type(0x0e00 | 0x80));
+
+  memset(state.dshot_temp, 0, sizeof(state.dshot_temp));
+  memset(state.dshot_voltage, 0, sizeof(state.dshot_voltage));
+  memset(state.dshot_current, 0, sizeof(state.dshot_current));
+  dshot_edt_update(1, DSHOT_EDT_TEMPERATURE, 45);
+  dshot_edt_update(2, DSHOT_EDT_VOLTAGE, 64);
+  TEST_ASSERT_EQUAL_UINT8(45, state.dshot_temp[1]);
+  TEST_ASSERT_EQUAL_FLOAT(16.0f, state.dshot_voltage[2]);
+
+  // a current frame through the gcr decoder
+  static uint16_t buffer[GCR_DMA_BUFFER_SIZE];
+  const gcr_test_channel_t clean = {0};
+  dshot_test_waveform(buffer, 0x0600 | 30, 20, &clean);
+
+  uint16_t value = 0;
+  TEST_ASSERT_EQUAL_INT(DSHOT_GCR_OK, dshot_decode_gcr(buffer, GCR_TEST_PIN_MASK, &value));
+  TEST_ASSERT_EQUAL_INT(DSHOT_EDT_CURRENT, dshot_edt_type(value));
+  dshot_edt_update(3, dshot_edt_type(value), value & 0xff);
+  TEST_ASSERT_EQUAL_FLOAT(30.0f, state.dshot_current[3]);
+}
+
+// Test the rpm of an esc that stops answering drops to zero instead of going stale
+void test_dshot_telemetry_timeout(void) {
+  const uint16_t erpm = (3 << 9) | 0x1a0;
+  dshot_telemetry_update(0, DSHOT_GCR_OK, erpm);
+  const uint32_t rpm = state.dshot_rpm[0];
+  TEST_ASSERT_NOT_EQUAL(0, rpm);
+
+  // single bad frames keep the last value
+  for (uint32_t i = 0; i < DSHOT_TELEMETRY_MAX_MISSES - 1; i++) {
+    dshot_telemetry_update(0, DSHOT_GCR_BAD_CHECKSUM, 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(rpm, state.dshot_rpm[0]);
+  dshot_telemetry_update(0, DSHOT_GCR_OK, erpm);
+
+  for (uint32_t i = 0; i < DSHOT_TELEMETRY_MAX_MISSES - 1; i++) {
+    dshot_telemetry_update(0, DSHOT_GCR_NO_FRAME, 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(rpm, state.dshot_rpm[0]);
+  dshot_telemetry_update(0, DSHOT_GCR_NO_FRAME, 0);
+  TEST_ASSERT_EQUAL_UINT32(0, state.dshot_rpm[0]);
+
+  dshot_telemetry_update(0, DSHOT_GCR_OK, erpm);
+  TEST_ASSERT_EQUAL_UINT32(rpm, state.dshot_rpm[0]);
+}
+
+// Test queued commands hold the motors stopped, repeat with spacing and drain in order
+void test_dshot_cmd_queue(void) {
+  dshot_cmd_queue_t queue;
+  dshot_cmd_queue_reset(&queue);
+
+  uint8_t command = 0xff;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_IDLE, dshot_cmd_queue_update(&queue, 0, &command));
+
+  const dshot_cmd_t save = {
+      .command = DSHOT_CMD_SAVE_SETTINGS,
+      .repeat = 3,
+      .delay_us = 100,
+      .spacing_us = 10,
+  };
+  const dshot_cmd_t beep = {
+      .command = DSHOT_CMD_BEEP2,
+      .repeat = 1,
+  };
+  TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &save));
+  TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &beep));
+  TEST_ASSERT_TRUE(dshot_cmd_queue_pending(&queue, DSHOT_CMD_SAVE_SETTINGS));
+  TEST_ASSERT_FALSE(dshot_cmd_queue_pending(&queue, DSHOT_CMD_BEEP1));
+
+  // stop frames for the idle time before the first send
+  uint32_t now = 1000;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_WAIT, dshot_cmd_queue_update(&queue, now, &command));
+  TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_MOTOR_STOP, command);
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_WAIT, dshot_cmd_queue_update(&queue, now + 99, &command));
+
+  now += 100;
+  for (uint32_t i = 0; i < save.repeat; i++) {
+    TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_SEND, dshot_cmd_queue_update(&queue, now, &command));
+    TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_SAVE_SETTINGS, command);
+    if (i + 1 < save.repeat) {
+      TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_WAIT, dshot_cmd_queue_update(&queue, now + 9, &command));
+      now += 10;
+    }
+  }
+  TEST_ASSERT_FALSE(dshot_cmd_queue_pending(&queue, DSHOT_CMD_SAVE_SETTINGS));
+
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_SEND, dshot_cmd_queue_update(&queue, now, &command));
+  TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_BEEP2, command);
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_IDLE, dshot_cmd_queue_update(&queue, now, &command));
+
+  // out of range commands, empty repeats and a full ring are refused
+  const dshot_cmd_t invalid = {
+      .command = DSHOT_CMD_MAX + 1,
+      .repeat = 1,
+  };
+  const dshot_cmd_t never = {
+      .command = DSHOT_CMD_BEEP1,
+      .repeat = 0,
+  };
+  TEST_ASSERT_FALSE(dshot_cmd_queue_push(&queue, &invalid));
+  TEST_ASSERT_FALSE(dshot_cmd_queue_push(&queue, &never));
+
+  for (uint32_t i = 0; i < DSHOT_CMD_QUEUE_SIZE - 1; i++) {
+    TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &beep));
+  }
+  TEST_ASSERT_FALSE(dshot_cmd_queue_push(&queue, &beep));
+}
+
+// Test flushing on arm drops settings but keeps direction changes in order
+void test_dshot_cmd_queue_flush(void) {
+  dshot_cmd_queue_t queue;
+  dshot_cmd_queue_reset(&queue);
+
+  const dshot_cmd_t led = {
+      .command = DSHOT_CMD_LED0_ON,
+      .repeat = 10,
+      .delay_us = 100,
+      .spacing_us = 10,
+  };
+  const dshot_cmd_t reverse = {
+      .command = DSHOT_CMD_ROTATE_REVERSE,
+      .repeat = 2,
+      .delay_us = 100,
+      .spacing_us = 10,
+  };
+  const dshot_cmd_t save = {
+      .command = DSHOT_CMD_SAVE_SETTINGS,
+      .repeat = 10,
+      .delay_us = 100,
+      .spacing_us = 10,
+  };
+  TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &led));
+  TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &reverse));
+  TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &save));
+
+  // the led command is already being sent when the pilot arms
+  uint8_t command = 0xff;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_WAIT, dshot_cmd_queue_update(&queue, 1000, &command));
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_SEND, dshot_cmd_queue_update(&queue, 1100, &command));
+  TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_LED0_ON, command);
+
+  dshot_cmd_queue_flush(&queue);
+  TEST_ASSERT_FALSE(dshot_cmd_queue_pending(&queue, DSHOT_CMD_LED0_ON));
+  TEST_ASSERT_FALSE(dshot_cmd_queue_pending(&queue, DSHOT_CMD_SAVE_SETTINGS));
+  TEST_ASSERT_TRUE(dshot_cmd_queue_pending(&queue, DSHOT_CMD_ROTATE_REVERSE));
+
+  // the direction change starts over with its own idle time
+  uint32_t now = 2000;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_WAIT, dshot_cmd_queue_update(&queue, now, &command));
+  TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_MOTOR_STOP, command);
+  now += 100;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_SEND, dshot_cmd_queue_update(&queue, now, &command));
+  TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_ROTATE_REVERSE, command);
+  now += 10;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_SEND, dshot_cmd_queue_update(&queue, now, &command));
+  TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_ROTATE_REVERSE, command);
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_IDLE, dshot_cmd_queue_update(&queue, now, &command));
+
+  // a direction change already in flight keeps its progress
+  TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &reverse));
+  TEST_ASSERT_TRUE(dshot_cmd_queue_push(&queue, &save));
+  now += 1000;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_WAIT, dshot_cmd_queue_update(&queue, now, &command));
+  now += 100;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_SEND, dshot_cmd_queue_update(&queue, now, &command));
+
+  dshot_cmd_queue_flush(&queue);
+  now += 10;
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_SEND, dshot_cmd_queue_update(&queue, now, &command));
+  TEST_ASSERT_EQUAL_UINT8(DSHOT_CMD_ROTATE_REVERSE, command);
+  TEST_ASSERT_EQUAL_INT(DSHOT_CMD_STATE_IDLE, dshot_cmd_queue_update(&queue, now, &command));
+}
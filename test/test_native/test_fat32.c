@@ -0,0 +1,163 @@
+#include <string.h>
+#include <unity.h>
+
+// Include the FAT32 helpers
+#include "util/fat32.h"
+
+static void put_u16(uint8_t *p, uint16_t val) {
+  p[0] = val;
+  p[1] = val >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t val) {
+  p[0] = val;
+  p[1] = val >> 8;
+  p[2] = val >> 16;
+  p[3] = val >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Builds a boot record: 8 sectors per cluster, 32 reserved, 2 fats of 16 sectors
+static void make_boot_record(uint8_t *sector) {
+  memset(sector, 0, FAT32_SECTOR_SIZE);
+  sector[0] = 0xEB;
+  put_u16(sector + 11, FAT32_SECTOR_SIZE);
+  sector[13] = 8;
+  put_u16(sector + 14, 32);
+  sector[16] = 2;
+  put_u32(sector + 32, 16384);
+  put_u32(sector + 36, 16);
+  put_u32(sector + 44, 2);
+  put_u16(sector + 48, 1);
+  put_u16(sector + 510, 0xAA55);
+}
+
+// Test volume detection with and without partition table
+void test_fat32_find_volume(void) {
+  uint8_t sector[FAT32_SECTOR_SIZE];
+  uint32_t lba = 1234;
+
+  make_boot_record(sector);
+  TEST_ASSERT_TRUE(fat32_find_volume(sector, &lba));
+  TEST_ASSERT_EQUAL_UINT32(0, lba);
+
+  // mbr with a fat32 lba partition
+  memset(sector, 0, FAT32_SECTOR_SIZE);
+  sector[446 + 16 + 4] = 0x0C;
+  put_u32(sector + 446 + 16 + 8, 8192);
+  put_u16(sector + 510, 0xAA55);
+  TEST_ASSERT_TRUE(fat32_find_volume(sector, &lba));
+  TEST_ASSERT_EQUAL_UINT32(8192, lba);
+
+  // exfat partition is not supported
+  sector[446 + 16 + 4] = 0x07;
+  TEST_ASSERT_FALSE(fat32_find_volume(sector, &lba));
+
+  // blank card
+  memset(sector, 0, FAT32_SECTOR_SIZE);
+  TEST_ASSERT_FALSE(fat32_find_volume(sector, &lba));
+}
+
+// Test boot record parsing
+void test_fat32_parse_volume(void) {
+  uint8_t sector[FAT32_SECTOR_SIZE];
+  make_boot_record(sector);
+
+  fat32_volume_t vol;
+  TEST_ASSERT_TRUE(fat32_parse_volume(&vol, sector, 100));
+  TEST_ASSERT_EQUAL_UINT32(132, vol.fat_lba);
+  TEST_ASSERT_EQUAL_UINT32(164, vol.data_lba);
+  TEST_ASSERT_EQUAL_UINT32(101, vol.fsinfo_lba);
+  TEST_ASSERT_EQUAL_UINT32(2, vol.root_cluster);
+  TEST_ASSERT_EQUAL_UINT32((16384 - 64) / 8, vol.cluster_count);
+
+  TEST_ASSERT_EQUAL_UINT32(164, fat32_cluster_lba(&vol, 2));
+  TEST_ASSERT_EQUAL_UINT32(172, fat32_cluster_lba(&vol, 3));
+  TEST_ASSERT_EQUAL_UINT32(4096, fat32_cluster_size(&vol));
+  TEST_ASSERT_EQUAL_UINT32(0, fat32_clusters_for(&vol, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, fat32_clusters_for(&vol, 4096));
+  TEST_ASSERT_EQUAL_UINT32(2, fat32_clusters_for(&vol, 4097));
+
+  // fat16 style record with a fixed root directory
+  put_u16(sector + 17, 512);
+  TEST_ASSERT_FALSE(fat32_parse_volume(&vol, sector, 100));
+}
+
+// Test chain allocation across two fat sectors
+void test_fat32_set_chain(void) {
+  uint8_t fat0[FAT32_SECTOR_SIZE];
+  uint8_t fat1[FAT32_SECTOR_SIZE];
+  memset(fat0, 0, FAT32_SECTOR_SIZE);
+  memset(fat1, 0, FAT32_SECTOR_SIZE);
+
+  // reserved upper bits must survive
+  put_u32(fat0 + 127 * 4, 0xF0000000);
+
+  fat32_set_chain(fat0, 0, 126, 4, true);
+  fat32_set_chain(fat1, 1, 126, 4, true);
+
+  TEST_ASSERT_EQUAL_UINT32(127, fat32_entry(fat0, 126));
+  TEST_ASSERT_EQUAL_UINT32(128, fat32_entry(fat0, 127));
+  TEST_ASSERT_EQUAL_HEX32(0xF0000080, get_u32(fat0 + 127 * 4));
+  TEST_ASSERT_EQUAL_UINT32(129, fat32_entry(fat1, 128));
+  TEST_ASSERT_EQUAL_HEX32(FAT32_CLUSTER_EOC, fat32_entry(fat1, 129));
+  TEST_ASSERT_EQUAL_UINT32(FAT32_CLUSTER_FREE, fat32_entry(fat1, 130));
+
+  fat32_set_chain(fat0, 0, 126, 4, false);
+  TEST_ASSERT_EQUAL_UINT32(FAT32_CLUSTER_FREE, fat32_entry(fat0, 126));
+  TEST_ASSERT_EQUAL_HEX32(0xF0000000, get_u32(fat0 + 127 * 4));
+}
+
+// Test search for the longest free run
+void test_fat32_scan_free(void) {
+  uint8_t sector[FAT32_SECTOR_SIZE];
+  make_boot_record(sector);
+
+  fat32_volume_t vol;
+  fat32_parse_volume(&vol, sector, 0);
+
+  uint8_t fat[FAT32_SECTOR_SIZE];
+  memset(fat, 0, FAT32_SECTOR_SIZE);
+  fat32_set_chain(fat, 0, 2, 8, true);
+  fat32_set_chain(fat, 0, 20, 1, true);
+
+  fat32_run_t current = {0, 0};
+  fat32_run_t best = {0, 0};
+  fat32_scan_free(&vol, fat, 0, &current, &best);
+  TEST_ASSERT_EQUAL_UINT32(21, best.start);
+  TEST_ASSERT_EQUAL_UINT32(FAT32_ENTRIES_PER_SECTOR - 21, best.count);
+
+  // run continues into the next fat sector
+  memset(fat, 0, FAT32_SECTOR_SIZE);
+  fat32_set_chain(fat, 1, 140, 1, true);
+  fat32_scan_free(&vol, fat, 1, &current, &best);
+  TEST_ASSERT_EQUAL_UINT32(21, best.start);
+  TEST_ASSERT_EQUAL_UINT32(140 - 21, best.count);
+}
+
+// Test directory entry and fsinfo helpers
+void test_fat32_dir_entry(void) {
+  TEST_ASSERT_EQUAL_UINT32(32, sizeof(fat32_dir_entry_t));
+
+  fat32_dir_entry_t entry;
+  fat32_make_dir_entry(&entry, "LOG00042BFL", 0x12345, 1000);
+  TEST_ASSERT_EQUAL_MEMORY("LOG00042BFL", entry.name, 11);
+  TEST_ASSERT_EQUAL_UINT8(FAT32_ATTR_ARCHIVE, entry.attr);
+  TEST_ASSERT_EQUAL_UINT32(0x12345, fat32_dir_entry_cluster(&entry));
+  TEST_ASSERT_EQUAL_UINT32(1000, entry.file_size);
+
+  uint8_t fsinfo[FAT32_SECTOR_SIZE];
+  memset(fsinfo, 0, FAT32_SECTOR_SIZE);
+  fat32_update_fsinfo(fsinfo, 10);
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, fat32_fsinfo_next_free(fsinfo));
+
+  put_u32(fsinfo, 0x41615252);
+  put_u32(fsinfo + 484, 0x61417272);
+  put_u32(fsinfo + 488, 5000);
+  fat32_update_fsinfo(fsinfo, 10);
+  TEST_ASSERT_EQUAL_UINT32(10, fat32_fsinfo_next_free(fsinfo));
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, get_u32(fsinfo + 488));
+}
@@ -0,0 +1,200 @@
+#include <string.h>
+#include <unity.h>
+
+#include "core/boot_profile.h"
+#include "core/flash.h"
+#include "core/profile.h"
+#include "core/target.h"
+#include "driver/fmc.h"
+
+extern profile_t profile;
+
+// every save changes both the profile and the raw storage blob
+static void flash_test_set_state(uint32_t index) {
+  profile.voltage.vbat_scale = 100.0f + index;
+  flash_storage.accelcal[0] = index;
+}
+
+static void flash_test_clear_state() {
+  profile.voltage.vbat_scale = -1.0f;
+  flash_storage.accelcal[0] = -1.0f;
+}
+
+static bool flash_test_is_state(uint32_t index) {
+  return profile.voltage.vbat_scale == 100.0f + index && flash_storage.accelcal[0] == index;
+}
+
+// saves states 0..count-1 on a blank flash
+static void flash_test_replay(uint32_t count) {
+  fmc_emulator_reset();
+  for (uint32_t i = 0; i < count; i++) {
+    flash_test_set_state(i);
+    flash_save();
+  }
+}
+
+void test_flash_save_load_roundtrip(void) {
+  flash_test_replay(1);
+
+  flash_test_clear_state();
+  flash_load();
+  TEST_ASSERT_TRUE(flash_test_is_state(0));
+
+  flash_test_set_state(1);
+  flash_save();
+
+  flash_test_clear_state();
+  flash_load();
+  TEST_ASSERT_TRUE(flash_test_is_state(1));
+}
+
+void test_flash_save_appends_without_erase(void) {
+  flash_test_replay(1);
+  TEST_ASSERT_EQUAL_UINT32(1, fmc_emulator_erases());
+
+  // only the changed records are written, not the whole snapshot
+  const uint32_t ops = fmc_emulator_ops();
+  flash_test_set_state(1);
+  flash_save();
+  TEST_ASSERT_EQUAL_UINT32(1, fmc_emulator_erases());
+  TEST_ASSERT_LESS_THAN(ops, fmc_emulator_ops() - ops);
+
+  // saving the same state again writes nothing
+  const uint32_t unchanged = fmc_emulator_ops();
+  flash_save();
+  TEST_ASSERT_EQUAL_UINT32(unchanged, fmc_emulator_ops());
+}
+
+void test_flash_compaction(void) {
+  fmc_emulator_reset();
+  for (uint32_t i = 0; i < 64; i++) {
+    flash_test_set_state(i);
+    flash_save();
+
+    flash_test_clear_state();
+    flash_load();
+    TEST_ASSERT_TRUE(flash_test_is_state(i));
+  }
+
+  // several saves fit a bank between erases, the profile image never takes their space
+  TEST_ASSERT_GREATER_THAN(1, fmc_emulator_erases());
+  TEST_ASSERT_LESS_OR_EQUAL(64 / 3 + 1, fmc_emulator_erases());
+}
+
+// cuts the power at every program and erase operation of the save after the replayed ones
+static void flash_test_power_loss(uint32_t saves) {
+  flash_test_replay(saves + 1);
+  const uint32_t total = fmc_emulator_ops();
+  flash_test_replay(saves);
+  const uint32_t ops = total - fmc_emulator_ops();
+
+  for (uint32_t cut = 0; cut <= ops; cut++) {
+    flash_test_replay(saves);
+
+    fmc_emulator_cut_power(cut);
+    flash_test_set_state(saves);
+    flash_save();
+    fmc_emulator_restore_power();
+
+    // every blob is either the old or the new one
+    flash_test_clear_state();
+    flash_load();
+    const bool old_profile = profile.voltage.vbat_scale == 100.0f + saves - 1;
+    const bool new_profile = profile.voltage.vbat_scale == 100.0f + saves;
+    const bool old_storage = flash_storage.accelcal[0] == saves - 1;
+    const bool new_storage = flash_storage.accelcal[0] == saves;
+    TEST_ASSERT_TRUE(old_profile || new_profile);
+    TEST_ASSERT_TRUE(old_storage || new_storage);
+
+    // and the next save recovers
+    flash_test_set_state(saves + 1);
+    flash_save();
+    flash_test_clear_state();
+    flash_load();
+    TEST_ASSERT_TRUE(flash_test_is_state(saves + 1));
+  }
+}
+
+void test_flash_power_loss_append(void) {
+  flash_test_power_loss(1);
+}
+
+void test_flash_power_loss_compaction(void) {
+  // find the first save that has to compact
+  fmc_emulator_reset();
+  uint32_t saves = 0;
+  while (fmc_emulator_erases() < 2) {
+    flash_test_set_state(saves++);
+    flash_save();
+  }
+
+  flash_test_power_loss(saves - 1);
+}
+
+static bool flash_test_boot_stage(const char *name) {
+  for (uint32_t i = 0; i < boot_profile.stage_count; i++) {
+    if (strcmp(boot_profile.stages[i].name, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool flash_test_load_stage(const char *name) {
+  boot_profile_start();
+  flash_test_clear_state();
+  flash_load();
+  boot_profile_finish();
+  return flash_test_boot_stage(name);
+}
+
+void test_flash_profile_image(void) {
+  flash_test_replay(1);
+  TEST_ASSERT_TRUE(flash_test_load_stage("profile cbor"));
+
+  // small saves fill the bank until no profile record fits, the image only goes into that tail
+  const uint32_t erases = fmc_emulator_erases();
+  uint32_t saves = 1;
+  while (!flash_test_load_stage("profile image")) {
+    TEST_ASSERT_LESS_THAN(64, saves);
+    flash_test_set_state(0);
+    flash_storage.accelcal[0] = saves++;
+    flash_save();
+  }
+  TEST_ASSERT_EQUAL_FLOAT(100.0f, profile.voltage.vbat_scale);
+  TEST_ASSERT_EQUAL_UINT32(erases, fmc_emulator_erases());
+
+  // images of another build fall back to the cbor record
+  const char *git_version = target_info.git_version;
+  target_info.git_version = "other";
+  TEST_ASSERT_TRUE(flash_test_load_stage("profile cbor"));
+  TEST_ASSERT_EQUAL_FLOAT(100.0f, profile.voltage.vbat_scale);
+  target_info.git_version = git_version;
+
+  // a changed profile does not match the image until it is written again
+  flash_test_set_state(7);
+  flash_save();
+  TEST_ASSERT_TRUE(flash_test_load_stage("profile cbor"));
+  TEST_ASSERT_TRUE(flash_test_is_state(7));
+
+  // stages are no longer recorded once booted
+  const uint32_t stages = boot_profile.stage_count;
+  flash_load();
+  TEST_ASSERT_EQUAL_UINT32(stages, boot_profile.stage_count);
+}
+
+// the profile record is capped, the worst case profile has to encode within it
+void test_flash_profile_record_size(void) {
+  profile_set_defaults();
+  memset(profile.meta.name, 'x', sizeof(profile.meta.name) - 1);
+  for (uint32_t i = 0; i < OSD_PROFILE_MAX; i++) {
+    memset(profile.osd.profiles[i].callsign, 'x', sizeof(profile.osd.profiles[i].callsign) - 1);
+  }
+
+  static uint8_t data[PROFILE_STORAGE_SIZE - FMC_MAGIC_SIZE];
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, data, sizeof(data));
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_profile_t(&enc, &profile));
+
+  profile_set_defaults();
+}
@@ -0,0 +1,107 @@
+#include <math.h>
+#include <unity.h>
+
+#include "flight/gyro_bias.h"
+#include "util/util.h"
+
+#define DT (GYRO_BIAS_DIVIDER / 8000.0f)
+
+static const vec3_t level = {{0, 0, 1}};
+
+// the residual seen by the estimator is the true bias minus its estimate
+static vec3_t gyro_bias_test_residual(const gyro_bias_t *b, const vec3_t *truth) {
+  return vec3_sub(*truth, b->bias);
+}
+
+void test_gyro_bias_still(void) {
+  gyro_bias_t est;
+  gyro_bias_reset(&est);
+  est.confidence = 0.0f;
+
+  const vec3_t truth = {{2.0f * DEGTORAD, -1.0f * DEGTORAD, 0.5f * DEGTORAD}};
+  for (uint32_t i = 0; i < GYRO_BIAS_WINDOW * 40; i++) {
+    // a bit of noise, well below the stillness limit
+    const float noise = (i % 2 ? 0.1f : -0.1f) * DEGTORAD;
+    vec3_t gyro = gyro_bias_test_residual(&est, &truth);
+    gyro.roll += noise;
+    gyro_bias_update(&est, GYRO_BIAS_STILL, &gyro, &level, &level, DT);
+  }
+
+  for (uint32_t i = 0; i < 3; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.01f * DEGTORAD, truth.axis[i], est.bias.axis[i]);
+  }
+  TEST_ASSERT_GREATER_THAN(0.9f, est.confidence);
+}
+
+void test_gyro_bias_still_rejects_motion(void) {
+  gyro_bias_t est;
+  gyro_bias_reset(&est);
+
+  // carried around, too much variance
+  for (uint32_t i = 0; i < GYRO_BIAS_WINDOW * 10; i++) {
+    const vec3_t gyro = {{(i % 2 ? 5.0f : -3.0f) * DEGTORAD, 0, 0}};
+    gyro_bias_update(&est, GYRO_BIAS_STILL, &gyro, &level, &level, DT);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, est.bias.roll);
+
+  // slowly rotating, too large a mean
+  for (uint32_t i = 0; i < GYRO_BIAS_WINDOW * 10; i++) {
+    const vec3_t gyro = {{0, 0, 20.0f * DEGTORAD}};
+    gyro_bias_update(&est, GYRO_BIAS_STILL, &gyro, &level, &level, DT);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, est.bias.yaw);
+
+  // confidence only fades
+  TEST_ASSERT_LESS_THAN(1.0f, est.confidence);
+
+  // a window interrupted by an arm is dropped
+  const vec3_t gyro = {{1.0f * DEGTORAD, 0, 0}};
+  for (uint32_t i = 0; i < GYRO_BIAS_WINDOW - 1; i++) {
+    gyro_bias_update(&est, GYRO_BIAS_STILL, &gyro, &level, &level, DT);
+  }
+  gyro_bias_update(&est, GYRO_BIAS_IDLE, &gyro, &level, &level, DT);
+  gyro_bias_update(&est, GYRO_BIAS_STILL, &gyro, &level, &level, DT);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, est.bias.roll);
+}
+
+void test_gyro_bias_gravity(void) {
+  gyro_bias_t est;
+  gyro_bias_reset(&est);
+
+  // flying tilted while turning, so gravity moves through every body axis
+  const vec3_t truth = {{1.0f * DEGTORAD, -2.0f * DEGTORAD, 0.5f * DEGTORAD}};
+  const vec3_t rate = {{0, 0, 10.0f * DEGTORAD}};
+  vec3_t accel = {{0.3f, 0.2f, 0.93f}};
+  accel = vec3_mul(accel, 1.0f / vec3_magnitude(&accel));
+
+  vec3_t gravity = accel;
+  for (uint32_t i = 0; i < (uint32_t)(180.0f / DT); i++) {
+    const vec3_t true_rot = {{-rate.pitch * DT, rate.roll * DT, rate.yaw * DT}};
+    accel = vec3_rotate(accel, true_rot);
+    accel = vec3_mul(accel, 1.0f / vec3_magnitude(&accel));
+
+    // propagate like the imu does and fuse the accel with its in air filter time
+    const vec3_t gyro = vec3_add(rate, gyro_bias_test_residual(&est, &truth));
+    const vec3_t rot = {{-gyro.pitch * DT, gyro.roll * DT, gyro.yaw * DT}};
+    gravity = vec3_rotate(gravity, rot);
+    gravity = vec3_add(gravity, vec3_mul(vec3_sub(accel, gravity), DT / 6.0f));
+
+    gyro_bias_update(&est, GYRO_BIAS_GRAVITY, &gyro, &accel, &gravity, DT);
+  }
+
+  for (uint32_t i = 0; i < 3; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.1f * DEGTORAD, truth.axis[i], est.bias.axis[i]);
+  }
+
+  // high g manoeuvres are no gravity reference
+  const vec3_t before = est.bias;
+  const vec3_t pulled = vec3_mul(accel, 2.0f);
+  const vec3_t gyro = {{0, 0, 0}};
+  gyro_bias_update(&est, GYRO_BIAS_GRAVITY, &gyro, &pulled, &level, DT);
+  TEST_ASSERT_EQUAL_MEMORY(&before, &est.bias, sizeof(vec3_t));
+
+  // neither are moderate ones the imu would still normalise to 1g
+  const vec3_t turning = vec3_mul(accel, 1.2f);
+  gyro_bias_update(&est, GYRO_BIAS_GRAVITY, &gyro, &turning, &level, DT);
+  TEST_ASSERT_EQUAL_MEMORY(&before, &est.bias, sizeof(vec3_t));
+}
@@ -0,0 +1,86 @@
+#include <unity.h>
+
+#include "flight/gyro_cal.h"
+
+static void gyro_cal_test_add(gyro_cal_model_t *m, float temp, float bias) {
+  const float b[3] = {bias, -bias, 2 * bias};
+  gyro_cal_add(m, temp, b);
+}
+
+static float gyro_cal_test_predict(const gyro_cal_model_t *m, float temp) {
+  float bias[3];
+  TEST_ASSERT_TRUE(gyro_cal_predict(m, temp, bias));
+  TEST_ASSERT_EQUAL_FLOAT(-bias[0], bias[1]);
+  TEST_ASSERT_EQUAL_FLOAT(2 * bias[0], bias[2]);
+  return bias[0];
+}
+
+void test_gyro_cal_invalid(void) {
+  gyro_cal_model_t m = {};
+  float bias[3];
+  TEST_ASSERT_FALSE(gyro_cal_predict(&m, 25.0f, bias));
+
+  // an empty model predicts nothing either
+  gyro_cal_reset(&m);
+  TEST_ASSERT_FALSE(gyro_cal_predict(&m, 25.0f, bias));
+
+  // garbage is replaced on the first add
+  m.magic = 0;
+  m.count = 100;
+  gyro_cal_test_add(&m, 25.0f, 10.0f);
+  TEST_ASSERT_EQUAL_UINT32(1, m.count);
+  TEST_ASSERT_EQUAL_FLOAT(10.0f, gyro_cal_test_predict(&m, 25.0f));
+}
+
+void test_gyro_cal_single_point(void) {
+  gyro_cal_model_t m;
+  gyro_cal_reset(&m);
+  gyro_cal_test_add(&m, 25.0f, 10.0f);
+
+  TEST_ASSERT_EQUAL_FLOAT(10.0f, gyro_cal_test_predict(&m, 0.0f));
+  TEST_ASSERT_EQUAL_FLOAT(10.0f, gyro_cal_test_predict(&m, 60.0f));
+}
+
+void test_gyro_cal_linear(void) {
+  gyro_cal_model_t m;
+  gyro_cal_reset(&m);
+  gyro_cal_test_add(&m, 20.0f, 10.0f);
+  gyro_cal_test_add(&m, 40.0f, 30.0f);
+
+  TEST_ASSERT_EQUAL_FLOAT(10.0f, gyro_cal_test_predict(&m, 20.0f));
+  TEST_ASSERT_EQUAL_FLOAT(20.0f, gyro_cal_test_predict(&m, 30.0f));
+  TEST_ASSERT_EQUAL_FLOAT(30.0f, gyro_cal_test_predict(&m, 40.0f));
+
+  // no extrapolation past the measured range
+  TEST_ASSERT_EQUAL_FLOAT(10.0f, gyro_cal_test_predict(&m, 0.0f));
+  TEST_ASSERT_EQUAL_FLOAT(30.0f, gyro_cal_test_predict(&m, 80.0f));
+
+  // points too close together give a constant bias
+  gyro_cal_reset(&m);
+  gyro_cal_test_add(&m, 20.0f, 10.0f);
+  gyro_cal_test_add(&m, 24.0f, 30.0f);
+  TEST_ASSERT_EQUAL_UINT32(2, m.count);
+  TEST_ASSERT_EQUAL_FLOAT(20.0f, gyro_cal_test_predict(&m, 20.0f));
+}
+
+void test_gyro_cal_replace(void) {
+  gyro_cal_model_t m;
+  gyro_cal_reset(&m);
+
+  // within a bin the newer calibration wins
+  gyro_cal_test_add(&m, 20.0f, 10.0f);
+  gyro_cal_test_add(&m, 21.0f, 12.0f);
+  TEST_ASSERT_EQUAL_UINT32(1, m.count);
+  TEST_ASSERT_EQUAL_FLOAT(12.0f, gyro_cal_test_predict(&m, 20.0f));
+
+  for (uint32_t i = 1; i < GYRO_CAL_POINTS; i++) {
+    gyro_cal_test_add(&m, 21.0f + i * 10.0f, 12.0f);
+  }
+  TEST_ASSERT_EQUAL_UINT32(GYRO_CAL_POINTS, m.count);
+
+  // a full model replaces the closest point
+  gyro_cal_test_add(&m, 29.0f, 50.0f);
+  TEST_ASSERT_EQUAL_UINT32(GYRO_CAL_POINTS, m.count);
+  TEST_ASSERT_EQUAL_FLOAT(29.0f, m.points[1].temp);
+  TEST_ASSERT_EQUAL_FLOAT(50.0f, m.points[1].bias[0]);
+}
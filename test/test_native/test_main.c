@@ -58,12 +58,26 @@ extern void test_ring_buffer_wrap_around(void);
 extern void test_ring_buffer_clear(void);
 extern void test_ring_buffer_partial_multi_write(void);
 extern void test_ring_buffer_partial_multi_read(void);
+extern void test_ring_buffer_write_reserve(void);
+extern void test_ring_buffer_read_reserve(void);
 
 // SPI tests
 extern void test_spi_init(void);
 extern void test_spi_txn_queue(void);
 extern void test_spi_dma_ready(void);
 extern void test_spi_reconfigure(void);
+extern void test_spi_lane_preempt(void);
+extern void test_spi_lane_reserve(void);
+extern void test_spi_seg_dma(void);
+
+// SPI emulator tests
+extern void test_spi_emulator_m25p16(void);
+extern void test_spi_emulator_sdcard(void);
+extern void test_spi_emulator_max7456(void);
+extern void test_spi_emulator_max7456_display(void);
+extern void test_spi_emulator_icm42688(void);
+extern void test_spi_emulator_sx1280(void);
+extern void test_spi_emulator_isr_latency(void);
 
 // ADC tests
 extern void test_adc_init(void);
@@ -97,6 +111,73 @@ extern void test_blackbox_pframe_field_optimization(void);
 extern void test_blackbox_cbor_vec3_roundtrip(void);
 extern void test_blackbox_cbor_vec4_roundtrip(void);
 extern void test_blackbox_iframe_interval(void);
+extern void test_blackbox_decode_columnar(void);
+extern void test_blackbox_decode_csv_image(void);
+extern void test_blackbox_decode_stream_resync(void);
+
+// FAT32 tests
+extern void test_fat32_find_volume(void);
+extern void test_fat32_parse_volume(void);
+extern void test_fat32_set_chain(void);
+extern void test_fat32_scan_free(void);
+extern void test_fat32_dir_entry(void);
+
+// QUIC tests
+extern void test_quic_blackbox_stream(void);
+extern void test_quic_profile_patch(void);
+extern void test_quic_telemetry_subscribe(void);
+extern void test_quic_continuation_frames(void);
+extern void test_quic_in_place_encode(void);
+extern void test_quic_motor_test_values(void);
+
+// CBOR tests
+extern void test_cbor_int_keys_profile(void);
+extern void test_cbor_int_keys_target(void);
+extern void test_cbor_key_tables(void);
+
+// Flash tests
+extern void test_flash_save_load_roundtrip(void);
+extern void test_flash_save_appends_without_erase(void);
+extern void test_flash_compaction(void);
+extern void test_flash_power_loss_append(void);
+extern void test_flash_power_loss_compaction(void);
+extern void test_flash_profile_image(void);
+extern void test_flash_profile_record_size(void);
+
+// Gyro calibration tests
+extern void test_gyro_cal_invalid(void);
+extern void test_gyro_cal_single_point(void);
+extern void test_gyro_cal_linear(void);
+extern void test_gyro_cal_replace(void);
+
+// Gyro bias tests
+extern void test_gyro_bias_still(void);
+extern void test_gyro_bias_still_rejects_motion(void);
+extern void test_gyro_bias_gravity(void);
+
+// Serial 4way tests
+extern void test_serial_4way_crc(void);
+extern void test_serial_4way_flash_sequential(void);
+extern void test_serial_4way_flash_parallel(void);
+extern void test_serial_4way_flash_parallel_missing(void);
+extern void test_serial_4way_flash_parallel_mismatch(void);
+
+// DShot tests
+extern void test_dshot_bitbang_encode(void);
+extern void test_dshot_bitbang_encode_benchmark(void);
+extern void test_dshot_gcr_decode(void);
+extern void test_dshot_edt(void);
+extern void test_dshot_telemetry_timeout(void);
+extern void test_dshot_cmd_queue(void);
+extern void test_dshot_cmd_queue_flush(void);
+
+// Motor tests
+extern void test_motor_mixer_quad(void);
+extern void test_motor_mixer_hex(void);
+extern void test_motor_mixer_benchmark(void);
+extern void test_motor_output_thrust_linear(void);
+extern void test_motor_output_vbat_sag(void);
+extern void test_motor_mixer_vbat_sag_headroom(void);
 
 // Common setUp and tearDown
 void setUp(void) {
@@ -168,12 +249,26 @@ int main(int argc, char **argv) {
   RUN_TEST(test_ring_buffer_clear);
   RUN_TEST(test_ring_buffer_partial_multi_write);
   RUN_TEST(test_ring_buffer_partial_multi_read);
+  RUN_TEST(test_ring_buffer_write_reserve);
+  RUN_TEST(test_ring_buffer_read_reserve);
 
   // SPI tests
   RUN_TEST(test_spi_init);
   RUN_TEST(test_spi_txn_queue);
   RUN_TEST(test_spi_dma_ready);
   RUN_TEST(test_spi_reconfigure);
+  RUN_TEST(test_spi_lane_preempt);
+  RUN_TEST(test_spi_lane_reserve);
+  RUN_TEST(test_spi_seg_dma);
+
+  // SPI emulator tests
+  RUN_TEST(test_spi_emulator_m25p16);
+  RUN_TEST(test_spi_emulator_sdcard);
+  RUN_TEST(test_spi_emulator_max7456);
+  RUN_TEST(test_spi_emulator_max7456_display);
+  RUN_TEST(test_spi_emulator_icm42688);
+  RUN_TEST(test_spi_emulator_sx1280);
+  RUN_TEST(test_spi_emulator_isr_latency);
 
   // ADC tests
   RUN_TEST(test_adc_init);
@@ -207,6 +302,73 @@ int main(int argc, char **argv) {
   RUN_TEST(test_blackbox_cbor_vec3_roundtrip);
   RUN_TEST(test_blackbox_cbor_vec4_roundtrip);
   RUN_TEST(test_blackbox_iframe_interval);
+  RUN_TEST(test_blackbox_decode_columnar);
+  RUN_TEST(test_blackbox_decode_csv_image);
+  RUN_TEST(test_blackbox_decode_stream_resync);
+
+  // FAT32 tests
+  RUN_TEST(test_fat32_find_volume);
+  RUN_TEST(test_fat32_parse_volume);
+  RUN_TEST(test_fat32_set_chain);
+  RUN_TEST(test_fat32_scan_free);
+  RUN_TEST(test_fat32_dir_entry);
+
+  // QUIC tests
+  RUN_TEST(test_quic_blackbox_stream);
+  RUN_TEST(test_quic_profile_patch);
+  RUN_TEST(test_quic_telemetry_subscribe);
+  RUN_TEST(test_quic_continuation_frames);
+  RUN_TEST(test_quic_in_place_encode);
+  RUN_TEST(test_quic_motor_test_values);
+
+  // CBOR tests
+  RUN_TEST(test_cbor_int_keys_profile);
+  RUN_TEST(test_cbor_int_keys_target);
+  RUN_TEST(test_cbor_key_tables);
+
+  // Flash tests
+  RUN_TEST(test_flash_save_load_roundtrip);
+  RUN_TEST(test_flash_save_appends_without_erase);
+  RUN_TEST(test_flash_compaction);
+  RUN_TEST(test_flash_power_loss_append);
+  RUN_TEST(test_flash_power_loss_compaction);
+  RUN_TEST(test_flash_profile_image);
+  RUN_TEST(test_flash_profile_record_size);
+
+  // Gyro calibration tests
+  RUN_TEST(test_gyro_cal_invalid);
+  RUN_TEST(test_gyro_cal_single_point);
+  RUN_TEST(test_gyro_cal_linear);
+  RUN_TEST(test_gyro_cal_replace);
+
+  // Gyro bias tests
+  RUN_TEST(test_gyro_bias_still);
+  RUN_TEST(test_gyro_bias_still_rejects_motion);
+  RUN_TEST(test_gyro_bias_gravity);
+
+  // Serial 4way tests
+  RUN_TEST(test_serial_4way_crc);
+  RUN_TEST(test_serial_4way_flash_sequential);
+  RUN_TEST(test_serial_4way_flash_parallel);
+  RUN_TEST(test_serial_4way_flash_parallel_missing);
+  RUN_TEST(test_serial_4way_flash_parallel_mismatch);
+
+  // DShot tests
+  RUN_TEST(test_dshot_bitbang_encode);
+  RUN_TEST(test_dshot_bitbang_encode_benchmark);
+  RUN_TEST(test_dshot_gcr_decode);
+  RUN_TEST(test_dshot_edt);
+  RUN_TEST(test_dshot_telemetry_timeout);
+  RUN_TEST(test_dshot_cmd_queue);
+  RUN_TEST(test_dshot_cmd_queue_flush);
+
+  // Motor tests
+  RUN_TEST(test_motor_mixer_quad);
+  RUN_TEST(test_motor_mixer_hex);
+  RUN_TEST(test_motor_mixer_benchmark);
+  RUN_TEST(test_motor_output_thrust_linear);
+  RUN_TEST(test_motor_output_vbat_sag);
+  RUN_TEST(test_motor_mixer_vbat_sag_headroom);
 
   return UNITY_END();
 }
\ No newline at end of file
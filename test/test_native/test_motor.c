@@ -0,0 +1,360 @@
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "core/profile.h"
+#include "driver/motor.h"
+#include "driver/time.h"
+#include "flight/control.h"
+#include "flight/motor.h"
+#include "util/util.h"
+
+#define MIXER_BENCH_LOOPS 20000
+#define MIXER_BENCH_RUNS 100
+
+// flat six, motors every 60 degrees starting at the front right
+static const profile_mixer_t mixer_test_hex = {
+    .roll = {-0.5f, -1.0f, -0.5f, 0.5f, 1.0f, 0.5f},
+    .pitch = {-0.866f, 0.0f, 0.866f, 0.866f, 0.0f, -0.866f},
+    .yaw = {1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f},
+    .throttle = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+};
+
+static uint32_t mixer_test_rand = 0x2545F491;
+
+static float mixer_test_uniform() {
+  mixer_test_rand = mixer_test_rand * 1664525 + 1013904223;
+  return (mixer_test_rand >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+}
+
+static void mixer_test_init(bool in_air) {
+  profile_set_defaults();
+  memset(state.motor_mix, 0, sizeof(state.motor_mix));
+
+  profile.motor.invert_yaw = 0;
+  target.brushless = true;
+  flags.on_ground = !in_air;
+  flags.in_air = in_air;
+  flags.arm_state = in_air;
+  flags.motortest_override = false;
+  motor_mixer_update();
+}
+
+// the fixed x quad mix and brushless scale the matrix replaces, checks included
+// kept out of line so both sides of the benchmark pay for a call
+__attribute__((noinline)) static void mixer_test_quad_reference(float mix[MOTOR_PIN_MAX]) {
+  const float yaw = profile.motor.invert_yaw ? -state.pidoutput.yaw : state.pidoutput.yaw;
+  mix[MOTOR_FR] = -state.pidoutput.roll - state.pidoutput.pitch + yaw;
+  mix[MOTOR_FL] = +state.pidoutput.roll - state.pidoutput.pitch - yaw;
+  mix[MOTOR_BR] = -state.pidoutput.roll + state.pidoutput.pitch - yaw;
+  mix[MOTOR_BL] = +state.pidoutput.roll + state.pidoutput.pitch + yaw;
+
+  if (!target.brushless || flags.on_ground || !flags.in_air) {
+    return;
+  }
+
+  float min = FLT_MAX;
+  float max = FLT_MIN;
+  for (uint32_t i = 0; i < 4; i++) {
+    if (mix[i] < min) {
+      min = mix[i];
+    }
+    if (mix[i] > max) {
+      max = mix[i];
+    }
+  }
+
+  const float range = max - min;
+  const float scale = range > 1.0f ? 1.0f / range : 1.0f;
+  const float scaled_throttle = constrain(state.throttle, -min * scale, 1.0f - max * scale);
+  for (uint32_t i = 0; i < 4; i++) {
+    mix[i] = mix[i] * scale + scaled_throttle;
+  }
+}
+
+// armed without idle or limit, the output stage alone shapes the commands
+static void output_test_init() {
+  mixer_test_init(true);
+  profile.motor.digital_idle = 0.0f;
+  profile.motor.motor_limit = 100.0f;
+  profile.motor.thrust_linear = 0.0f;
+  profile.voltage.vbat_sag_compensation = 0.0f;
+  state.lipo_cell_count = 4;
+  state.vbat_cell_avg = 4.2f;
+}
+
+static float output_test_single(float thrust) {
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    state.motor_mix[i] = thrust;
+  }
+  motor_output_calc(state.motor_mix);
+  // undo the 0.0001 armed motors are always mapped above
+  return (state.motor_mix[0] - 0.0001f) / (1.0f - 0.0001f);
+}
+
+// the thrust a quadratic prop delivers for a command
+static float output_test_thrust_reference(float k, float command) {
+  return (1.0f - k) * command + k * command * command;
+}
+
+static void mixer_test_random_input() {
+  state.pidoutput.roll = mixer_test_uniform();
+  state.pidoutput.pitch = mixer_test_uniform();
+  state.pidoutput.yaw = mixer_test_uniform() * 0.5f;
+  state.throttle = (mixer_test_uniform() + 1.0f) * 0.5f;
+}
+
+// Test the default matrix reproduces the fixed x quad mix
+void test_motor_mixer_quad(void) {
+  mixer_test_init(true);
+  TEST_ASSERT_EQUAL_UINT32(4, motor_count());
+
+  for (uint32_t n = 0; n < 1000; n++) {
+    mixer_test_random_input();
+
+    float expected[MOTOR_PIN_MAX] = {0};
+    mixer_test_quad_reference(expected);
+    motor_mixer_calc(state.motor_mix);
+
+    for (uint32_t i = 0; i < 4; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected[i], state.motor_mix[i]);
+    }
+  }
+
+  // reversed props go through the matrix and mix like an inverted yaw
+  for (uint32_t i = 0; i < 4; i++) {
+    profile.mixer.yaw[i] = -profile.mixer.yaw[i];
+  }
+  motor_mixer_update();
+
+  for (uint32_t n = 0; n < 1000; n++) {
+    mixer_test_random_input();
+
+    float expected[MOTOR_PIN_MAX] = {0};
+    profile.motor.invert_yaw = 1;
+    mixer_test_quad_reference(expected);
+    profile.motor.invert_yaw = 0;
+    motor_mixer_calc(state.motor_mix);
+
+    for (uint32_t i = 0; i < 4; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected[i], state.motor_mix[i]);
+    }
+  }
+}
+
+// Test a hex mixes every row, scales into range and keeps the unused pins off
+void test_motor_mixer_hex(void) {
+  mixer_test_init(false);
+  profile.motor.motor_count = 6;
+  profile.mixer = mixer_test_hex;
+  motor_mixer_update();
+  TEST_ASSERT_EQUAL_UINT32(6, motor_count());
+
+  // on the ground the mix is the plain matrix product
+  state.pidoutput.roll = 0.2f;
+  state.pidoutput.pitch = -0.1f;
+  state.pidoutput.yaw = 0.05f;
+  motor_mixer_calc(state.motor_mix);
+  for (uint32_t i = 0; i < 6; i++) {
+    const float expected = mixer_test_hex.roll[i] * 0.2f - mixer_test_hex.pitch[i] * 0.1f + mixer_test_hex.yaw[i] * 0.05f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected, state.motor_mix[i]);
+  }
+
+  // a full roll in the air is scaled into the motor range
+  mixer_test_init(true);
+  profile.motor.motor_count = 6;
+  profile.mixer = mixer_test_hex;
+  motor_mixer_update();
+  state.pidoutput.roll = 1.0f;
+  state.pidoutput.pitch = 0.0f;
+  state.pidoutput.yaw = 0.0f;
+  state.throttle = 0.5f;
+  motor_mixer_calc(state.motor_mix);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, state.motor_mix[1]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, state.motor_mix[4]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, state.motor_mix[0], state.motor_mix[2]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, state.motor_mix[3], state.motor_mix[5]);
+
+  state.motor_mix[6] = state.motor_mix[7] = 0.5f;
+  motor_output_calc(state.motor_mix);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, state.motor_mix[6]);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, state.motor_mix[7]);
+
+  float sum = 0;
+  for (uint32_t i = 0; i < 6; i++) {
+    sum += state.motor_mix[i];
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, sum / 6, state.thrsum);
+
+  // out of range counts fall back to what the pins allow
+  profile.motor.motor_count = 0;
+  TEST_ASSERT_EQUAL_UINT32(4, motor_count());
+  profile.motor.motor_count = 12;
+  TEST_ASSERT_EQUAL_UINT32(MOTOR_PIN_MAX, motor_count());
+}
+
+// Benchmark the matrix quad mix against the fixed one
+static uint32_t mixer_test_bench(float inputs[64][4], bool matrix) {
+  static volatile float sink;
+  float mix[MOTOR_PIN_MAX] = {0};
+
+  const uint32_t start = time_micros();
+  for (uint32_t n = 0; n < MIXER_BENCH_LOOPS; n++) {
+    const float *in = inputs[n % 64];
+    state.pidoutput.roll = in[0];
+    state.pidoutput.pitch = in[1];
+    state.pidoutput.yaw = in[2];
+    state.throttle = in[3];
+    if (matrix) {
+      motor_mixer_calc(mix);
+    } else {
+      mixer_test_quad_reference(mix);
+    }
+    sink = mix[n % 4];
+  }
+  (void)sink;
+  return time_micros() - start;
+}
+
+// Report the quad mixer next to the fixed mix it replaced, host timings are too noisy to assert on
+void test_motor_mixer_benchmark(void) {
+  mixer_test_init(true);
+
+  float inputs[64][4];
+  for (uint32_t i = 0; i < 64; i++) {
+    mixer_test_random_input();
+    inputs[i][0] = state.pidoutput.roll;
+    inputs[i][1] = state.pidoutput.pitch;
+    inputs[i][2] = state.pidoutput.yaw;
+    inputs[i][3] = state.throttle;
+  }
+
+  // interleave the runs and keep the best of each to shake off scheduler noise
+  uint32_t reference_us = UINT32_MAX;
+  uint32_t matrix_us = UINT32_MAX;
+  for (uint32_t run = 0; run < MIXER_BENCH_RUNS; run++) {
+    reference_us = min(reference_us, mixer_test_bench(inputs, false));
+    matrix_us = min(matrix_us, mixer_test_bench(inputs, true));
+  }
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "fixed quad: %u ns, matrix quad: %u ns per mix", reference_us * 1000 / MIXER_BENCH_LOOPS, matrix_us * 1000 / MIXER_BENCH_LOOPS);
+  TEST_MESSAGE(msg);
+}
+
+// Test the thrust curve inverts quadratic props back to a linear response
+void test_motor_output_thrust_linear(void) {
+  output_test_init();
+
+  // off is a plain pass through
+  for (uint32_t i = 0; i <= 100; i++) {
+    const float thrust = i * 0.01f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, thrust, output_test_single(thrust));
+  }
+
+  const float curves[] = {20.0f, 40.0f, 70.0f};
+  for (uint32_t c = 0; c < 3; c++) {
+    profile.motor.thrust_linear = curves[c];
+    const float k = curves[c] * 0.01f;
+
+    float last = 0;
+    for (uint32_t i = 0; i <= 100; i++) {
+      const float thrust = i * 0.01f;
+      const float command = output_test_single(thrust);
+      TEST_ASSERT_FLOAT_WITHIN(0.002f, thrust, output_test_thrust_reference(k, command));
+
+      // commands only ever grow, and sit above the linear ones in between
+      TEST_ASSERT_TRUE(command >= last);
+      TEST_ASSERT_TRUE(command >= thrust - 1e-5f);
+      last = command;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, output_test_single(1.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, output_test_single(0.0f));
+
+    // out of range mixes are clipped before the lookup
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, output_test_single(1.5f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, output_test_single(-0.5f));
+  }
+}
+
+// Test the outputs are scaled up as the pack sags
+void test_motor_output_vbat_sag(void) {
+  output_test_init();
+
+  // off leaves the outputs alone at any voltage
+  state.vbat_cell_avg = 3.5f;
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, output_test_single(0.5f));
+
+  profile.voltage.vbat_sag_compensation = 100.0f;
+  state.vbat_cell_avg = 4.2f;
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, output_test_single(0.5f));
+
+  // rpm is proportional to voltage times command, keep the product constant
+  const float cells[] = {4.0f, 3.7f, 3.5f, 3.2f};
+  for (uint32_t i = 0; i < 4; i++) {
+    state.vbat_cell_avg = cells[i];
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f * 4.2f, output_test_single(0.5f) * cells[i]);
+  }
+
+  // half the compensation goes half the way
+  profile.voltage.vbat_sag_compensation = 50.0f;
+  state.vbat_cell_avg = 3.5f;
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f * (1.0f + 0.5f * (4.2f / 3.5f - 1.0f)), output_test_single(0.5f));
+
+  // deep sag is bounded, and the scaled output is still clipped
+  profile.voltage.vbat_sag_compensation = 100.0f;
+  state.vbat_cell_avg = 2.8f;
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f * 4.2f / 3.0f, output_test_single(0.5f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, output_test_single(0.9f));
+
+  // a missing or failed reading leaves the outputs alone
+  state.vbat_cell_avg = 0.0f;
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, output_test_single(0.5f));
+  state.vbat_cell_avg = 3.5f;
+  state.lipo_cell_count = 0;
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, output_test_single(0.5f));
+  state.lipo_cell_count = 4;
+
+  // both together, the curve is applied first then scaled
+  profile.motor.thrust_linear = 40.0f;
+  state.vbat_cell_avg = 3.7f;
+  const float command = output_test_single(0.3f) * 3.7f / 4.2f;
+  TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.3f, output_test_thrust_reference(0.4f, command));
+}
+
+// Test the mixer leaves the headroom the sag compensation needs
+void test_motor_mixer_vbat_sag_headroom(void) {
+  const float curves[] = {0.0f, 40.0f};
+  for (uint32_t c = 0; c < 2; c++) {
+    output_test_init();
+    profile.motor.thrust_linear = curves[c];
+    profile.voltage.vbat_sag_compensation = 100.0f;
+    state.vbat_cell_avg = 3.5f;
+
+    // full throttle with a hard roll, the mixer has to give up throttle
+    state.pidoutput.roll = 0.4f;
+    state.pidoutput.pitch = 0.0f;
+    state.pidoutput.yaw = 0.0f;
+    state.throttle = 0.9f;
+    motor_mixer_calc(state.motor_mix);
+
+    // the spread only shrinks when it does not fit below the boosted full command
+    const float k = curves[c] * 0.01f;
+    const float sag = 4.2f / 3.5f;
+    const float limit = output_test_thrust_reference(k, 1.0f / sag);
+    const float low = state.motor_mix[MOTOR_FR];
+    const float high = state.motor_mix[MOTOR_FL];
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, min(0.8f, limit), high - low);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, limit, high);
+
+    // the boosted high side lands right at full command instead of clipping
+    motor_output_calc(state.motor_mix);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 1.0f, state.motor_mix[MOTOR_FL]);
+
+    // and the thrust the props deliver keeps the whole differential
+    const float thrust_low = output_test_thrust_reference(k, state.motor_mix[MOTOR_FR] / sag);
+    const float thrust_high = output_test_thrust_reference(k, state.motor_mix[MOTOR_FL] / sag);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, high - low, thrust_high - thrust_low);
+  }
+}
@@ -0,0 +1,574 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+// Include the QUIC protocol
+#include "core/profile.h"
+#include "driver/motor.h"
+#include "driver/time.h"
+#include "flight/control.h"
+#include "io/blackbox.h"
+#include "io/blackbox_device.h"
+#include "io/quic.h"
+#include "util/ring_buffer.h"
+
+#define LOOPBACK_SIZE 4096
+#define STREAM_FILE_SIZE (4 * 1024 * 1024 + 100)
+
+// Loopback transport, drained completely whenever the encoder asks for space
+static uint8_t loopback_data[LOOPBACK_SIZE];
+static ring_buffer_t loopback = {
+    .buffer = loopback_data,
+    .head = 0,
+    .tail = 0,
+    .size = LOOPBACK_SIZE,
+};
+
+static uint8_t received[STREAM_FILE_SIZE + 64 * 1024];
+static uint32_t received_len = 0;
+
+static uint8_t reply[64 * 1024];
+static uint32_t reply_len = 0;
+
+static void loopback_drain(void) {
+  received_len += ring_buffer_read_multi(&loopback, received + received_len, sizeof(received) - received_len);
+}
+
+static void loopback_send(uint8_t *data, uint32_t len, void *priv) {
+  uint32_t written = 0;
+  while (written < len) {
+    written += ring_buffer_write_multi(&loopback, data + written, len - written);
+    loopback_drain();
+  }
+}
+
+static uint32_t loopback_reserve(uint8_t **data, void *priv) {
+  loopback_drain();
+  return ring_buffer_write_reserve(&loopback, data);
+}
+
+static void loopback_commit(uint32_t len, void *priv) {
+  ring_buffer_write_commit(&loopback, len);
+}
+
+static uint32_t quic_request(quic_t *quic, quic_command cmd, uint8_t *frame, uint32_t len) {
+  frame[0] = QUIC_MAGIC;
+  frame[1] = cmd;
+  frame[2] = (len >> 8) & 0xFF;
+  frame[3] = len & 0xFF;
+
+  received_len = 0;
+  quic_process(quic, frame, len + QUIC_HEADER_LEN);
+  loopback_drain();
+  return received_len;
+}
+
+// joins continuation frames into reply, returns the command byte of the final frame
+static uint8_t quic_reply(void) {
+  reply_len = 0;
+
+  uint32_t offset = 0;
+  while (offset + QUIC_HEADER_LEN <= received_len) {
+    const uint8_t *frame = received + offset;
+    const uint32_t len = (frame[2] << 8) | frame[3];
+    memcpy(reply + reply_len, frame + QUIC_HEADER_LEN, len);
+    reply_len += len;
+    offset += QUIC_HEADER_LEN + len;
+
+    if ((frame[1] >> 5) != QUIC_FLAG_CONTINUATION) {
+      return frame[1];
+    }
+  }
+  return 0;
+}
+
+static uint32_t stream_request(quic_t *quic, uint32_t offset, uint32_t size) {
+  uint8_t frame[64];
+
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+
+  const uint8_t cmd = QUIC_BLACKBOX_STREAM;
+  const uint8_t file_index = 0;
+  cbor_encode_uint8_t(&enc, &cmd);
+  cbor_encode_uint8_t(&enc, &file_index);
+  cbor_encode_uint32_t(&enc, &offset);
+  cbor_encode_uint32_t(&enc, &size);
+
+  return quic_request(quic, QUIC_CMD_BLACKBOX, frame, cbor_encoder_len(&enc));
+}
+
+static uint32_t profile_session = 0;
+
+static uint32_t profile_changes_request(quic_t *quic, uint32_t since, uint32_t *generation) {
+  uint8_t frame[64];
+
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+
+  const uint8_t value = QUIC_VAL_PROFILE_CHANGES;
+  cbor_encode_uint8_t(&enc, &value);
+  cbor_encode_uint32_t(&enc, &since);
+  cbor_encode_uint32_t(&enc, &profile_session);
+  quic_request(quic, QUIC_CMD_GET, frame, cbor_encoder_len(&enc));
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_GET | (QUIC_FLAG_NONE << 5), quic_reply());
+
+  // {session, generation, profile: {section: value}}, returns the number of sections
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, reply, reply_len);
+
+  uint8_t reply_value;
+  cbor_decode_uint8_t(&dec, &reply_value);
+  TEST_ASSERT_EQUAL_UINT8(QUIC_VAL_PROFILE_CHANGES, reply_value);
+
+  cbor_container_t map;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_map(&dec, &map));
+
+  const uint8_t *key;
+  uint32_t key_len;
+  cbor_decode_tstr(&dec, &key, &key_len);
+  TEST_ASSERT_EQUAL_MEMORY("session", key, key_len);
+  cbor_decode_uint32_t(&dec, &profile_session);
+  TEST_ASSERT_NOT_EQUAL(0, profile_session);
+
+  cbor_decode_tstr(&dec, &key, &key_len);
+  TEST_ASSERT_EQUAL_MEMORY("generation", key, key_len);
+  cbor_decode_uint32_t(&dec, generation);
+
+  cbor_decode_tstr(&dec, &key, &key_len);
+  TEST_ASSERT_EQUAL_MEMORY("profile", key, key_len);
+
+  cbor_container_t sections;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_map(&dec, &sections));
+
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < cbor_decode_map_size(&dec, &sections); i++) {
+    cbor_decode_tstr(&dec, &key, &key_len);
+    cbor_decode_skip(&dec);
+    count++;
+  }
+  return count;
+}
+
+// Test streamed blackbox download through an in place loopback transport
+void test_quic_blackbox_stream(void) {
+  quic_t quic = {
+      .send = loopback_send,
+      .reserve = loopback_reserve,
+      .commit = loopback_commit,
+  };
+
+  blackbox_bounds.page_size = 256;
+  blackbox_device_header.file_num = 1;
+  blackbox_device_header.files[0].start = 0;
+  blackbox_device_header.files[0].size = STREAM_FILE_SIZE;
+
+  // resume offset is rounded down to the page it lives in
+  const clock_t start = clock();
+  stream_request(&quic, 1000, STREAM_FILE_SIZE);
+  const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  // first frame carries the actual window
+  TEST_ASSERT_EQUAL_UINT8(QUIC_MAGIC, received[0]);
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_BLACKBOX | (QUIC_FLAG_STREAMING << 5), received[1]);
+  uint32_t pos = QUIC_HEADER_LEN + ((received[2] << 8) | received[3]);
+
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, received + QUIC_HEADER_LEN, pos - QUIC_HEADER_LEN);
+
+  cbor_container_t map;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_map(&dec, &map));
+
+  const uint8_t *key;
+  uint32_t key_len;
+  uint32_t offset = 0;
+  uint32_t size = 0;
+  cbor_decode_tstr(&dec, &key, &key_len);
+  TEST_ASSERT_EQUAL_MEMORY("offset", key, key_len);
+  cbor_decode_uint32_t(&dec, &offset);
+  cbor_decode_tstr(&dec, &key, &key_len);
+  TEST_ASSERT_EQUAL_MEMORY("size", key, key_len);
+  cbor_decode_uint32_t(&dec, &size);
+
+  TEST_ASSERT_EQUAL_UINT32(768, offset);
+  TEST_ASSERT_EQUAL_UINT32(STREAM_FILE_SIZE - 768, size);
+
+  // data frames until the empty terminator
+  uint32_t payload = 0;
+  uint32_t frames = 0;
+  while (pos + QUIC_HEADER_LEN <= received_len) {
+    TEST_ASSERT_EQUAL_UINT8(QUIC_MAGIC, received[pos]);
+    TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_BLACKBOX | (QUIC_FLAG_STREAMING << 5), received[pos + 1]);
+
+    const uint32_t len = (received[pos + 2] << 8) | received[pos + 3];
+    pos += QUIC_HEADER_LEN + len;
+    if (len == 0) {
+      break;
+    }
+    payload += len;
+    frames++;
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(received_len, pos);
+  TEST_ASSERT_EQUAL_UINT32(size, payload);
+
+  // framing overhead has to stay well below the 80% usb fs target
+  TEST_ASSERT_LESS_THAN(payload / 20, frames * QUIC_HEADER_LEN);
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "blackbox stream: %u frames, %.1f MB/s", frames, seconds > 0 ? (payload / seconds) / (1024 * 1024) : 0);
+  TEST_MESSAGE(msg);
+
+  // a window past the end of the file only terminates the stream
+  stream_request(&quic, STREAM_FILE_SIZE + 1024, 1024);
+  TEST_ASSERT_EQUAL_UINT8(0, received[received_len - 1]);
+  TEST_ASSERT_EQUAL_UINT8(0, received[received_len - 2]);
+
+  blackbox_device_header.file_num = 0;
+  blackbox_bounds.page_size = 0;
+}
+
+// Test path addressed profile patches and change queries
+void test_quic_profile_patch(void) {
+  quic_t quic = {
+      .send = loopback_send,
+  };
+
+  profile_set_defaults();
+
+  // a full query returns every section
+  uint32_t generation = 0;
+  const uint32_t sections = profile_changes_request(&quic, 0, &generation);
+  const uint32_t full_len = received_len;
+  TEST_ASSERT_GREATER_THAN(5, sections);
+
+  // nothing changed yet
+  uint32_t current = 0;
+  TEST_ASSERT_EQUAL_UINT32(0, profile_changes_request(&quic, generation, &current));
+  TEST_ASSERT_EQUAL_UINT32(generation, current);
+
+  uint8_t frame[128];
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+
+  const uint8_t value = QUIC_VAL_PROFILE_PATCH;
+  const float idle = 7.5f;
+  const float pitch_p = 50.0f;
+  const uint8_t lqi_source = profile.receiver.lqi_source + 1;
+  cbor_encode_uint8_t(&enc, &value);
+  cbor_encode_map_indefinite(&enc);
+  cbor_encode_str(&enc, "motor.digital_idle");
+  cbor_encode_float(&enc, &idle);
+  cbor_encode_str(&enc, "pid.pid_rates.0.kp.1");
+  cbor_encode_float(&enc, &pitch_p);
+  cbor_encode_str(&enc, "receiver.lqi_source");
+  cbor_encode_uint8_t(&enc, &lqi_source);
+  cbor_encode_end_indefinite(&enc);
+  quic_request(&quic, QUIC_CMD_SET, frame, cbor_encoder_len(&enc));
+
+  // the reply is only the new generation
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_SET | (QUIC_FLAG_NONE << 5), received[1]);
+  TEST_ASSERT_LESS_THAN(16, received_len);
+
+  TEST_ASSERT_EQUAL_FLOAT(idle, profile.motor.digital_idle);
+  TEST_ASSERT_EQUAL_FLOAT(pitch_p, profile.pid.pid_rates[0].kp.pitch);
+  TEST_ASSERT_EQUAL_UINT8(lqi_source, profile.receiver.lqi_source);
+
+  // only the touched sections are returned
+  TEST_ASSERT_EQUAL_UINT32(3, profile_changes_request(&quic, generation, &current));
+  TEST_ASSERT_GREATER_THAN(generation, current);
+  TEST_ASSERT_LESS_THAN(full_len / 2, received_len);
+
+  // changes made outside of quic are picked up too
+  profile.voltage.vbattlow = 3.1f;
+  TEST_ASSERT_EQUAL_UINT32(1, profile_changes_request(&quic, current, &current));
+
+  // unknown paths and out of range indices are rejected
+  const char *invalid[] = {"motor.nope", "pid.pid_rates.9.kp", "pid.pid_rates.0.kp.3", "motor.digital_idle.0"};
+  for (uint32_t i = 0; i < 4; i++) {
+    cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+    cbor_encode_uint8_t(&enc, &value);
+    cbor_encode_map_indefinite(&enc);
+    cbor_encode_str(&enc, invalid[i]);
+    cbor_encode_float(&enc, &idle);
+    cbor_encode_end_indefinite(&enc);
+    quic_request(&quic, QUIC_CMD_SET, frame, cbor_encoder_len(&enc));
+    TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_SET | (QUIC_FLAG_ERROR << 5), received[1]);
+  }
+
+  // a bad path after good ones leaves the good ones unapplied
+  const float other_idle = idle + 1.0f;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+  cbor_encode_uint8_t(&enc, &value);
+  cbor_encode_map_indefinite(&enc);
+  cbor_encode_str(&enc, "motor.digital_idle");
+  cbor_encode_float(&enc, &other_idle);
+  cbor_encode_str(&enc, "motor.nope");
+  cbor_encode_float(&enc, &other_idle);
+  cbor_encode_end_indefinite(&enc);
+  quic_request(&quic, QUIC_CMD_SET, frame, cbor_encoder_len(&enc));
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_SET | (QUIC_FLAG_ERROR << 5), received[1]);
+  TEST_ASSERT_EQUAL_FLOAT(idle, profile.motor.digital_idle);
+
+  // a generation from an earlier session or past the current one gets everything
+  TEST_ASSERT_EQUAL_UINT32(0, profile_changes_request(&quic, current, &current));
+  const uint32_t session = profile_session;
+  profile_session = session + 1;
+  TEST_ASSERT_EQUAL_UINT32(sections, profile_changes_request(&quic, current, &current));
+  TEST_ASSERT_EQUAL_UINT32(session, profile_session);
+  TEST_ASSERT_EQUAL_UINT32(sections, profile_changes_request(&quic, current + 100, &current));
+
+  profile_set_defaults();
+}
+
+static void telemetry_subscribe(quic_t *quic, uint32_t field_flags, uint32_t rate_hz) {
+  uint8_t frame[64];
+
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+  cbor_encode_uint32_t(&enc, &field_flags);
+  cbor_encode_uint32_t(&enc, &rate_hz);
+  quic_request(quic, QUIC_CMD_TELEMETRY, frame, cbor_encoder_len(&enc));
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_TELEMETRY | (QUIC_FLAG_NONE << 5), received[1]);
+}
+
+// a transport that never has room
+static uint32_t full_reserve(uint8_t **data, void *priv) {
+  return 0;
+}
+
+// Test rate limited telemetry frames after a subscription
+void test_quic_telemetry_subscribe(void) {
+  quic_t quic = {
+      .send = loopback_send,
+      .reserve = loopback_reserve,
+      .commit = loopback_commit,
+  };
+
+  const uint32_t field_flags = (1 << BBOX_FIELD_LOOP) | (1 << BBOX_FIELD_GYRO_FILTER) | (1 << BBOX_FIELD_MOTOR);
+  // a dropped counter leads every sample
+  const uint32_t size = sizeof(uint32_t) + blackbox_raw_size(field_flags);
+  telemetry_subscribe(&quic, field_flags, 500);
+
+  // 20ms at 500hz
+  received_len = 0;
+  const uint32_t start = time_micros();
+  while ((time_micros() - start) < 20000) {
+    quic_telemetry_update(&quic);
+  }
+  loopback_drain();
+
+  uint32_t frames = 0;
+  for (uint32_t offset = 0; offset < received_len; offset += QUIC_HEADER_LEN + size) {
+    TEST_ASSERT_EQUAL_UINT8(QUIC_MAGIC, received[offset]);
+    TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_TELEMETRY | (QUIC_FLAG_STREAMING << 5), received[offset + 1]);
+    TEST_ASSERT_EQUAL_UINT32(size, (received[offset + 2] << 8) | received[offset + 3]);
+    frames++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(frames * (QUIC_HEADER_LEN + size), received_len);
+  TEST_ASSERT_GREATER_THAN(0, frames);
+  TEST_ASSERT_LESS_THAN(12, frames);
+
+  // samples the transport had no room for show up in the next count
+  uint32_t dropped = 0;
+  memcpy(&dropped, received + QUIC_HEADER_LEN, sizeof(dropped));
+  TEST_ASSERT_EQUAL_UINT32(0, dropped);
+
+  quic.reserve = full_reserve;
+  uint32_t now = time_micros();
+  while ((time_micros() - now) < 10000) {
+    quic_telemetry_update(&quic);
+  }
+
+  quic.reserve = loopback_reserve;
+  received_len = 0;
+  now = time_micros();
+  while (received_len == 0 && (time_micros() - now) < 10000) {
+    quic_telemetry_update(&quic);
+    loopback_drain();
+  }
+  TEST_ASSERT_EQUAL_UINT32(QUIC_HEADER_LEN + size, received_len);
+  memcpy(&dropped, received + QUIC_HEADER_LEN, sizeof(dropped));
+  TEST_ASSERT_GREATER_THAN(0, dropped);
+
+  // no frames once unsubscribed
+  telemetry_subscribe(&quic, field_flags, 0);
+  received_len = 0;
+  for (uint32_t i = 0; i < 1000; i++) {
+    quic_telemetry_update(&quic);
+  }
+  loopback_drain();
+  TEST_ASSERT_EQUAL_UINT32(0, received_len);
+}
+
+static void loopback_flush(const uint8_t *data, uint32_t len, void *priv) {
+  loopback_send((uint8_t *)data, len, priv);
+}
+
+// Test responses larger than the encode buffer are split into continuation frames
+void test_quic_continuation_frames(void) {
+  quic_t quic = {
+      .send = loopback_send,
+  };
+
+  profile_set_defaults();
+
+  uint8_t frame[16];
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+
+  const uint8_t value = QUIC_VAL_PROFILE;
+  cbor_encode_uint8_t(&enc, &value);
+  quic_request(&quic, QUIC_CMD_GET, frame, cbor_encoder_len(&enc));
+
+  // every frame but the last continues the payload
+  uint32_t frames = 0;
+  uint32_t offset = 0;
+  while (offset < received_len) {
+    const uint8_t *header = received + offset;
+    const uint32_t len = (header[2] << 8) | header[3];
+    offset += QUIC_HEADER_LEN + len;
+    frames++;
+
+    TEST_ASSERT_EQUAL_UINT8(QUIC_MAGIC, header[0]);
+    TEST_ASSERT_LESS_OR_EQUAL(512, len);
+    if (offset < received_len) {
+      TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_GET | (QUIC_FLAG_CONTINUATION << 5), header[1]);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(received_len, offset);
+  TEST_ASSERT_GREATER_THAN(1, frames);
+
+  // and joins up to the same bytes as a single buffer encode
+  static uint8_t expected[16 * 1024];
+  cbor_encoder_init(&enc, expected, sizeof(expected));
+  cbor_encode_uint8_t(&enc, &value);
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_profile_t(&enc, &profile));
+
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_GET | (QUIC_FLAG_NONE << 5), quic_reply());
+  TEST_ASSERT_EQUAL_UINT32(cbor_encoder_len(&enc), reply_len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, reply, reply_len);
+
+  // byte strings longer than the whole buffer are split as well
+  static uint8_t blob[1500];
+  for (uint32_t i = 0; i < sizeof(blob); i++) {
+    blob[i] = i;
+  }
+
+  uint8_t small[64];
+  received_len = 0;
+  cbor_encoder_init(&enc, small, sizeof(small));
+  cbor_encoder_set_flush(&enc, loopback_flush, NULL);
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_bstr(&enc, blob, sizeof(blob)));
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encoder_flush(&enc));
+  loopback_drain();
+
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, received, received_len);
+  const uint8_t *data = NULL;
+  uint32_t len = 0;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_bstr(&dec, &data, &len));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(blob), len);
+  TEST_ASSERT_EQUAL_MEMORY(blob, data, len);
+}
+
+static uint32_t copied_sends = 0;
+
+static void counting_send(uint8_t *data, uint32_t len, void *priv) {
+  copied_sends++;
+  loopback_send(data, len, priv);
+}
+
+// Test responses are encoded in place when the transport hands out slots
+void test_quic_in_place_encode(void) {
+  quic_t quic = {
+      .send = counting_send,
+      .reserve = loopback_reserve,
+      .commit = loopback_commit,
+  };
+
+  profile_set_defaults();
+
+  uint8_t frame[16];
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+
+  const uint8_t value = QUIC_VAL_PROFILE;
+  cbor_encode_uint8_t(&enc, &value);
+
+  // start the transport on an empty buffer so every slot fits without wrapping
+  loopback_drain();
+  loopback.head = loopback.tail = 0;
+  copied_sends = 0;
+  quic_request(&quic, QUIC_CMD_GET, frame, cbor_encoder_len(&enc));
+  TEST_ASSERT_EQUAL_UINT32(0, copied_sends);
+
+  static uint8_t expected[16 * 1024];
+  cbor_encoder_init(&enc, expected, sizeof(expected));
+  cbor_encode_uint8_t(&enc, &value);
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_profile_t(&enc, &profile));
+
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_GET | (QUIC_FLAG_NONE << 5), quic_reply());
+  TEST_ASSERT_EQUAL_UINT32(cbor_encoder_len(&enc), reply_len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, reply, reply_len);
+
+  // errors are written through send on top of the pending slot
+  uint8_t invalid[QUIC_HEADER_LEN + 1] = {0, 0, 0, 0, 0xFF};
+  quic_request(&quic, QUIC_CMD_GET, invalid, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, copied_sends);
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_GET | (QUIC_FLAG_ERROR << 5), received[1]);
+}
+
+static void motor_test_request(quic_t *quic, const float *values, uint32_t count) {
+  uint8_t frame[64];
+
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, frame + QUIC_HEADER_LEN, sizeof(frame) - QUIC_HEADER_LEN);
+
+  const uint8_t cmd = QUIC_MOTOR_TEST_SET_VALUE;
+  cbor_encode_uint8_t(&enc, &cmd);
+  cbor_encode_array(&enc, count);
+  for (uint32_t i = 0; i < count; i++) {
+    cbor_encode_float(&enc, &values[i]);
+  }
+  quic_request(quic, QUIC_CMD_MOTOR, frame, cbor_encoder_len(&enc));
+}
+
+// Test motor test values from hosts that only know four motors
+void test_quic_motor_test_values(void) {
+  quic_t quic = {
+      .send = loopback_send,
+  };
+
+  profile_set_defaults();
+  profile.motor.motor_count = 8;
+
+  const float stale = 0.7f;
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    motor_test.value[i] = stale;
+  }
+
+  // four values fill the first four motors, the rest are switched off
+  const float quad[4] = {0.1f, 0.2f, 0.0f, 0.4f};
+  motor_test_request(&quic, quad, 4);
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_MOTOR | (QUIC_FLAG_NONE << 5), received[1]);
+  TEST_ASSERT_EQUAL_FLOAT(0.1f, motor_test.value[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.2f, motor_test.value[1]);
+  TEST_ASSERT_EQUAL_FLOAT(MOTOR_OFF, motor_test.value[2]);
+  TEST_ASSERT_EQUAL_FLOAT(0.4f, motor_test.value[3]);
+  for (uint32_t i = 4; i < MOTOR_PIN_MAX; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(MOTOR_OFF, motor_test.value[i]);
+  }
+
+  // values past the configured motors are ignored
+  profile.motor.motor_count = 4;
+  const float octo[MOTOR_PIN_MAX] = {0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f};
+  motor_test_request(&quic, octo, MOTOR_PIN_MAX);
+  TEST_ASSERT_EQUAL_UINT8(QUIC_CMD_MOTOR | (QUIC_FLAG_NONE << 5), received[1]);
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(i < 4 ? 0.5f : MOTOR_OFF, motor_test.value[i]);
+  }
+
+  profile_set_defaults();
+}
@@ -214,4 +214,77 @@ void test_ring_buffer_partial_multi_read(void) {
   for (int i = 0; i < 3; i++) {
     TEST_ASSERT_EQUAL_UINT8(write_data[i], read_data[i]);
   }
-}
\ No newline at end of file
+}
+
+// Test in place writes through reserve and commit
+void test_ring_buffer_write_reserve(void) {
+  ring_buffer_setUp();
+
+  // Empty buffer starting at 0 keeps one slot free
+  uint8_t *ptr = NULL;
+  uint32_t space = ring_buffer_write_reserve(&ring_buffer, &ptr);
+  TEST_ASSERT_EQUAL_UINT32(TEST_BUFFER_SIZE - 1, space);
+  TEST_ASSERT_EQUAL_PTR(test_buffer, ptr);
+
+  ptr[0] = 1;
+  ptr[1] = 2;
+  ptr[2] = 3;
+  ring_buffer_write_commit(&ring_buffer, 3);
+  TEST_ASSERT_EQUAL_UINT32(3, ring_buffer_available(&ring_buffer));
+
+  uint8_t read_data[TEST_BUFFER_SIZE] = {0};
+  TEST_ASSERT_EQUAL_UINT32(3, ring_buffer_read_multi(&ring_buffer, read_data, 3));
+  TEST_ASSERT_EQUAL_UINT8(1, read_data[0]);
+  TEST_ASSERT_EQUAL_UINT8(3, read_data[2]);
+
+  // Move head close to the end, reserve only covers the contiguous part
+  uint8_t fill[10] = {0};
+  ring_buffer_write_multi(&ring_buffer, fill, 10);
+  ring_buffer_read_multi(&ring_buffer, read_data, 10);
+
+  space = ring_buffer_write_reserve(&ring_buffer, &ptr);
+  TEST_ASSERT_EQUAL_UINT32(3, space);
+  TEST_ASSERT_EQUAL_PTR(test_buffer + 13, ptr);
+
+  ptr[0] = 4;
+  ptr[1] = 5;
+  ptr[2] = 6;
+  ring_buffer_write_commit(&ring_buffer, 3);
+  TEST_ASSERT_EQUAL_UINT32(0, ring_buffer.head);
+  TEST_ASSERT_EQUAL_UINT32(3, ring_buffer_read_multi(&ring_buffer, read_data, 3));
+  TEST_ASSERT_EQUAL_UINT8(4, read_data[0]);
+  TEST_ASSERT_EQUAL_UINT8(6, read_data[2]);
+}
+
+// Test in place reads through reserve and commit
+void test_ring_buffer_read_reserve(void) {
+  ring_buffer_setUp();
+
+  uint8_t *ptr = NULL;
+  TEST_ASSERT_EQUAL_UINT32(0, ring_buffer_read_reserve(&ring_buffer, &ptr));
+
+  const uint8_t data[6] = {1, 2, 3, 4, 5, 6};
+  ring_buffer_write_multi(&ring_buffer, data, 6);
+
+  // Reserved data stays in the buffer until it is committed
+  TEST_ASSERT_EQUAL_UINT32(6, ring_buffer_read_reserve(&ring_buffer, &ptr));
+  TEST_ASSERT_EQUAL_PTR(test_buffer, ptr);
+  TEST_ASSERT_EQUAL_UINT32(TEST_BUFFER_SIZE - 1 - 6, ring_buffer_free(&ring_buffer));
+
+  ring_buffer_read_commit(&ring_buffer, 4);
+  TEST_ASSERT_EQUAL_UINT32(2, ring_buffer_available(&ring_buffer));
+
+  // Wrapped data is handed out up to the end of the buffer first
+  uint8_t fill[12] = {7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+  TEST_ASSERT_EQUAL_UINT32(12, ring_buffer_write_multi(&ring_buffer, fill, 12));
+
+  TEST_ASSERT_EQUAL_UINT32(TEST_BUFFER_SIZE - 4, ring_buffer_read_reserve(&ring_buffer, &ptr));
+  TEST_ASSERT_EQUAL_PTR(test_buffer + 4, ptr);
+  TEST_ASSERT_EQUAL_UINT8(5, ptr[0]);
+  ring_buffer_read_commit(&ring_buffer, TEST_BUFFER_SIZE - 4);
+  TEST_ASSERT_EQUAL_UINT32(0, ring_buffer.tail);
+
+  TEST_ASSERT_EQUAL_UINT32(2, ring_buffer_read_reserve(&ring_buffer, &ptr));
+  TEST_ASSERT_EQUAL_UINT8(17, ptr[0]);
+  TEST_ASSERT_EQUAL_UINT8(18, ptr[1]);
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "core/profile.h"
+#include "core/target.h"
+#include "driver/serial_4way.h"
+#include "driver/serial_esc.h"
+#include "util/crc.h"
+
+#define IMAGE_SIZE (8 * 1024)
+#define IMAGE_PAGE_SIZE 512
+#define IMAGE_CHUNK_SIZE 256
+
+static uint8_t image[IMAGE_SIZE];
+
+static void serial_4way_test_init() {
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    target.motor_pins[i] = PIN_NONE + 1 + i;
+    profile.motor.motor_pins[i] = i;
+  }
+  profile.motor.motor_count = MOTOR_PIN_MAX;
+  serial_4way_init();
+  esc_emulator_reset();
+
+  for (uint32_t i = 0; i < IMAGE_SIZE; i++) {
+    image[i] = (i * 7 + (i >> 8)) & 0xFF;
+  }
+}
+
+static serial_esc4way_ack_t serial_4way_test_send(uint8_t cmd, uint16_t addr, const uint8_t *input, uint8_t size) {
+  uint8_t output[256];
+  uint8_t output_size = 0;
+  return serial_4way_send(cmd, addr, input, size, output, &output_size);
+}
+
+// erases and writes the image the way the configurator does
+static void serial_4way_test_flash(uint8_t channel) {
+  TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_test_send(ESC4WAY_DEVICE_INIT_FLASH, 0, &channel, 1));
+
+  for (uint32_t addr = 0; addr < IMAGE_SIZE; addr += IMAGE_CHUNK_SIZE) {
+    if (addr % IMAGE_PAGE_SIZE == 0) {
+      const uint8_t page = addr / IMAGE_PAGE_SIZE;
+      TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_test_send(ESC4WAY_DEVICE_PAGE_ERASE, 0, &page, 1));
+    }
+    TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_test_send(ESC4WAY_DEVICE_WRITE, addr, image + addr, 0));
+  }
+
+  TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_test_send(ESC4WAY_DEVICE_RESET, 0, &channel, 1));
+}
+
+static void serial_4way_test_check(const char *mode, uint32_t time_us) {
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    TEST_ASSERT_EQUAL_MEMORY(image, esc_emulator_flash(target.motor_pins[i]), IMAGE_SIZE);
+  }
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s: %u escs in %u ms, %.1f KB/s", mode, MOTOR_PIN_MAX, time_us / 1000, (double)(MOTOR_PIN_MAX * IMAGE_SIZE / 1024.0f / (time_us / 1e6f)));
+  TEST_MESSAGE(msg);
+}
+
+// Test the table driven crcs against their check values
+void test_serial_4way_crc(void) {
+  const uint8_t check[] = "123456789";
+  TEST_ASSERT_EQUAL_HEX16(0x31C3, crc16_xmodem_data(0, check, 9));
+  TEST_ASSERT_EQUAL_HEX16(0xBB3D, crc16_arc_data(0, check, 9));
+
+  uint16_t crc = 0;
+  for (uint32_t i = 0; i < 9; i++) {
+    crc = crc16_xmodem_calc(crc, check[i]);
+  }
+  TEST_ASSERT_EQUAL_HEX16(0x31C3, crc);
+}
+
+// Test flashing every esc one after the other
+void test_serial_4way_flash_sequential(void) {
+  serial_4way_test_init();
+  for (uint8_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    serial_4way_test_flash(i);
+  }
+  serial_4way_test_check("sequential", esc_emulator_time_us());
+}
+
+// Test flashing every esc at once and that it beats the sequential path
+void test_serial_4way_flash_parallel(void) {
+  serial_4way_test_init();
+  for (uint8_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    serial_4way_test_flash(i);
+  }
+  const uint32_t sequential_us = esc_emulator_time_us();
+
+  serial_4way_test_init();
+  serial_4way_test_flash(SERIAL_4WAY_ALL_ESCS);
+  const uint32_t parallel_us = esc_emulator_time_us();
+  serial_4way_test_check("parallel", parallel_us);
+
+  TEST_ASSERT_LESS_THAN(sequential_us / 3, parallel_us);
+
+  // a single esc still reads back after a parallel write
+  uint8_t channel = 2;
+  TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_test_send(ESC4WAY_DEVICE_INIT_FLASH, 0, &channel, 1));
+
+  uint8_t output[256];
+  uint8_t output_size = 0;
+  const uint8_t size = 0;
+  TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_send(ESC4WAY_DEVICE_READ, 0x200, &size, 1, output, &output_size));
+  TEST_ASSERT_EQUAL_MEMORY(image + 0x200, output, 256);
+}
+
+// Test a parallel init reports the escs that answered and leaves the others alone
+void test_serial_4way_flash_parallel_missing(void) {
+  serial_4way_test_init();
+  esc_emulator_set_absent(target.motor_pins[1], true);
+
+  uint8_t output[256];
+  uint8_t output_size = 0;
+  const uint8_t channel = SERIAL_4WAY_ALL_ESCS;
+  TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_send(ESC4WAY_DEVICE_INIT_FLASH, 0, &channel, 1, output, &output_size));
+  TEST_ASSERT_EQUAL_UINT8(SERIAL_4WAY_DEVICE_INFO_SIZE + 1, output_size);
+  TEST_ASSERT_EQUAL_HEX8(((1 << MOTOR_PIN_MAX) - 1) & ~(1 << 1), output[SERIAL_4WAY_DEVICE_INFO_SIZE]);
+  TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_OK, serial_4way_test_send(ESC4WAY_DEVICE_RESET, 0, &channel, 1));
+
+  serial_4way_test_flash(SERIAL_4WAY_ALL_ESCS);
+
+  static uint8_t erased[IMAGE_SIZE];
+  memset(erased, 0xFF, IMAGE_SIZE);
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    const uint8_t *flash = esc_emulator_flash(target.motor_pins[i]);
+    if (i == 1) {
+      TEST_ASSERT_EQUAL_MEMORY(erased, flash, IMAGE_SIZE);
+    } else {
+      TEST_ASSERT_EQUAL_MEMORY(image, flash, IMAGE_SIZE);
+    }
+  }
+}
+
+// Test a parallel init with mixed escs fails and sends the connected ones back to their firmware
+void test_serial_4way_flash_parallel_mismatch(void) {
+  serial_4way_test_init();
+  esc_emulator_set_signature(target.motor_pins[2], 0x1F06);
+
+  uint8_t output[256];
+  uint8_t output_size = 0;
+  const uint8_t channel = SERIAL_4WAY_ALL_ESCS;
+  TEST_ASSERT_EQUAL_UINT8(ESC4WAY_ACK_D_GENERAL_ERROR, serial_4way_send(ESC4WAY_DEVICE_INIT_FLASH, 0, &channel, 1, output, &output_size));
+  TEST_ASSERT_EQUAL_HEX8(0, output[SERIAL_4WAY_DEVICE_INFO_SIZE]);
+
+  for (uint32_t i = 0; i < MOTOR_PIN_MAX; i++) {
+    TEST_ASSERT_FALSE(esc_emulator_connected(target.motor_pins[i]));
+  }
+}
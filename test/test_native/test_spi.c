@@ -1,7 +1,9 @@
+#include <string.h>
 #include <unity.h>
 
 #include "driver/spi.h"
 #include "driver/gpio.h"
+#include "util/cbor_helper.h"
 #include "mock_helpers.h"
 
 // Override target configuration for tests
@@ -98,4 +100,170 @@ void test_spi_reconfigure(void) {
   
   TEST_ASSERT_EQUAL(SPI_MODE_TRAILING_EDGE, bus.mode);
   TEST_ASSERT_EQUAL(2000000, bus.hz);
+}
+
+#define SPI_TEST_PORT SPI_PORT1
+
+static uint8_t order[SPI_TXN_MAX];
+static uint32_t order_count = 0;
+
+static spi_bus_device_t gyro = {.port = SPI_TEST_PORT, .lane = SPI_LANE_REALTIME};
+static spi_bus_device_t rx = {.port = SPI_TEST_PORT, .lane = SPI_LANE_NORMAL};
+static spi_bus_device_t osd = {.port = SPI_TEST_PORT, .lane = SPI_LANE_BULK};
+
+static void spi_test_done(void *arg) {
+  order[order_count++] = (uintptr_t)arg;
+}
+
+static void spi_test_submit(spi_bus_device_t *bus, uint8_t id) {
+  const spi_txn_segment_t segs[] = {
+      spi_make_seg_const(id),
+  };
+  spi_seg_submit(bus, segs, .done_fn = spi_test_done, .done_fn_arg = (void *)(uintptr_t)id);
+}
+
+static void spi_test_init() {
+  spi_device_init(SPI_TEST_PORT);
+  spi_lane_stats_reset(SPI_TEST_PORT);
+  order_count = 0;
+}
+
+// Test the realtime lane overtakes queued bulk transactions at the next boundary
+void test_spi_lane_preempt(void) {
+  spi_test_init();
+
+  for (uint8_t i = 0; i < 8; i++) {
+    spi_test_submit(&osd, 10 + i);
+  }
+  TEST_ASSERT_TRUE(spi_txn_continue_port(SPI_TEST_PORT));
+
+  spi_test_submit(&rx, 20);
+  spi_test_submit(&gyro, 1);
+  TEST_ASSERT_FALSE(spi_txn_ready(&gyro));
+
+  // the osd write in progress is not interrupted, the gyro read starts right after it
+  TEST_ASSERT_FALSE(spi_txn_continue(&gyro));
+  spi_dma_complete_port(SPI_TEST_PORT);
+  TEST_ASSERT_EQUAL_UINT8(SPI_LANE_REALTIME, spi_dev[SPI_TEST_PORT].txn_lane);
+
+  spi_dma_complete_port(SPI_TEST_PORT);
+  TEST_ASSERT_TRUE(spi_txn_ready(&gyro));
+  TEST_ASSERT_EQUAL_UINT8(SPI_LANE_NORMAL, spi_dev[SPI_TEST_PORT].txn_lane);
+
+  while (!spi_txn_ready(&osd)) {
+    spi_dma_complete_port(SPI_TEST_PORT);
+  }
+
+  const uint8_t expected[] = {10, 1, 20, 11, 12, 13, 14, 15, 16, 17};
+  TEST_ASSERT_EQUAL_UINT32(sizeof(expected), order_count);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, order, sizeof(expected));
+
+  const spi_device_t *dev = &spi_dev[SPI_TEST_PORT];
+  TEST_ASSERT_EQUAL_UINT32(1, dev->stats[SPI_LANE_REALTIME].count);
+  TEST_ASSERT_EQUAL_UINT32(1, dev->stats[SPI_LANE_NORMAL].count);
+  TEST_ASSERT_EQUAL_UINT32(8, dev->stats[SPI_LANE_BULK].count);
+
+  // the same counts reach the host
+  uint8_t buf[256];
+  cbor_value_t enc;
+  cbor_encoder_init(&enc, buf, sizeof(buf));
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_encode_spi_lane_stats(&enc));
+
+  cbor_value_t dec;
+  cbor_decoder_init(&dec, buf, cbor_encoder_len(&enc));
+
+  cbor_container_t ports;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_map(&dec, &ports));
+
+  uint32_t port = 0;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_uint32_t(&dec, &port));
+  TEST_ASSERT_EQUAL_UINT32(SPI_TEST_PORT, port);
+
+  cbor_container_t lanes;
+  TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_array(&dec, &lanes));
+  TEST_ASSERT_EQUAL_UINT32(SPI_LANE_MAX, cbor_decode_array_size(&dec, &lanes));
+
+  const uint32_t counts[SPI_LANE_MAX] = {
+      [SPI_LANE_NORMAL] = 1,
+      [SPI_LANE_REALTIME] = 1,
+      [SPI_LANE_BULK] = 8,
+  };
+  for (uint32_t i = 0; i < SPI_LANE_MAX; i++) {
+    cbor_container_t lane;
+    TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_map(&dec, &lane));
+
+    const uint8_t *name;
+    uint32_t name_len;
+    TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_tstr(&dec, &name, &name_len));
+    TEST_ASSERT_EQUAL_MEMORY("count", name, name_len);
+
+    uint32_t count = 0;
+    TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_uint32_t(&dec, &count));
+    TEST_ASSERT_EQUAL_UINT32(counts[i], count);
+
+    for (uint32_t j = 1; j < cbor_decode_map_size(&dec, &lane); j++) {
+      TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_skip(&dec));
+      TEST_ASSERT_GREATER_OR_EQUAL(CBOR_OK, cbor_decode_skip(&dec));
+    }
+  }
+}
+
+// Test the bulk lane leaves transactions for the others
+void test_spi_lane_reserve(void) {
+  spi_test_init();
+
+  uint32_t submitted = 0;
+  while (spi_txn_has_free(&osd)) {
+    spi_test_submit(&osd, 10);
+    submitted++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(SPI_TXN_MAX - SPI_TXN_RESERVED, submitted);
+  TEST_ASSERT_EQUAL_UINT8(SPI_TXN_RESERVED, spi_txn_free_count(&gyro));
+
+  spi_test_submit(&gyro, 1);
+  TEST_ASSERT_TRUE(spi_txn_continue_port(SPI_TEST_PORT));
+  while (!spi_txn_ready(&osd)) {
+    spi_dma_complete_port(SPI_TEST_PORT);
+  }
+  TEST_ASSERT_EQUAL_UINT8(1, order[0]);
+  TEST_ASSERT_EQUAL_UINT8(SPI_TXN_MAX, spi_txn_free_count(&gyro));
+}
+
+// Test dma segments are chained with the copied ones in submit order
+void test_spi_seg_dma(void) {
+  spi_test_init();
+
+  uint8_t tx[4] = {0x01, 0x02, 0x03, 0x04};
+  uint8_t rx[4] = {};
+  uint8_t rx_copy[2] = {0x55, 0x55};
+  uint8_t rx_fill[3] = {0x55, 0x55, 0x55};
+
+  const spi_txn_segment_t segs[] = {
+      spi_make_seg_const(0x10),
+      spi_make_seg_dma(rx, tx, 4),
+      spi_make_seg_buffer(rx_copy, NULL, 2),
+      spi_make_seg_const(0x20),
+      spi_make_seg_dma(rx_fill, NULL, 3),
+  };
+  spi_seg_submit(&osd, segs, .done_fn = spi_test_done, .done_fn_arg = (void *)(uintptr_t)1);
+  TEST_ASSERT_TRUE(spi_txn_continue_port(SPI_TEST_PORT));
+
+  // the const, dma, copied and dma chunks each take one transfer
+  for (uint32_t i = 0; i < 3; i++) {
+    spi_dma_complete_port(SPI_TEST_PORT);
+    TEST_ASSERT_EQUAL_UINT32(0, order_count);
+  }
+  spi_dma_complete_port(SPI_TEST_PORT);
+  TEST_ASSERT_EQUAL_UINT32(1, order_count);
+  TEST_ASSERT_TRUE(spi_txn_ready(&osd));
+
+  // the native port answers every byte inverted
+  const uint8_t expected[4] = {0xFE, 0xFD, 0xFC, 0xFB};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, rx, 4);
+  TEST_ASSERT_EQUAL_UINT8(0x00, rx_copy[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x00, rx_fill[2]);
+
+  // tx data is read in place, never written
+  const uint8_t sent[4] = {0x01, 0x02, 0x03, 0x04};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(sent, tx, 4);
 }
\ No newline at end of file
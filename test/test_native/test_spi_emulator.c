@@ -0,0 +1,447 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "core/target.h"
+#include "driver/blackbox/m25p16.h"
+#include "driver/blackbox/sdcard.h"
+#include "driver/gyro/icm42605.h"
+#include "driver/mcu/native/spi_emulator.h"
+#include "driver/osd/max7456.h"
+#include "driver/rx/sx128x.h"
+#include "driver/spi.h"
+
+#define EMULATOR_PORT SPI_PORT2
+#define EMULATOR_LOOPS 1000000
+
+static spi_emulator_m25p16_t flash;
+static spi_emulator_sdcard_t card;
+static spi_emulator_max7456_t osd;
+static spi_emulator_icm42688_t imu;
+static spi_emulator_sx1280_t radio;
+
+extern sdcard_info_t sdcard_info;
+
+static void spi_emulator_test_init() {
+  target.spi_ports[EMULATOR_PORT] = (target_spi_port_t){
+      .index = 2,
+      .miso = PIN_B14,
+      .mosi = PIN_B15,
+      .sck = PIN_B13,
+  };
+  spi_device_init(EMULATOR_PORT);
+  spi_emulator_reset();
+}
+
+static void spi_emulator_test_message(const char *name, uint32_t bytes, uint64_t time_ns) {
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s: %u bytes in %u us, %.1f KB/s", name, bytes, (uint32_t)(time_ns / 1000), (double)(bytes / 1024.0f / (time_ns / 1e9f)));
+  TEST_MESSAGE(msg);
+}
+
+// Test the flash driver against the m25p16 model, programs only land after the busy time
+void test_spi_emulator_m25p16(void) {
+  spi_emulator_test_init();
+  spi_emulator_m25p16_init(&flash);
+  spi_emulator_attach(EMULATOR_PORT, PIN_B12, &flash.dev);
+
+  target.flash = (target_spi_device_t){.port = EMULATOR_PORT, .nss = PIN_B12};
+  m25p16_init();
+
+  blackbox_device_bounds_t bounds;
+  m25p16_get_bounds(&bounds);
+  TEST_ASSERT_EQUAL_UINT32(SPI_EMULATOR_M25P16_SIZE, bounds.total_size);
+  TEST_ASSERT_EQUAL_UINT32(M25P16_PAGE_SIZE, bounds.page_size);
+
+  uint8_t page[M25P16_PAGE_SIZE];
+  for (uint32_t i = 0; i < M25P16_PAGE_SIZE; i++) {
+    page[i] = i ^ 0x5A;
+  }
+
+  const uint64_t start_ns = spi_emulator_time_ns();
+  for (uint32_t i = 0; i < 4; i++) {
+    uint32_t loops = 0;
+    while (!m25p16_page_program(0x10000 + i * M25P16_PAGE_SIZE, page, M25P16_PAGE_SIZE) && loops++ < EMULATOR_LOOPS)
+      ;
+  }
+  m25p16_wait_for_ready();
+  const uint64_t time_ns = spi_emulator_time_ns() - start_ns;
+  spi_emulator_test_message("m25p16 program", 4 * M25P16_PAGE_SIZE, time_ns);
+
+  TEST_ASSERT_EQUAL_UINT32(4, flash.programs);
+  TEST_ASSERT_GREATER_OR_EQUAL(4 * 640000, time_ns);
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_MEMORY(page, flash.memory + 0x10000 + i * M25P16_PAGE_SIZE, M25P16_PAGE_SIZE);
+  }
+
+  uint8_t out[M25P16_PAGE_SIZE];
+  m25p16_read_addr(M25P16_READ_DATA_BYTES, 0x10000 + M25P16_PAGE_SIZE, out, M25P16_PAGE_SIZE);
+  TEST_ASSERT_EQUAL_MEMORY(page, out, M25P16_PAGE_SIZE);
+
+  target.flash = (target_spi_device_t){.port = SPI_PORT_INVALID, .nss = PIN_NONE};
+  spi_emulator_reset();
+}
+
+static sdcard_status_t spi_emulator_test_sdcard_wait() {
+  sdcard_status_t status = SDCARD_WAIT;
+  for (uint32_t loops = 0; status == SDCARD_WAIT && loops < EMULATOR_LOOPS; loops++) {
+    status = sdcard_update();
+  }
+  return status;
+}
+
+// Test the sdcard state machine through detection, a multi block write and read back
+void test_spi_emulator_sdcard(void) {
+  spi_emulator_test_init();
+  spi_emulator_sdcard_init(&card);
+  spi_emulator_attach(EMULATOR_PORT, PIN_B11, &card.dev);
+
+  target.sdcard = (target_spi_device_t){.port = EMULATOR_PORT, .nss = PIN_B11};
+  target.sdcard_detect.pin = PIN_NONE;
+  sdcard_init();
+
+  TEST_ASSERT_EQUAL(SDCARD_IDLE, spi_emulator_test_sdcard_wait());
+  TEST_ASSERT_TRUE(sdcard_info.high_capacity);
+
+  blackbox_device_bounds_t bounds;
+  sdcard_get_bounds(&bounds);
+  TEST_ASSERT_EQUAL_UINT32(SPI_EMULATOR_SDCARD_SIZE, bounds.total_size);
+
+  static uint8_t pages[4][SDCARD_PAGE_SIZE];
+  for (uint32_t i = 0; i < sizeof(pages); i++) {
+    pages[i / SDCARD_PAGE_SIZE][i % SDCARD_PAGE_SIZE] = (i * 13) >> 2;
+  }
+
+  const uint64_t start_ns = spi_emulator_time_ns();
+  while (!sdcard_write_pages_start(8, 4)) {
+    spi_emulator_test_sdcard_wait();
+  }
+  for (uint32_t i = 0; i < 4; i++) {
+    while (!sdcard_write_pages_continue(pages[i])) {
+      spi_emulator_test_sdcard_wait();
+    }
+  }
+  while (!sdcard_write_pages_finish()) {
+    spi_emulator_test_sdcard_wait();
+  }
+  spi_emulator_test_message("sdcard write", sizeof(pages), spi_emulator_time_ns() - start_ns);
+
+  TEST_ASSERT_EQUAL_UINT32(4, card.blocks_written);
+  TEST_ASSERT_EQUAL_MEMORY(pages, card.memory + 8 * SDCARD_PAGE_SIZE, sizeof(pages));
+
+  static uint8_t out[4][SDCARD_PAGE_SIZE];
+  while (!sdcard_read_pages((uint8_t *)out, 8, 4)) {
+    spi_emulator_test_sdcard_wait();
+  }
+  TEST_ASSERT_EQUAL_MEMORY(pages, out, sizeof(out));
+
+  target.sdcard = (target_spi_device_t){.port = SPI_PORT_INVALID, .nss = PIN_NONE};
+  spi_emulator_reset();
+}
+
+// Test strings pushed by the osd driver end up in display memory
+void test_spi_emulator_max7456(void) {
+  spi_emulator_test_init();
+  spi_emulator_max7456_init(&osd, 0x01);
+  spi_emulator_attach(EMULATOR_PORT, PIN_B10, &osd.dev);
+
+  target.osd = (target_spi_device_t){.port = EMULATOR_PORT, .nss = PIN_B10};
+  TEST_ASSERT_TRUE(max7456_init());
+  TEST_ASSERT_EQUAL_UINT8(0x08, osd.regs[VM0]);
+  TEST_ASSERT_EQUAL_UINT32(1, osd.clears);
+
+  const uint32_t bytes = osd.dev.bytes;
+  const uint8_t text[] = "HELLO";
+  TEST_ASSERT_TRUE(max7456_push_string(OSD_ATTR_TEXT, 3, 5, text, 5));
+  while (!max7456_is_ready())
+    ;
+
+  TEST_ASSERT_EQUAL_MEMORY(text, osd.display + 5 * MAX7456_COLS + 3, 5);
+  TEST_ASSERT_EQUAL_UINT8(0, osd.display[5 * MAX7456_COLS + 8]);
+  // address setup, two bytes per character and the terminator
+  TEST_ASSERT_EQUAL_UINT32(6 + 5 * 2 + 2, osd.dev.bytes - bytes);
+
+  target.osd = (target_spi_device_t){.port = SPI_PORT_INVALID, .nss = PIN_NONE};
+  spi_emulator_reset();
+}
+
+// Test the screen flush coalesces dirty spans into a single auto increment stream
+void test_spi_emulator_max7456_display(void) {
+  spi_emulator_test_init();
+  spi_emulator_max7456_init(&osd, 0x01);
+  spi_emulator_attach(EMULATOR_PORT, PIN_B10, &osd.dev);
+
+  target.osd = (target_spi_device_t){.port = EMULATOR_PORT, .nss = PIN_B10};
+  TEST_ASSERT_TRUE(max7456_init());
+  for (uint32_t i = 0; i < EMULATOR_LOOPS && max7456_check_system() != OSD_SYS_PAL; i++)
+    ;
+  while (!max7456_is_ready())
+    ;
+
+  static osd_char_t display[MAX7456_COLS * MAX7456_ROWS];
+  uint64_t dirty_rows[MAX7456_ROWS];
+
+  // full screen repaint
+  for (uint32_t i = 0; i < MAX7456_COLS * MAX7456_ROWS; i++) {
+    display[i] = (osd_char_t){.val = 'A' + i % 26, .attr = OSD_ATTR_TEXT};
+  }
+  for (uint32_t y = 0; y < MAX7456_ROWS; y++) {
+    dirty_rows[y] = (1ULL << MAX7456_COLS) - 1;
+  }
+
+  uint32_t bytes = osd.dev.bytes;
+  uint32_t selects = osd.dev.selects;
+  TEST_ASSERT_TRUE(max7456_push_display(display, dirty_rows, MAX7456_ROWS));
+  while (!max7456_is_ready())
+    ;
+
+  for (uint32_t i = 0; i < MAX7456_COLS * MAX7456_ROWS; i++) {
+    TEST_ASSERT_EQUAL_UINT8(display[i].val, osd.display[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT8(0, osd.regs[DMM] & 0x01);
+  // one address setup for the whole screen, one string per row takes 16 transactions and 1088 bytes
+  TEST_ASSERT_EQUAL_UINT32(1, osd.dev.selects - selects);
+  TEST_ASSERT_EQUAL_UINT32(6 + MAX7456_COLS * MAX7456_ROWS * 2 + 2, osd.dev.bytes - bytes);
+
+  // sparse updates with short gaps, an attribute change and a far jump
+  display[2 * MAX7456_COLS + 4].val = '1';
+  display[2 * MAX7456_COLS + 6].val = '2';
+  display[2 * MAX7456_COLS + 7] = (osd_char_t){.val = '3', .attr = OSD_ATTR_INVERT};
+  display[9 * MAX7456_COLS + 20].val = '4';
+  dirty_rows[2] = (1ULL << 4) | (1ULL << 6) | (1ULL << 7);
+  dirty_rows[9] = (1ULL << 20);
+
+  bytes = osd.dev.bytes;
+  selects = osd.dev.selects;
+  TEST_ASSERT_TRUE(max7456_push_display(display, dirty_rows, MAX7456_ROWS));
+  while (!max7456_is_ready())
+    ;
+
+  TEST_ASSERT_EQUAL_UINT32(0, dirty_rows[2] | dirty_rows[9]);
+  TEST_ASSERT_EQUAL_UINT8('1', osd.display[2 * MAX7456_COLS + 4]);
+  TEST_ASSERT_EQUAL_UINT8(display[2 * MAX7456_COLS + 5].val, osd.display[2 * MAX7456_COLS + 5]);
+  TEST_ASSERT_EQUAL_UINT8('2', osd.display[2 * MAX7456_COLS + 6]);
+  TEST_ASSERT_EQUAL_UINT8('3', osd.display[2 * MAX7456_COLS + 7]);
+  TEST_ASSERT_EQUAL_UINT8(INVERT >> 3, osd.attrs[2 * MAX7456_COLS + 7]);
+  TEST_ASSERT_EQUAL_UINT8(TEXT >> 3, osd.attrs[9 * MAX7456_COLS + 20]);
+  TEST_ASSERT_EQUAL_UINT8('4', osd.display[9 * MAX7456_COLS + 20]);
+  // setup, four characters plus one filled, two attribute changes, one new address and the terminator
+  TEST_ASSERT_EQUAL_UINT32(1, osd.dev.selects - selects);
+  TEST_ASSERT_EQUAL_UINT32(6 + 5 * 2 + 2 * 2 + 4 + 2, osd.dev.bytes - bytes);
+
+  target.osd = (target_spi_device_t){.port = SPI_PORT_INVALID, .nss = PIN_NONE};
+  spi_emulator_reset();
+}
+
+// Test register access and the fifo of the icm42688 model with the reads the gyro driver issues
+void test_spi_emulator_icm42688(void) {
+  spi_emulator_test_init();
+  spi_emulator_icm42688_init(&imu);
+  spi_emulator_attach(EMULATOR_PORT, PIN_C4, &imu.dev);
+
+  spi_bus_device_t bus = {
+      .port = EMULATOR_PORT,
+      .nss = PIN_C4,
+      .lane = SPI_LANE_REALTIME,
+      .mode = SPI_MODE_TRAILING_EDGE,
+      .hz = MHZ_TO_HZ(24),
+  };
+
+  uint8_t who_am_i[2] = {ICM42605_WHO_AM_I | 0x80, 0x00};
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_buffer(who_am_i, who_am_i, 2),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x47, who_am_i[1]);
+
+  {
+    // stream mode
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(ICM42605_FIFO_CONFIG, 0x40),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+
+  for (int16_t i = 0; i < 3; i++) {
+    const int16_t accel[3] = {100 + i, -200, 2048};
+    const int16_t gyro[3] = {-5 - i, 7, 300};
+    spi_emulator_icm42688_push(&imu, accel, gyro, 0);
+  }
+
+  uint8_t data[14];
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(ICM42605_TEMP_DATA1 | 0x80),
+        spi_make_seg_buffer(data, NULL, 14),
+    };
+    spi_seg_submit_continue(&bus, segs);
+  }
+  spi_txn_wait(&bus);
+  TEST_ASSERT_EQUAL_INT16(102, (int16_t)((data[2] << 8) | data[3]));
+  TEST_ASSERT_EQUAL_INT16(-7, (int16_t)((data[8] << 8) | data[9]));
+  TEST_ASSERT_EQUAL_INT16(300, (int16_t)((data[12] << 8) | data[13]));
+
+  uint8_t fifo[2 + 16];
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(ICM42605_FIFO_COUNTH | 0x80),
+        spi_make_seg_buffer(fifo, NULL, 2),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+  TEST_ASSERT_EQUAL_UINT16(3 * 16, (fifo[0] << 8) | fifo[1]);
+
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(ICM42605_FIFO_DATA | 0x80),
+        spi_make_seg_buffer(fifo + 2, NULL, 16),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x68, fifo[2]);
+  TEST_ASSERT_EQUAL_INT16(100, (int16_t)((fifo[3] << 8) | fifo[4]));
+  TEST_ASSERT_EQUAL_INT16(-5, (int16_t)((fifo[9] << 8) | fifo[10]));
+  TEST_ASSERT_EQUAL_UINT32(2 * 16, imu.fifo_count);
+
+  spi_emulator_reset();
+}
+
+static void spi_emulator_test_sx1280_read(spi_bus_device_t *bus, uint8_t cmd, uint8_t *data, uint8_t size) {
+  const spi_txn_segment_t segs[] = {
+      spi_make_seg_const(cmd, 0x00),
+      spi_make_seg_buffer(data, NULL, size),
+  };
+  spi_seg_submit_wait(bus, segs);
+}
+
+// Test a packet received by the sx1280 model is signalled and read back the way the elrs driver does
+void test_spi_emulator_sx1280(void) {
+  spi_emulator_test_init();
+  spi_emulator_sx1280_init(&radio);
+  spi_emulator_attach(EMULATOR_PORT, PIN_A15, &radio.dev);
+
+  spi_bus_device_t bus = {
+      .port = EMULATOR_PORT,
+      .nss = PIN_A15,
+      .mode = SPI_MODE_LEADING_EDGE,
+      .hz = MHZ_TO_HZ(10),
+  };
+
+  uint8_t version[2];
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(SX1280_RADIO_READ_REGISTER, 0x01, 0x53, 0x00),
+        spi_make_seg_buffer(version, NULL, 2),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0xA9, version[0]);
+
+  const uint8_t packet[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  TEST_ASSERT_FALSE(spi_emulator_sx1280_receive(&radio, packet, 8, -60));
+
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(SX1280_RADIO_SET_DIOIRQPARAMS),
+        spi_make_seg_const(0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(SX1280_RADIO_SET_RX, 0x02, 0xFF, 0xFF),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+
+  TEST_ASSERT_TRUE(spi_emulator_sx1280_receive(&radio, packet, 8, -60));
+  TEST_ASSERT_TRUE(spi_emulator_sx1280_dio1(&radio));
+
+  uint8_t irq[2];
+  spi_emulator_test_sx1280_read(&bus, SX1280_RADIO_GET_IRQSTATUS, irq, 2);
+  TEST_ASSERT_EQUAL_UINT16(SX1280_IRQ_RX_DONE, (irq[0] << 8) | irq[1]);
+
+  uint8_t buffer_status[2];
+  spi_emulator_test_sx1280_read(&bus, SX1280_RADIO_GET_RXBUFFERSTATUS, buffer_status, 2);
+  TEST_ASSERT_EQUAL_UINT8(8, buffer_status[0]);
+
+  uint8_t payload[8];
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(SX1280_RADIO_READ_BUFFER, buffer_status[1], 0x00),
+        spi_make_seg_buffer(payload, NULL, 8),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, payload, 8);
+
+  uint8_t packet_status[2];
+  spi_emulator_test_sx1280_read(&bus, SX1280_RADIO_GET_PACKETSTATUS, packet_status, 2);
+  TEST_ASSERT_EQUAL_INT8(-60, -(packet_status[0] / 2));
+
+  {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(SX1280_RADIO_CLR_IRQSTATUS, 0xFF, 0xFF),
+    };
+    spi_seg_submit_wait(&bus, segs);
+  }
+  TEST_ASSERT_FALSE(spi_emulator_sx1280_dio1(&radio));
+
+  spi_emulator_reset();
+}
+
+static uint64_t spi_emulator_test_isr_run(spi_bus_device_t *bus, uint32_t latency_ns) {
+  spi_emulator_test_init();
+  spi_emulator_max7456_init(&osd, 0x01);
+  spi_emulator_attach(EMULATOR_PORT, PIN_B10, &osd.dev);
+  spi_emulator_set_isr_latency(latency_ns);
+
+  for (uint32_t i = 0; i < 16; i++) {
+    const spi_txn_segment_t segs[] = {
+        spi_make_seg_const(VM1, i),
+    };
+    spi_seg_submit(bus, segs);
+  }
+  spi_txn_wait(bus);
+
+  const uint64_t time_ns = spi_emulator_time_ns();
+  spi_emulator_reset();
+  return time_ns;
+}
+
+// Test every transaction waits for its isr, and that advancing time fires it
+void test_spi_emulator_isr_latency(void) {
+  spi_bus_device_t bus = {
+      .port = EMULATOR_PORT,
+      .nss = PIN_B10,
+      .lane = SPI_LANE_BULK,
+      .mode = SPI_MODE_LEADING_EDGE,
+      .hz = MHZ_TO_HZ(8),
+  };
+
+  // two bytes at 8mhz each
+  TEST_ASSERT_EQUAL_UINT32(16 * 2000, (uint32_t)spi_emulator_test_isr_run(&bus, 0));
+  TEST_ASSERT_EQUAL_UINT32(16 * (2000 + 5000), (uint32_t)spi_emulator_test_isr_run(&bus, 5000));
+
+  spi_emulator_test_init();
+  spi_emulator_max7456_init(&osd, 0x01);
+  spi_emulator_attach(EMULATOR_PORT, PIN_B10, &osd.dev);
+  spi_emulator_set_isr_latency(5000);
+
+  const spi_txn_segment_t segs[] = {
+      spi_make_seg_const(VM1, 0x0C),
+  };
+  spi_seg_submit(&bus, segs);
+  TEST_ASSERT_TRUE(spi_txn_continue_port(EMULATOR_PORT));
+  TEST_ASSERT_EQUAL_UINT8(0x0C, osd.regs[VM1]);
+
+  spi_emulator_advance(6);
+  TEST_ASSERT_FALSE(spi_txn_ready(&bus));
+  spi_emulator_advance(1);
+  TEST_ASSERT_TRUE(spi_txn_ready(&bus));
+  TEST_ASSERT_EQUAL_UINT32(7000, (uint32_t)spi_emulator_time_ns());
+
+  spi_emulator_reset();
+}